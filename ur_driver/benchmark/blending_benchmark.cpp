@@ -0,0 +1,130 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Benchmarks for the blend radius optimization
+// ----------------------------------------------------------------------------
+
+#include <benchmark/benchmark.h>
+
+#include <blending.h>
+
+#include <math.h>
+
+using namespace ur_driver;
+
+/**
+ * Dense TCP path: a wave in the xy plane (amplitude 5 cm, wavelength 20 cm) sampled every 5 mm along x.
+ * @param count Waypoints
+ * @return positions of the start and the waypoints
+ */
+static std::vector<double> createDensePath(int count)
+{
+    std::vector<double> positions;
+    for (int i = 0; i <= count; i++)
+    {
+        double x = 0.005 * i;
+        positions.push_back(0.4 + x);
+        positions.push_back(0.05 * sin(2 * M_PI * x / 0.2));
+        positions.push_back(0.3);
+    }
+
+    return positions;
+}
+
+/**
+ * Count the segments whose blends overlap.
+ * @param positions
+ * @param radii
+ * @return
+ */
+static int countOverlaps(const std::vector<double>& positions, const std::vector<double>& radii)
+{
+    int overlaps = 0;
+    for (size_t i = 0; i < radii.size(); i++)
+    {
+        double length = sqrt(pow(positions[(i + 1) * 3] - positions[i * 3], 2) + pow(positions[(i + 1) * 3 + 1] - positions[i * 3 + 1], 2) + pow(positions[(i + 1) * 3 + 2] - positions[i * 3 + 2], 2));
+        double before = (i > 0) ? radii[i - 1] : 0.0;
+        if (before + radii[i] > length)
+        {
+            overlaps++;
+        }
+    }
+
+    return overlaps;
+}
+
+/**
+ * Optimizing the radii of a dense path of 10000 waypoints.
+ */
+static void BM_BlendOptimizer(benchmark::State& state)
+{
+    std::vector<double> positions = createDensePath(10000);
+    BlendOptimizer optimizer;
+    optimizer.setTolerance(0.005);
+
+    while (state.KeepRunning())
+    {
+        std::vector<double> radii(10000, 0.001);
+        benchmark::DoNotOptimize(optimizer.optimize(positions, radii));
+    }
+}
+BENCHMARK(BM_BlendOptimizer);
+
+//=================================================================
+// cycle time (counters, one iteration)
+//=================================================================
+/**
+ * Cycle time of the dense path of 200 waypoints (1 m along x) with LIN moves of 0.25 m/s and 1.2 m/s^2 [s]:
+ * - handTuned: blend radius 1 mm at each waypoint
+ * - optimized: radii optimized for a deviation of at most 5 mm
+ * The gain is the factor of the cycle times. overlapsHandTuned5mm counts the segments whose blends overlap with a
+ * radius of 5 mm at each waypoint (the controller aborts the program), overlapsOptimized after the optimization.
+ */
+static void BM_DensePathCycleTime(benchmark::State& state)
+{
+    std::vector<double> positions = createDensePath(200);
+    std::vector<double> velocities(200, 0.25);
+    std::vector<double> accelerations(200, 1.2);
+    std::vector<double> durations;
+
+    double handTuned = 0;
+    double optimized = 0;
+    int overlapsHandTuned = 0;
+    int overlapsOptimized = 0;
+
+    while (state.KeepRunning())
+    {
+        std::vector<double> radii(200, 0.001);
+        radii.back() = 0;
+        handTuned = BlendedMoveEstimator::estimate(positions, 3, velocities, accelerations, radii, durations);
+
+        radii.assign(200, 0.005);
+        radii.back() = 0;
+        overlapsHandTuned = countOverlaps(positions, radii);
+
+        BlendOptimizer optimizer;
+        optimizer.setTolerance(0.005);
+        optimizer.optimize(positions, radii);
+        overlapsOptimized = countOverlaps(positions, radii);
+        optimized = BlendedMoveEstimator::estimate(positions, 3, velocities, accelerations, radii, durations);
+    }
+
+    state.counters["handTuned"] = handTuned;
+    state.counters["optimized"] = optimized;
+    state.counters["gain"] = handTuned / optimized;
+    state.counters["overlapsHandTuned5mm"] = overlapsHandTuned;
+    state.counters["overlapsOptimized"] = overlapsOptimized;
+}
+BENCHMARK(BM_DensePathCycleTime)->Iterations(1);
@@ -0,0 +1,114 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Benchmarks for formatting the scripts sent to the robot controller
+// ----------------------------------------------------------------------------
+
+#include <benchmark/benchmark.h>
+
+#include <command.h>
+
+#include <vector>
+
+using namespace ur_driver;
+
+static JointValue createJointPosition()
+{
+    JointValue position(6);
+    for (int i = 0; i < 6; i++)
+    {
+        position[i] = 0.1 * i;
+    }
+
+    return position;
+}
+
+static CartesianValue createCartesianPosition()
+{
+    CartesianValue position;
+    position.setValues(0.4, -0.1, 0.3, 3.1, 0.1, -0.2);
+
+    return position;
+}
+
+static void BM_CommandLinJointBlending(benchmark::State& state)
+{
+    JointValue position = createJointPosition();
+
+    while (state.KeepRunning())
+    {
+        CommandLinJointBlending command(position, 0.5, 1.0, 0.01);
+        benchmark::DoNotOptimize(command.getCommandString());
+    }
+}
+BENCHMARK(BM_CommandLinJointBlending);
+
+static void BM_CommandPtpJointBlending(benchmark::State& state)
+{
+    JointValue position = createJointPosition();
+
+    while (state.KeepRunning())
+    {
+        CommandPtpJointBlending command(position, 0.5, 1.0, 0.01);
+        benchmark::DoNotOptimize(command.getCommandString());
+    }
+}
+BENCHMARK(BM_CommandPtpJointBlending);
+
+static void BM_CommandLinCartesianBlending(benchmark::State& state)
+{
+    CartesianValue position = createCartesianPosition();
+
+    while (state.KeepRunning())
+    {
+        CommandLinCartesianBlending command(position, 0.5, 1.0, 0.01);
+        benchmark::DoNotOptimize(command.getCommandString());
+    }
+}
+BENCHMARK(BM_CommandLinCartesianBlending);
+
+static void BM_CommandLinJointTimed(benchmark::State& state)
+{
+    JointValue position = createJointPosition();
+
+    while (state.KeepRunning())
+    {
+        CommandLinJointTimed command(position, 0.5, 1.0, 0.01, 2.0);
+        benchmark::DoNotOptimize(command.getCommandString());
+    }
+}
+BENCHMARK(BM_CommandLinJointTimed);
+
+/**
+ * Concatenation of a command list into one script. The argument is the number of commands.
+ */
+static void BM_CommandMultiCommand(benchmark::State& state)
+{
+    JointValue position = createJointPosition();
+    std::vector<Command> commands(state.range(0));
+    for (size_t i = 0; i < commands.size(); i++)
+    {
+        commands[i] = CommandLinJointBlending(position, 0.5, 1.0, 0.01);
+    }
+
+    while (state.KeepRunning())
+    {
+        CommandMultiCommand command(&commands[0], commands.size());
+        benchmark::DoNotOptimize(command.getCommandString());
+    }
+
+    state.SetItemsProcessed(state.iterations() * commands.size());
+}
+BENCHMARK(BM_CommandMultiCommand)->Arg(1)->Arg(10)->Arg(100)->Arg(1000);
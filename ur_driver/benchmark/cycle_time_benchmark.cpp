@@ -0,0 +1,102 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Benchmarks for the cycle time estimation of command lists
+// ----------------------------------------------------------------------------
+
+#include <benchmark/benchmark.h>
+
+#include <cycle_time.h>
+#include <command.h>
+#include <kinematics.h>
+
+#include <math.h>
+
+using namespace ur_driver;
+
+/**
+ * Pick and place cycles: a joint move above the pick, two linear moves down and up, a joint move above the place and
+ * two linear moves down and up. Blend radius 2 cm above the parts.
+ * @param estimator
+ * @param cycles
+ */
+static void addPickAndPlace(CycleTimeEstimator& estimator, int cycles)
+{
+    double pick[6] = {0.0, -1.57, 1.57, -1.57, -1.57, 0.0};
+    double place[6] = {1.2, -1.4, 1.3, -1.47, -1.57, 0.0};
+
+    for (int i = 0; i < cycles; i++)
+    {
+        double* joints[2] = {pick, place};
+        for (int k = 0; k < 2; k++)
+        {
+            double above[6];
+            double down[6];
+            Kinematics::forward(Kinematics::UR5, joints[k], above);
+            std::copy(above, above + 3, down);
+            down[2] -= 0.1;
+
+            estimator.addJoint(joints[k], above, 1.05, 1.4, 0.02);
+            estimator.addLinear(down, NULL, 0.25, 1.2, 0);
+            estimator.addLinear(above, joints[k], 0.25, 1.2, 0.02);
+        }
+    }
+}
+
+/**
+ * Estimating a list of 100000 commands.
+ */
+static void BM_CycleTimeEstimate(benchmark::State& state)
+{
+    double start[6] = {0.0, -1.57, 1.57, -1.57, -1.57, 0.0};
+    double tcp[6];
+    Kinematics::forward(Kinematics::UR5, start, tcp);
+    CycleTimeEstimator estimator;
+    std::vector<double> durations;
+
+    double total = 0;
+    while (state.KeepRunning())
+    {
+        estimator.reset(start, tcp);
+        addPickAndPlace(estimator, 100000 / 6);
+        total = estimator.estimate(durations);
+    }
+
+    state.counters["commands"] = estimator.getCount();
+    state.counters["total"] = total;
+}
+BENCHMARK(BM_CycleTimeEstimate)->Unit(benchmark::kMillisecond);
+
+/**
+ * Building the script of 100000 commands, which validates each command of an estimated list.
+ */
+static void BM_CycleTimeValidation(benchmark::State& state)
+{
+    JointValue position(6);
+    for (int i = 0; i < 6; i++)
+    {
+        position[i] = 0.1 * i;
+    }
+
+    while (state.KeepRunning())
+    {
+        for (int i = 0; i < 100000; i++)
+        {
+            CommandPtpJointBlending command(position, 1.05, 1.4, 0.02);
+            benchmark::DoNotOptimize(command.getCommandString());
+        }
+    }
+}
+BENCHMARK(BM_CycleTimeValidation)->Unit(benchmark::kMillisecond);
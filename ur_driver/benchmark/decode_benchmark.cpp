@@ -0,0 +1,187 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Benchmarks for decoding the data received from the robot controller
+// ----------------------------------------------------------------------------
+
+#include <benchmark/benchmark.h>
+
+#include <connector.h>
+#include <dummy.h>
+
+#include <string.h>
+#include <vector>
+
+using namespace ur_driver;
+
+/**
+ * Robot state frame of port 30003 with a joint position and tool pose set.
+ */
+static std::vector<char> createRealtimeFrame()
+{
+    Packet_port30003 packet;
+    memset(&packet, 0, sizeof(packet));
+    for (int i = 0; i < 6; i++)
+    {
+        packet.q_act[i] = 0.1 * i;
+        packet.qd_act[i] = 0.01 * i;
+        packet.tool_pose[i] = 0.2 * i;
+    }
+    //swapping twice is the identity, the same function converts to big endian
+    packet.fixByteOrder();
+
+    uint32_t frameSize = htobe32(4 + sizeof(packet));
+    std::vector<char> frame(4 + sizeof(packet));
+    memcpy(&frame[0], &frameSize, 4);
+    memcpy(&frame[4], &packet, sizeof(packet));
+
+    return frame;
+}
+
+/**
+ * Counts the robot states received from the connector.
+ */
+class BenchmarkListener
+{
+    public:
+        unsigned long robotStates;
+
+        BenchmarkListener() :
+            robotStates(0)
+        {
+        }
+
+        void robotStateListener(const RobotState& robotState)
+        {
+            robotStates++;
+        }
+};
+
+static void BM_DecodeSecondary(benchmark::State& state)
+{
+    std::string frame = Dummy::createRobotStateFrame();
+    std::vector<char> buffer(frame.size());
+
+    while (state.KeepRunning())
+    {
+        //the frame is decoded in place, therefore each iteration starts with a copy
+        memcpy(&buffer[0], frame.data(), frame.size());
+
+        RobotState robotState;
+        benchmark::DoNotOptimize(Connector::decodeSecondary(&buffer[4], buffer.size() - 4, robotState));
+    }
+
+    state.SetBytesProcessed(state.iterations() * frame.size());
+}
+BENCHMARK(BM_DecodeSecondary);
+
+static void BM_DecodeRealtime(benchmark::State& state)
+{
+    std::vector<char> frame = createRealtimeFrame();
+
+    while (state.KeepRunning())
+    {
+        RobotState robotState;
+        benchmark::DoNotOptimize(Connector::decodeRealtime(&frame[4], frame.size() - 4, robotState));
+    }
+
+    state.SetBytesProcessed(state.iterations() * frame.size());
+}
+BENCHMARK(BM_DecodeRealtime);
+
+/**
+ * Frame assembly, decoding and listener notification. The argument is the size of the chunks the stream is split into.
+ */
+static void BM_ProcessDataSecondary(benchmark::State& state)
+{
+    std::string frame = Dummy::createRobotStateFrame();
+    std::string stream;
+    for (int i = 0; i < 16; i++)
+    {
+        stream += frame;
+    }
+
+    size_t chunkSize = state.range(0);
+
+    Connector connector;
+    BenchmarkListener listener;
+    connector.addRobotStateListener(&BenchmarkListener::robotStateListener, &listener);
+
+    while (state.KeepRunning())
+    {
+        for (size_t offset = 0; offset < stream.size(); offset += chunkSize)
+        {
+            connector.processData(Connector::SECONDARY, stream.data() + offset, std::min(chunkSize, stream.size() - offset));
+        }
+    }
+
+    connector.removeRobotStateListener(&BenchmarkListener::robotStateListener, &listener);
+
+    state.SetBytesProcessed(state.iterations() * stream.size());
+    state.SetItemsProcessed(listener.robotStates);
+}
+BENCHMARK(BM_ProcessDataSecondary)->Arg(64)->Arg(465)->Arg(4096);
+
+static void BM_ProcessDataRealtime(benchmark::State& state)
+{
+    std::vector<char> frame = createRealtimeFrame();
+
+    Connector connector;
+    BenchmarkListener listener;
+    connector.addRobotStateListener(&BenchmarkListener::robotStateListener, &listener);
+
+    while (state.KeepRunning())
+    {
+        connector.processData(Connector::REALTIME, &frame[0], frame.size());
+    }
+
+    connector.removeRobotStateListener(&BenchmarkListener::robotStateListener, &listener);
+
+    state.SetBytesProcessed(state.iterations() * frame.size());
+    state.SetItemsProcessed(listener.robotStates);
+}
+BENCHMARK(BM_ProcessDataRealtime);
+
+static void BM_ByteSwapDouble(benchmark::State& state)
+{
+    std::vector<double> values(1024, 1.5);
+
+    while (state.KeepRunning())
+    {
+        for (size_t i = 0; i < values.size(); i++)
+        {
+            values[i] = bedtoh(values[i]);
+        }
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed(state.iterations() * values.size() * sizeof(double));
+}
+BENCHMARK(BM_ByteSwapDouble);
+
+static void BM_ByteSwapPacket30003(benchmark::State& state)
+{
+    Packet_port30003 packet;
+    memset(&packet, 0, sizeof(packet));
+
+    while (state.KeepRunning())
+    {
+        packet.fixByteOrder();
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed(state.iterations() * sizeof(packet));
+}
+BENCHMARK(BM_ByteSwapPacket30003);
@@ -0,0 +1,137 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Benchmarks for the driver logic per robot state
+// ----------------------------------------------------------------------------
+
+#include <benchmark/benchmark.h>
+
+#include <driver.h>
+
+#include <stdlib.h>
+#include <new>
+
+using namespace ur_driver;
+
+/*
+ * count heap allocations of the benchmark process to verify the allocation free paths (also used by the other
+ * benchmark files)
+ */
+unsigned long allocations = 0;
+
+void* operator new(size_t size)
+{
+    __sync_fetch_and_add(&allocations, 1);
+
+    void* p = malloc(size == 0 ? 1 : size);
+    if (p == NULL)
+    {
+        throw std::bad_alloc();
+    }
+
+    return p;
+}
+
+void operator delete(void* p) throw()
+{
+    free(p);
+}
+
+static RobotState createRobotState()
+{
+    JointPosition jointPosition(6);
+    JointVelocity jointVelocity(6);
+    for (int i = 0; i < 6; i++)
+    {
+        jointPosition[i] = 0.1 * i;
+        jointVelocity[i] = 0.01 * i;
+    }
+
+    CartesianPosition cartesianPosition;
+    cartesianPosition.setValues(0.4, -0.1, 0.3, 3.1, 0.1, -0.2);
+
+    return RobotState(jointPosition, jointVelocity, cartesianPosition);
+}
+
+static void BM_IsCommandFinishedJoints(benchmark::State& state)
+{
+    RobotState robotState = createRobotState();
+
+    robot_movement_interface::Command command;
+    command.pose_type = "JOINTS";
+    command.pose.resize(6, 0.1);
+    command.blending.resize(2, 0.01);
+
+    int result;
+    while (state.KeepRunning())
+    {
+        benchmark::DoNotOptimize(Driver::isCommandFinished(command, robotState, &result));
+    }
+}
+BENCHMARK(BM_IsCommandFinishedJoints);
+
+static void BM_IsCommandFinishedEuler(benchmark::State& state)
+{
+    RobotState robotState = createRobotState();
+
+    robot_movement_interface::Command command;
+    command.pose_type = "EULER_INTRINSIC_ZYX";
+    command.pose.resize(6, 0.1);
+    command.blending.resize(2, 0.01);
+
+    int result;
+    while (state.KeepRunning())
+    {
+        benchmark::DoNotOptimize(Driver::isCommandFinished(command, robotState, &result));
+    }
+}
+BENCHMARK(BM_IsCommandFinishedEuler);
+
+/**
+ * Filling a preallocated joint state message must not allocate. The allocations counter is reported per iteration.
+ */
+static void BM_FillJointState(benchmark::State& state)
+{
+    RobotState robotState = createRobotState();
+
+    sensor_msgs::JointState jointState;
+    jointState.name.resize(6);
+    jointState.position.resize(6);
+    jointState.velocity.resize(6);
+    ros::Time stamp;
+
+    unsigned long allocationsBefore = allocations;
+    while (state.KeepRunning())
+    {
+        Driver::fillJointState(robotState, stamp, jointState);
+        benchmark::ClobberMemory();
+    }
+
+    state.counters["allocations"] = benchmark::Counter(allocations - allocationsBefore, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_FillJointState);
+
+static void BM_FillPoseState(benchmark::State& state)
+{
+    RobotState robotState = createRobotState();
+    geometry_msgs::Pose poseState;
+
+    while (state.KeepRunning())
+    {
+        Driver::fillPoseState(robotState, poseState);
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_FillPoseState);
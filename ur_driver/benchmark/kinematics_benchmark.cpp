@@ -0,0 +1,231 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Benchmarks of the closed form UR kinematics against the product of DH transformations
+// ----------------------------------------------------------------------------
+
+#include <benchmark/benchmark.h>
+
+#include <kinematics.h>
+#include <waypoints.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace ur_driver;
+
+//=================================================================
+// reference: product of the six DH transformations
+//=================================================================
+template <typename Parameters>
+static void dhForward(const double* q, double* rotation, double* position)
+{
+    const double alpha[6] = {M_PI_2, 0, 0, M_PI_2, -M_PI_2, 0};
+    const double a[6] = {0, Parameters::a2(), Parameters::a3(), 0, 0, 0};
+    const double d[6] = {Parameters::d1(), 0, 0, Parameters::d4(), Parameters::d5(), Parameters::d6()};
+
+    double transform[3][4] = {{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}};
+    for (int i = 0; i < 6; i++)
+    {
+        double ct = std::cos(q[i]);
+        double st = std::sin(q[i]);
+        double ca = std::cos(alpha[i]);
+        double sa = std::sin(alpha[i]);
+        double link[3][4] = {{ct, -st * ca, st * sa, a[i] * ct}, {st, ct * ca, -ct * sa, a[i] * st}, {0, sa, ca, d[i]}};
+
+        double product[3][4];
+        for (int row = 0; row < 3; row++)
+        {
+            for (int column = 0; column < 4; column++)
+            {
+                product[row][column] = transform[row][0] * link[0][column] + transform[row][1] * link[1][column] + transform[row][2] * link[2][column];
+            }
+            product[row][3] += transform[row][3];
+        }
+        std::copy(&product[0][0], &product[0][0] + 12, &transform[0][0]);
+    }
+
+    for (int row = 0; row < 3; row++)
+    {
+        rotation[row * 3] = transform[row][0];
+        rotation[row * 3 + 1] = transform[row][1];
+        rotation[row * 3 + 2] = transform[row][2];
+        position[row] = transform[row][3];
+    }
+}
+
+//=================================================================
+// samples
+//=================================================================
+static const size_t SAMPLE_COUNT = 1024;
+
+/**
+ * Random joint positions in [-2 pi, 2 pi].
+ */
+static JointBatch createJointSamples()
+{
+    unsigned int seed = 42;
+    JointBatch joints;
+    joints.resize(SAMPLE_COUNT);
+
+    for (size_t i = 0; i < SAMPLE_COUNT; i++)
+    {
+        for (int j = 0; j < 6; j++)
+        {
+            joints.q[j][i] = (-1.0 + 2.0 * rand_r(&seed) / (double)RAND_MAX) * 2 * M_PI;
+        }
+    }
+
+    return joints;
+}
+
+//=================================================================
+// throughput of 1024 poses per iteration
+//=================================================================
+static void BM_DhForward(benchmark::State& state)
+{
+    JointBatch joints = createJointSamples();
+    std::vector<double> result(SAMPLE_COUNT * 12);
+
+    while (state.KeepRunning())
+    {
+        for (size_t i = 0; i < SAMPLE_COUNT; i++)
+        {
+            double q[6] = {joints.q[0][i], joints.q[1][i], joints.q[2][i], joints.q[3][i], joints.q[4][i], joints.q[5][i]};
+            dhForward<Ur5Parameters>(q, &result[i * 12], &result[i * 12 + 9]);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * SAMPLE_COUNT);
+}
+BENCHMARK(BM_DhForward);
+
+static void BM_Ur5ForwardMatrix(benchmark::State& state)
+{
+    JointBatch joints = createJointSamples();
+    std::vector<double> result(SAMPLE_COUNT * 12);
+
+    while (state.KeepRunning())
+    {
+        for (size_t i = 0; i < SAMPLE_COUNT; i++)
+        {
+            double q[6] = {joints.q[0][i], joints.q[1][i], joints.q[2][i], joints.q[3][i], joints.q[4][i], joints.q[5][i]};
+            Ur5Kinematics::forward(q, &result[i * 12], &result[i * 12 + 9]);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * SAMPLE_COUNT);
+}
+BENCHMARK(BM_Ur5ForwardMatrix);
+
+/**
+ * Poses like the controller (axis angle) through the runtime dispatch, the path of the driver.
+ */
+static void BM_KinematicsForward(benchmark::State& state)
+{
+    Kinematics::Model model = (Kinematics::Model)state.range(0);
+    JointBatch joints = createJointSamples();
+    std::vector<double> result(SAMPLE_COUNT * 6);
+
+    while (state.KeepRunning())
+    {
+        for (size_t i = 0; i < SAMPLE_COUNT; i++)
+        {
+            double q[6] = {joints.q[0][i], joints.q[1][i], joints.q[2][i], joints.q[3][i], joints.q[4][i], joints.q[5][i]};
+            Kinematics::forward(model, q, &result[i * 6]);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * SAMPLE_COUNT);
+}
+BENCHMARK(BM_KinematicsForward)->Arg(Kinematics::UR5)->Arg(Kinematics::UR10);
+
+static void BM_KinematicsBatchForward(benchmark::State& state)
+{
+    Kinematics::Model model = (Kinematics::Model)state.range(0);
+    JointBatch joints = createJointSamples();
+    PoseBatch poses;
+
+    while (state.KeepRunning())
+    {
+        Kinematics::forward(model, joints, poses);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * SAMPLE_COUNT);
+}
+BENCHMARK(BM_KinematicsBatchForward)->Arg(Kinematics::UR5)->Arg(Kinematics::UR10);
+
+/**
+ * All solutions of the flange poses of the samples.
+ */
+static void BM_Ur5Inverse(benchmark::State& state)
+{
+    JointBatch joints = createJointSamples();
+    std::vector<double> rotations(SAMPLE_COUNT * 9);
+    std::vector<double> positions(SAMPLE_COUNT * 3);
+    for (size_t i = 0; i < SAMPLE_COUNT; i++)
+    {
+        double q[6] = {joints.q[0][i], joints.q[1][i], joints.q[2][i], joints.q[3][i], joints.q[4][i], joints.q[5][i]};
+        Ur5Kinematics::forward(q, &rotations[i * 9], &positions[i * 3]);
+    }
+
+    std::vector<InverseSolutions> solutions(SAMPLE_COUNT);
+    while (state.KeepRunning())
+    {
+        for (size_t i = 0; i < SAMPLE_COUNT; i++)
+        {
+            Ur5Kinematics::inverse(&rotations[i * 9], &positions[i * 3], 0.0, solutions[i]);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * SAMPLE_COUNT);
+}
+BENCHMARK(BM_Ur5Inverse);
+
+/**
+ * Waypoints of a long program: poses along a random joint walk, linear moves. The argument is the number of threads.
+ */
+static void BM_WaypointSolver(benchmark::State& state)
+{
+    const size_t count = 16 * SAMPLE_COUNT;
+    unsigned int seed = 42;
+    double q[6] = {0.3, -1.2, 1.5, -1.9, -1.4, 0.2};
+    double start[6];
+    std::copy(q, q + 6, start);
+
+    std::vector<Waypoint> waypoints(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        for (int j = 0; j < 6; j++)
+        {
+            q[j] += 0.002 * (-1.0 + 2.0 * rand_r(&seed) / (double)RAND_MAX);
+        }
+        double pose[6];
+        Ur5Kinematics::forward(q, pose);
+        waypoints[i].setPose(pose, true);
+    }
+
+    WaypointSolver solver(Kinematics::UR5, state.range(0));
+    std::vector<WaypointSolution> solutions;
+    int rejected = -1;
+    while (state.KeepRunning())
+    {
+        rejected = solver.solve(waypoints, start, solutions);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+    state.counters["rejected"] = rejected;
+}
+BENCHMARK(BM_WaypointSolver)->Arg(1)->Arg(2)->Arg(4)->UseRealTime();
@@ -0,0 +1,164 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Benchmarks for the move stream
+// ----------------------------------------------------------------------------
+
+#include <benchmark/benchmark.h>
+
+#include <move_stream.h>
+#include <simulator.h>
+
+#include <math.h>
+#include <stdio.h>
+
+using namespace ur_driver;
+
+/**
+ * Controller cycle of the replanning simulation [s].
+ */
+static const double CYCLE = 0.008;
+
+/**
+ * Create a joint move of the first joint.
+ * @param position [rad]
+ * @param radius
+ * @return
+ */
+static ScriptInstruction createMove(double position, double radius)
+{
+    char line[256];
+    snprintf(line, sizeof(line), "movej([%f, 0, 0, 0, 0, 0], a=1.4, v=1.05, r=%f)", position, radius);
+
+    ScriptInstruction instruction;
+    ScriptParser::parseInstruction(line, instruction);
+
+    return instruction;
+}
+
+/**
+ * Encoding and decoding a move frame.
+ */
+static void BM_MoveFrame(benchmark::State& state)
+{
+    StreamedMove move;
+    move.type = MOVE_PROCESS_POSE;
+    move.target[0] = 0.4;
+    move.target[3] = 3.1;
+    move.acceleration = 1.2;
+    move.velocity = 0.25;
+    move.radius = 0.01;
+    char frame[MOVE_FRAME_SIZE];
+
+    while (state.KeepRunning())
+    {
+        MoveStreamServer::encodeMove(move, 1, frame);
+        benchmark::DoNotOptimize(MoveStreamServer::decodeMove(frame, move));
+    }
+}
+BENCHMARK(BM_MoveFrame);
+
+//=================================================================
+// replanning (counters, one iteration)
+//=================================================================
+/**
+ * Replanning a move of the first joint through 0.5, 1.0, 1.5 and 2.0 rad (blend radius 0.1) after 0.6 s with a new
+ * list through 2.5 and 3.0 rad, simulated with the controller cycle [s]:
+ * - aborted: the new list is sent as a program, the running program is aborted (stopj) before the new moves
+ * - streamed: the moves are streamed like by the move program, the running move and the next one are committed and
+ *   the new list replaces the others
+ * The times are until the robot rests at 3.0 rad, minSpeed is the lowest speed between 0.3 rad and the
+ * deceleration at the final target [rad/s].
+ */
+static void BM_ReplanCycleTime(benchmark::State& state)
+{
+    double times[2] = {0, 0};
+    double minSpeeds[2] = {0, 0};
+
+    while (state.KeepRunning())
+    {
+        for (int mode = 0; mode < 2; mode++)
+        {
+            Simulator simulator;
+            simulator.reset(std::vector<double>(6, 0.0), std::vector<double>(6, 0.0));
+
+            std::vector<ScriptInstruction> moves;
+            moves.push_back(createMove(0.5, 0.1));
+            moves.push_back(createMove(1.0, 0.1));
+            moves.push_back(createMove(1.5, 0.1));
+            moves.push_back(createMove(2.0, 0));
+            size_t next = 0;
+            if (mode == 0)
+            {
+                simulator.execute(moves);
+            }
+
+            double time = 0;
+            double last = 0;
+            double minSpeed = 1e9;
+            simulator.update(time);
+            while (time < 20)
+            {
+                if (fabs(time - 0.6) < CYCLE / 2)
+                {
+                    std::vector<ScriptInstruction> tail;
+                    tail.push_back(createMove(2.5, 0.1));
+                    tail.push_back(createMove(3.0, 0));
+                    if (mode == 0)
+                    {
+                        tail.insert(tail.begin(), ScriptInstruction());
+                        ScriptParser::parseInstruction("stopj(1.4)", tail[0]);
+                        simulator.execute(tail);
+                    }
+                    else
+                    {
+                        moves.resize(next);
+                        moves.insert(moves.end(), tail.begin(), tail.end());
+                    }
+                }
+
+                //the program reads the next move when the active one has no successor
+                if (mode == 1 && next < moves.size() && !simulator.isMotionQueued())
+                {
+                    simulator.append(moves[next++]);
+                }
+
+                time += CYCLE;
+                simulator.update(time);
+
+                double position = simulator.getJointPosition()[0];
+                if (position > 0.3 && position < 2.9)
+                {
+                    minSpeed = std::min(minSpeed, fabs(position - last) / CYCLE);
+                }
+                last = position;
+                if (time > 0.1 && !simulator.isProgramRunning())
+                {
+                    break;
+                }
+            }
+
+            times[mode] = time;
+            minSpeeds[mode] = minSpeed;
+        }
+    }
+
+    state.counters["aborted"] = times[0];
+    state.counters["streamed"] = times[1];
+    state.counters["saved"] = times[0] - times[1];
+    state.counters["minSpeedAborted"] = minSpeeds[0];
+    state.counters["minSpeedStreamed"] = minSpeeds[1];
+}
+BENCHMARK(BM_ReplanCycleTime)->Iterations(1);
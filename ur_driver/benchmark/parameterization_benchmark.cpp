@@ -0,0 +1,144 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Benchmarks for the time optimal retiming of joint waypoint lists
+// ----------------------------------------------------------------------------
+
+#include <benchmark/benchmark.h>
+
+#include <parameterization.h>
+
+#include <math.h>
+#include <algorithm>
+
+using namespace ur_driver;
+
+/*
+ * pick and place cycle of a UR10 in joint space: home, above the pick, pick, above the pick, above the place, place,
+ * above the place, home. The robot stops at the pick, the place and home.
+ */
+static const int PICK_AND_PLACE_POINTS = 8;
+static const double PICK_AND_PLACE[PICK_AND_PLACE_POINTS][6] = {
+    { 0.0, -1.57, 1.57, -1.57, -1.57, 0.0 },
+    { 0.6, -1.20, 1.70, -2.07, -1.57, 0.6 },
+    { 0.6, -1.05, 1.85, -2.37, -1.57, 0.6 },
+    { 0.6, -1.20, 1.70, -2.07, -1.57, 0.6 },
+    { -0.9, -1.30, 1.60, -1.87, -1.57, -0.9 },
+    { -0.9, -1.12, 1.80, -2.25, -1.57, -0.9 },
+    { -0.9, -1.30, 1.60, -1.87, -1.57, -0.9 },
+    { 0.0, -1.57, 1.57, -1.57, -1.57, 0.0 }
+};
+static const bool PICK_AND_PLACE_STOP[PICK_AND_PLACE_POINTS] = { true, false, true, false, false, true, false, true };
+
+/*
+ * limits: the velocities of the <limit> tags of ur10_robot.urdf, the accelerations as configured
+ */
+static const double MAX_VELOCITY[6] = { 2.16, 2.16, 3.15, 3.2, 3.2, 3.2 };
+static const double MAX_ACCELERATION[6] = { 3.0, 3.0, 4.0, 6.0, 6.0, 6.0 };
+
+/**
+ * Duration of a movej from rest to rest like the controller: trapezoidal profile of the joint with the largest
+ * distance.
+ * @param from
+ * @param to
+ * @param velocity [rad/s]
+ * @param acceleration [rad/s^2]
+ * @return [s]
+ */
+static double getMovejDuration(const double* from, const double* to, double velocity, double acceleration)
+{
+    double distance = 0;
+    for (int j = 0; j < 6; j++)
+    {
+        distance = std::max(distance, fabs(to[j] - from[j]));
+    }
+
+    if (distance < velocity * velocity / acceleration)
+    {
+        return 2 * sqrt(distance / acceleration);
+    }
+
+    return distance / velocity + velocity / acceleration;
+}
+
+static double getRetimedDuration(double deviation)
+{
+    std::vector<double> waypoints;
+    std::vector<double> deviations;
+    for (int i = 0; i < PICK_AND_PLACE_POINTS; i++)
+    {
+        waypoints.insert(waypoints.end(), PICK_AND_PLACE[i], PICK_AND_PLACE[i] + 6);
+        deviations.push_back(PICK_AND_PLACE_STOP[i] ? 0.0 : deviation);
+    }
+
+    PathParameterization parameterization;
+    parameterization.setLimits(std::vector<double>(MAX_VELOCITY, MAX_VELOCITY + 6), std::vector<double>(MAX_ACCELERATION, MAX_ACCELERATION + 6));
+    parameterization.compute(waypoints, deviations);
+
+    return parameterization.getDuration();
+}
+
+/**
+ * Retiming the pick and place cycle (grid step 1 mrad).
+ */
+static void BM_PathParameterization(benchmark::State& state)
+{
+    while (state.KeepRunning())
+    {
+        benchmark::DoNotOptimize(getRetimedDuration(0.05));
+    }
+}
+BENCHMARK(BM_PathParameterization);
+
+//=================================================================
+// cycle time (counters, one iteration)
+//=================================================================
+/**
+ * Cycle time of the pick and place cycle [s]:
+ * - handTuned: PTP commands with the velocity and acceleration of movej (1.05 rad/s, 1.4 rad/s^2), stop at each point
+ * - scalarLimits: PTP commands with the lowest joint limits (the fastest safe scalars), stop at each point
+ * - retimedStop: retimed with the limits of each joint, stop at each point
+ * - retimedBlended: retimed, the approach points are blended within 0.05 rad
+ * The gains are the factors of the cycle time of the retimed blended cycle.
+ */
+static void BM_PickAndPlaceCycleTime(benchmark::State& state)
+{
+    double handTuned = 0;
+    double scalarLimits = 0;
+    double retimedStop = 0;
+    double retimedBlended = 0;
+
+    while (state.KeepRunning())
+    {
+        handTuned = 0;
+        scalarLimits = 0;
+        for (int i = 0; i + 1 < PICK_AND_PLACE_POINTS; i++)
+        {
+            handTuned += getMovejDuration(PICK_AND_PLACE[i], PICK_AND_PLACE[i + 1], 1.05, 1.4);
+            scalarLimits += getMovejDuration(PICK_AND_PLACE[i], PICK_AND_PLACE[i + 1], *std::min_element(MAX_VELOCITY, MAX_VELOCITY + 6), *std::min_element(MAX_ACCELERATION, MAX_ACCELERATION + 6));
+        }
+
+        retimedStop = getRetimedDuration(0.0);
+        retimedBlended = getRetimedDuration(0.05);
+    }
+
+    state.counters["handTuned"] = handTuned;
+    state.counters["scalarLimits"] = scalarLimits;
+    state.counters["retimedStop"] = retimedStop;
+    state.counters["retimedBlended"] = retimedBlended;
+    state.counters["gainHandTuned"] = handTuned / retimedBlended;
+    state.counters["gainScalarLimits"] = scalarLimits / retimedBlended;
+}
+BENCHMARK(BM_PickAndPlaceCycleTime)->Iterations(1);
@@ -0,0 +1,378 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Benchmarks of the inline rotation conversions against the tf based conversions
+// ----------------------------------------------------------------------------
+
+#include <benchmark/benchmark.h>
+
+#include <rotation.h>
+#include <tf/tf.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace ur_driver;
+
+//=================================================================
+// tf based conversions (the former implementation in utils.cpp)
+//=================================================================
+static void tfAxisToQuaternion(double rx, double ry, double rz, double& x, double& y, double& z, double& w)
+{
+    tf::Vector3 e(rx, ry, rz);
+
+    if (e.isZero())
+    {
+        e = tf::Vector3(1, 1, 1);
+    }
+
+    double l = e.length();
+    e = e / l;
+
+    tf::Quaternion quaternion(e, l);
+    x = quaternion.x();
+    y = quaternion.y();
+    z = quaternion.z();
+    w = quaternion.w();
+}
+
+static void tfQuaternionToAxis(double x, double y, double z, double w, double& rx, double& ry, double& rz)
+{
+    tf::Quaternion quaternion(x, y, z, w);
+    tf::Vector3 axis = quaternion.getAxis() * quaternion.getAngle();
+    rx = axis.x();
+    ry = axis.y();
+    rz = axis.z();
+}
+
+static void tfRpyToQuaternion(double roll, double pitch, double yaw, double& x, double& y, double& z, double& w)
+{
+    tf::Quaternion quaternion;
+    quaternion.setRPY(roll, pitch, yaw);
+    x = quaternion.x();
+    y = quaternion.y();
+    z = quaternion.z();
+    w = quaternion.w();
+}
+
+static void tfQuaternionToRpy(double x, double y, double z, double w, double& roll, double& pitch, double& yaw)
+{
+    tf::Quaternion quaternion(x, y, z, w);
+    tf::Matrix3x3 matrix(quaternion);
+    matrix.getRPY(roll, pitch, yaw);
+}
+
+static void tfAxisToRpy(double rx, double ry, double rz, double& roll, double& pitch, double& yaw)
+{
+    double x, y, z, w;
+    tfAxisToQuaternion(rx, ry, rz, x, y, z, w);
+    tfQuaternionToRpy(x, y, z, w, roll, pitch, yaw);
+}
+
+static void tfRpyToAxis(double roll, double pitch, double yaw, double& rx, double& ry, double& rz)
+{
+    tf::Quaternion quaternion = tf::createQuaternionFromRPY(roll, pitch, yaw);
+    tf::Vector3 axis = quaternion.getAngle() * quaternion.getAxis();
+    rx = axis.x();
+    ry = axis.y();
+    rz = axis.z();
+}
+
+//=================================================================
+// samples
+//=================================================================
+static const size_t SAMPLE_COUNT = 1024;
+
+static double randomValue(unsigned int& seed, double min, double max)
+{
+    return min + (max - min) * rand_r(&seed) / (double)RAND_MAX;
+}
+
+/**
+ * Random axis angles with an angle in [0, pi].
+ */
+static Vector3Batch createAxisSamples()
+{
+    unsigned int seed = 42;
+    Vector3Batch axis;
+    axis.resize(SAMPLE_COUNT);
+
+    for (size_t i = 0; i < SAMPLE_COUNT; i++)
+    {
+        double x = randomValue(seed, -1, 1);
+        double y = randomValue(seed, -1, 1);
+        double z = randomValue(seed, -1, 1);
+        double length = std::sqrt(x * x + y * y + z * z);
+
+        double angle = randomValue(seed, 0, M_PI);
+        axis.x[i] = x / length * angle;
+        axis.y[i] = y / length * angle;
+        axis.z[i] = z / length * angle;
+    }
+
+    return axis;
+}
+
+static Vector3Batch createRpySamples()
+{
+    unsigned int seed = 42;
+    Vector3Batch rpy;
+    rpy.resize(SAMPLE_COUNT);
+
+    for (size_t i = 0; i < SAMPLE_COUNT; i++)
+    {
+        rpy.x[i] = randomValue(seed, -M_PI, M_PI);
+        rpy.y[i] = randomValue(seed, -M_PI_2, M_PI_2);
+        rpy.z[i] = randomValue(seed, -M_PI, M_PI);
+    }
+
+    return rpy;
+}
+
+//=================================================================
+// throughput of 1024 conversions per iteration
+//=================================================================
+static void BM_TfAxisToQuaternion(benchmark::State& state)
+{
+    Vector3Batch axis = createAxisSamples();
+    QuaternionBatch quaternion;
+    quaternion.resize(SAMPLE_COUNT);
+
+    while (state.KeepRunning())
+    {
+        for (size_t i = 0; i < SAMPLE_COUNT; i++)
+        {
+            tfAxisToQuaternion(axis.x[i], axis.y[i], axis.z[i], quaternion.x[i], quaternion.y[i], quaternion.z[i], quaternion.w[i]);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * SAMPLE_COUNT);
+}
+BENCHMARK(BM_TfAxisToQuaternion);
+
+static void BM_RotationAxisToQuaternion(benchmark::State& state)
+{
+    Vector3Batch axis = createAxisSamples();
+    QuaternionBatch quaternion;
+    quaternion.resize(SAMPLE_COUNT);
+
+    while (state.KeepRunning())
+    {
+        for (size_t i = 0; i < SAMPLE_COUNT; i++)
+        {
+            Rotation::axisToQuaternion(axis.x[i], axis.y[i], axis.z[i], quaternion.x[i], quaternion.y[i], quaternion.z[i], quaternion.w[i]);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * SAMPLE_COUNT);
+}
+BENCHMARK(BM_RotationAxisToQuaternion);
+
+static void BM_RotationBatchAxisToQuaternion(benchmark::State& state)
+{
+    Vector3Batch axis = createAxisSamples();
+    QuaternionBatch quaternion;
+
+    while (state.KeepRunning())
+    {
+        RotationBatch::axisToQuaternion(axis, quaternion);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * SAMPLE_COUNT);
+}
+BENCHMARK(BM_RotationBatchAxisToQuaternion);
+
+static void BM_TfQuaternionToAxis(benchmark::State& state)
+{
+    QuaternionBatch quaternion;
+    RotationBatch::axisToQuaternion(createAxisSamples(), quaternion);
+    Vector3Batch axis;
+    axis.resize(SAMPLE_COUNT);
+
+    while (state.KeepRunning())
+    {
+        for (size_t i = 0; i < SAMPLE_COUNT; i++)
+        {
+            tfQuaternionToAxis(quaternion.x[i], quaternion.y[i], quaternion.z[i], quaternion.w[i], axis.x[i], axis.y[i], axis.z[i]);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * SAMPLE_COUNT);
+}
+BENCHMARK(BM_TfQuaternionToAxis);
+
+static void BM_RotationQuaternionToAxis(benchmark::State& state)
+{
+    QuaternionBatch quaternion;
+    RotationBatch::axisToQuaternion(createAxisSamples(), quaternion);
+    Vector3Batch axis;
+    axis.resize(SAMPLE_COUNT);
+
+    while (state.KeepRunning())
+    {
+        for (size_t i = 0; i < SAMPLE_COUNT; i++)
+        {
+            Rotation::quaternionToAxis(quaternion.x[i], quaternion.y[i], quaternion.z[i], quaternion.w[i], axis.x[i], axis.y[i], axis.z[i]);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * SAMPLE_COUNT);
+}
+BENCHMARK(BM_RotationQuaternionToAxis);
+
+static void BM_RotationBatchQuaternionToAxis(benchmark::State& state)
+{
+    QuaternionBatch quaternion;
+    RotationBatch::axisToQuaternion(createAxisSamples(), quaternion);
+    Vector3Batch axis;
+
+    while (state.KeepRunning())
+    {
+        RotationBatch::quaternionToAxis(quaternion, axis);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * SAMPLE_COUNT);
+}
+BENCHMARK(BM_RotationBatchQuaternionToAxis);
+
+static void BM_TfRpyToQuaternion(benchmark::State& state)
+{
+    Vector3Batch rpy = createRpySamples();
+    QuaternionBatch quaternion;
+    quaternion.resize(SAMPLE_COUNT);
+
+    while (state.KeepRunning())
+    {
+        for (size_t i = 0; i < SAMPLE_COUNT; i++)
+        {
+            tfRpyToQuaternion(rpy.x[i], rpy.y[i], rpy.z[i], quaternion.x[i], quaternion.y[i], quaternion.z[i], quaternion.w[i]);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * SAMPLE_COUNT);
+}
+BENCHMARK(BM_TfRpyToQuaternion);
+
+static void BM_RotationBatchRpyToQuaternion(benchmark::State& state)
+{
+    Vector3Batch rpy = createRpySamples();
+    QuaternionBatch quaternion;
+
+    while (state.KeepRunning())
+    {
+        RotationBatch::rpyToQuaternion(rpy, quaternion);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * SAMPLE_COUNT);
+}
+BENCHMARK(BM_RotationBatchRpyToQuaternion);
+
+static void BM_TfQuaternionToRpy(benchmark::State& state)
+{
+    QuaternionBatch quaternion;
+    RotationBatch::rpyToQuaternion(createRpySamples(), quaternion);
+    Vector3Batch rpy;
+    rpy.resize(SAMPLE_COUNT);
+
+    while (state.KeepRunning())
+    {
+        for (size_t i = 0; i < SAMPLE_COUNT; i++)
+        {
+            tfQuaternionToRpy(quaternion.x[i], quaternion.y[i], quaternion.z[i], quaternion.w[i], rpy.x[i], rpy.y[i], rpy.z[i]);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * SAMPLE_COUNT);
+}
+BENCHMARK(BM_TfQuaternionToRpy);
+
+static void BM_RotationBatchQuaternionToRpy(benchmark::State& state)
+{
+    QuaternionBatch quaternion;
+    RotationBatch::rpyToQuaternion(createRpySamples(), quaternion);
+    Vector3Batch rpy;
+
+    while (state.KeepRunning())
+    {
+        RotationBatch::quaternionToRpy(quaternion, rpy);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * SAMPLE_COUNT);
+}
+BENCHMARK(BM_RotationBatchQuaternionToRpy);
+
+static void BM_TfAxisToRpy(benchmark::State& state)
+{
+    Vector3Batch axis = createAxisSamples();
+    Vector3Batch rpy;
+    rpy.resize(SAMPLE_COUNT);
+
+    while (state.KeepRunning())
+    {
+        for (size_t i = 0; i < SAMPLE_COUNT; i++)
+        {
+            tfAxisToRpy(axis.x[i], axis.y[i], axis.z[i], rpy.x[i], rpy.y[i], rpy.z[i]);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * SAMPLE_COUNT);
+}
+BENCHMARK(BM_TfAxisToRpy);
+
+static void BM_RotationBatchAxisToRpy(benchmark::State& state)
+{
+    Vector3Batch axis = createAxisSamples();
+    Vector3Batch rpy;
+
+    while (state.KeepRunning())
+    {
+        RotationBatch::axisToRpy(axis, rpy);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * SAMPLE_COUNT);
+}
+BENCHMARK(BM_RotationBatchAxisToRpy);
+
+static void BM_TfRpyToAxis(benchmark::State& state)
+{
+    Vector3Batch rpy = createRpySamples();
+    Vector3Batch axis;
+    axis.resize(SAMPLE_COUNT);
+
+    while (state.KeepRunning())
+    {
+        for (size_t i = 0; i < SAMPLE_COUNT; i++)
+        {
+            tfRpyToAxis(rpy.x[i], rpy.y[i], rpy.z[i], axis.x[i], axis.y[i], axis.z[i]);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * SAMPLE_COUNT);
+}
+BENCHMARK(BM_TfRpyToAxis);
+
+static void BM_RotationBatchRpyToAxis(benchmark::State& state)
+{
+    Vector3Batch rpy = createRpySamples();
+    Vector3Batch axis;
+
+    while (state.KeepRunning())
+    {
+        RotationBatch::rpyToAxis(rpy, axis);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * SAMPLE_COUNT);
+}
+BENCHMARK(BM_RotationBatchRpyToAxis);
@@ -0,0 +1,106 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Benchmarks for the velocity teleoperation
+// ----------------------------------------------------------------------------
+
+#include <benchmark/benchmark.h>
+
+#include <teleop.h>
+
+#include <math.h>
+#include <algorithm>
+
+using namespace ur_driver;
+
+static const double TELEOP_CYCLE_TIME = 0.008;
+
+/**
+ * One cycle with a new target every 50 cycles (joystick reversing all joints).
+ */
+static void BM_VelocityTeleopStep(benchmark::State& state)
+{
+    VelocityTeleop teleop;
+    teleop.setLimits(1.0, 2.0, 20.0);
+    std::vector<double> target(6, 0.5);
+    std::vector<double> velocity(6);
+
+    int cycle = 0;
+    while (state.KeepRunning())
+    {
+        if (cycle++ % 50 == 0)
+        {
+            target.assign(6, -target[0]);
+        }
+        teleop.setTarget(target);
+        benchmark::DoNotOptimize(teleop.step(TELEOP_CYCLE_TIME, velocity));
+    }
+}
+BENCHMARK(BM_VelocityTeleopStep);
+
+//=================================================================
+// limits (counters, one iteration)
+//=================================================================
+/**
+ * Reversal from -1 to 1 rad/s with the limits 2 rad/s^2 and 20 rad/s^3, then the input stops. The counters are the
+ * largest acceleration and jerk while following the input, the overshoot of the target and the cycles from the last
+ * input until the velocity is zero (watchdog 10 cycles, ramp 25 cycles).
+ */
+static void BM_VelocityTeleopLimits(benchmark::State& state)
+{
+    double maxAcceleration = 0;
+    double maxJerk = 0;
+    double overshoot = 0;
+    int stopCycles = 0;
+
+    while (state.KeepRunning())
+    {
+        VelocityTeleop teleop;
+        teleop.setLimits(1.0, 2.0, 20.0);
+        teleop.setWatchdog(10, 25);
+
+        std::vector<double> target(6, -1.0);
+        std::vector<double> velocity(6);
+        for (int i = 0; i < 200; i++)
+        {
+            teleop.setTarget(target);
+            teleop.step(TELEOP_CYCLE_TIME, velocity);
+        }
+
+        target.assign(6, 1.0);
+        double previousVelocity = velocity[0];
+        double previousAcceleration = 0;
+        for (int i = 0; i < 200; i++)
+        {
+            teleop.setTarget(target);
+            teleop.step(TELEOP_CYCLE_TIME, velocity);
+
+            double acceleration = (velocity[0] - previousVelocity) / TELEOP_CYCLE_TIME;
+            maxAcceleration = std::max(maxAcceleration, fabs(acceleration));
+            maxJerk = std::max(maxJerk, fabs(acceleration - previousAcceleration) / TELEOP_CYCLE_TIME);
+            overshoot = std::max(overshoot, velocity[0] - target[0]);
+            previousVelocity = velocity[0];
+            previousAcceleration = acceleration;
+        }
+
+        for (stopCycles = 1; teleop.step(TELEOP_CYCLE_TIME, velocity) && stopCycles < 1000; stopCycles++);
+    }
+
+    state.counters["maxAcceleration"] = maxAcceleration;
+    state.counters["maxJerk"] = maxJerk;
+    state.counters["overshoot"] = overshoot;
+    state.counters["stopCycles"] = stopCycles;
+}
+BENCHMARK(BM_VelocityTeleopLimits)->Iterations(1);
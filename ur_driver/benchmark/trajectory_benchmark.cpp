@@ -0,0 +1,108 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Benchmarks for the spline interpolation of servo trajectories
+// ----------------------------------------------------------------------------
+
+#include <benchmark/benchmark.h>
+
+#include <trajectory.h>
+
+#include <math.h>
+
+using namespace ur_driver;
+
+/*
+ * heap allocations of the benchmark process (see driver_benchmark.cpp)
+ */
+extern unsigned long allocations;
+
+static const double SERVO_CYCLE_TIME = 0.002;
+
+/**
+ * Sparse trajectory of 6 joints: 20 points 0.5 s apart, with velocities and accelerations for the quintic spline.
+ * @param isQuintic
+ * @return
+ */
+static SplineTrajectory createTrajectory(bool isQuintic)
+{
+    std::vector<double> times;
+    std::vector<double> positions;
+    std::vector<double> velocities;
+    std::vector<double> accelerations;
+    for (int i = 0; i < 20; i++)
+    {
+        times.push_back(0.5 * i);
+        for (int j = 0; j < 6; j++)
+        {
+            positions.push_back(sin(0.3 * i + j));
+            velocities.push_back(0.6 * cos(0.3 * i + j));
+            accelerations.push_back(-0.36 * sin(0.3 * i + j));
+        }
+    }
+
+    SplineTrajectory trajectory;
+    if (isQuintic)
+    {
+        trajectory.fit(times, positions, velocities, accelerations);
+    }
+    else
+    {
+        trajectory.fit(times, positions, std::vector<double>(), std::vector<double>());
+    }
+
+    return trajectory;
+}
+
+/**
+ * One sample of all 6 joints at the rate of an e-Series controller (arg 0: cubic, 1: quintic). Sampling must not
+ * allocate, the allocations counter is reported per sample.
+ */
+static void BM_SplineSample(benchmark::State& state)
+{
+    SplineTrajectory trajectory = createTrajectory(state.range(0) != 0);
+    double position[6];
+    double velocity[6];
+
+    double time = 0;
+    unsigned long allocationsBefore = allocations;
+    while (state.KeepRunning())
+    {
+        trajectory.sample(time, position, velocity, NULL);
+        benchmark::DoNotOptimize(position[0]);
+
+        time += SERVO_CYCLE_TIME;
+        if (time > trajectory.getDuration())
+        {
+            time = 0;
+        }
+    }
+
+    state.counters["allocations"] = benchmark::Counter(allocations - allocationsBefore, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_SplineSample)->Arg(0)->Arg(1);
+
+/**
+ * Fitting the spline of a trajectory with 20 points and checking the limits, done once per received trajectory.
+ */
+static void BM_SplineFit(benchmark::State& state)
+{
+    while (state.KeepRunning())
+    {
+        SplineTrajectory trajectory = createTrajectory(false);
+        benchmark::DoNotOptimize(trajectory.limit(1.0, 2.0));
+    }
+}
+BENCHMARK(BM_SplineFit);
@@ -0,0 +1,124 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Benchmarks for the transports between the connector and the robot controller
+// ----------------------------------------------------------------------------
+
+#include <benchmark/benchmark.h>
+
+#include <connector.h>
+#include <dummy.h>
+#include <transport.h>
+
+#include <string>
+
+using namespace ur_driver;
+using boost::asio::ip::tcp;
+
+/**
+ * Create two connected ends of a transport, TCP over the loopback interface.
+ */
+static void createTransportPair(boost::asio::io_service& io, Transport::Type type, boost::shared_ptr<Transport>& first, boost::shared_ptr<Transport>& second)
+{
+    if (type == Transport::UNIX)
+    {
+        UnixTransport::createPair(io, first, second);
+    }
+    else if (type == Transport::MEMORY)
+    {
+        MemoryTransport::createPair(io, first, second);
+    }
+    else
+    {
+        tcp::acceptor acceptor(io, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+
+        boost::shared_ptr<TcpTransport> client(new TcpTransport(io));
+        boost::shared_ptr<TcpTransport> server(new TcpTransport(io));
+        client->getSocket().connect(acceptor.local_endpoint());
+        acceptor.accept(server->getSocket());
+        client->setNoDelay(true);
+
+        first = client;
+        second = server;
+    }
+}
+
+/**
+ * A robot state frame from the server end to the connector: write, read, frame assembly and decoding.
+ * The argument is the transport type.
+ */
+static void BM_TransportFrame(benchmark::State& state)
+{
+    Transport::Type type = (Transport::Type)state.range(0);
+    std::string frame = Dummy::createRobotStateFrame();
+
+    boost::asio::io_service io;
+    boost::shared_ptr<Transport> client;
+    boost::shared_ptr<Transport> server;
+    createTransportPair(io, type, client, server);
+
+    Connector connector;
+    char data[4096];
+
+    while (state.KeepRunning())
+    {
+        boost::system::error_code error;
+        server->write(frame.data(), frame.size(), error);
+
+        size_t received = 0;
+        while (received < frame.size() && !error)
+        {
+            size_t length = client->read(data, sizeof(data), error);
+            connector.processData(Connector::SECONDARY, data, length);
+            received += length;
+        }
+    }
+
+    state.SetLabel(Transport::getTypeName(type));
+    state.SetBytesProcessed(state.iterations() * frame.size());
+}
+BENCHMARK(BM_TransportFrame)->Arg(Transport::TCP)->Arg(Transport::UNIX)->Arg(Transport::MEMORY);
+
+/**
+ * A script from the connector end to the server: the write and read of a command.
+ */
+static void BM_TransportScript(benchmark::State& state)
+{
+    Transport::Type type = (Transport::Type)state.range(0);
+    std::string script = "movej([0.1, -1.2, 1.2, -1.57, -1.57, 0.0], a=1.4, v=1.05)\n";
+
+    boost::asio::io_service io;
+    boost::shared_ptr<Transport> client;
+    boost::shared_ptr<Transport> server;
+    createTransportPair(io, type, client, server);
+
+    char data[1024];
+
+    while (state.KeepRunning())
+    {
+        boost::system::error_code error;
+        client->write(script.data(), script.size(), error);
+
+        size_t received = 0;
+        while (received < script.size() && !error)
+        {
+            received += server->read(data, sizeof(data), error);
+        }
+    }
+
+    state.SetLabel(Transport::getTypeName(type));
+    state.SetBytesProcessed(state.iterations() * script.size());
+}
+BENCHMARK(BM_TransportScript)->Arg(Transport::TCP)->Arg(Transport::UNIX)->Arg(Transport::MEMORY);
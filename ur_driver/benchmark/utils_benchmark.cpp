@@ -0,0 +1,89 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Benchmarks for the rotation conversions
+// ----------------------------------------------------------------------------
+
+#include <benchmark/benchmark.h>
+
+#include <utils.h>
+
+using namespace ur_driver;
+
+static void BM_RpyToQuaternion(benchmark::State& state)
+{
+    double roll = 0.1;
+    while (state.KeepRunning())
+    {
+        benchmark::DoNotOptimize(rpyToQuaternion(roll, 0.2, 0.3));
+        roll += 1e-6;
+    }
+}
+BENCHMARK(BM_RpyToQuaternion);
+
+static void BM_RpyToAxis(benchmark::State& state)
+{
+    double roll = 0.1;
+    while (state.KeepRunning())
+    {
+        benchmark::DoNotOptimize(rpyToAxis(roll, 0.2, 0.3));
+        roll += 1e-6;
+    }
+}
+BENCHMARK(BM_RpyToAxis);
+
+static void BM_AxisToRpy(benchmark::State& state)
+{
+    double rx = 1.2;
+    while (state.KeepRunning())
+    {
+        benchmark::DoNotOptimize(axisToRpy(rx, -0.4, 0.3));
+        rx += 1e-6;
+    }
+}
+BENCHMARK(BM_AxisToRpy);
+
+static void BM_AxisToQuaternion(benchmark::State& state)
+{
+    double rx = 1.2;
+    while (state.KeepRunning())
+    {
+        benchmark::DoNotOptimize(axisToQuaternion(rx, -0.4, 0.3));
+        rx += 1e-6;
+    }
+}
+BENCHMARK(BM_AxisToQuaternion);
+
+static void BM_QuaternionToAxis(benchmark::State& state)
+{
+    double x = 0.1;
+    while (state.KeepRunning())
+    {
+        benchmark::DoNotOptimize(quaternionToAxis(x, 0.2, 0.3, 0.927));
+        x += 1e-9;
+    }
+}
+BENCHMARK(BM_QuaternionToAxis);
+
+static void BM_QuaternionToRpy(benchmark::State& state)
+{
+    double x = 0.1;
+    while (state.KeepRunning())
+    {
+        benchmark::DoNotOptimize(quaternionToRpy(x, 0.2, 0.3, 0.927));
+        x += 1e-9;
+    }
+}
+BENCHMARK(BM_QuaternionToRpy);
@@ -0,0 +1,103 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Blend radii of the waypoints of a command list and the duration of blended moves
+// ----------------------------------------------------------------------------
+
+#ifndef BLENDING_H_
+#define BLENDING_H_
+
+#include <vector>
+
+namespace ur_driver
+{
+    /**
+     * Part of a segment which the blends at both of its ends may cover together. The controller aborts the program if
+     * the blends of a segment overlap, the margin keeps them apart.
+     */
+    static const double BLEND_MARGIN = 0.9;
+
+    //=================================================================
+    // BlendOptimizer
+    //=================================================================
+    /**
+     * Largest blend radius of each waypoint of a move sequence: the blend (an arc tangent to both segments, see
+     * BlendedMoveEstimator) deviates at most the tolerance from the waypoint and, with the neighbouring blends, covers
+     * at most BLEND_MARGIN of the segments before and after the waypoint. The segments are first shared equally, then
+     * the part a smaller neighbour doesn't use is given to the waypoint. A waypoint without blend (radius 0) stays an
+     * exact stop, the last waypoint is always a stop.
+     */
+    class BlendOptimizer
+    {
+        public:
+            BlendOptimizer();
+
+            /**
+             * Set the largest deviation of a blend from its waypoint.
+             * @param tolerance [m]
+             */
+            void setTolerance(double tolerance);
+
+            /**
+             * Optimize the blend radii.
+             * @param positions TCP positions (3 values [m]) of the start and of each waypoint
+             * @param radii Blend radius of each waypoint [m], replaced by the optimized radius. One less than the
+             * positions.
+             * @return number of changed radii
+             */
+            int optimize(const std::vector<double>& positions, std::vector<double>& radii) const;
+
+        private:
+            double tolerance;
+    };
+
+    //=================================================================
+    // BlendedMoveEstimator
+    //=================================================================
+    /**
+     * Duration of a sequence of linear moves with trapezoidal velocity profiles which starts and ends at rest. A blend
+     * of radius r at a waypoint with the direction change angle a is an arc tangent to both segments with the radius
+     * r / tan(a / 2), the speed through it is limited by the accelerations of both moves. A waypoint without blend is
+     * passed at rest.
+     */
+    class BlendedMoveEstimator
+    {
+        public:
+            /**
+             * Estimate the duration of each move.
+             * @param positions Positions (dimension values) of the start and of each waypoint
+             * @param dimension Values per position
+             * @param velocities Speed of each move
+             * @param accelerations Acceleration of each move
+             * @param radii Blend radius of each waypoint
+             * @param durations Time from the previous waypoint to the waypoint, one per move [s]
+             * @return total duration [s]
+             */
+            static double estimate(const std::vector<double>& positions, int dimension, const std::vector<double>& velocities, const std::vector<double>& accelerations, const std::vector<double>& radii, std::vector<double>& durations);
+
+            /**
+             * Duration of a trapezoidal (or triangular) velocity profile between two speeds.
+             * @param distance
+             * @param startSpeed
+             * @param endSpeed
+             * @param velocity Maximum speed
+             * @param acceleration
+             * @return [s]
+             */
+            static double getProfileDuration(double distance, double startSpeed, double endSpeed, double velocity, double acceleration);
+    };
+}
+
+#endif
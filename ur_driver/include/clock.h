@@ -0,0 +1,183 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// Clocks which pace the worker threads, on wall time or on a simulated time
+// ----------------------------------------------------------------------------
+
+#ifndef CLOCK_H_
+#define CLOCK_H_
+
+#include <stdint.h>
+#include <set>
+#include <utility>
+
+#include <boost/thread.hpp>
+
+namespace ur_driver
+{
+    //=================================================================
+    // Clock
+    //=================================================================
+    /**
+     * Time source of the worker threads of the connector, the dummy server and the driver. Threads which sleep on the clock
+     * are participants. The participant functions are only used by lockstep clocks, the wall clock ignores them.
+     */
+    class Clock
+    {
+        public:
+            /**
+             * Destructor.
+             */
+            virtual ~Clock();
+
+            /**
+             * Get the current time.
+             * @return time in seconds
+             */
+            virtual double now() = 0;
+
+            /**
+             * Sleep until the given time.
+             * @param time
+             */
+            virtual void sleepUntil(double time) = 0;
+
+            /**
+             * Check if the time is simulated.
+             * @return
+             */
+            virtual bool isSimulated();
+
+            /**
+             * Register a participant thread. Called before the thread is started, so the time can not advance before the
+             * thread waits for the first time.
+             */
+            virtual void addParticipant();
+
+            /**
+             * Unregister a participant thread when it exits.
+             */
+            virtual void removeParticipant();
+
+            /**
+             * A participant starts to block on a socket read. Writes are not waits, the peer reads the data without the
+             * time advancing.
+             */
+            virtual void beginWait();
+
+            /**
+             * A participant stops blocking on I/O.
+             */
+            virtual void endWait();
+
+            /**
+             * Account data which was written (positive) or read (negative) by a participant.
+             * @param bytes
+             */
+            virtual void addInFlight(long bytes);
+
+            /**
+             * Get the shared wall clock.
+             * @return
+             */
+            static Clock* getWallClock();
+    };
+
+    //=================================================================
+    // WallClock
+    //=================================================================
+    /**
+     * Monotonic wall time.
+     */
+    class WallClock : public Clock
+    {
+        public:
+            double now();
+            void sleepUntil(double time);
+    };
+
+    //=================================================================
+    // SimulatedClock
+    //=================================================================
+    /**
+     * Deterministic simulated time. The time only advances when all participants sleep on the clock or block on I/O and
+     * all written data was read. Then the sleeper with the earliest wake-up time (the first one on ties) is woken and the
+     * time jumps to its wake-up time. Participants therefore run one after the other, as fast as the CPU allows, and
+     * repeated runs produce the same results.
+     * Data which is never read (e.g. after a connection reset) is dropped from the accounting after one second of wall time.
+     */
+    class SimulatedClock : public Clock
+    {
+        public:
+            /**
+             * Constructor.
+             * @param startTime
+             */
+            SimulatedClock(double startTime = 0);
+
+            double now();
+            void sleepUntil(double time);
+            bool isSimulated();
+            void addParticipant();
+            void removeParticipant();
+            void beginWait();
+            void endWait();
+            void addInFlight(long bytes);
+
+        private:
+            boost::mutex mutexClock;
+            boost::condition_variable condition;
+
+            double time;
+            int participants;
+            int waiting;
+            long long inFlight;
+            unsigned long long sequence;
+            std::set<std::pair<double, unsigned long long> > sleepers;
+
+            /**
+             * Wake the next sleeper if all participants wait (mutexClock must be locked).
+             */
+            void advance();
+    };
+
+    //=================================================================
+    // ClockRate
+    //=================================================================
+    /**
+     * Loop rate on a clock, like ros::Rate. Missed cycles are skipped if the loop is behind by more than one period.
+     */
+    class ClockRate
+    {
+        public:
+            /**
+             * Constructor.
+             * @param clock
+             * @param frequency
+             */
+            ClockRate(Clock* clock, double frequency);
+
+            /**
+             * Sleep until the next cycle.
+             */
+            void sleep();
+
+        private:
+            Clock* clock;
+            double period;
+            double next;
+    };
+}
+
+#endif
@@ -23,6 +23,7 @@
 #define COMMAND_H_
 
 #include <utils.h>
+#include <vector>
 
 namespace ur_driver
 {
@@ -37,9 +38,22 @@ namespace ur_driver
     {
         protected:
             std::string commandString;
+            std::vector<int> commandIds;
 
         public:
             std::string getCommandString();
+
+            /**
+             * Get the ids of the robot movement interface commands contained in the script (used for tracing).
+             * @return
+             */
+            const std::vector<int>& getCommandIds();
+
+            /**
+             * Set the ids of the robot movement interface commands contained in the script.
+             * @param commandIds
+             */
+            void setCommandIds(const std::vector<int>& commandIds);
     };
 
     class CommandJointPosition : public Command
@@ -160,6 +174,61 @@ namespace ur_driver
 		public:
 			CommandPtpJointBlending(JointValue position, double speed, double accel, double blending);
 	};
+
+    /**
+     * Persistent program which connects to the ServoServer of the driver and executes servoj with the streamed setpoints
+     * every controller cycle. With a buffer depth the program buffers the setpoints and plays them in order (see
+     * ServoServer).
+     */
+    class CommandServoProgram : public Command
+    {
+        public:
+            /**
+             * Constructor.
+             * @param host Address of the driver as seen from the robot controller.
+             * @param port Port of the ServoServer.
+             * @param cycleTime Time of each servoj [s] (0.008 at 125 Hz, 0.002 at 500 Hz).
+             * @param lookahead Lookahead time of servoj [s] (0.03 - 0.2), smooths the trajectory.
+             * @param gain Proportional gain of servoj (100 - 2000).
+             * @param timeout The program ends if no frame arrives within this time [s] (buffered: and the buffer is empty).
+             * @param bufferDepth Setpoints buffered by the program, 0 executes the latest setpoint.
+             */
+            CommandServoProgram(const std::string& host, int port, double cycleTime, double lookahead, double gain, double timeout, int bufferDepth = 0);
+    };
+
+    /**
+     * Persistent program which connects to a ServoServer of the driver and executes speedj with the streamed joint
+     * velocities every controller cycle (teleoperation).
+     */
+    class CommandSpeedProgram : public Command
+    {
+        public:
+            /**
+             * Constructor.
+             * @param host Address of the driver as seen from the robot controller.
+             * @param port Port of the ServoServer.
+             * @param cycleTime Time of each speedj [s].
+             * @param acceleration Acceleration of speedj [rad/s^2], the streamed velocities are already limited.
+             * @param timeout The program stops the robot if no frame arrives within this time [s].
+             */
+            CommandSpeedProgram(const std::string& host, int port, double cycleTime, double acceleration, double timeout);
+    };
+
+    /**
+     * Persistent program which connects to the MoveStreamServer of the driver and executes the streamed moves one after
+     * the other with blending.
+     */
+    class CommandMoveProgram : public Command
+    {
+        public:
+            /**
+             * Constructor.
+             * @param host Address of the driver as seen from the robot controller.
+             * @param port Port of the MoveStreamServer.
+             * @param timeout The program ends if no frame arrives within this time [s].
+             */
+            CommandMoveProgram(const std::string& host, int port, double timeout);
+    };
 }
 
 
@@ -27,6 +27,7 @@
 #include <semaphore.h>
 
 #include <string>
+#include <vector>
 #include <queue>
 #include <stdexcept>
 #include <cstdarg>
@@ -39,273 +40,15 @@
 #include <utils.h>
 #include <command.h>
 #include <dummy.h>
+#include <clock.h>
+#include <transport.h>
+#include <executor.h>
+#include <flight_recorder.h>
+#include <packets.h>
+#include <latency_tracer.h>
 
 namespace ur_driver
 {
-    //=================================================================
-    // Packages
-    //=================================================================
-    inline double bedtoh(const double &x)
-    {
-        double temp;
-        *((uint64_t*)(&temp)) = be64toh(*((uint64_t*)&x));
-        return temp;
-    }
-
-    inline float beftoh(const float &x)
-    {
-        float temp;
-        *((uint32_t*)(&temp)) = be32toh(*((uint32_t*)&x));
-        return temp;
-    }
-
-    /**
-     * Packet structure on port 30002
-     */
-    class Packet_port30002
-    {
-        public:
-            class PacketHeader
-            {
-                public:
-                    int packageLength;
-                    unsigned char packageType;
-
-                public:
-                    void fixByteOrder()
-                    {
-                        packageLength = be32toh(packageLength);
-                    }
-            }__attribute__((packed));
-
-            class ToolData
-            {
-                public:
-                    unsigned char stuff[37-5];
-
-                public:
-                    void fixByteOrder()
-                    {
-                        // TODO
-                    }
-            }__attribute__((packed));
-
-            class MasterboardData
-            {
-                public:
-                    int DigitalnputBits;
-                    int DigitaOutputBits;
-
-                public:
-                    void fixByteOrder()
-                    {
-                        DigitalnputBits = be32toh(DigitalnputBits);
-                        DigitaOutputBits = be32toh(DigitaOutputBits);
-                    }
-
-                    // returns true if bit number pos of a given byte is true or false if not
-                    bool bit_to_bool(int byte, int pos){
-                        return (byte >> pos) & 1;
-                    }
-            }__attribute__((packed));
-
-            class CartesianInfo
-            {
-                public:
-                    double X_Tool;// vector, X-value
-                    double Y_Tool;// vector, Y-value
-                    double Z_Tool;// vector, Z-value
-                    double Rx; //Rx: Rotation vector representation of the tool orientation
-                    double Ry; //Ry: Rotation vector representation of the tool orientation
-                    double Rz; //Rz: Rotation vector representation of the tool orientation
-
-                    double TCPOffsetX; //TCP offset, X-value
-                    double TCPOffsetY; //TCP offset, Y-value
-                    double TCPOffsetZ; //TCP offset, Z-value
-                    double TCPOffsetRX; //TCP offset, Rx-value (Rotation vector representation of TCP orientation)
-                    double TCPOffsetRY; //TCP offset, Ry-value (Rotation vector representation of TCP orientation)
-                    double TCPOffsetRZ;	//TCP offset, Rz-value (Rotation vector representation of TCP orientation)
-
-                public:
-                    void fixByteOrder()
-                    {
-                        X_Tool = bedtoh(X_Tool);
-                        Y_Tool = bedtoh(Y_Tool);
-                        Z_Tool = bedtoh(Z_Tool);
-                        Rx     = bedtoh(Rx);
-                        Ry     = bedtoh(Ry);
-                        Rz     = bedtoh(Rz);
-
-                        TCPOffsetX     = bedtoh(TCPOffsetX);
-                        TCPOffsetY     = bedtoh(TCPOffsetY);
-                        TCPOffsetZ     = bedtoh(TCPOffsetZ);
-                        TCPOffsetRX     = bedtoh(TCPOffsetRX);
-                        TCPOffsetRY     = bedtoh(TCPOffsetRY);
-                        TCPOffsetRZ     = bedtoh(TCPOffsetRZ);
-                    }
-            }__attribute__((packed));
-
-            class RobotMode
-            {
-                public:
-                    unsigned long long timeStamp;
-                    bool isPhysicalRobotConnected;
-                    bool isRealRobotEnabled;
-                    bool isRobotPowerOn;
-                    bool isEmergencyStopped;
-                    bool isSecurityStopped;
-                    bool isProgramRunning;
-                    bool isProgramPaused;
-                    unsigned char Robot_Mode;//   See table Robot Modes
-                    unsigned char ControlMode; //new in CB3
-                    double Speed_Fraction;
-                    double SpeedScaling; //new in CB3
-
-                public:
-                    void fixByteOrder()
-                    {
-                        timeStamp = be64toh(timeStamp);
-                        Speed_Fraction = bedtoh(Speed_Fraction);
-                        SpeedScaling = bedtoh(SpeedScaling);
-                    }
-            } __attribute__((packed));
-
-            class Joint
-            {
-                public:
-                    double q_act;
-                    double q_tar;
-                    double qd_act;
-                    float current;
-                    float voltage;
-                    float temperature;
-                    float unknown; //obsolete
-                    unsigned char JointMode; //new in CB3
-
-                public:
-                    void fixByteOrder()
-                    {
-                        q_act       = bedtoh(q_act);
-                        q_tar       = bedtoh(q_tar);
-                        qd_act      = bedtoh(qd_act);
-                        current     = beftoh(current);
-                        voltage     = beftoh(voltage);
-                        temperature = beftoh(temperature);
-                        unknown     = beftoh(unknown);
-                    }
-
-            } __attribute__((packed));
-
-            //double time;
-            unsigned char robotMessageType;
-
-            // Get info out here!!!
-            PacketHeader robotModeHeader;
-            RobotMode robotMode;
-            PacketHeader jointsHeader;
-            Joint joint[6];
-
-            PacketHeader cartesianInfoHeader;
-            CartesianInfo cartesianInfo;
-
-            PacketHeader masterBoardHeader;
-            MasterboardData masterboardData;
-
-            PacketHeader toolDataHeader;
-            ToolData toolData;
-
-        public:
-            void fixByteOrder()
-            {
-                robotModeHeader.fixByteOrder();
-                robotMode.fixByteOrder();
-                jointsHeader.fixByteOrder();
-                for (int ii=0; ii < 6; ++ii)
-                {
-                    joint[ii].fixByteOrder();
-                }
-                toolDataHeader.fixByteOrder();
-                toolData.fixByteOrder();
-                masterBoardHeader.fixByteOrder();
-                masterboardData.fixByteOrder();
-                cartesianInfoHeader.fixByteOrder();
-                cartesianInfo.fixByteOrder();
-            }
-
-            // returns true if bit number pos of a given byte is true or false if not
-            bool bit_to_bool(char * byteArray, int byteNum, int pos){
-                return (byteArray[byteNum] >> pos) & 1;
-            }
-    } __attribute__((packed));
-
-    /**
-     * Packet structure on port 30003
-     */
-    class Packet_port30003
-    {
-        public:
-            double time;
-            double q_target[6];
-            double qd_target[6];
-            double qdd_target[6];
-            double I_target[6];
-            double M_target[6];
-
-            double q_act[6];
-            double qd_act[6];
-            double I_act[6];
-
-            double tool_acc[3];
-            double unused[15];
-
-            double tcp_force[6];
-
-            double tool_pose[6];
-            double tool_vel[6];
-
-            int64_t dig_in_bits; // int64_t bitwise encoded
-
-            double motor_temp[6];
-            double controller_timer;
-            double testValue;
-            double robot_mode;
-            double joint_modes[6];
-
-
-
-            void fixByteOrder()
-            {
-                time = bedtoh(time);
-                controller_timer = bedtoh(controller_timer);
-                testValue = bedtoh(testValue);
-                robot_mode = bedtoh(robot_mode);
-
-                for (int i=0; i<3; i++)
-                {
-                    tool_acc[i] = bedtoh(tool_acc[i]);
-                }
-
-                for (int i=0; i < 6; i++)
-                {
-                    q_target[i] = bedtoh(q_target[i]);
-                    qd_target[i] = bedtoh(qd_target[i]);
-                    qdd_target[i] = bedtoh(qdd_target[i]);
-                    I_target[i] = bedtoh(I_target[i]);
-                    M_target[i] = bedtoh(M_target[i]);
-                    q_act[i] = bedtoh(q_act[i]);
-                    qd_act[i] = bedtoh(qd_act[i]);
-                    I_act[i] = bedtoh(I_act[i]);
-                    tcp_force[i] = bedtoh(tcp_force[i]);
-                    tool_pose[i] = bedtoh(tool_pose[i]);
-                    tool_vel[i] = bedtoh(tool_vel[i]);
-
-                    motor_temp[i] = bedtoh(motor_temp[i]);
-                    joint_modes[i] = bedtoh(joint_modes[i]);
-                }
-            }
-
-    }__attribute__((packed));
-
     //=================================================================
     // RobotState
     //=================================================================
@@ -361,6 +104,42 @@ namespace ur_driver
              */
             void setCartesianPosition(const CartesianPosition& cartesianPosition);
 
+            /**
+             * Get the flange pose (the cartesian position is the pose of the TCP).
+             * @return
+             */
+            CartesianPosition& getFlangePosition();
+
+            /**
+             * Set the flange pose.
+             * @param flangePosition
+             */
+            void setFlangePosition(const CartesianPosition& flangePosition);
+
+            /**
+             * Get the TCP offset (flange to TCP) configured on the robot controller.
+             * @return
+             */
+            CartesianPosition& getTcpOffset();
+
+            /**
+             * Set the TCP offset (flange to TCP) configured on the robot controller.
+             * @param tcpOffset
+             */
+            void setTcpOffset(const CartesianPosition& tcpOffset);
+
+            /**
+             * Check if the state contains the TCP offset of the controller (the realtime interface does not send it).
+             * @return
+             */
+            bool hasTcpOffset();
+
+            /**
+             * Get the latency trace (only recorded if latency tracing is enabled).
+             * @return
+             */
+            LatencyTrace& getLatencyTrace();
+
             bool get_IO(int i){
                 return IOS[i];
             }
@@ -375,10 +154,35 @@ namespace ur_driver
             JointPosition jointPosition;
             JointVelocity jointVelocity;
             CartesianPosition cartesianPosition;
+            CartesianPosition flangePosition;
+            CartesianPosition tcpOffset;
+            bool isTcpOffsetSet;
+            LatencyTrace latencyTrace;
 
             bool IOS[36]; // 0-7 digital input, 8-15 configurable input, 16-17 tool input, 18-25 digital output, 26-33 configurable output, 34-35 tool output
     };
 
+    //=================================================================
+    // ConnectorStatistics
+    //=================================================================
+    /**
+     * Counters of the data received by a connector since it was created.
+     */
+    class ConnectorStatistics
+    {
+        public:
+            ConnectorStatistics();
+
+            unsigned long long bytes;
+            unsigned long long frames;
+            unsigned long long robotStates;
+            unsigned long long decodeErrors; // corrupt frames
+            unsigned long long skippedMessages; // frames of other message types without a robot state (version, error codes, ...)
+            unsigned long long resyncs; // invalid frame sizes
+            unsigned long long discardedBytes; // bytes skipped to find the next frame
+            unsigned long long connections;
+    };
+
     //=================================================================
     // Connector
     //=================================================================
@@ -390,6 +194,13 @@ namespace ur_driver
     class Connector
     {
         public:
+            typedef enum DecodeResult
+            {
+                DECODED = 0,
+                SKIPPED = 1,        // valid frame without a robot state
+                DECODE_ERROR = 2
+            } DecodeResult;
+
             typedef enum InterfacePort
             {
                 PRIMARY = 30001,
@@ -415,14 +226,13 @@ namespace ur_driver
 
             /**
              * Connect to the robot controller on the given host address and port.
-             * Note: Currently only the connection to port 30002 is supported. (TODO)
+             * Note: Currently only the connections to port 30002 and 30003 are supported. (TODO)
              * @param host IP or DNS name of the robot controller.
              * @param port Port number for the connection. Usually 30001, 30002, 30003.
              * @param isDummy
-             * @param readFrequency
              * @param writeFrequency
              */
-            void connect(std::string host, int port, bool isDummy, double readFrequency, double writeFrequency);
+            void connect(std::string host, int port, bool isDummy, double writeFrequency);
 
             /**
              * Disconnect from the robot controller.
@@ -451,12 +261,95 @@ namespace ur_driver
                 signalRobotState.disconnect(boost::bind(member, object, _1));
             }
 
+            /**
+             * Set a flight recorder which records all received frames and all sent scripts.
+             * @param flightRecorder The flight recorder or NULL to disable recording.
+             */
+            void setFlightRecorder(FlightRecorder* flightRecorder);
+
+            /**
+             * Set a latency tracer which stamps the frame read and decode trace points of the robot states.
+             * @param latencyTracer The latency tracer or NULL to disable tracing.
+             */
+            void setLatencyTracer(LatencyTracer* latencyTracer);
+
+            /**
+             * Set a command tracer which stamps when the commands are taken from the queue and written to the socket.
+             * @param commandTracer The command tracer or NULL to disable tracing.
+             */
+            void setCommandTracer(CommandTracer* commandTracer);
+
+            /**
+             * Set the clock which paces the read and write threads (and the dummy server). Must be set before connecting.
+             * With a simulated clock the read thread processes the data as soon as it arrives.
+             * @param clock
+             */
+            void setClock(Clock* clock);
+
+            /**
+             * Set the transport to the robot controller. Must be set before connecting. Unix socket pairs and memory
+             * transports connect in the same process to a dummy server: the given one or the built-in one (isDummy).
+             * The built-in dummy server then does not listen on the port.
+             * @param type
+             * @param server External dummy server or NULL.
+             */
+            void setTransport(Transport::Type type, Dummy* server = NULL);
+
+            /**
+             * Set the executor which runs the reading and writing (and the in-process clients of the built-in dummy
+             * server), NULL for a read and a write thread per connection. The received data is processed as soon as it
+             * arrives, the read frequency is not used. The executor is not used with a simulated clock. Must be set
+             * before connecting.
+             * @param executor
+             */
+            void setExecutor(Executor* executor);
+
+            /**
+             * Get the statistics of the received data.
+             * @return
+             */
+            ConnectorStatistics getStatistics();
+
             /**
              * Notify all listeners with a robot state.
              * @param robotState The robot state to send to all listeners.
              */
             void notifyListeners(RobotState& robotState);
 
+            /**
+             * Process data received from the robot controller. The data is split into frames, incomplete frames are kept until
+             * the next call. Each complete frame is recorded, decoded and sent to all listeners. After an invalid frame size the
+             * data is skipped byte by byte until a valid frame size is found (on port 30003 the size of the previous frames).
+             * Used by the read socket thread and for replaying recorded data without a connection.
+             * @param port Port the data was received from (SECONDARY or REALTIME).
+             * @param data
+             * @param length
+             */
+            void processData(int port, const char* data, size_t length);
+
+            /**
+             * Decode a frame of port 30002 (without the 4 byte frame size). The frame is byte swapped in place.
+             * @param dataPackageContent
+             * @param packageSize
+             * @param robotState
+             * @return SKIPPED for other message types than robot state, DECODE_ERROR for a corrupt frame
+             */
+            static DecodeResult decodeSecondary(char* dataPackageContent, uint32_t packageSize, RobotState& robotState);
+
+            /**
+             * Decode a frame of port 30003 (without the 4 byte frame size).
+             * @param dataPackageContent
+             * @param packageSize
+             * @param robotState
+             * @return false if the frame is too short
+             */
+            static bool decodeRealtime(char* dataPackageContent, uint32_t packageSize, RobotState& robotState);
+
+            /**
+             * Maximum size of a frame, larger sizes are treated as corrupt data.
+             */
+            static const uint32_t MAX_FRAME_SIZE = 65536;
+
         private:
             Dummy dummy;
 
@@ -471,7 +364,8 @@ namespace ur_driver
             boost::thread writeSocketThread;
 
             boost::asio::io_service io;
-            boost::asio::ip::tcp::socket socket;
+            boost::shared_ptr<Transport> transport;
+            boost::mutex mutexTransport;
 
             bool isRunning;
 
@@ -481,8 +375,45 @@ namespace ur_driver
             std::string host;
             int port;
             bool isDummy;
-            double readFrequency;
             double writeFrequency;
+            Transport::Type transportType;
+            Dummy* server;
+
+            Clock* clock;
+
+            /*
+             * executor mode, the connect thread waits until the asynchronous read is finished
+             */
+            Executor* executor;
+            boost::shared_ptr<PeriodicTask> writeTask;
+            bool isReading;
+            char readData[4096];
+            boost::mutex mutexRead;
+            boost::condition_variable readCondition;
+
+            /*
+             * flight recorder
+             */
+            FlightRecorder* flightRecorder;
+
+            /*
+             * latency tracing
+             */
+            LatencyTracer* latencyTracer;
+            unsigned long frameSequence;
+            CommandTracer* commandTracer;
+
+            /*
+             * received data which does not form a complete frame yet
+             */
+            std::vector<char> receiveBuffer;
+            uint32_t realtimeFrameSize; // size of the realtime frames of the current connection, 0 if unknown
+
+            /*
+             * statistics
+             */
+            ConnectorStatistics statistics;
+            boost::mutex mutexStatistics;
 
             /*
              * signals
@@ -511,11 +442,46 @@ namespace ur_driver
              */
             void readSocketWorker();
 
+            /**
+             * Handler of the asynchronous read in executor mode.
+             * @param error
+             * @param length
+             */
+            void handleRead(const boost::system::error_code& error, size_t length);
+
+            /**
+             * Record bytes of the receive buffer which were skipped to find the next frame.
+             * @param port
+             * @param start
+             * @param end
+             */
+            void recordDiscarded(int port, size_t start, size_t end);
+
+            /**
+             * Record, decode and publish a complete frame.
+             * @param port
+             * @param frame Frame including the 4 byte frame size.
+             * @param frameSize
+             * @param readTimestamp Monotonic time the frame was read (only if latency tracing is enabled).
+             * @return SKIPPED if the frame does not contain a robot state, DECODE_ERROR if it is corrupt
+             */
+            DecodeResult processFrame(int port, char* frame, uint32_t frameSize, uint64_t readTimestamp);
+
             /**
              * Worker thread for writing to the socket.
              */
             void writeSocketWorker();
 
+            /**
+             * Step of the write task in executor mode.
+             */
+            void writeStep();
+
+            /**
+             * Write the next command of the queue to the socket.
+             */
+            void writeCommand();
+
             /**
              * Helper function to create a hex string from a char array.
              * @param data
@@ -0,0 +1,127 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Execution time of a command list without running it
+// ----------------------------------------------------------------------------
+
+#ifndef CYCLE_TIME_H_
+#define CYCLE_TIME_H_
+
+#include <vector>
+#include <stddef.h>
+
+namespace ur_driver
+{
+    //=================================================================
+    // CycleTimeEstimator
+    //=================================================================
+    /**
+     * Estimates the duration of each move of a command list with the trapezoidal velocity profiles of the controller.
+     * Consecutive moves of the same kind blend into each other (see BlendedMoveEstimator): linear moves (movel) in TCP
+     * space with the speed in [m/s], joint moves (movej) in joint space with the speed of the leading joint in [rad/s].
+     * The blend radius of joint moves is a TCP distance like the one of movej, in joint space it is scaled with the
+     * joint distance per TCP distance of the moves at the waypoint (without a TCP position the moves stop). The robot
+     * stops between moves of different kinds and around timed moves.
+     */
+    class CycleTimeEstimator
+    {
+        public:
+            CycleTimeEstimator();
+
+            /**
+             * Start a new list.
+             * @param q Joint positions of the robot [rad], NULL if unknown (the first move starts at its target)
+             * @param tcp TCP position of the robot [m], NULL if unknown
+             */
+            void reset(const double* q, const double* tcp);
+
+            /**
+             * Add a linear move.
+             * @param tcp Target TCP position [m]
+             * @param q Target joint positions [rad], NULL if unknown (the joints don't move)
+             * @param velocity [m/s]
+             * @param acceleration [m/s^2]
+             * @param radius Blend radius [m], 0 to stop at the target
+             */
+            void addLinear(const double* tcp, const double* q, double velocity, double acceleration, double radius);
+
+            /**
+             * Add a joint move.
+             * @param q Target joint positions [rad]
+             * @param tcp Target TCP position [m], NULL if unknown (the TCP doesn't move)
+             * @param velocity Speed of the leading joint [rad/s]
+             * @param acceleration [rad/s^2]
+             * @param radius Blend radius of the TCP [m]
+             */
+            void addJoint(const double* q, const double* tcp, double velocity, double acceleration, double radius);
+
+            /**
+             * Add a move with a given duration (timed linear move, speed command).
+             * @param q Target joint positions [rad], NULL if unknown
+             * @param tcp Target TCP position [m], NULL if unknown
+             * @param time [s]
+             */
+            void addTimed(const double* q, const double* tcp, double time);
+
+            /**
+             * Estimate the durations.
+             * @param durations One per move [s]
+             * @return total duration [s]
+             */
+            double estimate(std::vector<double>& durations);
+
+            /**
+             * Get the number of moves.
+             * @return
+             */
+            size_t getCount() const;
+
+        private:
+            enum MoveType
+            {
+                LINEAR,
+                JOINT,
+                TIMED
+            };
+
+            /*
+             * moves, the targets start with the robot position
+             */
+            std::vector<int> types;
+            std::vector<double> velocities;
+            std::vector<double> accelerations;
+            std::vector<double> radii;
+            std::vector<double> times;      // timed moves
+            std::vector<double> joints;     // 6 per target
+            std::vector<double> tcps;       // 3 per target
+            bool hasJoints;                 // a joint position is known
+            bool hasTcp;                    // a TCP position is known
+
+            /*
+             * one run of blended moves
+             */
+            std::vector<double> runPositions;
+            std::vector<double> runVelocities;
+            std::vector<double> runAccelerations;
+            std::vector<double> runRadii;
+            std::vector<double> runScales;  // joint distance per TCP distance of each joint move
+            std::vector<double> runDurations;
+
+            void addTarget(int type, const double* q, const double* tcp, double velocity, double acceleration, double radius, double time);
+            double estimateRun(size_t begin, size_t end, std::vector<double>& durations);
+    };
+}
+
+#endif
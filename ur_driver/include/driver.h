@@ -25,8 +25,11 @@
 #include <tf/transform_broadcaster.h>
 #include <actionlib/server/simple_action_server.h>
 
+#include <geometry_msgs/Pose.h>
 #include <geometry_msgs/TwistStamped.h>
 #include <sensor_msgs/JointState.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
+#include <rosgraph_msgs/Clock.h>
 
 #include <robot_movement_interface/EulerFrame.h>
 #include <robot_movement_interface/Command.h>
@@ -38,14 +41,28 @@
 
 #include <ur_driver/DigIOAction.h>
 #include <ur_driver/DigIOArrayAction.h>
+#include <ur_driver/CommandLatency.h>
+#include <ur_driver/EstimateCycleTime.h>
+#include <ur_driver/GetCommandTrace.h>
 
 #include <std_srvs/Empty.h>
 
 #include <connector.h>
+#include <message_pool.h>
+#include <kinematics.h>
+#include <waypoints.h>
+#include <servo.h>
+#include <teleop.h>
+#include <trajectory.h>
+#include <parameterization.h>
+#include <blending.h>
+#include <cycle_time.h>
+#include <move_stream.h>
 
 #include <boost/thread.hpp>
 #include <math.h>
 #include <assert.h>
+#include <set>
 
 namespace ur_driver
 {
@@ -60,18 +77,54 @@ namespace ur_driver
             std::string host;
             int port;
             bool isDummy;
+            bool simulatedClock;
+            std::string transport;
+            int executorThreads;
             std::vector<std::string> jointNames;
             std::string robotBaseFrameName;
             std::string robotFlangeFrameName;
             std::string robotTcpFrameName;
+            std::string tcpOffsetSource;
+            std::string kinematics;
+            bool checkWaypoints;
+            double blendTolerance;
+            bool servoMode;
+            std::string servoHost;
+            int servoPort;
+            double servoFrequency;
+            double servoLookahead;
+            double servoGain;
+            double servoTimeout;
+            int servoBufferDepth;
+            double servoAcceleration;
+            bool retimeCommandLists;
+            bool teleopMode;
+            int teleopPort;
+            double teleopFrequency;
+            double teleopAcceleration;
+            double teleopJerk;
+            int teleopWatchdogCycles;
+            int teleopStopCycles;
+            bool streamCommandLists;
+            int movePort;
+            double tcpOffsetUpdateFrequency;
             double robotReadFrequency;
             double robotWriteFrequency;
-            double publishStateFrequency;
+            int jointStatesDecimation;
+            int poseStateDecimation;
+            int toolFrameDecimation;
+            int tfDecimation;
             double velocity;
             double acceleration;
             double angleTolerance;
             double maxLinearVelocity;
             double maxAngularVelocity;
+            std::vector<double> jointMaxVelocity;
+            std::vector<double> jointMaxAcceleration;
+            std::string flightRecorderFile;
+            int flightRecorderSize;
+            bool latencyTracing;
+            bool commandTracing;
 
             /**
              * Constructor.
@@ -93,8 +146,9 @@ namespace ur_driver
         public:
             /**
              * Constructor.
+             * @param driverNodeHandle Node handle for the configuration and all topics, services and actions of the driver.
              */
-            Driver();
+            Driver(const ros::NodeHandle& driverNodeHandle);
 
             /**
              * Destructor.
@@ -103,9 +157,71 @@ namespace ur_driver
 
             /**
              * Starts a ROS spinner and blocks until the shutdown signal was received.
+             * Only used by the standalone node, the nodelet is spinned by the nodelet manager.
              */
             void spin();
 
+            /**
+             * Overwrite the numeric fields of a joint state message. The joint names and the sizes of the vectors must be
+             * initialized already, then no memory will be allocated.
+             * @param robotState
+             * @param stamp
+             * @param jointState
+             */
+            static void fillJointState(RobotState& robotState, const ros::Time& stamp, sensor_msgs::JointState& jointState);
+
+            /**
+             * Overwrite a pose state message (position and quaternion).
+             * @param robotState
+             * @param poseState
+             */
+            static void fillPoseState(RobotState& robotState, geometry_msgs::Pose& poseState);
+
+            /**
+             * Overwrite a tool frame message (position and euler intrinsic zyx).
+             * @param robotState
+             * @param toolFrame
+             */
+            static void fillToolFrame(RobotState& robotState, robot_movement_interface::EulerFrame& toolFrame);
+
+            /**
+             * Check if the robot reached the target of a command (within blending and tolerance).
+             * @param command
+             * @param robotState
+             * @param result
+             * @return
+             */
+            static bool isCommandFinished(const robot_movement_interface::Command& command, RobotState& robotState, int *result);
+
+            /**
+             * Check if the robot passed the target of a command between two robot states (within blending and
+             * tolerance like isCommandFinished). The robot states only sample the motion, so a robot which is fast at a
+             * blended target can pass it between them.
+             * @param command
+             * @param previousState
+             * @param robotState
+             * @param result
+             * @return
+             */
+            static bool isCommandPassed(const robot_movement_interface::Command& command, RobotState& previousState, RobotState& robotState, int *result);
+
+            /**
+             * Retime a command list of PTP moves to joint positions time optimally. A blended waypoint is passed within
+             * its blend radius (blending[0], a TCP distance scaled to joint space with the kinematics) and within half of
+             * the distance at which its command counts as finished (blending[1], see isCommandFinished).
+             * @param commands
+             * @param start Joint positions of the robot [rad]
+             * @param maxVelocity Per joint [rad/s]
+             * @param maxAcceleration Per joint [rad/s^2]
+             * @param frequency Rate of the servo program [Hz]
+             * @param model Kinematics to scale the blend radii, NONE only bounds the deviation by blending[1]
+             * @param trajectory
+             * @return false if the list can't be retimed
+             */
+            static bool retimeCommandList(const std::vector<robot_movement_interface::Command>& commands, const std::vector<double>& start,
+                const std::vector<double>& maxVelocity, const std::vector<double>& maxAcceleration, double frequency, Kinematics::Model model,
+                SplineTrajectory& trajectory);
+
         private:
        
             ros::NodeHandle nodeHandle;
@@ -126,14 +242,54 @@ namespace ur_driver
             Configuration configuration;
 
             RobotState lastRobotState;
-            tf::TransformListener tfListener;
+            unsigned long robotStateSequence;
+            boost::mutex mutexRobotState;
+            boost::condition_variable robotStateCondition;
+            RobotState publishedRobotState; // reused by the read handler of the connector on the executor
+
+            Kinematics::Model kinematicsModel; // NONE: pose of the controller
+            boost::shared_ptr<WaypointSolver> waypointSolver; // only if the waypoints are checked
+
+            boost::shared_ptr<tf::TransformListener> tfListener; // shared by the drivers of the process
             tf::TransformBroadcaster tfBroadcaster;
 
+            /*
+             * cached TCP offset (flange to TCP)
+             */
+            bool runTcpOffsetThread;
+            boost::thread tcpOffsetThread;
+            boost::shared_ptr<PeriodicTask> tcpOffsetTask;
+            std::string tcpOffsetFlangeFrameName;
+            std::string tcpOffsetTcpFrameName;
+            boost::mutex mutexTcpOffset;
+            tf::Transform transformFlange2Tcp;
+            ros::Time tcpOffsetTime;
+            bool isTcpOffsetValid;
+            bool isTfChanged;
+            boost::signals2::connection tfChangedConnection;
+
+            /*
+             * executor of the connector and the periodic work, shared by the drivers of the process (NULL: dedicated threads)
+             */
+            boost::shared_ptr<Executor> executor;
+
             /*
              * Connector
              */
+            FlightRecorder flightRecorder;
+            LatencyTracer latencyTracer;
+            CommandTracer commandTracer;
             Connector connector;
 
+            /*
+             * clock of the connector, the dummy server and the commander
+             */
+            SimulatedClock simulatedClock;
+            Clock* clock;
+            bool runClockPublishThread;
+            boost::thread clockPublishThread;
+            ros::Publisher clockPublisher;
+
             /*
              * Interface Input
              */
@@ -151,18 +307,48 @@ namespace ur_driver
             /*
              * Robot Movement Action v2 (2 topics) -> paq@ipa.fhg.de
              */
+            bool runCommandThread;
             boost::thread commandThread;
+            boost::shared_ptr<PeriodicTask> commandTask;
             boost::mutex commandMutex;
             std::vector<robot_movement_interface::Command> commandList;
             robot_movement_interface::Command commandActive;
 			bool isLastCommand;
 			robot_movement_interface::Command lastCommand;
+            RobotState commandRobotState;   // robot state of the last command step
             ros::Time lastCommandExecutionTime;
 
             bool isCommandActive;
 
             ros::Subscriber commandListSubscriber;
             ros::Publisher commandResultPublisher;
+            ros::ServiceServer estimateCycleTimeService;
+
+            /*
+             * servo streaming
+             */
+            ServoServer servoServer;
+            ros::Subscriber jointServoSubscriber;
+            double lastServoUpload; // clock time of the last upload of the servo program [s]
+            SplineTrajectory servoTrajectory;
+            double servoTrajectoryTime; // of the next sample of the servo trajectory [s], -1 if no trajectory is streamed
+            boost::mutex mutexServoTrajectory;
+            bool isCommandListRetimed; // the command list was retimed and streamed to the servo program
+
+            /*
+             * velocity teleoperation
+             */
+            ServoServer teleopServer;
+            VelocityTeleop teleop;
+            ros::Subscriber jointTeleopSubscriber;
+            double lastTeleopUpload; // clock time of the last upload of the speed program [s]
+
+            /*
+             * move streaming
+             */
+            MoveStreamServer moveStream;
+            double lastMoveUpload; // clock time of the last upload of the move program [s]
+            bool isCommandListStreamed; // the moves of the command list were streamed to the move program
 
             /*
              * Interface Output
@@ -171,6 +357,25 @@ namespace ur_driver
             ros::Publisher poseStatePublisher;
             ros::Publisher toolFrameStatePublisher;
 
+            MessagePool<sensor_msgs::JointState> jointStatePool;
+            MessagePool<geometry_msgs::Pose> poseStatePool;
+            MessagePool<robot_movement_interface::EulerFrame> toolFramePool;
+
+            ros::Publisher commandTracePublisher;
+            ros::ServiceServer commandTraceService;
+
+            /*
+             * diagnostics of all drivers of the process, published together on /diagnostics
+             */
+            class SharedDiagnostics
+            {
+                public:
+                    boost::mutex mutex;
+                    std::set<Driver*> drivers;
+                    ros::Publisher publisher;
+                    ros::WallTimer timer;
+            };
+
             /**
              * Callback for receiving a home command request from a client. (service server)
              * The home command will move the robot into the home position.
@@ -235,6 +440,145 @@ namespace ur_driver
              */
             void commandListCallback(const robot_movement_interface::CommandListConstPtr &msg);
 
+            /**
+             * Service for the execution time of a command list. The list is validated and prepared like on the
+             * command_list topic but not sent, the durations are estimated by CycleTimeEstimator.
+             * @param req
+             * @param res
+             * @return
+             */
+            bool estimateCycleTimeCallback(ur_driver::EstimateCycleTime::Request &req, ur_driver::EstimateCycleTime::Response &res);
+
+            /**
+             * Callback for receiving a joint setpoint of the servo mode. The joint positions of the first point are
+             * streamed to the servo program, which is uploaded again if it is not connected. Points with time stamps are
+             * a trajectory which is interpolated at the servo rate and replaces the previous one.
+             * @param msg
+             */
+            void jointServoCallback(const trajectory_msgs::JointTrajectory::ConstPtr &msg);
+
+            /**
+             * Fit the spline of a servo trajectory within the joint limits and start streaming it.
+             * @param points
+             * @param jointIndex Joint of each position of the points.
+             */
+            void setServoTrajectory(const std::vector<trajectory_msgs::JointTrajectoryPoint>& points, const std::vector<int>& jointIndex);
+
+            /**
+             * Stream a trajectory to the servo program, replaces the running one.
+             * @param trajectory
+             */
+            void startServoTrajectory(const SplineTrajectory& trajectory);
+
+            /**
+             * Retime a command list of PTP moves to joint positions time optimally from the current joint positions
+             * and stream it to the servo program. The commands stay in the command list for their results.
+             * @param commands
+             * @return false if the list can't be retimed, it is sent as a program then
+             */
+            bool streamCommandList(const std::vector<robot_movement_interface::Command>& commands);
+
+            /**
+             * Sample the servo trajectory for a cycle of the servo program (ServoServer::Generator).
+             * @param isFirst
+             * @param jointPosition
+             * @return false if no trajectory is streamed
+             */
+            bool servoStep(bool isFirst, std::vector<double>& jointPosition);
+
+            /**
+             * Upload the servo program, which connects to the servo server.
+             */
+            void uploadServoProgram();
+
+            /**
+             * Callback for receiving a joint velocity of the teleoperation. The velocities of the first point replace the
+             * previous ones, the speed program is uploaded again if it is not connected.
+             * @param msg
+             */
+            void jointTeleopCallback(const trajectory_msgs::JointTrajectory::ConstPtr &msg);
+
+            /**
+             * Compute the velocity of a cycle of the speed program (ServoServer::Generator).
+             * @param isFirst
+             * @param velocity
+             * @return false if the robot is at rest after the watchdog stopped it
+             */
+            bool teleopStep(bool isFirst, std::vector<double>& velocity);
+
+            /**
+             * Upload the speed program, which connects to the teleoperation server.
+             */
+            void uploadTeleopProgram();
+
+            /**
+             * Get the streamed moves of a command list.
+             * @param commands
+             * @param start Index of the first streamed command
+             * @param moves
+             * @return false if the list has other commands than LIN and PTP moves with JOINTS or EULER_INTRINSIC_ZYX poses
+             * of 6 values and a velocity, an acceleration and a blending, it is sent as a program then
+             */
+            bool getStreamedMoves(const std::vector<robot_movement_interface::Command>& commands, size_t start, std::vector<StreamedMove>& moves);
+
+            /**
+             * Result of streamCommandMoves.
+             */
+            typedef enum StreamResult
+            {
+                STREAMED = 0, // the moves are queued for the move program
+                NOT_STREAMED = 1, // the command list is sent as a program
+                REJECTED = 2 // invalid or unreachable, the previous list continues
+            } StreamResult;
+
+            /**
+             * Stream the moves of the command list to the move program, they replace the queued moves and the robot
+             * blends into them without stopping. If the previous list was streamed as well, the moves which were sent to
+             * the controller are committed and stay at the front of the command list for their results. The new moves
+             * are checked behind them (blend radii from the last committed waypoint, waypoints through the committed
+             * moves) while the queued moves of the previous list keep the program going, and replace them only if the
+             * program took none meanwhile, otherwise they are checked again. The program is uploaded if it is not
+             * connected.
+             * @param previousCommands Command list which is replaced
+             * @param receivedTimestamp For the command tracer
+             * @return NOT_STREAMED if the list has other commands than LIN and PTP moves with JOINTS or
+             * EULER_INTRINSIC_ZYX poses of 6 values and a velocity, an acceleration and a blending or if the blend of the
+             * last committed move overlaps the first new move
+             */
+            StreamResult streamCommandMoves(const std::vector<robot_movement_interface::Command>& previousCommands, uint64_t receivedTimestamp);
+
+            /**
+             * Get the traced command ids of a command list.
+             * @param commands
+             * @param start Index of the first command
+             * @param commandIds The ids >= 0 are appended
+             */
+            void getCommandIds(const std::vector<robot_movement_interface::Command>& commands, size_t start, std::vector<int>& commandIds);
+
+            /**
+             * Reset the command list after a rejected streamed list.
+             * @param previousCommands Command list which was to be replaced
+             * @param isSpliced The previous list is streamed to the connected program and continues
+             */
+            void rejectStreamedCommands(const std::vector<robot_movement_interface::Command>& previousCommands, bool isSpliced);
+
+            /**
+             * Get the largest blend radius of the first move after the moves committed to the move program: the blend
+             * of the last committed move and the blend of the first move may cover BLEND_MARGIN of the segment between
+             * their waypoints together.
+             * @param commands Committed moves followed by the new moves
+             * @param committed Number of committed moves, at least one
+             * @param radius [m]
+             * @return false if the blend of the last committed move alone overlaps the segment or the waypoints are not
+             * known, the new moves can't follow the committed ones then
+             */
+            bool getSpliceBlendLimit(const std::vector<robot_movement_interface::Command>& commands, size_t committed, double& radius);
+
+            /**
+             * Upload the move program, which connects to the move stream server.
+             */
+            void uploadMoveProgram();
+
             /**
              * Callback for receiving a digital IO goal from a client. (action server)
              * Set digital IO of the robot.
@@ -242,17 +586,179 @@ namespace ur_driver
              */
             void executeDigIo(const ur_driver::DigIOGoalConstPtr &goal);
 
+            /**
+             * Worker thread for publishing the simulated time on /clock.
+             */
+            void clockPublishWorker();
+
             /**
              * Worker thread for publishing the robot state.
+             * Waits for a new robot state from the connector and publishes it immediately, reduced by the configured decimation factors.
              */
             void robotStatePublishWorker();
 
+            /**
+             * Publish a robot state, reduced by the configured decimation factors.
+             * @param robotState
+             * @param sequence Number of the robot state since the start.
+             */
+            void publishRobotState(RobotState& robotState, unsigned long sequence);
+
+            /**
+             * Check if the robot state with the given sequence number has to be published on an output.
+             * @param sequence
+             * @param decimation Publish every n-th state, 0 disables the output.
+             * @return
+             */
+            static bool isPublishCycle(unsigned long sequence, int decimation);
+
+            /**
+             * Publish the joint state.
+             * @param robotState
+             * @param stamp
+             */
+            void publishJointState(RobotState& robotState, const ros::Time& stamp);
+
+            /**
+             * Publish the pose state (position and quaternion).
+             * @param robotState
+             */
+            void publishPoseState(RobotState& robotState);
+
+            /**
+             * Publish the tool frame (position and euler intrinsic zyx).
+             * @param robotState
+             */
+            void publishToolFrame(RobotState& robotState);
+
+            /**
+             * Broadcast the TCP frame of the robot state in TF.
+             * @param robotState
+             * @param stamp
+             */
+            void broadcastTcpFrame(RobotState& robotState, const ros::Time& stamp);
+
+            /**
+             * Worker thread for updating the cached TCP offset from TF.
+             * The lookup is repeated only if TF changed or the frame names were changed on the parameter server. The state
+             * publisher never waits for TF.
+             */
+            void tcpOffsetWorker();
+
+            /**
+             * Update the cached TCP offset once.
+             * @param timeout Maximum time to wait for TF.
+             */
+            void tcpOffsetStep(const ros::Duration& timeout);
+
+            /**
+             * Get the TF listener of the process. It is created on first use and destroyed with its last user.
+             * @return
+             */
+            static boost::shared_ptr<tf::TransformListener> getSharedTransformListener();
+
+            /**
+             * Callback for receiving a notification when TF changed. Invalidates the cached TCP offset only if the
+             * transform from the flange to the TCP changed.
+             */
+            void tfChangedListener();
+
+            /**
+             * Get the TCP offset (flange to TCP) from the configured source.
+             * @param robotState
+             * @param transform
+             * @return false if no valid TCP offset is available
+             */
+            bool getTcpOffset(RobotState& robotState, tf::Transform& transform);
+
+            /**
+             * Get the TCP position of a flange pose.
+             * @param pose Position [m] and axis angle [rad] of the flange
+             * @param tcpOffset
+             * @param tcp Position [m]
+             */
+            void getTcpPosition(const double* pose, const tf::Transform& tcpOffset, double* tcp);
+
+            /**
+             * Transform a pose (pose * transform), e.g. a flange pose into a TCP pose.
+             * @param pose Position [m] and axis angle [rad]
+             * @param transform
+             * @param result Position [m] and axis angle [rad]
+             */
+            static void transformPose(const double* pose, const tf::Transform& transform, double* result);
+
+            /**
+             * Convert a pose into a transform.
+             * @param pose Position [m] and axis angle [rad]
+             * @return
+             */
+            static tf::Transform poseToTransform(const double* pose);
+
             /**
              * Callback for receiving continuously robot state updates from the connector.
              * @param robotState
              */
             void robotStateListener(const RobotState& robotState);
 
+            /**
+             * Add the latency histograms and the servo buffer state of the last period to the diagnostics.
+             * @param diagnostics
+             */
+            void addDiagnostics(diagnostic_msgs::DiagnosticArray& diagnostics);
+
+            static SharedDiagnostics& getSharedDiagnostics();
+
+            /**
+             * Add or remove a driver whose diagnostics are published. The statuses of all drivers of the process are
+             * published in one message on /diagnostics once per second.
+             * @param driver
+             * @param add
+             */
+            static void registerDiagnostics(Driver* driver, bool add);
+
+            /**
+             * Callback for publishing the diagnostics of all registered drivers.
+             * @param event
+             */
+            static void publishDiagnostics(const ros::WallTimerEvent& event);
+
+            /**
+             * Claim or release /clock for the simulated clock of a driver. Only one driver of the process publishes
+             * /clock.
+             * @param claim
+             * @return false if another driver of the process publishes /clock
+             */
+            static bool claimClockTopic(bool claim);
+
+            /**
+             * Add count, mean, percentiles and maximum of a histogram to a diagnostic status.
+             * @param status
+             * @param name
+             * @param histogram
+             */
+            static void addHistogramValues(diagnostic_msgs::DiagnosticStatus& status, const std::string& name, const LatencyHistogram& histogram);
+
+            /**
+             * Finish the trace of a command and publish it.
+             * @param commandId
+             */
+            void publishCommandTrace(int commandId);
+
+            /**
+             * Service for the stage durations of a command which is traced.
+             * @param req
+             * @param res
+             * @return
+             */
+            bool getCommandTraceCallback(ur_driver::GetCommandTrace::Request &req, ur_driver::GetCommandTrace::Response &res);
+
+            /**
+             * Get the duration of each stage of a command trace, a stage which was not passed is 0.
+             * @param trace
+             * @param latency
+             */
+            static void getCommandLatency(const CommandTrace& trace, ur_driver::CommandLatency& latency);
+
             /**
              * Callback for receiving signal. When SIGINT was received shutdown everything.
              * @param signal
@@ -263,7 +769,46 @@ namespace ur_driver
              * Worker thread for robot movement action v2
              */
             void commandThreadWorker();
-            bool isCommandFinished(robot_movement_interface::Command command, int *result);
+
+            /**
+             * Check once if the active command is finished and publish its result.
+             */
+            void commandStep();
+
+            /**
+             * Solve the waypoints of a command list from the current joint positions and publish an error result for
+             * the first unreachable or branch flipping waypoint.
+             * @param commands
+             * @return false if the list is rejected
+             */
+            bool isCommandListReachable(const std::vector<robot_movement_interface::Command>& commands);
+
+            /**
+             * Get the waypoints of the moves of a command list.
+             * @param commands
+             * @param tcpOffset
+             * @param waypoints One per command, unknown for other commands
+             */
+            void getWaypoints(const std::vector<robot_movement_interface::Command>& commands, const tf::Transform& tcpOffset, std::vector<Waypoint>& waypoints);
+
+            /**
+             * Replace the blend radii of a command list of moves by the largest radii which deviate at most
+             * blendTolerance from the waypoints and don't overlap (see BlendOptimizer). Lists with other commands are not changed.
+             * @param commands
+             * @param start Index of the first optimized command, the moves start at the waypoint of the command before
+             * it instead of the robot position
+             */
+            void optimizeBlending(std::vector<robot_movement_interface::Command>& commands, size_t start = 0);
+
+            /**
+             * Get the TCP position of the waypoint of a move.
+             * @param command
+             * @param tcpOffset
+             * @param tcp Position [m]
+             * @return false if the pose type is unknown or joint positions can't be converted without the kinematics
+             */
+            bool getWaypointPosition(const robot_movement_interface::Command& command, const tf::Transform& tcpOffset, double* tcp);
+
 			int processCommand(robot_movement_interface::Command command, ur_driver::Command * result);  
 			void replaceQuaternions(std::vector<robot_movement_interface::Command> & list);
 			void transformQuaternionToEulerIntrinsicZYX(float qx, float qy, float qz, float qw, float * z, float * y, float * x );
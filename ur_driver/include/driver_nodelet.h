@@ -0,0 +1,45 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// This file contains the nodelet wrapper of the driver
+// ----------------------------------------------------------------------------
+
+#ifndef DRIVER_NODELET_H_
+#define DRIVER_NODELET_H_
+
+#include <nodelet/nodelet.h>
+#include <boost/shared_ptr.hpp>
+
+#include <driver.h>
+
+namespace ur_driver
+{
+    /**
+     * Nodelet which runs the driver inside a nodelet manager. Nodelets in the same manager exchange the state
+     * and command messages of the driver by pointer without serialization.
+     */
+    class DriverNodelet : public nodelet::Nodelet
+    {
+        private:
+            boost::shared_ptr<Driver> driver;
+
+            /**
+             * Create the driver with the multi threaded node handle of the nodelet.
+             */
+            virtual void onInit();
+    };
+}
+
+#endif
@@ -19,26 +19,181 @@
 #ifndef DUMMY_H_
 #define DUMMY_H_
 
+#include <string>
+#include <vector>
+#include <deque>
+
 #include <boost/smart_ptr.hpp>
 #include <boost/asio.hpp>
 #include <boost/thread/thread.hpp>
 
+#include <simulator.h>
+#include <clock.h>
+#include <transport.h>
+#include <executor.h>
+
 namespace ur_driver
 {
+    /**
+     * Load and faults generated by the dummy server for stress tests. The default sends valid frames at the native rate.
+     * Probabilities are per frame (truncate, corrupt) or per write (stall, disconnect).
+     */
+    class DummyLoad
+    {
+        public:
+            DummyLoad();
+
+            double frequency; // frames per second and client, 0 for the native rate of the port
+            int coalesceFrames; // frames per write
+            int fragmentSize; // maximum bytes per write, 0 writes all frames at once
+            double truncateProbability; // a truncated frame breaks the frame boundaries
+            double corruptProbability; // flip a random bit of a frame
+            double stallProbability;
+            double stallDuration; // [s] the frames missed during the stall are sent as a burst
+            double disconnectProbability; // reset the connection
+            unsigned int seed;
+    };
+
+    /**
+     * Counters of the data sent by the dummy server since it was started.
+     */
+    class DummyStatistics
+    {
+        public:
+            DummyStatistics();
+
+            unsigned long long clients;
+            unsigned long long frames;
+            unsigned long long bytes;
+            unsigned long long truncatedFrames;
+            unsigned long long corruptFrames;
+            unsigned long long stalls;
+            unsigned long long disconnects;
+    };
+
+    /**
+     * State of a client connected to the dummy server. It is used either by a read and a write thread or by an
+     * asynchronous read and a periodic task on the executor.
+     */
+    class DummyClient
+    {
+        public:
+            DummyClient(boost::shared_ptr<Transport> transport, unsigned int seed);
+
+            boost::shared_ptr<Transport> transport;
+            unsigned int seed; // random numbers of the faults
+
+            /*
+             * read
+             */
+            ScriptParser parser;
+            std::vector<ScriptInstruction> program;
+            char data[1024];
+
+            /*
+             * write
+             */
+            std::string frame;
+            std::string buffer;
+            bool isRealtime;
+            double frequency;
+            int coalesceFrames;
+            bool isStalled;
+            double stallEnd;
+            bool isWriting;
+            boost::shared_ptr<PeriodicTask> writeTask; // destroyed first, it uses the client
+    };
+
+    /**
+     * Parameters of a servo, speed or move program (see CommandServoProgram, CommandSpeedProgram, CommandMoveProgram)
+     * emulated by the dummy server.
+     */
+    class DummyServoProgram
+    {
+        public:
+            DummyServoProgram();
+
+            double cycleTime; // [s]
+            double lookahead; // [s]
+            int capacity; // setpoints buffered by the program, 0 executes the latest setpoint
+            bool isMoveStream; // move program (see CommandMoveProgram)
+            ScriptInstruction motion; // servoj or speedj of the loop
+            std::vector<ScriptInstruction> end; // instructions after the servo loop
+    };
+
+    /**
+     * Dummy robot controller. The received script is executed by a kinematic simulation, the robot state is sent at the
+     * native rate of the port (30003: 125 Hz realtime packets, otherwise 10 Hz robot state messages).
+     * Several clients can connect at the same time, each one gets its own stream. Clients connect to the TCP port or,
+     * in the same process, through a Unix socket pair or a memory transport. In-process clients run on an executor if
+     * one is set, the clients of the port always get their own threads.
+     * The servo program (see CommandServoProgram) is emulated: the dummy connects to the ServoServer and executes one
+     * received setpoint per cycle and requests the next one (buffered: plays them one per cycle and reports the fill
+     * level) until the stream stops or another program arrives. The speed program is emulated the same way, each velocity is executed with speedj. The
+     * move program (see CommandMoveProgram) reads the next move when the active one has no successor and appends it to
+     * the simulated program, so the moves blend.
+     */
     class Dummy {
         public:
             Dummy();
             ~Dummy();
 
-            void start(int port);
+            /**
+             * Start the server.
+             * @param port Port of the robot controller which is simulated.
+             * @param isListening Accept TCP connections on the port. Otherwise only in-process clients can connect.
+             */
+            void start(int port, bool isListening = true);
             void stop();
 
+            /**
+             * Connect an in-process client. A TCP transport connects to the port of the server.
+             * @param type
+             * @return the client end of the connection, NULL if the server is not running
+             */
+            boost::shared_ptr<Transport> connect(Transport::Type type);
+
+            /**
+             * Set the load and faults of the sent data. Must be set before the server is started.
+             * @param load
+             */
+            void setLoad(const DummyLoad& load);
+
+            /**
+             * Set the clock which paces the sent data and the simulation. Must be set before the server is started.
+             * @param clock
+             */
+            void setClock(Clock* clock);
+
+            /**
+             * Set the executor which runs the in-process clients, NULL for a read and a write thread per client.
+             * It is not used with a simulated clock. Must be set before the server is started.
+             * @param executor
+             */
+            void setExecutor(Executor* executor);
+
+            /**
+             * Get the statistics of the sent data.
+             * @return
+             */
+            DummyStatistics getStatistics();
+
+            /**
+             * Create the robot state frame of port 30002 which is sent by the dummy.
+             * @return
+             */
+            static std::string createRobotStateFrame();
+
+            /**
+             * Get the simulation of the dummy.
+             * @return
+             */
+            Simulator& getSimulator();
+
         private:
             bool runReadSocketThread;
             bool runWriteSocketThread;
             boost::thread acceptSocketThread;
-            boost::thread readSocketThread;
-            boost::thread writeSocketThread;
 
             boost::asio::io_service io;
 
@@ -47,11 +202,100 @@ namespace ur_driver
 
             boost::mutex mutexStartStop;
 
-            void readSocketWorker(boost::shared_ptr<boost::asio::ip::tcp::socket> socket);
-            void writeSocketWorker(boost::shared_ptr<boost::asio::ip::tcp::socket> socket);
+            Simulator simulator;
+            Clock* clock;
+            Executor* executor;
+
+            /*
+             * connected clients
+             */
+            std::vector<boost::shared_ptr<DummyClient> > clients;
+            std::vector<boost::shared_ptr<boost::thread> > clientThreads;
+            int executorClients; // clients whose asynchronous read has not finished
+            boost::mutex mutexClients;
+            boost::condition_variable clientCondition;
+
+            /*
+             * load generation
+             */
+            DummyLoad load;
+            DummyStatistics statistics;
+            boost::mutex mutexStatistics;
+
+            /*
+             * servo program
+             */
+            boost::shared_ptr<TcpTransport> servoTransport;
+            boost::thread servoThread;
+            boost::thread servoPlayThread; // buffered program
+            bool runServoThread;
+            boost::mutex mutexServo;
+            std::deque<std::vector<double> > servoBuffer;
+            int servoReceived; // sequence number of the last buffered setpoint
+            bool isServoReading;
+            bool isServoStopped;
+            boost::mutex mutexServoBuffer;
+
+            void readSocketWorker(boost::shared_ptr<DummyClient> client);
+            void handleRead(boost::shared_ptr<DummyClient> client, const boost::system::error_code& error, size_t length);
+            void executeScripts(DummyClient& client, size_t length);
+
+            /**
+             * Start the emulation of a servo, speed or move program, a running one is stopped.
+             * @param program
+             * @return false if the program is not a servo program
+             */
+            bool startServo(const std::vector<ScriptInstruction>& program);
+
+            /**
+             * Stop the emulation of a servo program without executing its end.
+             */
+            void stopServo();
+
+            /**
+             * Read the setpoints of the ServoServer until the stream stops, without buffer one per cycle with a report
+             * after each one. Then the program without buffer executes its end.
+             * @param transport
+             * @param servo
+             */
+            void servoWorker(boost::shared_ptr<TcpTransport> transport, DummyServoProgram servo);
+
+            /**
+             * Play the buffer of the buffered program at the cycle time and report the fill level. When the stream
+             * stopped or ended and the buffer is empty, execute the end of the program.
+             * @param transport
+             * @param servo
+             */
+            void servoPlayWorker(boost::shared_ptr<TcpTransport> transport, DummyServoProgram servo);
+
+            /**
+             * Read and acknowledge the moves of the MoveStreamServer and append them to the simulated program until
+             * the stream stops. Then the program executes its end.
+             * @param transport
+             * @param servo
+             */
+            void moveWorker(boost::shared_ptr<TcpTransport> transport, DummyServoProgram servo);
+
+            void writeSocketWorker(boost::shared_ptr<DummyClient> client);
+            void writeStep(DummyClient* client);
+
+            /**
+             * Write the frames of one cycle.
+             * @param client
+             * @return false if the connection is finished
+             */
+            bool writeFrames(DummyClient& client);
+            void addStatistics(const DummyStatistics& sent);
 
             void acceptSocketWorker(boost::asio::io_service& io);
-            void handleAccept(const boost::system::error_code& error, boost::shared_ptr<boost::asio::ip::tcp::socket> socket, boost::asio::ip::tcp::acceptor& acceptor);
+            void handleAccept(const boost::system::error_code& error, boost::shared_ptr<TcpTransport> transport, boost::asio::ip::tcp::acceptor& acceptor);
+
+            /**
+             * Start the worker threads or the executor work of a connected client.
+             * @param transport
+             * @param isExecutorClient
+             */
+            void addClient(boost::shared_ptr<Transport> transport, bool isExecutorClient);
     };
 }
 
@@ -0,0 +1,117 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Thread pool which runs the I/O and the periodic work of several drivers
+// ----------------------------------------------------------------------------
+
+#ifndef EXECUTOR_H_
+#define EXECUTOR_H_
+
+#include <boost/asio.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/function.hpp>
+#include <boost/smart_ptr.hpp>
+#include <boost/thread.hpp>
+
+namespace ur_driver
+{
+    //=================================================================
+    // Executor
+    //=================================================================
+    /**
+     * Pool of threads which run the handlers of an io_service: asynchronous reads and periodic tasks. Several
+     * connectors, dummy servers and drivers share one executor instead of running their own threads.
+     * The handlers must not block for long, each blocking handler occupies one thread of the pool.
+     */
+    class Executor
+    {
+        public:
+            /**
+             * Constructor, starts the threads.
+             * @param threads Number of threads, 0 for one thread per CPU.
+             */
+            Executor(int threads = 0);
+
+            /**
+             * Destructor, waits for the pending handlers and stops the threads. All users must have stopped their work
+             * (closed their transports and stopped their tasks) before.
+             */
+            ~Executor();
+
+            boost::asio::io_service& getIoService();
+
+            int getThreadCount();
+
+            /**
+             * Get the executor of the process. It is created on first use and destroyed with its last user.
+             * @param threads Number of threads if the executor is created, 0 for one thread per CPU.
+             * @return
+             */
+            static boost::shared_ptr<Executor> getShared(int threads = 0);
+
+        private:
+            boost::asio::io_service io;
+            boost::scoped_ptr<boost::asio::io_service::work> work;
+            boost::thread_group threads;
+            int threadCount;
+
+            void runWorker();
+    };
+
+    //=================================================================
+    // PeriodicTask
+    //=================================================================
+    /**
+     * Calls a function at a fixed frequency on an executor. Missed cycles are skipped. A step never runs in parallel to
+     * itself.
+     */
+    class PeriodicTask
+    {
+        public:
+            /**
+             * Constructor.
+             * @param executor
+             * @param frequency
+             * @param step
+             */
+            PeriodicTask(Executor* executor, double frequency, const boost::function<void()>& step);
+
+            /**
+             * Destructor, stops the task.
+             */
+            ~PeriodicTask();
+
+            /**
+             * Start the task, the first step runs after one period.
+             */
+            void start();
+
+            /**
+             * Stop the task. Waits until a running step is finished, unless it is called by the step.
+             */
+            void stop();
+
+        private:
+            /*
+             * shared with the pending timer handler, which may run after the task was destroyed
+             */
+            class State;
+            boost::shared_ptr<State> state;
+
+            static void handleTimer(boost::shared_ptr<State> state, unsigned long generation, const boost::system::error_code& error);
+    };
+}
+
+#endif
@@ -0,0 +1,204 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Flight recorder for the raw data exchanged with the robot controller
+// ----------------------------------------------------------------------------
+
+#ifndef FLIGHT_RECORDER_H_
+#define FLIGHT_RECORDER_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <boost/thread.hpp>
+
+namespace ur_driver
+{
+    //=================================================================
+    // File format
+    //=================================================================
+    /**
+     * Header at the beginning of a flight recorder file. The records are stored in a ring behind the header.
+     * The ring contains the records from tailOffset to headOffset (usedBytes bytes), oldest first.
+     */
+    class FlightRecorderFileHeader
+    {
+        public:
+            char magic[8];
+            uint32_t version;
+            uint32_t headerSize;
+            uint64_t capacity;
+            uint64_t headOffset;
+            uint64_t tailOffset;
+            uint64_t usedBytes;
+            uint64_t sequence;
+            uint64_t droppedRecords;
+    } __attribute__((packed));
+
+    /**
+     * Header of a single record. The payload follows the header, records are aligned to 8 bytes.
+     */
+    class FlightRecorderRecordHeader
+    {
+        public:
+            typedef enum RecordType
+            {
+                PADDING = 0,
+                FRAME = 1,
+                SCRIPT = 2,
+                DISCARDED = 3       // received bytes skipped to find the next frame
+            } RecordType;
+
+            uint32_t magic;
+            uint16_t type;
+            uint16_t source;
+            uint32_t length;
+            uint32_t reserved;
+            uint64_t sequence;
+            uint64_t timestamp;
+    } __attribute__((packed));
+
+    //=================================================================
+    // FlightRecorder
+    //=================================================================
+    /**
+     * Records the raw frames received from and the scripts sent to the robot controller into a fixed-size, memory-mapped
+     * ring file. Received bytes between frames (corrupt data) are recorded as they are, so the received stream can be
+     * replayed completely. Recording is a memory copy, there are no system calls per record. Because the file is mapped shared,
+     * all completed records are in the file even if the process crashes. The oldest records are overwritten.
+     */
+    class FlightRecorder
+    {
+        public:
+            /**
+             * Constructor.
+             */
+            FlightRecorder();
+
+            /**
+             * Destructor.
+             */
+            ~FlightRecorder();
+
+            /**
+             * Create (or overwrite) the recorder file and map it into memory.
+             * @param fileName
+             * @param capacity Size of the record ring in bytes.
+             * @return false if the file could not be created
+             */
+            bool open(const std::string& fileName, uint64_t capacity);
+
+            /**
+             * Flush and unmap the recorder file.
+             */
+            void close();
+
+            /**
+             * Check if the recorder is open.
+             * @return
+             */
+            bool isOpen();
+
+            /**
+             * Append a record with the current time.
+             * @param type
+             * @param source Port of the connection.
+             * @param data
+             * @param length
+             */
+            void record(FlightRecorderRecordHeader::RecordType type, uint16_t source, const char* data, uint32_t length);
+
+        private:
+            int fileDescriptor;
+            char* memory;
+            uint64_t mappedSize;
+            FlightRecorderFileHeader* header;
+            char* ring;
+
+            boost::mutex mutexRecord;
+
+            /**
+             * Drop the oldest records until the ring range from the head offset to the given end offset is free.
+             * @param end
+             */
+            void freeUntil(uint64_t end);
+    };
+
+    //=================================================================
+    // FlightRecorderReader
+    //=================================================================
+    /**
+     * A single record read from a flight recorder file.
+     */
+    class FlightRecorderRecord
+    {
+        public:
+            FlightRecorderRecordHeader::RecordType type;
+            uint16_t source;
+            uint64_t sequence;
+            uint64_t timestamp;
+            std::vector<char> data;
+    };
+
+    /**
+     * Reads the records of a flight recorder file from the oldest to the newest record.
+     */
+    class FlightRecorderReader
+    {
+        public:
+            /**
+             * Constructor.
+             */
+            FlightRecorderReader();
+
+            /**
+             * Destructor.
+             */
+            ~FlightRecorderReader();
+
+            /**
+             * Open a flight recorder file.
+             * @param fileName
+             * @return false if the file is not a valid flight recorder file
+             */
+            bool open(const std::string& fileName);
+
+            /**
+             * Read the next record.
+             * @param record
+             * @return false if there are no more records
+             */
+            bool next(FlightRecorderRecord& record);
+
+        private:
+            std::vector<char> file;
+            FlightRecorderFileHeader header;
+            uint64_t offset;
+            uint64_t remainingBytes;
+    };
+
+    /**
+     * Size of a record in the ring including header and alignment.
+     * @param length Payload length.
+     * @return
+     */
+    inline uint64_t flightRecorderRecordSize(uint32_t length)
+    {
+        return (sizeof(FlightRecorderRecordHeader) + length + 7) & ~((uint64_t)7);
+    }
+}
+
+#endif
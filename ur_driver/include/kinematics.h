@@ -0,0 +1,572 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Header-only forward kinematics of the UR5 and UR10
+// ----------------------------------------------------------------------------
+
+#ifndef KINEMATICS_H_
+#define KINEMATICS_H_
+
+#include <rotation.h>
+
+#include <cmath>
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <cstddef>
+
+namespace ur_driver
+{
+    /**
+     * |sin(q5)| below which the wrist is singular (joint 4 and 6 aligned), the inverse kinematics keep the given q6.
+     */
+    static const double KINEMATICS_WRIST_SINGULAR = 1e-10;
+
+    /**
+     * Tolerance of the arguments of acos at the boundary of the workspace.
+     */
+    static const double KINEMATICS_BOUNDARY = 1e-10;
+
+    //=================================================================
+    // robot parameters
+    //=================================================================
+    /*
+     * Denavit-Hartenberg parameters of the robots (see ur_description/urdf/ur5.urdf.xacro and ur10.urdf.xacro). The
+     * remaining parameters are the same for all models: alpha = (pi/2, 0, 0, pi/2, -pi/2, 0), a1 = a4 = a5 = a6 = 0 and
+     * d2 = d3 = 0. The functions return constants, so the kinematics are specialized at compile time.
+     */
+
+    /**
+     * Parameters of the UR5 in [m].
+     */
+    class Ur5Parameters
+    {
+        public:
+            static inline double d1() { return 0.089159; }
+            static inline double a2() { return -0.42500; }
+            static inline double a3() { return -0.39225; }
+            static inline double d4() { return 0.10915; }
+            static inline double d5() { return 0.09465; }
+            static inline double d6() { return 0.0823; }
+    };
+
+    /**
+     * Parameters of the UR10 in [m].
+     */
+    class Ur10Parameters
+    {
+        public:
+            static inline double d1() { return 0.1273; }
+            static inline double a2() { return -0.612; }
+            static inline double a3() { return -0.5723; }
+            static inline double d4() { return 0.163941; }
+            static inline double d5() { return 0.1157; }
+            static inline double d6() { return 0.0922; }
+    };
+
+    //=================================================================
+    // batches (struct of arrays)
+    //=================================================================
+    /**
+     * Joint positions stored as one array per joint.
+     */
+    class JointBatch
+    {
+        public:
+            std::vector<double> q[6];
+
+            inline void resize(size_t size)
+            {
+                for (int i = 0; i < 6; i++)
+                {
+                    q[i].resize(size);
+                }
+            }
+
+            inline size_t size() const
+            {
+                return q[0].size();
+            }
+    };
+
+    /**
+     * Poses (position and axis angle) stored as separate arrays.
+     */
+    class PoseBatch
+    {
+        public:
+            Vector3Batch position;
+            Vector3Batch rotation;
+
+            inline void resize(size_t size)
+            {
+                position.resize(size);
+                rotation.resize(size);
+            }
+
+            inline size_t size() const
+            {
+                return position.size();
+            }
+    };
+
+    /**
+     * Up to 8 joint solutions of the inverse kinematics. The branches are the combinations of the bits SHOULDER (arm on
+     * the other side of the base), WRIST (flipped wrist, sin(q5) < 0) and ELBOW (sin(q3) < 0). The joints are in [-pi, pi).
+     */
+    class InverseSolutions
+    {
+        public:
+            enum Branch
+            {
+                SHOULDER = 1,
+                WRIST = 2,
+                ELBOW = 4
+            };
+
+            int count;
+            double q[8][6];
+            int branch[8];
+    };
+
+    //=================================================================
+    // UrKinematics
+    //=================================================================
+    /**
+     * Closed form forward kinematics of the flange in the base frame of the controller. The product of the six DH
+     * transformations is expanded and the joints 2, 3 and 4 (parallel axes) are combined into sums of angles, which
+     * needs 12 sin/cos and about 60 multiplications per pose.
+     */
+    template <typename Parameters>
+    class UrKinematics
+    {
+        public:
+            /**
+             * Compute the rotation matrix (row major) and the position of the flange.
+             * @param q joint positions in [rad]
+             * @param rotation 9 elements
+             * @param position 3 elements
+             */
+            static inline void forward(const double* q, double* rotation, double* position)
+            {
+                double s1 = std::sin(q[0]);
+                double c1 = std::cos(q[0]);
+                double s2 = std::sin(q[1]);
+                double c2 = std::cos(q[1]);
+                double s23 = std::sin(q[1] + q[2]);
+                double c23 = std::cos(q[1] + q[2]);
+                double s234 = std::sin(q[1] + q[2] + q[3]);
+                double c234 = std::cos(q[1] + q[2] + q[3]);
+                double s5 = std::sin(q[4]);
+                double c5 = std::cos(q[4]);
+                double s6 = std::sin(q[5]);
+                double c6 = std::cos(q[5]);
+
+                //rotation relative to the frame of joint 1, the base rotation q1 is applied below
+                double r00 = c234 * c5 * c6 - s234 * s6;
+                double r01 = -c234 * c5 * s6 - s234 * c6;
+                double r02 = -c234 * s5;
+                double r10 = s234 * c5 * c6 + c234 * s6;
+                double r11 = -s234 * c5 * s6 + c234 * c6;
+                double r12 = -s234 * s5;
+                double r20 = s5 * c6;
+                double r21 = -s5 * s6;
+                double r22 = c5;
+
+                rotation[0] = c1 * r00 + s1 * r20;
+                rotation[1] = c1 * r01 + s1 * r21;
+                rotation[2] = c1 * r02 + s1 * r22;
+                rotation[3] = s1 * r00 - c1 * r20;
+                rotation[4] = s1 * r01 - c1 * r21;
+                rotation[5] = s1 * r02 - c1 * r22;
+                rotation[6] = r10;
+                rotation[7] = r11;
+                rotation[8] = r12;
+
+                double x1 = Parameters::a2() * c2 + Parameters::a3() * c23 + Parameters::d5() * s234 + Parameters::d6() * r02;
+                double y1 = Parameters::a2() * s2 + Parameters::a3() * s23 - Parameters::d5() * c234 + Parameters::d6() * r12;
+                double z1 = Parameters::d4() + Parameters::d6() * r22;
+
+                position[0] = c1 * x1 + s1 * z1;
+                position[1] = s1 * x1 - c1 * z1;
+                position[2] = Parameters::d1() + y1;
+            }
+
+            /**
+             * Compute the pose of the flange like the controller (x, y, z, rx, ry, rz).
+             * @param q joint positions in [rad]
+             * @param pose position in [m] and axis angle in [rad]
+             */
+            static inline void forward(const double* q, double* pose)
+            {
+                double m[9];
+                forward(q, m, pose);
+
+                double x, y, z, w;
+                Rotation::matrixToQuaternion(m[0], m[1], m[2], m[3], m[4], m[5], m[6], m[7], m[8], x, y, z, w);
+                Rotation::quaternionToAxis(x, y, z, w, pose[3], pose[4], pose[5]);
+            }
+
+            /**
+             * Batch variant, the output is resized to the input.
+             * @param joints
+             * @param poses
+             */
+            static inline void forward(const JointBatch& joints, PoseBatch& poses)
+            {
+                size_t size = joints.size();
+                poses.resize(size);
+
+                if (size == 0)
+                {
+                    return;
+                }
+
+                const double* __restrict__ q1 = &joints.q[0][0];
+                const double* __restrict__ q2 = &joints.q[1][0];
+                const double* __restrict__ q3 = &joints.q[2][0];
+                const double* __restrict__ q4 = &joints.q[3][0];
+                const double* __restrict__ q5 = &joints.q[4][0];
+                const double* __restrict__ q6 = &joints.q[5][0];
+                double* __restrict__ x = &poses.position.x[0];
+                double* __restrict__ y = &poses.position.y[0];
+                double* __restrict__ z = &poses.position.z[0];
+                double* __restrict__ rx = &poses.rotation.x[0];
+                double* __restrict__ ry = &poses.rotation.y[0];
+                double* __restrict__ rz = &poses.rotation.z[0];
+
+                for (size_t i = 0; i < size; i++)
+                {
+                    double q[6] = {q1[i], q2[i], q3[i], q4[i], q5[i], q6[i]};
+                    double pose[6];
+                    forward(q, pose);
+
+                    x[i] = pose[0];
+                    y[i] = pose[1];
+                    z[i] = pose[2];
+                    rx[i] = pose[3];
+                    ry[i] = pose[4];
+                    rz[i] = pose[5];
+                }
+            }
+
+            /**
+             * Get the branch of a joint position (see InverseSolutions).
+             * @param q joint positions in [rad]
+             * @return
+             */
+            static inline int getBranch(const double* q)
+            {
+                //the shoulder branch is the side of the wrist center relative to the plane of the arm
+                double arm = Parameters::a2() * std::cos(q[1]) + Parameters::a3() * std::cos(q[1] + q[2]) + Parameters::d5() * std::sin(q[1] + q[2] + q[3]);
+
+                return (arm > 0 ? InverseSolutions::SHOULDER : 0) | (std::sin(q[4]) < 0 ? InverseSolutions::WRIST : 0) | (std::sin(q[2]) < 0 ? InverseSolutions::ELBOW : 0);
+            }
+
+            /**
+             * Compute all joint solutions of a flange pose. In the wrist singularity only q4 + q6 is defined, the
+             * solutions keep q6.
+             * @param rotation rotation matrix (row major, 9 elements)
+             * @param position 3 elements in [m]
+             * @param q6 wrist 3 position in the singularity
+             * @param solutions no solutions if the pose is out of reach
+             */
+            static inline void inverse(const double* rotation, const double* position, double q6, InverseSolutions& solutions)
+            {
+                solutions.count = 0;
+
+                //wrist center (origin of frame 5), joint 1 turns the arm plane to d4 from it
+                double wx = position[0] - Parameters::d6() * rotation[2];
+                double wy = position[1] - Parameters::d6() * rotation[5];
+                double radius = std::sqrt(wx * wx + wy * wy);
+                if (radius < std::fabs(Parameters::d4()) * (1 - KINEMATICS_BOUNDARY))
+                {
+                    return;
+                }
+
+                double psi = std::atan2(wy, wx);
+                double phi = std::acos(std::min(Parameters::d4() / radius, 1.0));
+
+                for (int shoulder = 0; shoulder < 2; shoulder++)
+                {
+                    double q1 = psi + (shoulder ? -phi : phi) + M_PI_2;
+                    double s1 = std::sin(q1);
+                    double c1 = std::cos(q1);
+
+                    double c5 = (position[0] * s1 - position[1] * c1 - Parameters::d4()) / Parameters::d6();
+                    if (std::fabs(c5) > 1 + KINEMATICS_BOUNDARY)
+                    {
+                        continue;
+                    }
+                    c5 = std::max(-1.0, std::min(c5, 1.0));
+
+                    //rotation relative to the frame of joint 1 (see forward)
+                    double r00 = c1 * rotation[0] + s1 * rotation[3];
+                    double r01 = c1 * rotation[1] + s1 * rotation[4];
+                    double r02 = c1 * rotation[2] + s1 * rotation[5];
+                    double r10 = rotation[6];
+                    double r11 = rotation[7];
+                    double r12 = rotation[8];
+                    double r20 = s1 * rotation[0] - c1 * rotation[3];
+                    double r21 = s1 * rotation[1] - c1 * rotation[4];
+
+                    double x1 = c1 * position[0] + s1 * position[1];
+                    double y1 = position[2] - Parameters::d1();
+
+                    for (int wrist = 0; wrist < 2; wrist++)
+                    {
+                        double q5 = wrist ? -std::acos(c5) : std::acos(c5);
+                        double s5 = std::sin(q5);
+
+                        if (std::fabs(s5) > KINEMATICS_WRIST_SINGULAR)
+                        {
+                            q6 = std::atan2(-r21 / s5, r20 / s5);
+                        }
+                        double s6 = std::sin(q6);
+                        double c6 = std::cos(q6);
+
+                        //q2 + q3 + q4 from the rotation, valid in the singularity
+                        double c234 = c5 * (r00 * c6 - r01 * s6) - s5 * r02;
+                        double s234 = c5 * (r10 * c6 - r11 * s6) - s5 * r12;
+
+                        //planar arm of joint 2 and 3 to the origin of frame 4
+                        double a = x1 - Parameters::d5() * s234 + Parameters::d6() * s5 * c234;
+                        double b = y1 + Parameters::d5() * c234 + Parameters::d6() * s5 * s234;
+                        double c3 = (a * a + b * b - Parameters::a2() * Parameters::a2() - Parameters::a3() * Parameters::a3()) / (2 * Parameters::a2() * Parameters::a3());
+                        if (std::fabs(c3) > 1 + KINEMATICS_BOUNDARY)
+                        {
+                            continue;
+                        }
+                        c3 = std::max(-1.0, std::min(c3, 1.0));
+
+                        for (int elbow = 0; elbow < 2; elbow++)
+                        {
+                            double q3 = elbow ? -std::acos(c3) : std::acos(c3);
+                            double q2 = std::atan2(b, a) - std::atan2(Parameters::a3() * std::sin(q3), Parameters::a2() + Parameters::a3() * c3);
+                            double q4 = std::atan2(s234, c234) - q2 - q3;
+
+                            double* q = solutions.q[solutions.count];
+                            q[0] = q1;
+                            q[1] = q2;
+                            q[2] = q3;
+                            q[3] = q4;
+                            q[4] = q5;
+                            q[5] = q6;
+                            for (int i = 0; i < 6; i++)
+                            {
+                                q[i] -= 2 * M_PI * std::floor((q[i] + M_PI) / (2 * M_PI));
+                            }
+
+                            solutions.branch[solutions.count] = getBranch(q);
+                            solutions.count++;
+                        }
+                    }
+                }
+            }
+
+            /**
+             * Compute all joint solutions of a flange pose like the controller (x, y, z, rx, ry, rz).
+             * @param pose position in [m] and axis angle in [rad]
+             * @param q6 wrist 3 position in the singularity
+             * @param solutions
+             */
+            static inline void inverse(const double* pose, double q6, InverseSolutions& solutions)
+            {
+                double x, y, z, w;
+                double m[9];
+                Rotation::axisToQuaternion(pose[3], pose[4], pose[5], x, y, z, w);
+                Rotation::quaternionToMatrix(x, y, z, w, m[0], m[1], m[2], m[3], m[4], m[5], m[6], m[7], m[8]);
+                inverse(m, pose, q6, solutions);
+            }
+    };
+
+    typedef UrKinematics<Ur5Parameters> Ur5Kinematics;
+    typedef UrKinematics<Ur10Parameters> Ur10Kinematics;
+
+    //=================================================================
+    // Kinematics
+    //=================================================================
+    /**
+     * Selection of the kinematics at runtime. The model is resolved once, the functions dispatch to the specialized
+     * kinematics.
+     */
+    class Kinematics
+    {
+        public:
+            enum Model
+            {
+                NONE,
+                UR5,
+                UR10
+            };
+
+            /**
+             * Get the model for a name ("ur5" or "ur10").
+             * @param name
+             * @return NONE for unknown names
+             */
+            static inline Model getModel(const std::string& name)
+            {
+                if (name == "ur5")
+                {
+                    return UR5;
+                }
+                else if (name == "ur10")
+                {
+                    return UR10;
+                }
+
+                return NONE;
+            }
+
+            /**
+             * Compute the pose of the flange.
+             * @param model
+             * @param q joint positions in [rad]
+             * @param pose position in [m] and axis angle in [rad]
+             * @return false for the model NONE
+             */
+            static inline bool forward(Model model, const double* q, double* pose)
+            {
+                switch (model)
+                {
+                    case UR5:
+                        Ur5Kinematics::forward(q, pose);
+                        return true;
+                    case UR10:
+                        Ur10Kinematics::forward(q, pose);
+                        return true;
+                    default:
+                        return false;
+                }
+            }
+
+            /**
+             * Batch variant.
+             * @param model
+             * @param joints
+             * @param poses
+             * @return false for the model NONE
+             */
+            static inline bool forward(Model model, const JointBatch& joints, PoseBatch& poses)
+            {
+                switch (model)
+                {
+                    case UR5:
+                        Ur5Kinematics::forward(joints, poses);
+                        return true;
+                    case UR10:
+                        Ur10Kinematics::forward(joints, poses);
+                        return true;
+                    default:
+                        return false;
+                }
+            }
+
+            /**
+             * Get the branch of a joint position (see InverseSolutions).
+             * @param model
+             * @param q joint positions in [rad]
+             * @return -1 for the model NONE
+             */
+            static inline int getBranch(Model model, const double* q)
+            {
+                switch (model)
+                {
+                    case UR5:
+                        return Ur5Kinematics::getBranch(q);
+                    case UR10:
+                        return Ur10Kinematics::getBranch(q);
+                    default:
+                        return -1;
+                }
+            }
+
+            /**
+             * Compute all joint solutions of a flange pose.
+             * @param model
+             * @param rotation rotation matrix (row major, 9 elements)
+             * @param position 3 elements in [m]
+             * @param q6 wrist 3 position in the singularity
+             * @param solutions
+             * @return false for the model NONE
+             */
+            static inline bool inverse(Model model, const double* rotation, const double* position, double q6, InverseSolutions& solutions)
+            {
+                switch (model)
+                {
+                    case UR5:
+                        Ur5Kinematics::inverse(rotation, position, q6, solutions);
+                        return true;
+                    case UR10:
+                        Ur10Kinematics::inverse(rotation, position, q6, solutions);
+                        return true;
+                    default:
+                        solutions.count = 0;
+                        return false;
+                }
+            }
+
+            /**
+             * Select the solution nearest to a seed (sum of the squared joint differences). Each joint is shifted by
+             * multiples of 2 pi towards the seed within the joint limits of +-2 pi.
+             * @param solutions
+             * @param seed joint positions in [rad]
+             * @param branch only solutions of this branch (-1: all branches)
+             * @param q the nearest solution
+             * @return index of the solution, -1 if there is no solution (of the branch)
+             */
+            static inline int nearest(const InverseSolutions& solutions, const double* seed, int branch, double* q)
+            {
+                int index = -1;
+                double minDistance = 0;
+
+                for (int i = 0; i < solutions.count; i++)
+                {
+                    if (branch >= 0 && solutions.branch[i] != branch)
+                    {
+                        continue;
+                    }
+
+                    double candidate[6];
+                    double distance = 0;
+                    for (int j = 0; j < 6; j++)
+                    {
+                        candidate[j] = solutions.q[i][j];
+                        if (candidate[j] - seed[j] > M_PI && candidate[j] - 2 * M_PI >= -2 * M_PI)
+                        {
+                            candidate[j] -= 2 * M_PI;
+                        }
+                        else if (seed[j] - candidate[j] > M_PI && candidate[j] + 2 * M_PI <= 2 * M_PI)
+                        {
+                            candidate[j] += 2 * M_PI;
+                        }
+                        distance += (candidate[j] - seed[j]) * (candidate[j] - seed[j]);
+                    }
+
+                    if (index < 0 || distance < minDistance)
+                    {
+                        index = i;
+                        minDistance = distance;
+                        std::copy(candidate, candidate + 6, q);
+                    }
+                }
+
+                return index;
+            }
+    };
+}
+
+#endif
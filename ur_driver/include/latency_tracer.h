@@ -0,0 +1,331 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Latency tracing of the robot state and of the commands sent to the robot
+// ----------------------------------------------------------------------------
+
+#ifndef LATENCY_TRACER_H_
+#define LATENCY_TRACER_H_
+
+#include <stdint.h>
+#include <time.h>
+#include <vector>
+#include <map>
+#include <deque>
+
+#include <boost/thread.hpp>
+
+namespace ur_driver
+{
+    //=================================================================
+    // LatencyTrace
+    //=================================================================
+    /**
+     * Monotonic timestamps (ns) of a robot state at the trace points between the socket and the published message.
+     * A timestamp of 0 means the trace point was not passed (e.g. tracing was enabled in between).
+     */
+    class LatencyTrace
+    {
+        public:
+            typedef enum Stage
+            {
+                FRAME_READ = 0,
+                DECODED = 1,
+                NOTIFIED = 2,
+                SNAPSHOT = 3,
+                PUBLISHED = 4,
+                STAGE_COUNT = 5
+            } Stage;
+
+            /**
+             * Constructor.
+             */
+            LatencyTrace();
+
+            unsigned long sequence;
+            uint64_t timestamps[STAGE_COUNT];
+    };
+
+    //=================================================================
+    // LatencyHistogram
+    //=================================================================
+    /**
+     * Histogram with logarithmic buckets (4 buckets per power of two, max. 19% relative error) for latencies in ns.
+     * Adding a value does not allocate.
+     */
+    class LatencyHistogram
+    {
+        public:
+            /**
+             * Constructor.
+             */
+            LatencyHistogram();
+
+            /**
+             * Add a latency.
+             * @param latency [ns]
+             */
+            void add(uint64_t latency);
+
+            /**
+             * Remove all values.
+             */
+            void reset();
+
+            /**
+             * Get the number of values.
+             * @return
+             */
+            uint64_t getCount() const;
+
+            /**
+             * Get the mean latency [ns].
+             * @return
+             */
+            double getMean() const;
+
+            /**
+             * Get the maximum latency [ns].
+             * @return
+             */
+            uint64_t getMax() const;
+
+            /**
+             * Get a percentile [ns], the upper bound of the bucket which contains the percentile.
+             * @param percentile Percentile between 0 and 100.
+             * @return
+             */
+            uint64_t getPercentile(double percentile) const;
+
+        private:
+            static const int BUCKET_COUNT = 252;
+
+            uint64_t buckets[BUCKET_COUNT];
+            uint64_t count;
+            uint64_t sum;
+            uint64_t max;
+
+            static int getBucketIndex(uint64_t latency);
+            static uint64_t getBucketUpperBound(int index);
+    };
+
+    //=================================================================
+    // LatencyTracer
+    //=================================================================
+    /**
+     * Collects the latencies of complete robot state traces per stage. The trace points are only recorded if the tracer
+     * is enabled, otherwise each trace point costs a single branch.
+     * Histogram 0 is the total latency (frame read to published), histogram n the latency from stage n-1 to stage n.
+     */
+    class LatencyTracer
+    {
+        public:
+            /**
+             * Constructor.
+             */
+            LatencyTracer();
+
+            /**
+             * Enable or disable the trace points.
+             * @param enabled
+             */
+            void setEnabled(bool enabled);
+
+            /**
+             * Check if the trace points are enabled.
+             * @return
+             */
+            inline bool isEnabled()
+            {
+                return enabled;
+            }
+
+            /**
+             * Record a trace point with the current time.
+             * @param trace
+             * @param stage
+             */
+            inline void stamp(LatencyTrace& trace, LatencyTrace::Stage stage)
+            {
+                if (enabled)
+                {
+                    trace.timestamps[stage] = now();
+                }
+            }
+
+            /**
+             * Add the latencies of a trace which passed all trace points to the histograms. Incomplete traces are ignored.
+             * @param trace
+             */
+            void record(const LatencyTrace& trace);
+
+            /**
+             * Copy the histograms.
+             * @param histograms Histograms in the order of the stages, index 0 is the total latency.
+             * @param reset Reset the histograms after copying.
+             */
+            void getHistograms(std::vector<LatencyHistogram>& histograms, bool reset);
+
+            /**
+             * Get the name of a histogram.
+             * @param index
+             * @return
+             */
+            static const char* getHistogramName(int index);
+
+            /**
+             * Get the monotonic time [ns].
+             * @return
+             */
+            static inline uint64_t now()
+            {
+                struct timespec time;
+                clock_gettime(CLOCK_MONOTONIC, &time);
+
+                return (uint64_t)time.tv_sec * 1000000000ULL + time.tv_nsec;
+            }
+
+        private:
+            bool enabled;
+
+            boost::mutex mutexHistograms;
+            LatencyHistogram histograms[LatencyTrace::STAGE_COUNT];
+    };
+
+    //=================================================================
+    // CommandTrace
+    //=================================================================
+    /**
+     * Monotonic timestamps (ns) of a robot movement interface command from receiving the command list until the robot
+     * reached the target.
+     */
+    class CommandTrace
+    {
+        public:
+            typedef enum Stage
+            {
+                RECEIVED = 0,
+                QUEUED = 1,
+                DEQUEUED = 2,
+                WRITTEN = 3,
+                FINISHED = 4,
+                STAGE_COUNT = 5
+            } Stage;
+
+            /**
+             * Constructor.
+             */
+            CommandTrace();
+
+            int commandId;
+            uint64_t timestamps[STAGE_COUNT];
+    };
+
+    //=================================================================
+    // CommandTracer
+    //=================================================================
+    /**
+     * Collects the stage timestamps per command id and the latencies of finished commands per stage.
+     * Histogram 0 is the total latency (received to finished), histogram n the latency from stage n-1 to stage n.
+     */
+    class CommandTracer
+    {
+        public:
+            /**
+             * Constructor.
+             */
+            CommandTracer();
+
+            /**
+             * Enable or disable the tracer.
+             * @param enabled
+             */
+            void setEnabled(bool enabled);
+
+            /**
+             * Check if the tracer is enabled.
+             * @return
+             */
+            inline bool isEnabled()
+            {
+                return enabled;
+            }
+
+            /**
+             * Start the traces of a new command list. The traces of all previous commands are discarded because the
+             * command list replaces the previous commands, except those of commands which the new list keeps.
+             * @param commandIds
+             * @param timestamp Monotonic time the command list was received.
+             * @param keptCommandIds Previous commands which stay in front of the new ones (committed streamed moves)
+             */
+            void start(const std::vector<int>& commandIds, uint64_t timestamp, const std::vector<int>& keptCommandIds = std::vector<int>());
+
+            /**
+             * Discard the traces of commands which were replaced without being executed.
+             * @param commandIds
+             * @param keptCommandIds Commands of the new list, their traces are kept if they reuse an id
+             */
+            void discard(const std::vector<int>& commandIds, const std::vector<int>& keptCommandIds);
+
+            /**
+             * Record a stage with the current time for all given commands.
+             * @param commandIds
+             * @param stage
+             */
+            void stamp(const std::vector<int>& commandIds, CommandTrace::Stage stage);
+
+            /**
+             * Record that the robot reached the target of a command and add the latencies of the command to the histograms.
+             * @param commandId
+             * @param trace The complete trace.
+             * @return false if the command was not traced
+             */
+            bool finish(int commandId, CommandTrace& trace);
+
+            /**
+             * Get the trace of a command which is not finished yet or of one of the last finished commands.
+             * @param commandId
+             * @param trace
+             * @return false if the command is not traced
+             */
+            bool getTrace(int commandId, CommandTrace& trace);
+
+            /**
+             * Copy the histograms.
+             * @param histograms Histograms in the order of the stages, index 0 is the total latency.
+             * @param reset Reset the histograms after copying.
+             */
+            void getHistograms(std::vector<LatencyHistogram>& histograms, bool reset);
+
+            /**
+             * Get the name of a histogram.
+             * @param index
+             * @return
+             */
+            static const char* getHistogramName(int index);
+
+        private:
+            static const size_t FINISHED_TRACE_COUNT = 256;
+
+            bool enabled;
+
+            boost::mutex mutexTraces;
+            std::map<int, CommandTrace> traces;
+            std::deque<CommandTrace> finishedTraces;    // newest first
+            LatencyHistogram histograms[CommandTrace::STAGE_COUNT];
+    };
+}
+
+#endif
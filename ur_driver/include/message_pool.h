@@ -0,0 +1,103 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Pool of preallocated messages which are reused for publishing
+// ----------------------------------------------------------------------------
+
+#ifndef MESSAGE_POOL_H_
+#define MESSAGE_POOL_H_
+
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
+
+namespace ur_driver
+{
+    /**
+     * Pool of preallocated messages. A message which was published as shared pointer may still be referenced by intra-process
+     * subscribers and must not be changed. Therefore a message is only reused when the pool holds the last reference.
+     * Only the numeric fields of an acquired message have to be overwritten, all other fields keep the values of the prototype.
+     */
+    template <typename M>
+    class MessagePool
+    {
+        public:
+            /**
+             * Constructor.
+             * @param size Number of preallocated messages.
+             */
+            MessagePool(int size = 4) :
+                messages(size),
+                next(0),
+                allocations(0)
+            {
+            }
+
+            /**
+             * Preallocate all messages as copies of the prototype.
+             * @param prototype
+             */
+            void init(const M& prototype)
+            {
+                for (size_t i = 0; i < messages.size(); i++)
+                {
+                    messages[i] = boost::make_shared<M>(prototype);
+                }
+            }
+
+            /**
+             * Get a message which is not referenced anymore by any subscriber.
+             * If all messages are still in use, one message is replaced by a new copy (heap allocation).
+             * @return
+             */
+            boost::shared_ptr<M> acquire()
+            {
+                for (size_t i = 0; i < messages.size(); i++)
+                {
+                    boost::shared_ptr<M>& message = messages[(next + i) % messages.size()];
+
+                    if (message.unique())
+                    {
+                        next = (next + i + 1) % messages.size();
+
+                        return message;
+                    }
+                }
+
+                boost::shared_ptr<M>& message = messages[next];
+                message = boost::make_shared<M>(*message);
+                next = (next + 1) % messages.size();
+                allocations++;
+
+                return message;
+            }
+
+            /**
+             * Get the number of messages which had to be allocated because all messages were still in use.
+             * @return
+             */
+            unsigned long getAllocations()
+            {
+                return allocations;
+            }
+
+        private:
+            std::vector<boost::shared_ptr<M> > messages;
+            size_t next;
+            unsigned long allocations;
+    };
+}
+
+#endif
@@ -0,0 +1,247 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Move stream to the move program on the robot controller
+// ----------------------------------------------------------------------------
+
+#ifndef MOVE_STREAM_H_
+#define MOVE_STREAM_H_
+
+#include <string>
+#include <vector>
+#include <deque>
+
+#include <boost/asio.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/smart_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include <clock.h>
+#include <transport.h>
+#include <latency_tracer.h>
+
+namespace ur_driver
+{
+    /**
+     * Size of a move frame: type, sequence number, 6 target values, acceleration, velocity and blend radius as big
+     * endian 32 bit integers.
+     */
+    static const size_t MOVE_FRAME_SIZE = 44;
+
+    /**
+     * Size of an acknowledgement of the move program: sequence number of the received frame as big endian 32 bit
+     * integer.
+     */
+    static const size_t MOVE_ACK_SIZE = 4;
+
+    /**
+     * Values are sent multiplied by this factor.
+     */
+    static const double MOVE_SCALE = 1000000.0;
+
+    /**
+     * Types of a move frame.
+     */
+    static const int MOVE_STOP = 0; // end the program
+    static const int MOVE_JOINT = 1; // movej to joint positions
+    static const int MOVE_JOINT_POSE = 2; // movej to a pose
+    static const int MOVE_PROCESS = 3; // movep to joint positions
+    static const int MOVE_PROCESS_POSE = 4; // movep to a pose
+    static const int MOVE_IDLE = 5; // no move, keeps the program alive
+
+    /**
+     * Move of the stream.
+     */
+    class StreamedMove
+    {
+        public:
+            StreamedMove();
+
+            int type;
+            double target[6]; // joint positions [rad] or pose (position [m], axis angle [rad])
+            double acceleration;
+            double velocity;
+            double radius; // blend radius [m]
+            int commandId; // traced when the frame is written, -1 for none
+    };
+
+    //=================================================================
+    // MoveStreamServer
+    //=================================================================
+    /**
+     * Server for the move program (see CommandMoveProgram). The program on the robot controller connects to the server,
+     * reads one move frame, acknowledges it and executes the move. The acknowledgement requests the next frame, which
+     * is therefore known to the controller before the move ends and the moves blend. Without a queued move the server
+     * does not answer, the program waits in its read and a move queued later is sent at once. While the program waits,
+     * a MOVE_IDLE frame every half timeout keeps it alive.
+     * The moves sent to the program are committed, the queued moves can be replaced at any time: the robot continues
+     * through the committed moves and blends into the new ones without stopping. The program ends when no frame arrives
+     * within its timeout or when the server sends MOVE_STOP. Only one robot is connected at a time, a new connection
+     * replaces the previous one.
+     */
+    class MoveStreamServer
+    {
+        public:
+            MoveStreamServer();
+
+            /**
+             * Destructor, stops the server.
+             */
+            ~MoveStreamServer();
+
+            /**
+             * Listen on the port.
+             * @param port
+             */
+            void start(int port);
+
+            /**
+             * Stop the program on the controller and the server.
+             */
+            void stop();
+
+            /**
+             * Set the clock which accounts the frames in flight. Must be set before the server is started.
+             * @param clock
+             */
+            void setClock(Clock* clock);
+
+            /**
+             * Set the timeout of the program (see CommandMoveProgram). Must be set before the server is started.
+             * @param timeout [s]
+             */
+            void setTimeout(double timeout);
+
+            /**
+             * Set a command tracer which stamps when the frame of a move is written to the program.
+             * @param commandTracer The command tracer or NULL to disable tracing.
+             */
+            void setCommandTracer(CommandTracer* commandTracer);
+
+            /**
+             * Replace the queued moves, the moves sent to the program are kept.
+             * @param moves
+             * @return number of replaced moves
+             */
+            size_t replace(const std::vector<StreamedMove>& moves);
+
+            /**
+             * Replace the queued moves if the program took none of them since they were counted (see getQueuedCount),
+             * so the moves can be checked against the committed ones without holding up the program.
+             * @param moves
+             * @param queued Number of queued moves the new moves were checked against
+             * @return number of queued moves, the moves are replaced only if it is queued
+             */
+            size_t replace(const std::vector<StreamedMove>& moves, size_t queued);
+
+            /**
+             * Get the number of queued moves.
+             * @return
+             */
+            size_t getQueuedCount();
+
+            /**
+             * Check if a move program is connected.
+             * @return
+             */
+            bool isConnected();
+
+            /**
+             * Encode a move frame.
+             * @param move
+             * @param sequence Number of the frame, counts from 0 for each connection.
+             * @param frame MOVE_FRAME_SIZE bytes
+             */
+            static void encodeMove(const StreamedMove& move, int sequence, char* frame);
+
+            /**
+             * Decode a move frame.
+             * @param frame MOVE_FRAME_SIZE bytes
+             * @param move
+             * @return sequence
+             */
+            static int decodeMove(const char* frame, StreamedMove& move);
+
+            /**
+             * Encode an acknowledgement.
+             * @param sequence
+             * @param ack MOVE_ACK_SIZE bytes
+             */
+            static void encodeAck(int sequence, char* ack);
+
+            /**
+             * Decode an acknowledgement.
+             * @param ack MOVE_ACK_SIZE bytes
+             * @return sequence
+             */
+            static int decodeAck(const char* ack);
+
+        private:
+            boost::asio::io_service io;
+            boost::thread acceptThread;
+            bool isRunning;
+            boost::mutex mutexStartStop;
+
+            Clock* clock;
+            int port;
+            double timeout;
+            boost::asio::steady_timer keepaliveTimer;
+            CommandTracer* commandTracer;
+
+            boost::mutex mutexStream;
+            boost::shared_ptr<TcpTransport> transport; // connected program
+            std::deque<StreamedMove> queuedMoves;
+            int sequence; // of the next frame
+            bool isProgramWaiting; // the program acknowledged all frames and waits for the next one
+            char ackData[64];
+            std::string ackBuffer;
+
+            void acceptWorker();
+            void handleAccept(const boost::system::error_code& error, boost::shared_ptr<TcpTransport> transport, boost::asio::ip::tcp::acceptor& acceptor);
+
+            /**
+             * Read the acknowledgements of the program and answer each one with the next frame.
+             * @param transport
+             * @param error
+             * @param length
+             */
+            void handleAck(boost::shared_ptr<TcpTransport> transport, const boost::system::error_code& error, size_t length);
+
+            /**
+             * Replace the queued moves. The stream must be locked.
+             * @param moves
+             */
+            void queueMoves(const std::vector<StreamedMove>& moves);
+
+            /**
+             * Send MOVE_IDLE to a waiting program every half timeout.
+             * @param error
+             */
+            void handleKeepalive(const boost::system::error_code& error);
+
+            /**
+             * Start the keepalive timer.
+             */
+            void startKeepalive();
+
+            /**
+             * Write the next frame to the connected program, a failed connection is closed. The stream must be locked.
+             * @param isStop
+             */
+            void writeMove(bool isStop);
+    };
+}
+
+#endif
@@ -0,0 +1,205 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Time optimal parameterization of joint waypoint paths
+// ----------------------------------------------------------------------------
+
+#ifndef PARAMETERIZATION_H_
+#define PARAMETERIZATION_H_
+
+#include <vector>
+#include <stddef.h>
+
+namespace ur_driver
+{
+    //=================================================================
+    // PathElement
+    //=================================================================
+    /**
+     * Straight line or circular arc of a joint path, parameterized by the arc length s [rad]:
+     * line: q(s) = start + s * y, arc: q(s) = start + radius * (x * cos(s / radius) + y * sin(s / radius)) with the
+     * center start and the unit vectors x (center to the arc start) and y (direction at the arc start).
+     */
+    class PathElement
+    {
+        public:
+            double length;
+            double radius; // 0 for a line
+            double start[6];
+            double x[6];
+            double y[6];
+
+            PathElement();
+
+            /**
+             * Evaluate the path.
+             * @param s [rad] from the start of the element
+             * @param position
+             * @param tangent First derivative by s (unit vector), or NULL
+             * @param curvature Second derivative by s, or NULL
+             */
+            void evaluate(double s, double* position, double* tangent, double* curvature) const;
+    };
+
+    //=================================================================
+    // PathParameterization
+    //=================================================================
+    /**
+     * Time optimal motion along the straight joint path through waypoints, with a velocity and an acceleration limit
+     * per joint. The corners are blended with circular arcs within a deviation of each waypoint, a waypoint without
+     * deviation is passed at rest. The path velocity is found in the phase plane (path position s, squared path velocity)
+     * on a grid of the step size, which is finer on arcs of a small radius: a backward pass limits the velocity to what
+     * can still be stopped in time, a forward pass accelerates as fast as the limits allow. The path acceleration is
+     * constant in each interval and keeps the joint accelerations within the limits at both of its ends. The motion
+     * starts and ends at rest.
+     */
+    class PathParameterization
+    {
+        public:
+            PathParameterization();
+
+            /**
+             * Set the limits of the joints.
+             * @param maxVelocity 6 values [rad/s]
+             * @param maxAcceleration 6 values [rad/s^2]
+             */
+            void setLimits(const std::vector<double>& maxVelocity, const std::vector<double>& maxAcceleration);
+
+            /**
+             * Set the resolution of the grid, an arc is divided further so that its tangent turns by at most 0.02 rad
+             * per interval.
+             * @param step [rad] of path length
+             */
+            void setStep(double step);
+
+            /**
+             * Compute the motion through the waypoints, replaces the previous one. Consecutive equal waypoints are
+             * merged.
+             * @param waypoints 6 joint positions per waypoint [rad]
+             * @param deviations Maximum distance [rad] of the path from each waypoint, 0 stops at the waypoint. The
+             * values of the first and the last waypoint are not used.
+             * @return false if the limits are not set or there are less than 2 different waypoints
+             */
+            bool compute(const std::vector<double>& waypoints, const std::vector<double>& deviations);
+
+            /**
+             * Get the duration of the motion.
+             * @return [s], 0 without a motion
+             */
+            double getDuration() const;
+
+            /**
+             * Get the length of the path.
+             * @return [rad]
+             */
+            double getLength() const;
+
+            /**
+             * Sample the motion, does not allocate.
+             * @param time [s], clamped to the duration
+             * @param position 6 joint positions [rad]
+             * @param velocity 6 joint velocities [rad/s] or NULL
+             * @param acceleration 6 joint accelerations [rad/s^2] or NULL
+             */
+            void sample(double time, double* position, double* velocity, double* acceleration) const;
+
+            /**
+             * Sample the motion at a constant interval including the end, e.g. for SplineTrajectory::fit.
+             * @param interval [s]
+             * @param times
+             * @param positions 6 values per point
+             * @param velocities 6 values per point
+             * @param accelerations 6 values per point
+             */
+            void getPoints(double interval, std::vector<double>& times, std::vector<double>& positions, std::vector<double>& velocities, std::vector<double>& accelerations) const;
+
+        private:
+            double maxVelocity[6];
+            double maxAcceleration[6];
+            bool hasLimits;
+            double step;
+
+            std::vector<PathElement> elements;
+            std::vector<double> elementStarts; // path position of each element [rad]
+
+            /*
+             * grid of the phase plane
+             */
+            std::vector<double> gridPositions; // path position s [rad]
+            std::vector<size_t> gridElements; // element of the interval starting at the point
+            std::vector<double> gridVelocities; // squared path velocity [rad^2/s^2]
+            std::vector<double> gridTimes; // [s]
+
+            /**
+             * Build the path of lines and blend arcs.
+             * @param waypoints
+             * @param deviations
+             * @param stops Path positions at which the motion has to be at rest (unblended corners).
+             */
+            void buildPath(const std::vector<double>& waypoints, const std::vector<double>& deviations, std::vector<double>& stops);
+
+            /**
+             * Get the range of the path acceleration at a path position and squared path velocity: each joint adds
+             * -maxAcceleration <= tangent * acceleration + curvature * velocity <= maxAcceleration.
+             * @param tangent
+             * @param curvature
+             * @param velocity Squared path velocity.
+             * @param minimum
+             * @param maximum
+             */
+            void getAccelerationRange(const double* tangent, const double* curvature, double velocity, double& minimum, double& maximum) const;
+
+            /**
+             * Get the range of the constant path acceleration in a grid interval which keeps the joint accelerations
+             * within the limits at both ends and the squared path velocity at the end positive.
+             * @param tangent At the start of the interval.
+             * @param curvature At the start of the interval.
+             * @param endTangent
+             * @param endCurvature
+             * @param distance Length of the interval [rad].
+             * @param velocity Squared path velocity at the start.
+             * @param minimum
+             * @param maximum
+             */
+            void getIntervalRange(const double* tangent, const double* curvature, const double* endTangent, const double* endCurvature,
+                double distance, double velocity, double& minimum, double& maximum) const;
+
+            /**
+             * Check whether an interval can be passed within the limits from a squared path velocity at the start
+             * without exceeding a squared path velocity at the end.
+             * @param tangent
+             * @param curvature
+             * @param endTangent
+             * @param endCurvature
+             * @param distance
+             * @param velocity
+             * @param next
+             * @return
+             */
+            bool isIntervalValid(const double* tangent, const double* curvature, const double* endTangent, const double* endCurvature,
+                double distance, double velocity, double next) const;
+
+            /**
+             * Get the largest squared path velocity at a path position (the velocity limits and on arcs the
+             * acceleration limits, which have to leave a non empty acceleration range).
+             * @param tangent
+             * @param curvature
+             * @return
+             */
+            double getMaximumVelocity(const double* tangent, const double* curvature) const;
+    };
+}
+
+#endif
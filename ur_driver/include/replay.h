@@ -0,0 +1,105 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Offline replay of recorded robot controller data through the connector
+// ----------------------------------------------------------------------------
+
+#ifndef REPLAY_H_
+#define REPLAY_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <connector.h>
+
+namespace ur_driver
+{
+    /**
+     * Data received at once from the robot controller.
+     */
+    class ReplayChunk
+    {
+        public:
+            int port;
+            uint64_t timestamp; // nanoseconds since the first chunk
+            std::vector<char> data;
+    };
+
+    /**
+     * Replays recorded data of port 30002 or 30003 through Connector::processData, which is the same frame assembly,
+     * decoding and listener path as used for a live connection. No socket is needed.
+     */
+    class Replay
+    {
+        public:
+            /**
+             * Constructor.
+             */
+            Replay();
+
+            /**
+             * Destructor.
+             */
+            ~Replay();
+
+            /**
+             * Load a raw byte stream as captured from the socket (e.g. with "nc robot 30002 > capture.bin").
+             * The stream contains no timestamps, the frames are timed with the native rate of the port
+             * (10 Hz on port 30002, 125 Hz on port 30003).
+             * @param fileName
+             * @param port SECONDARY or REALTIME
+             * @return false if the file could not be read
+             */
+            bool loadStream(const std::string& fileName, int port);
+
+            /**
+             * Load the received frames of a flight recorder file, timed with the recorded timestamps.
+             * @param fileName
+             * @return false if the file is not a valid flight recorder file
+             */
+            bool loadFlightRecord(const std::string& fileName);
+
+            /**
+             * Feed all loaded chunks into the connector.
+             * @param connector The robot state listeners of this connector are notified.
+             * @param speed 1 replays in real time, 2 with twice the speed, 0 as fast as possible.
+             */
+            void run(Connector& connector, double speed);
+
+            /**
+             * Get the number of loaded chunks.
+             * @return
+             */
+            size_t getChunkCount();
+
+            /**
+             * Get the number of loaded bytes.
+             * @return
+             */
+            uint64_t getByteCount();
+
+            /**
+             * Get the recorded duration from the first to the last chunk in seconds.
+             * @return
+             */
+            double getDuration();
+
+        private:
+            std::vector<ReplayChunk> chunks;
+    };
+}
+
+#endif
@@ -0,0 +1,445 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Header-only rotation conversions (roll/pitch/yaw, axis angle, quaternion)
+// ----------------------------------------------------------------------------
+
+#ifndef ROTATION_H_
+#define ROTATION_H_
+
+#include <cmath>
+#include <vector>
+#include <cstddef>
+
+namespace ur_driver
+{
+    /**
+     * Angle below which the axis angle conversions use the series expansion.
+     */
+    static const double ROTATION_SMALL_ANGLE = 1e-4;
+
+    /**
+     * cos(pitch) below which roll is derived from the well conditioned roll - yaw (or roll + yaw) near the gimbal lock.
+     */
+    static const double ROTATION_GIMBAL_LOCK = 1e-3;
+
+    //=================================================================
+    // Rotation
+    //=================================================================
+    /**
+     * Conversions between roll, pitch, yaw (fixed axes x, y, z like tf::Matrix3x3::getRPY), axis angle (rotation
+     * vector of the robot controller), quaternion (x, y, z, w) and from rotation matrices. The functions are inline and do
+     * not create tf objects.
+     * Quaternions do not need to be normalized. Axis angles are returned with an angle in [0, pi], the rotation near
+     * identity uses series expansions instead of dividing by the angle, the gimbal lock (pitch +-pi/2) returns yaw 0.
+     */
+    class Rotation
+    {
+        public:
+            static inline void rpyToQuaternion(double roll, double pitch, double yaw, double& x, double& y, double& z, double& w)
+            {
+                double sr = std::sin(0.5 * roll);
+                double cr = std::cos(0.5 * roll);
+                double sp = std::sin(0.5 * pitch);
+                double cp = std::cos(0.5 * pitch);
+                double sy = std::sin(0.5 * yaw);
+                double cy = std::cos(0.5 * yaw);
+
+                x = sr * cp * cy - cr * sp * sy;
+                y = cr * sp * cy + sr * cp * sy;
+                z = cr * cp * sy - sr * sp * cy;
+                w = cr * cp * cy + sr * sp * sy;
+            }
+
+            static inline void quaternionToRpy(double x, double y, double z, double w, double& roll, double& pitch, double& yaw)
+            {
+                //elements of the rotation matrix
+                double s = 2.0 / (x * x + y * y + z * z + w * w);
+                double m00 = 1.0 - s * (y * y + z * z);
+                double m01 = s * (x * y - w * z);
+                double m02 = s * (x * z + w * y);
+                double m10 = s * (x * y + w * z);
+                double m11 = 1.0 - s * (x * x + z * z);
+                double m12 = s * (y * z - w * x);
+                double m20 = s * (x * z - w * y);
+                double m21 = s * (y * z + w * x);
+                double m22 = 1.0 - s * (x * x + y * y);
+
+                //atan2 keeps the pitch accurate near +-pi/2, where asin(-m20) loses half of the digits
+                double cosPitch = std::sqrt(m00 * m00 + m10 * m10);
+                pitch = std::atan2(-m20, cosPitch);
+
+                yaw = std::atan2(m10, m00);
+
+                if (cosPitch > ROTATION_GIMBAL_LOCK)
+                {
+                    roll = std::atan2(m21, m22);
+                }
+                else
+                {
+                    //roll and yaw alone lose precision with 1/cos(pitch), the rotation depends on roll - yaw (pitch pi/2)
+                    //or roll + yaw (pitch -pi/2), which is accurate. In the gimbal lock the yaw is 0.
+                    if (cosPitch == 0)
+                    {
+                        yaw = 0;
+                    }
+
+                    if (m20 <= 0)
+                    {
+                        roll = yaw + std::atan2(m01 - m12, m11 + m02);
+                    }
+                    else
+                    {
+                        roll = -yaw + std::atan2(-(m01 + m12), m11 - m02);
+                    }
+
+                    if (roll > M_PI)
+                    {
+                        roll -= 2 * M_PI;
+                    }
+                    else if (roll < -M_PI)
+                    {
+                        roll += 2 * M_PI;
+                    }
+                }
+            }
+
+            static inline void axisToQuaternion(double rx, double ry, double rz, double& x, double& y, double& z, double& w)
+            {
+                double angle2 = rx * rx + ry * ry + rz * rz;
+                double scale;
+
+                if (angle2 < ROTATION_SMALL_ANGLE * ROTATION_SMALL_ANGLE)
+                {
+                    //sin(a/2)/a and cos(a/2), the next terms are below 1e-19
+                    scale = 0.5 - angle2 / 48.0;
+                    w = 1.0 - angle2 / 8.0;
+                }
+                else
+                {
+                    double angle = std::sqrt(angle2);
+                    scale = std::sin(0.5 * angle) / angle;
+                    w = std::cos(0.5 * angle);
+                }
+
+                x = scale * rx;
+                y = scale * ry;
+                z = scale * rz;
+            }
+
+            static inline void quaternionToAxis(double x, double y, double z, double w, double& rx, double& ry, double& rz)
+            {
+                //q and -q are the same rotation, the one with w >= 0 has an angle in [0, pi]
+                if (w < 0)
+                {
+                    x = -x;
+                    y = -y;
+                    z = -z;
+                    w = -w;
+                }
+
+                double sinHalf = std::sqrt(x * x + y * y + z * z);
+                double scale;
+
+                if (sinHalf < ROTATION_SMALL_ANGLE * w)
+                {
+                    //2 * atan(s / w) / s, the next term is below 1e-17 relative
+                    scale = 2.0 / w * (1.0 - sinHalf * sinHalf / (3.0 * w * w));
+                }
+                else
+                {
+                    //asin for small angles and acos for large angles, acos(w) alone loses half of the digits near identity
+                    double norm = std::sqrt(sinHalf * sinHalf + w * w);
+                    double angle = (sinHalf < 0.7 * norm) ? 2.0 * std::asin(sinHalf / norm) : 2.0 * std::acos(w / norm);
+                    scale = angle / sinHalf;
+                }
+
+                rx = scale * x;
+                ry = scale * y;
+                rz = scale * z;
+            }
+
+            static inline void quaternionToMatrix(double x, double y, double z, double w, double& m00, double& m01, double& m02,
+                                                  double& m10, double& m11, double& m12, double& m20, double& m21, double& m22)
+            {
+                double s = 2.0 / (x * x + y * y + z * z + w * w);
+                m00 = 1.0 - s * (y * y + z * z);
+                m01 = s * (x * y - w * z);
+                m02 = s * (x * z + w * y);
+                m10 = s * (x * y + w * z);
+                m11 = 1.0 - s * (x * x + z * z);
+                m12 = s * (y * z - w * x);
+                m20 = s * (x * z - w * y);
+                m21 = s * (y * z + w * x);
+                m22 = 1.0 - s * (x * x + y * y);
+            }
+
+            static inline void matrixToQuaternion(double m00, double m01, double m02, double m10, double m11, double m12, double m20, double m21, double m22,
+                                                  double& x, double& y, double& z, double& w)
+            {
+                //divide by the largest of the four components, the other branches lose precision when it is small
+                double trace = m00 + m11 + m22;
+                if (trace > 0)
+                {
+                    double s = 0.5 / std::sqrt(trace + 1.0);
+                    w = 0.25 / s;
+                    x = (m21 - m12) * s;
+                    y = (m02 - m20) * s;
+                    z = (m10 - m01) * s;
+                }
+                else if (m00 > m11 && m00 > m22)
+                {
+                    double s = 0.5 / std::sqrt(1.0 + m00 - m11 - m22);
+                    w = (m21 - m12) * s;
+                    x = 0.25 / s;
+                    y = (m01 + m10) * s;
+                    z = (m02 + m20) * s;
+                }
+                else if (m11 > m22)
+                {
+                    double s = 0.5 / std::sqrt(1.0 + m11 - m00 - m22);
+                    w = (m02 - m20) * s;
+                    x = (m01 + m10) * s;
+                    y = 0.25 / s;
+                    z = (m12 + m21) * s;
+                }
+                else
+                {
+                    double s = 0.5 / std::sqrt(1.0 + m22 - m00 - m11);
+                    w = (m10 - m01) * s;
+                    x = (m02 + m20) * s;
+                    y = (m12 + m21) * s;
+                    z = 0.25 / s;
+                }
+            }
+
+            static inline void rpyToAxis(double roll, double pitch, double yaw, double& rx, double& ry, double& rz)
+            {
+                double x, y, z, w;
+                rpyToQuaternion(roll, pitch, yaw, x, y, z, w);
+                quaternionToAxis(x, y, z, w, rx, ry, rz);
+            }
+
+            static inline void axisToRpy(double rx, double ry, double rz, double& roll, double& pitch, double& yaw)
+            {
+                double x, y, z, w;
+                axisToQuaternion(rx, ry, rz, x, y, z, w);
+                quaternionToRpy(x, y, z, w, roll, pitch, yaw);
+            }
+    };
+
+    //=================================================================
+    // batch conversions (struct of arrays)
+    //=================================================================
+    /**
+     * Vectors (roll, pitch, yaw or axis angle) stored as separate arrays.
+     */
+    class Vector3Batch
+    {
+        public:
+            std::vector<double> x;
+            std::vector<double> y;
+            std::vector<double> z;
+
+            inline void resize(size_t size)
+            {
+                x.resize(size);
+                y.resize(size);
+                z.resize(size);
+            }
+
+            inline size_t size() const
+            {
+                return x.size();
+            }
+    };
+
+    /**
+     * Quaternions stored as separate arrays.
+     */
+    class QuaternionBatch
+    {
+        public:
+            std::vector<double> x;
+            std::vector<double> y;
+            std::vector<double> z;
+            std::vector<double> w;
+
+            inline void resize(size_t size)
+            {
+                x.resize(size);
+                y.resize(size);
+                z.resize(size);
+                w.resize(size);
+            }
+
+            inline size_t size() const
+            {
+                return x.size();
+            }
+    };
+
+    /**
+     * Batch variants of the Rotation functions. The loops have no dependencies between the elements and contiguous
+     * inputs and outputs, so the compiler can vectorize the arithmetic. The output is resized to the input.
+     */
+    class RotationBatch
+    {
+        public:
+            static inline void rpyToQuaternion(const Vector3Batch& rpy, QuaternionBatch& quaternion)
+            {
+                size_t size = rpy.size();
+                quaternion.resize(size);
+
+                if (size == 0)
+                {
+                    return;
+                }
+
+                const double* __restrict__ roll = &rpy.x[0];
+                const double* __restrict__ pitch = &rpy.y[0];
+                const double* __restrict__ yaw = &rpy.z[0];
+                double* __restrict__ x = &quaternion.x[0];
+                double* __restrict__ y = &quaternion.y[0];
+                double* __restrict__ z = &quaternion.z[0];
+                double* __restrict__ w = &quaternion.w[0];
+
+                for (size_t i = 0; i < size; i++)
+                {
+                    Rotation::rpyToQuaternion(roll[i], pitch[i], yaw[i], x[i], y[i], z[i], w[i]);
+                }
+            }
+
+            static inline void quaternionToRpy(const QuaternionBatch& quaternion, Vector3Batch& rpy)
+            {
+                size_t size = quaternion.size();
+                rpy.resize(size);
+
+                if (size == 0)
+                {
+                    return;
+                }
+
+                const double* __restrict__ x = &quaternion.x[0];
+                const double* __restrict__ y = &quaternion.y[0];
+                const double* __restrict__ z = &quaternion.z[0];
+                const double* __restrict__ w = &quaternion.w[0];
+                double* __restrict__ roll = &rpy.x[0];
+                double* __restrict__ pitch = &rpy.y[0];
+                double* __restrict__ yaw = &rpy.z[0];
+
+                for (size_t i = 0; i < size; i++)
+                {
+                    Rotation::quaternionToRpy(x[i], y[i], z[i], w[i], roll[i], pitch[i], yaw[i]);
+                }
+            }
+
+            static inline void axisToQuaternion(const Vector3Batch& axis, QuaternionBatch& quaternion)
+            {
+                size_t size = axis.size();
+                quaternion.resize(size);
+
+                if (size == 0)
+                {
+                    return;
+                }
+
+                const double* __restrict__ rx = &axis.x[0];
+                const double* __restrict__ ry = &axis.y[0];
+                const double* __restrict__ rz = &axis.z[0];
+                double* __restrict__ x = &quaternion.x[0];
+                double* __restrict__ y = &quaternion.y[0];
+                double* __restrict__ z = &quaternion.z[0];
+                double* __restrict__ w = &quaternion.w[0];
+
+                for (size_t i = 0; i < size; i++)
+                {
+                    Rotation::axisToQuaternion(rx[i], ry[i], rz[i], x[i], y[i], z[i], w[i]);
+                }
+            }
+
+            static inline void quaternionToAxis(const QuaternionBatch& quaternion, Vector3Batch& axis)
+            {
+                size_t size = quaternion.size();
+                axis.resize(size);
+
+                if (size == 0)
+                {
+                    return;
+                }
+
+                const double* __restrict__ x = &quaternion.x[0];
+                const double* __restrict__ y = &quaternion.y[0];
+                const double* __restrict__ z = &quaternion.z[0];
+                const double* __restrict__ w = &quaternion.w[0];
+                double* __restrict__ rx = &axis.x[0];
+                double* __restrict__ ry = &axis.y[0];
+                double* __restrict__ rz = &axis.z[0];
+
+                for (size_t i = 0; i < size; i++)
+                {
+                    Rotation::quaternionToAxis(x[i], y[i], z[i], w[i], rx[i], ry[i], rz[i]);
+                }
+            }
+
+            static inline void rpyToAxis(const Vector3Batch& rpy, Vector3Batch& axis)
+            {
+                size_t size = rpy.size();
+                axis.resize(size);
+
+                if (size == 0)
+                {
+                    return;
+                }
+
+                const double* __restrict__ roll = &rpy.x[0];
+                const double* __restrict__ pitch = &rpy.y[0];
+                const double* __restrict__ yaw = &rpy.z[0];
+                double* __restrict__ rx = &axis.x[0];
+                double* __restrict__ ry = &axis.y[0];
+                double* __restrict__ rz = &axis.z[0];
+
+                for (size_t i = 0; i < size; i++)
+                {
+                    Rotation::rpyToAxis(roll[i], pitch[i], yaw[i], rx[i], ry[i], rz[i]);
+                }
+            }
+
+            static inline void axisToRpy(const Vector3Batch& axis, Vector3Batch& rpy)
+            {
+                size_t size = axis.size();
+                rpy.resize(size);
+
+                if (size == 0)
+                {
+                    return;
+                }
+
+                const double* __restrict__ rx = &axis.x[0];
+                const double* __restrict__ ry = &axis.y[0];
+                const double* __restrict__ rz = &axis.z[0];
+                double* __restrict__ roll = &rpy.x[0];
+                double* __restrict__ pitch = &rpy.y[0];
+                double* __restrict__ yaw = &rpy.z[0];
+
+                for (size_t i = 0; i < size; i++)
+                {
+                    Rotation::axisToRpy(rx[i], ry[i], rz[i], roll[i], pitch[i], yaw[i]);
+                }
+            }
+    };
+}
+
+#endif
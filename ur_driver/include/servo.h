@@ -0,0 +1,255 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Joint setpoint stream to the servo program on the robot controller
+// ----------------------------------------------------------------------------
+
+#ifndef SERVO_H_
+#define SERVO_H_
+
+#include <string>
+#include <vector>
+#include <deque>
+
+#include <boost/asio.hpp>
+#include <boost/smart_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/function.hpp>
+
+#include <clock.h>
+#include <transport.h>
+
+namespace ur_driver
+{
+    /**
+     * Size of a setpoint frame: keepalive, sequence number and 6 joint positions as big endian 32 bit integers.
+     */
+    static const size_t SERVO_FRAME_SIZE = 32;
+
+    /**
+     * Size of a report of the program: buffer fill level (0 without buffer) and sequence number of the last received
+     * setpoint as big endian 32 bit integers. Sent every controller cycle, the unbuffered program requests the next
+     * frame with it.
+     */
+    static const size_t SERVO_REPORT_SIZE = 8;
+
+    /**
+     * Joint positions are sent in [rad] multiplied by this factor.
+     */
+    static const double SERVO_SCALE = 1000000.0;
+
+    /**
+     * Maximum number of setpoints sent in one cycle to refill the buffer of the program.
+     */
+    static const int SERVO_MAX_BATCH = 16;
+
+    /**
+     * Keepalive values of a setpoint frame.
+     */
+    static const int SERVO_STOP = 0; // end the program
+    static const int SERVO_SETPOINT = 1; // execute servoj with the joint positions (buffered: add them to the buffer)
+    static const int SERVO_IDLE = 2; // no setpoint, the program waits (buffered: plays the buffer)
+
+    /**
+     * State of the buffer of the servo program since the last call of ServoServer::getStatistics.
+     */
+    class ServoStatistics
+    {
+        public:
+            ServoStatistics();
+
+            int fill; // last reported fill level, -1 without report
+            int minimumFill; // -1 without report
+            unsigned long long setpoints; // sent setpoints
+            unsigned long long droppedSetpoints; // setpoints which arrived faster than they were played
+            unsigned long long starvedCycles; // cycles the program had an empty buffer while setpoints were waiting
+    };
+
+    //=================================================================
+    // ServoServer
+    //=================================================================
+    /**
+     * Server for the servo program (see CommandServoProgram). The program on the robot controller connects to the
+     * server, reads a setpoint every controller cycle with socket_read_binary_integer, requests the next one with a
+     * report and executes servoj. The server answers each report with the latest setpoint, so the controller paces the
+     * stream and exactly one frame is in flight: a hiccup of the driver or a drift between the clocks can't queue old
+     * setpoints in the socket. Setpoints may arrive faster or slower. Until the first setpoint the program waits. The
+     * program ends when no frame arrives within its timeout or when the server sends SERVO_STOP.
+     * Only one robot is connected at a time, a new connection replaces the previous one.
+     * With a buffer depth the setpoints are played in order instead: the program reads them into a FIFO of twice the
+     * depth and plays one per cycle, a late frame is absorbed by the buffer instead of repeating or skipping a setpoint.
+     * The program reports the fill level every cycle and the server tops the buffer up to the depth, so the depth is
+     * the added latency in cycles.
+     * Instead of the latest setpoint a generator can compute the setpoint of each cycle, e.g. the jerk limited velocity
+     * of the speed program (see CommandSpeedProgram) or the samples of a spline trajectory.
+     */
+    class ServoServer
+    {
+        public:
+            /**
+             * Computes the setpoint of a cycle.
+             * @param isFirst First cycle of a new program, which starts at rest.
+             * @param setpoint 6 values
+             * @return false if there is no new setpoint: the latest setpoint of setSetpoint is sent, SERVO_IDLE without
+             * one
+             */
+            typedef boost::function<bool(bool isFirst, std::vector<double>& setpoint)> Generator;
+
+            ServoServer();
+
+            /**
+             * Destructor, stops the server.
+             */
+            ~ServoServer();
+
+            /**
+             * Listen on the port and start streaming.
+             * @param port
+             * @param frequency Rate of the controller (125 or 500 Hz), paces the buffered stream.
+             */
+            void start(int port, double frequency);
+
+            /**
+             * Stop the program on the controller and the server.
+             */
+            void stop();
+
+            /**
+             * Set the clock which paces the stream. Must be set before the server is started.
+             * @param clock
+             */
+            void setClock(Clock* clock);
+
+            /**
+             * Set the number of setpoints buffered by the program, 0 streams the latest setpoint. Must be set before the
+             * server is started.
+             * @param depth
+             */
+            void setBufferDepth(int depth);
+
+            /**
+             * Set the generator which computes the setpoint of each cycle, NULL to send the setpoints set with
+             * setSetpoint. It is called on the stream thread. With a buffer depth it is called for the setpoints which top
+             * the buffer up after the queued setpoints of setSetpoint. Must be set before the server is started.
+             * @param generator
+             */
+            void setGenerator(const Generator& generator);
+
+            /**
+             * Set the setpoint which is sent from the next cycle on if the generator has no setpoint. With a buffer
+             * depth the setpoint is queued and played after the previous ones, one per cycle.
+             * @param jointPosition [rad]
+             */
+            void setSetpoint(const std::vector<double>& jointPosition);
+
+            /**
+             * Get the state of the buffer of the program.
+             * @param reset Start a new period of the minimum and the counters.
+             * @return
+             */
+            ServoStatistics getStatistics(bool reset);
+
+            /**
+             * Check if a servo program is connected.
+             * @return
+             */
+            bool isConnected();
+
+            /**
+             * Encode a setpoint frame.
+             * @param jointPosition 6 joint positions in [rad]
+             * @param keepalive SERVO_STOP, SERVO_SETPOINT or SERVO_IDLE
+             * @param sequence Number of the setpoint, counts from 0 for each connection.
+             * @param frame SERVO_FRAME_SIZE bytes
+             */
+            static void encodeSetpoint(const double* jointPosition, int keepalive, int sequence, char* frame);
+
+            /**
+             * Decode a setpoint frame.
+             * @param frame SERVO_FRAME_SIZE bytes
+             * @param jointPosition 6 joint positions in [rad]
+             * @param sequence
+             * @return keepalive
+             */
+            static int decodeSetpoint(const char* frame, double* jointPosition, int& sequence);
+
+            /**
+             * Encode a report of the buffered program.
+             * @param fill
+             * @param sequence
+             * @param report SERVO_REPORT_SIZE bytes
+             */
+            static void encodeReport(int fill, int sequence, char* report);
+
+            /**
+             * Decode a report of the buffered program.
+             * @param report SERVO_REPORT_SIZE bytes
+             * @param fill
+             * @param sequence
+             */
+            static void decodeReport(const char* report, int& fill, int& sequence);
+
+        private:
+            boost::asio::io_service io;
+            boost::thread acceptThread;
+            boost::thread writeThread;
+            bool runWriteThread;
+            bool isRunning;
+            boost::mutex mutexStartStop;
+
+            Clock* clock;
+            int port;
+            double frequency;
+
+            boost::mutex mutexStream;
+            boost::shared_ptr<TcpTransport> transport; // connected program
+            std::vector<double> setpoint;
+            bool hasSetpoint;
+            Generator generator;
+            bool isFirstCycle; // of the connected program
+
+            /*
+             * buffered program
+             */
+            int bufferDepth;
+            std::deque<std::vector<double> > pendingSetpoints;
+            int sequence; // of the next setpoint
+            int reportedFill;
+            int reportedSequence;
+            char reportData[64];
+            std::string reportBuffer;
+            ServoStatistics statistics;
+
+            void acceptWorker();
+            void handleAccept(const boost::system::error_code& error, boost::shared_ptr<TcpTransport> transport, boost::asio::ip::tcp::acceptor& acceptor);
+            void writeWorker();
+
+            /**
+             * Read the reports of the program, the unbuffered program gets a frame for each report.
+             * @param transport
+             * @param error
+             * @param length
+             */
+            void handleReport(boost::shared_ptr<TcpTransport> transport, const boost::system::error_code& error, size_t length);
+
+            /**
+             * Write the frames of a cycle to the connected program, a failed connection is closed.
+             * @param isStop
+             */
+            void writeSetpoint(bool isStop);
+    };
+}
+
+#endif
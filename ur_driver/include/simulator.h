@@ -0,0 +1,355 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// Lightweight kinematic robot simulator used by the dummy server
+// ----------------------------------------------------------------------------
+
+#ifndef SIMULATOR_H_
+#define SIMULATOR_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+
+#include <boost/thread.hpp>
+
+#include <packets.h>
+
+namespace ur_driver
+{
+    //=================================================================
+    // Script
+    //=================================================================
+    /**
+     * Argument of a script function call. A list ([...]) or pose (p[...]) has several values, a number or boolean one.
+     * A string ("...") or a variable has no values but a text.
+     */
+    class ScriptArgument
+    {
+        public:
+            std::string keyword; // empty for positional arguments
+            std::vector<double> values;
+            bool isPose;
+            std::string text; // string or variable name
+    };
+
+    /**
+     * Script function call, e.g. movej([0, 0, 0, 0, 0, 0], a=1.2, v=0.3).
+     */
+    class ScriptInstruction
+    {
+        public:
+            std::string name;
+            std::vector<ScriptArgument> arguments;
+
+            /**
+             * Get an argument by keyword or, if not given as keyword argument, by position.
+             * @param position Position of the argument in the function signature.
+             * @param keyword
+             * @return NULL if the argument is not given
+             */
+            const ScriptArgument* getArgument(size_t position, const char* keyword) const;
+
+            /**
+             * Get the first value of an argument.
+             * @param position Position of the argument in the function signature.
+             * @param keyword
+             * @param defaultValue Value if the argument is not given.
+             * @return
+             */
+            double getValue(size_t position, const char* keyword, double defaultValue) const;
+    };
+
+    /**
+     * Parses the subset of URScript sent by the driver: single function calls and programs defined with def ... end and
+     * called afterwards. The data can arrive in arbitrary pieces. Variables are not evaluated: assignments and the
+     * conditions of blocks (while, if, ...) are skipped, the function calls within blocks are added to the program in
+     * the order of the text.
+     */
+    class ScriptParser
+    {
+        public:
+            /**
+             * Constructor.
+             */
+            ScriptParser();
+
+            /**
+             * Add received data.
+             * @param data
+             * @param length
+             */
+            void addData(const char* data, size_t length);
+
+            /**
+             * Get the next complete program.
+             * @param program
+             * @return false if no complete program was received
+             */
+            bool nextProgram(std::vector<ScriptInstruction>& program);
+
+            /**
+             * Parse a single function call.
+             * @param line
+             * @param instruction
+             * @return false on a syntax error
+             */
+            static bool parseInstruction(const std::string& line, ScriptInstruction& instruction);
+
+        private:
+            std::string buffer;
+            bool isInDefinition;
+            int blockDepth; // blocks opened within the definition
+            std::string definitionName;
+            std::vector<ScriptInstruction> definition;
+            std::deque<std::vector<ScriptInstruction> > programs;
+    };
+
+    //=================================================================
+    // TrapezoidalProfile
+    //=================================================================
+    /**
+     * Velocity profile along a path of given length with constant acceleration and deceleration and a limited velocity.
+     */
+    class TrapezoidalProfile
+    {
+        public:
+            /**
+             * Constructor.
+             */
+            TrapezoidalProfile();
+
+            /**
+             * Plan the profile.
+             * @param length Path length.
+             * @param startVelocity Velocity at the start of the path (>= 0).
+             * @param maxVelocity
+             * @param acceleration
+             * @param duration Fixed duration (the velocity is reduced), 0 for the fastest profile.
+             */
+            void plan(double length, double startVelocity, double maxVelocity, double acceleration, double duration);
+
+            /**
+             * Get the position on the path at a time.
+             * @param time
+             * @return
+             */
+            double getPosition(double time) const;
+
+            /**
+             * Get the velocity at a time.
+             * @param time
+             * @return
+             */
+            double getVelocity(double time) const;
+
+            /**
+             * Get the duration of the profile.
+             * @return
+             */
+            double getDuration() const;
+
+        private:
+            double length;
+            double startVelocity;
+            double peakVelocity;
+            double acceleration;
+            double startAcceleration;
+            double accelerationTime;
+            double cruiseTime;
+            double duration;
+    };
+
+    //=================================================================
+    // Simulator
+    //=================================================================
+    /**
+     * Kinematic simulation of the robot controller. Executes the programs received by the dummy server and creates the
+     * frames of port 30002 and 30003 from the simulated state.
+     * Joint targets are interpolated in joint space and pose targets in cartesian space; joint position and tool pose are
+     * independent of each other (no kinematic model).
+     */
+    class Simulator
+    {
+        public:
+            /**
+             * Constructor.
+             */
+            Simulator();
+
+            /**
+             * Set the state of the robot at rest.
+             * @param jointPosition
+             * @param pose Tool pose (x, y, z, rx, ry, rz).
+             */
+            void reset(const std::vector<double>& jointPosition, const std::vector<double>& pose);
+
+            /**
+             * Execute a program. A running program is replaced, the robot continues from its current state.
+             * @param program
+             */
+            void execute(const std::vector<ScriptInstruction>& program);
+
+            /**
+             * Append a move to the running program like a streamed move, an idle robot starts it at once. The active move
+             * blends into it if it has a blend radius and has not reached it yet.
+             * @param instruction
+             * @return false if the instruction is not supported
+             */
+            bool append(const ScriptInstruction& instruction);
+
+            /**
+             * Check if a motion is waiting behind the active one.
+             * @return
+             */
+            bool isMotionQueued();
+
+            /**
+             * Track a joint setpoint like servoj. The previous motion (and program) is replaced, the robot follows the
+             * setpoint with a first order lag of the lookahead time until the next setpoint or program. The gain is not
+             * modelled.
+             * @param jointPosition
+             * @param lookahead [s]
+             */
+            void servo(const std::vector<double>& jointPosition, double lookahead);
+
+            /**
+             * Advance the simulation to a time. Calls with a time in the past are ignored.
+             * @param time [s]
+             */
+            void update(double time);
+
+            /**
+             * Check if a program is running.
+             * @return
+             */
+            bool isProgramRunning();
+
+            /**
+             * Get the joint position.
+             * @return
+             */
+            std::vector<double> getJointPosition();
+
+            /**
+             * Get the tool pose.
+             * @return
+             */
+            std::vector<double> getPose();
+
+            /**
+             * Get a digital output (0-7 digital, 8-15 configurable, 16-17 tool).
+             * @param id
+             * @return
+             */
+            bool getDigitalOutput(int id);
+
+            /**
+             * Create a robot state frame of port 30002 (including the frame size).
+             * @param frame
+             */
+            void createSecondaryFrame(std::string& frame);
+
+            /**
+             * Create a robot state frame of port 30003 (including the frame size).
+             * @param frame
+             */
+            void createRealtimeFrame(std::string& frame);
+
+        private:
+            typedef enum MotionType
+            {
+                MOVE_JOINT,
+                MOVE_POSE,
+                SPEED_JOINT,
+                SPEED_POSE,
+                SERVO_JOINT,
+                STOP,
+                WAIT,
+                SET_OUTPUT
+            } MotionType;
+
+            /**
+             * Single step of a program.
+             */
+            class Motion
+            {
+                public:
+                    Motion() : type(WAIT), velocity(0), acceleration(0), time(0), blendRadius(0), output(0), value(false) {}
+
+                    MotionType type;
+                    std::vector<double> target; // joint position, pose or velocity
+                    double velocity;
+                    double acceleration;
+                    double time; // duration, time constant of SERVO_JOINT
+                    double blendRadius;
+                    int output;
+                    bool value;
+            };
+
+            boost::mutex mutexState;
+
+            double simulationTime;
+            bool isTimeValid;
+            double startTime;
+
+            std::vector<double> jointPosition;
+            std::vector<double> jointVelocity;
+            std::vector<double> pose;
+            std::vector<double> poseVelocity;
+            uint32_t digitalOutputs;
+
+            std::deque<Motion> motions;
+            bool isMotionActive;
+            Motion motion;
+            double motionTime;
+            std::vector<double> motionStart;
+            std::vector<double> motionDirection;
+            TrapezoidalProfile profile;
+
+            /**
+             * Convert an instruction into a motion.
+             * @param instruction
+             * @param motion
+             * @return false if the instruction is not supported
+             */
+            bool createMotion(const ScriptInstruction& instruction, Motion& motion);
+
+            /**
+             * Start the next motion of the program. A move starts with the current velocity projected onto its path, a
+             * moving robot without further motions is stopped.
+             */
+            void startNextMotion();
+
+            /**
+             * Advance the active motion.
+             * @param step [s]
+             */
+            void step(double step);
+
+            /**
+             * Change velocities towards a target velocity with limited acceleration and integrate the positions.
+             * @param position
+             * @param velocity
+             * @param targetVelocity
+             * @param acceleration
+             * @param step
+             * @return true if the target velocity is reached
+             */
+            static bool integrateVelocity(std::vector<double>& position, std::vector<double>& velocity, const std::vector<double>& targetVelocity, double acceleration, double step);
+    };
+}
+
+#endif
@@ -0,0 +1,102 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Jerk limited velocity setpoints with a watchdog for teleoperation
+// ----------------------------------------------------------------------------
+
+#ifndef TELEOP_H_
+#define TELEOP_H_
+
+#include <vector>
+
+#include <boost/thread.hpp>
+
+namespace ur_driver
+{
+    //=================================================================
+    // VelocityTeleop
+    //=================================================================
+    /**
+     * Joint velocity setpoint of the teleoperation, advanced once per cycle of the stream. Only the latest target counts.
+     * Each joint follows its target with limited velocity, acceleration and jerk: the acceleration is reduced early
+     * enough to reach the target without overshoot. If no target arrives for the watchdog timeout, the velocity ramps
+     * linearly to zero within the stop cycles (faster than the limits if necessary) and stays there until the next
+     * target.
+     */
+    class VelocityTeleop
+    {
+        public:
+            VelocityTeleop();
+
+            /**
+             * Set the limits of each joint.
+             * @param maxVelocity [rad/s]
+             * @param maxAcceleration [rad/s^2]
+             * @param maxJerk [rad/s^3]
+             */
+            void setLimits(double maxVelocity, double maxAcceleration, double maxJerk);
+
+            /**
+             * Set the watchdog.
+             * @param timeoutCycles Cycles without a target until the robot stops.
+             * @param stopCycles Cycles of the ramp to zero velocity.
+             */
+            void setWatchdog(int timeoutCycles, int stopCycles);
+
+            /**
+             * Set the target velocity, replaces the previous target. Thread safe.
+             * @param velocity 6 joint velocities [rad/s]
+             */
+            void setTarget(const std::vector<double>& velocity);
+
+            /**
+             * Restart at rest, e.g. when the robot was stopped by other means.
+             */
+            void reset();
+
+            /**
+             * Advance one cycle.
+             * @param cycleTime [s]
+             * @param velocity Velocity setpoint of the cycle, 6 values.
+             * @return false if the robot is at rest after the watchdog stopped it
+             */
+            bool step(double cycleTime, std::vector<double>& velocity);
+
+            /**
+             * Check if the watchdog stopped the robot since the last target.
+             * @return
+             */
+            bool isWatchdogActive();
+
+        private:
+            double maxVelocity;
+            double maxAcceleration;
+            double maxJerk;
+            int timeoutCycles;
+            int stopCycles;
+
+            boost::mutex mutexTarget;
+            std::vector<double> target;
+            bool hasTarget; // a target arrived since the last cycle
+            int silentCycles;
+
+            std::vector<double> velocity;
+            std::vector<double> acceleration;
+            std::vector<double> stopRate; // velocity change per cycle of the watchdog ramp
+            bool isStopping;
+    };
+}
+
+#endif
@@ -0,0 +1,107 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Spline interpolation of sparse time stamped joint trajectories
+// ----------------------------------------------------------------------------
+
+#ifndef TRAJECTORY_H_
+#define TRAJECTORY_H_
+
+#include <vector>
+#include <stddef.h>
+
+namespace ur_driver
+{
+    /**
+     * Points per segment at which SplineTrajectory::limit checks the velocity and the acceleration.
+     */
+    static const int SPLINE_CHECK_SAMPLES = 16;
+
+    //=================================================================
+    // SplineTrajectory
+    //=================================================================
+    /**
+     * Joint trajectory through sparse time stamped points (e.g. of trajectory_msgs/JointTrajectory), sampled at the
+     * rate of the servo stream. Each segment is a polynomial per joint:
+     * - positions only: cubic spline with continuous acceleration, at rest at the first and the last point
+     * - positions and velocities: cubic Hermite spline
+     * - positions, velocities and accelerations: quintic Hermite spline
+     * Fitting allocates, sampling doesn't.
+     */
+    class SplineTrajectory
+    {
+        public:
+            SplineTrajectory();
+
+            /**
+             * Fit the splines through the points, replaces the previous trajectory.
+             * @param times Time of each point [s], strictly increasing, at least 2 points.
+             * @param positions 6 joint positions per point [rad]
+             * @param velocities 6 joint velocities per point [rad/s] or empty
+             * @param accelerations 6 joint accelerations per point [rad/s^2] or empty, only used with velocities
+             * @return false if the points are invalid, the trajectory is empty then
+             */
+            bool fit(const std::vector<double>& times, const std::vector<double>& positions, const std::vector<double>& velocities, const std::vector<double>& accelerations);
+
+            /**
+             * Slow the trajectory down uniformly until no joint exceeds the limits. The path is kept, a uniform time
+             * scale divides the velocities by the factor and the accelerations by its square.
+             * @param maxVelocity [rad/s]
+             * @param maxAcceleration [rad/s^2]
+             * @return time scale factor (1 if the trajectory is within the limits)
+             */
+            double limit(double maxVelocity, double maxAcceleration);
+
+            /**
+             * Get the duration.
+             * @return [s] from the first to the last point, 0 if empty
+             */
+            double getDuration() const;
+
+            /**
+             * Check if a trajectory was fitted.
+             * @return
+             */
+            bool isEmpty() const;
+
+            /**
+             * Sample the trajectory, does not allocate. Before the first point the first point is returned, after the
+             * last point the last point at rest. Consecutive samples with increasing time are found in constant time.
+             * @param time [s] since the first point
+             * @param position 6 joint positions [rad]
+             * @param velocity 6 joint velocities [rad/s] or NULL
+             * @param acceleration 6 joint accelerations [rad/s^2] or NULL
+             */
+            void sample(double time, double* position, double* velocity, double* acceleration);
+
+        private:
+            std::vector<double> times; // of the points, relative to the first point
+            std::vector<double> coefficients; // 6 polynomial coefficients in the time since the segment start per joint and segment
+            size_t segment; // of the last sample
+
+            /**
+             * Set the coefficients of a joint of a segment from the values at both ends (quintic Hermite polynomial,
+             * cubic if the accelerations are NULL).
+             * @param index Segment
+             * @param joint
+             * @param p Positions at the start and the end
+             * @param v Velocities at the start and the end
+             * @param a Accelerations at the start and the end or NULL
+             */
+            void setSegment(size_t index, int joint, const double* p, const double* v, const double* a);
+    };
+}
+
+#endif
@@ -0,0 +1,274 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Byte stream transports between the connector and the robot controller
+// ----------------------------------------------------------------------------
+
+#ifndef TRANSPORT_H_
+#define TRANSPORT_H_
+
+#include <string>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/function.hpp>
+#include <boost/smart_ptr.hpp>
+#include <boost/thread.hpp>
+
+namespace ur_driver
+{
+    //=================================================================
+    // Transport
+    //=================================================================
+    /**
+     * Connected, blocking byte stream. One thread may read while another one writes.
+     */
+    class Transport
+    {
+        public:
+            typedef enum Type
+            {
+                TCP = 0, // socket to a robot controller or a dummy server port
+                UNIX = 1, // socket pair to an in-process dummy server
+                MEMORY = 2 // ring buffers to an in-process dummy server, no system calls
+            } Type;
+
+            typedef boost::function<void(const boost::system::error_code&, size_t)> ReadHandler;
+
+            virtual ~Transport();
+
+            /**
+             * Read the available data, block until at least one byte is available.
+             * @param data
+             * @param size
+             * @param error eof if the peer closed the stream
+             * @return number of bytes read
+             */
+            virtual size_t read(char* data, size_t size, boost::system::error_code& error) = 0;
+
+            /**
+             * Read asynchronously like read. The handler is called by a thread which runs the io_service of the transport.
+             * @param data Must stay valid until the handler is called.
+             * @param size
+             * @param handler
+             */
+            virtual void asyncRead(char* data, size_t size, const ReadHandler& handler) = 0;
+
+            /**
+             * Write all data, block while the peer does not read.
+             * @param data
+             * @param length
+             * @param error
+             * @return number of bytes written
+             */
+            virtual size_t write(const char* data, size_t length, boost::system::error_code& error) = 0;
+
+            /**
+             * Shut down both directions. Blocking reads and writes of both ends return.
+             */
+            virtual void shutdown() = 0;
+
+            /**
+             * Abort the stream: the peer gets a connection reset, the own reads return eof.
+             */
+            virtual void reset() = 0;
+
+            virtual void close() = 0;
+
+            virtual bool isOpen() = 0;
+
+            /**
+             * Send each write immediately instead of coalescing small writes.
+             * @param noDelay
+             */
+            virtual void setNoDelay(bool noDelay);
+
+            /**
+             * Get the type from its name (tcp, unix or memory).
+             * @param name
+             * @param type
+             * @return false if the name is unknown
+             */
+            static bool parseType(const std::string& name, Type& type);
+
+            static const char* getTypeName(Type type);
+    };
+
+    //=================================================================
+    // TcpTransport
+    //=================================================================
+    class TcpTransport : public Transport
+    {
+        public:
+            TcpTransport(boost::asio::io_service& io);
+
+            /**
+             * Connect to the first resolved endpoint. Throws on failure.
+             * @param host
+             * @param port
+             */
+            void connect(const std::string& host, int port);
+
+            /**
+             * Get the socket, e.g. to accept a connection.
+             * @return
+             */
+            boost::asio::ip::tcp::socket& getSocket();
+
+            size_t read(char* data, size_t size, boost::system::error_code& error);
+            void asyncRead(char* data, size_t size, const ReadHandler& handler);
+            size_t write(const char* data, size_t length, boost::system::error_code& error);
+            void shutdown();
+            void reset();
+            void close();
+            bool isOpen();
+            void setNoDelay(bool noDelay);
+
+        private:
+            boost::asio::io_service& io;
+            boost::asio::ip::tcp::socket socket;
+    };
+
+    //=================================================================
+    // UnixTransport
+    //=================================================================
+    /**
+     * One end of a Unix socket pair. Avoids the TCP stack and does not occupy a port.
+     */
+    class UnixTransport : public Transport
+    {
+        public:
+            UnixTransport(boost::asio::io_service& io);
+
+            /**
+             * Create two connected ends.
+             * @param io
+             * @param first
+             * @param second
+             */
+            static void createPair(boost::asio::io_service& io, boost::shared_ptr<Transport>& first, boost::shared_ptr<Transport>& second);
+
+            size_t read(char* data, size_t size, boost::system::error_code& error);
+            void asyncRead(char* data, size_t size, const ReadHandler& handler);
+            size_t write(const char* data, size_t length, boost::system::error_code& error);
+            void shutdown();
+            void reset();
+            void close();
+            bool isOpen();
+
+        private:
+            boost::asio::local::stream_protocol::socket socket;
+    };
+
+    //=================================================================
+    // MemoryTransport
+    //=================================================================
+    class MemoryPipe;
+
+    /**
+     * One end of a pair of ring buffers. Reads and writes are memory copies under a mutex, only a blocked reader or writer
+     * waits on a condition.
+     */
+    class MemoryTransport : public Transport
+    {
+        public:
+            MemoryTransport(boost::asio::io_service& io, boost::shared_ptr<MemoryPipe> input, boost::shared_ptr<MemoryPipe> output);
+
+            /**
+             * Create two connected ends.
+             * @param io Runs the handlers of the asynchronous reads.
+             * @param first
+             * @param second
+             * @param capacity Size of each ring buffer in bytes.
+             */
+            static void createPair(boost::asio::io_service& io, boost::shared_ptr<Transport>& first, boost::shared_ptr<Transport>& second, size_t capacity = 65536);
+
+            size_t read(char* data, size_t size, boost::system::error_code& error);
+            void asyncRead(char* data, size_t size, const ReadHandler& handler);
+            size_t write(const char* data, size_t length, boost::system::error_code& error);
+            void shutdown();
+            void reset();
+            void close();
+            bool isOpen();
+
+        private:
+            boost::asio::io_service& io;
+            boost::shared_ptr<MemoryPipe> input;
+            boost::shared_ptr<MemoryPipe> output;
+            bool isClosed;
+    };
+
+    /**
+     * Ring buffer of one direction of a memory transport.
+     */
+    class MemoryPipe
+    {
+        public:
+            MemoryPipe(size_t capacity);
+
+            size_t read(char* data, size_t size, boost::system::error_code& error);
+
+            /**
+             * Read asynchronously. Only one read may be pending.
+             * @param io
+             * @param data
+             * @param size
+             * @param handler
+             */
+            void asyncRead(boost::asio::io_service& io, char* data, size_t size, const Transport::ReadHandler& handler);
+
+            size_t write(const char* data, size_t length, boost::system::error_code& error);
+
+            /**
+             * Close the pipe. The reader gets the remaining data and then eof, or a connection reset if the pipe is reset.
+             * @param isReset
+             */
+            void close(bool isReset);
+
+        private:
+            boost::mutex mutexPipe;
+            boost::condition_variable condition;
+
+            std::vector<char> buffer;
+            size_t head;
+            size_t size;
+            bool isClosed;
+            bool isReset;
+
+            /*
+             * pending asynchronous read
+             */
+            boost::asio::io_service* pendingIo;
+            char* pendingData;
+            size_t pendingSize;
+            Transport::ReadHandler pendingHandler;
+
+            /**
+             * Copy the available data or get the end of file error. The mutex must be locked.
+             * @param data
+             * @param size
+             * @param error
+             * @return
+             */
+            size_t readAvailable(char* data, size_t size, boost::system::error_code& error);
+
+            /**
+             * Complete the pending asynchronous read if data is available or the pipe is closed. The mutex must be locked.
+             */
+            void completePendingRead();
+    };
+}
+
+#endif
@@ -20,6 +20,7 @@
 #define UTILS_H_
 
 #include <tf/tf.h>
+#include <rotation.h>
 
 namespace ur_driver
 {
@@ -108,6 +109,11 @@ namespace ur_driver
     //=================================================================
     // conversion functions
     //=================================================================
+    /*
+     * tf::Vector3 wrappers of the Rotation functions (quaternions carry w in the fourth component). Use Rotation in the
+     * hot paths, it does not construct the vectors.
+     */
+
     /**
      * Convert roll, pitch, yaw into axis angle representation.
      * @param roll
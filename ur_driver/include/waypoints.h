@@ -0,0 +1,125 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Joint solutions of the waypoints of a command list before it is sent
+// ----------------------------------------------------------------------------
+
+#ifndef WAYPOINTS_H_
+#define WAYPOINTS_H_
+
+#include <kinematics.h>
+
+#include <vector>
+
+namespace ur_driver
+{
+    //=================================================================
+    // Waypoint
+    //=================================================================
+    /**
+     * Target of a command: joint positions or a flange pose (rotation matrix and position). A linear move (movel, movep)
+     * keeps the robot on its branch, in a joint move (movej) the controller picks the pose solution nearest to the robot.
+     */
+    class Waypoint
+    {
+        public:
+            enum Type
+            {
+                JOINT,
+                CARTESIAN,
+                UNKNOWN     // the robot position afterwards is unknown (velocity commands), the later waypoints are not checked
+            };
+
+            Type type;
+            bool isLinear;
+            double q[6];
+            double rotation[9];
+            double position[3];
+
+            Waypoint();
+
+            /**
+             * Set a flange pose like the controller.
+             * @param pose position in [m] and axis angle in [rad]
+             * @param isLinear
+             */
+            void setPose(const double* pose, bool isLinear);
+
+            /**
+             * Set joint positions.
+             * @param q in [rad]
+             * @param isLinear
+             */
+            void setJoints(const double* q, bool isLinear);
+    };
+
+    /**
+     * Joint solution of a waypoint.
+     */
+    class WaypointSolution
+    {
+        public:
+            enum Status
+            {
+                OK,
+                UNREACHABLE,    // no joint solution
+                BRANCH_FLIP,    // linear move to a target on another branch (through a singularity)
+                NOT_CHECKED     // after an unknown waypoint
+            };
+
+            Status status;
+            double q[6];
+            int branch;
+
+            static const char* getStatusName(Status status);
+    };
+
+    //=================================================================
+    // WaypointSolver
+    //=================================================================
+    /**
+     * Selects the joint solutions of the waypoints of a command list, starting at the current joint positions. The
+     * analytic inverse kinematics of all waypoints are independent and run on several threads for long lists, the
+     * selection of the solutions follows the waypoints (each solution is nearest to the previous one).
+     */
+    class WaypointSolver
+    {
+        public:
+            /**
+             * Constructor.
+             * @param model
+             * @param threads Number of threads for long lists, 0 for one thread per CPU.
+             */
+            WaypointSolver(Kinematics::Model model, int threads = 0);
+
+            /**
+             * Solve all waypoints.
+             * @param waypoints
+             * @param seed current joint positions in [rad]
+             * @param solutions one per waypoint
+             * @return index of the first rejected (unreachable or branch flipping) waypoint, -1 if all are valid
+             */
+            int solve(const std::vector<Waypoint>& waypoints, const double* seed, std::vector<WaypointSolution>& solutions);
+
+        private:
+            Kinematics::Model model;
+            int threadCount;
+            std::vector<InverseSolutions> inverseSolutions;
+
+            void solveRange(const std::vector<Waypoint>* waypoints, size_t begin, size_t end);
+    };
+}
+
+#endif
@@ -0,0 +1,213 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Blend radii of the waypoints of a command list and the duration of blended moves
+// ----------------------------------------------------------------------------
+
+#include <blending.h>
+
+#include <math.h>
+#include <algorithm>
+
+using namespace ur_driver;
+
+/**
+ * Segments shorter than this have no direction [m].
+ */
+static const double BLEND_EPSILON = 1e-9;
+
+/**
+ * Get the distance between two positions.
+ * @param a
+ * @param b
+ * @param dimension
+ * @return
+ */
+static double getDistance(const double* a, const double* b, int dimension)
+{
+    double sum = 0;
+    for (int j = 0; j < dimension; j++)
+    {
+        sum += (b[j] - a[j]) * (b[j] - a[j]);
+    }
+
+    return sqrt(sum);
+}
+
+//=================================================================
+// BlendOptimizer
+//=================================================================
+BlendOptimizer::BlendOptimizer() :
+    tolerance(0)
+{
+
+}
+
+void BlendOptimizer::setTolerance(double tolerance)
+{
+    this->tolerance = std::max(tolerance, 0.0);
+}
+
+int BlendOptimizer::optimize(const std::vector<double>& positions, std::vector<double>& radii) const
+{
+    size_t count = std::min(radii.size(), positions.size() / 3 - 1);
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    //length of the segment to each waypoint
+    std::vector<double> lengths(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        lengths[i] = getDistance(&positions[i * 3], &positions[(i + 1) * 3], 3);
+    }
+
+    //largest radius of each waypoint: the arc of a blend of radius r deviates r * tan(a / 4) from the corner with the
+    //direction change angle a, without direction change only the segments limit the radius
+    std::vector<double> limits(count, 0.0);
+    for (size_t i = 0; i + 1 < count; i++)
+    {
+        if (radii[i] <= 0)
+        {
+            continue;
+        }
+
+        limits[i] = tolerance;
+        if (lengths[i] >= BLEND_EPSILON && lengths[i + 1] >= BLEND_EPSILON)
+        {
+            double cosine = 0;
+            for (int j = 0; j < 3; j++)
+            {
+                cosine += (positions[(i + 1) * 3 + j] - positions[i * 3 + j]) * (positions[(i + 2) * 3 + j] - positions[(i + 1) * 3 + j]);
+            }
+            double angle = acos(std::max(-1.0, std::min(cosine / (lengths[i] * lengths[i + 1]), 1.0)));
+
+            limits[i] = (angle > BLEND_EPSILON) ? tolerance / tan(angle / 4) : HUGE_VAL;
+        }
+    }
+
+    //equal shares of the segments, the first segment starts at rest
+    std::vector<double> result(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        double before = (i == 0) ? BLEND_MARGIN * lengths[i] : BLEND_MARGIN * lengths[i] / 2;
+        double after = (i + 1 < count) ? BLEND_MARGIN * lengths[i + 1] / 2 : 0.0;
+        result[i] = std::min(limits[i], std::min(before, after));
+    }
+
+    //the shares the neighbours don't use
+    for (size_t i = 0; i + 1 < count; i++)
+    {
+        double before = BLEND_MARGIN * lengths[i] - ((i > 0) ? result[i - 1] : 0.0);
+        double after = BLEND_MARGIN * lengths[i + 1] - result[i + 1];
+        result[i] = std::max(result[i], std::min(limits[i], std::min(before, after)));
+    }
+
+    int changes = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (result[i] != radii[i])
+        {
+            radii[i] = result[i];
+            changes++;
+        }
+    }
+
+    return changes;
+}
+
+//=================================================================
+// BlendedMoveEstimator
+//=================================================================
+double BlendedMoveEstimator::estimate(const std::vector<double>& positions, int dimension, const std::vector<double>& velocities, const std::vector<double>& accelerations, const std::vector<double>& radii, std::vector<double>& durations)
+{
+    size_t count = std::min(std::min(velocities.size(), accelerations.size()), std::min(radii.size(), positions.size() / dimension - 1));
+    durations.assign(count, 0.0);
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    std::vector<double> lengths(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        lengths[i] = getDistance(&positions[i * dimension], &positions[(i + 1) * dimension], dimension);
+    }
+
+    //largest speed at each waypoint: the arc of the blend, 0 at the last waypoint
+    std::vector<double> speeds(count, 0.0);
+    for (size_t i = 0; i + 1 < count; i++)
+    {
+        if (radii[i] <= 0 || lengths[i] < BLEND_EPSILON || lengths[i + 1] < BLEND_EPSILON)
+        {
+            continue;
+        }
+
+        double cosine = 0;
+        for (int j = 0; j < dimension; j++)
+        {
+            cosine += (positions[(i + 1) * dimension + j] - positions[i * dimension + j]) * (positions[(i + 2) * dimension + j] - positions[(i + 1) * dimension + j]);
+        }
+        double angle = acos(std::max(-1.0, std::min(cosine / (lengths[i] * lengths[i + 1]), 1.0)));
+
+        double speed = std::min(velocities[i], velocities[i + 1]);
+        if (angle > BLEND_EPSILON)
+        {
+            double radius = std::min(radii[i], std::min(lengths[i], lengths[i + 1])) / tan(angle / 2);
+            speed = std::min(speed, sqrt(std::min(accelerations[i], accelerations[i + 1]) * radius));
+        }
+        speeds[i] = speed;
+    }
+
+    //backward: the speed from which the next waypoint can be reached, forward: the speed which can be reached
+    for (size_t i = count - 1; i > 0; i--)
+    {
+        speeds[i - 1] = std::min(speeds[i - 1], sqrt(speeds[i] * speeds[i] + 2 * accelerations[i] * lengths[i]));
+    }
+
+    double total = 0;
+    double startSpeed = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        double endSpeed = std::min(speeds[i], sqrt(startSpeed * startSpeed + 2 * accelerations[i] * lengths[i]));
+        durations[i] = getProfileDuration(lengths[i], startSpeed, endSpeed, velocities[i], accelerations[i]);
+        total += durations[i];
+        startSpeed = endSpeed;
+    }
+
+    return total;
+}
+
+double BlendedMoveEstimator::getProfileDuration(double distance, double startSpeed, double endSpeed, double velocity, double acceleration)
+{
+    if (distance <= 0 || velocity <= 0 || acceleration <= 0)
+    {
+        return 0;
+    }
+
+    //triangular profile if the peak speed stays below the velocity
+    double peak = sqrt((2 * acceleration * distance + startSpeed * startSpeed + endSpeed * endSpeed) / 2);
+    if (peak <= velocity)
+    {
+        peak = std::max(peak, std::max(startSpeed, endSpeed));
+
+        return (2 * peak - startSpeed - endSpeed) / acceleration;
+    }
+
+    double ramps = (2 * velocity * velocity - startSpeed * startSpeed - endSpeed * endSpeed) / (2 * acceleration);
+
+    return (2 * velocity - startSpeed - endSpeed) / acceleration + (distance - ramps) / velocity;
+}
@@ -0,0 +1,220 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// Clocks which pace the worker threads, on wall time or on a simulated time
+// ----------------------------------------------------------------------------
+
+#include <clock.h>
+#include <ros/ros.h>
+
+#include <time.h>
+#include <errno.h>
+
+using namespace ur_driver;
+
+//=================================================================
+// Clock
+//=================================================================
+Clock::~Clock()
+{
+
+}
+
+bool Clock::isSimulated()
+{
+    return false;
+}
+
+void Clock::addParticipant()
+{
+
+}
+
+void Clock::removeParticipant()
+{
+
+}
+
+void Clock::beginWait()
+{
+
+}
+
+void Clock::endWait()
+{
+
+}
+
+void Clock::addInFlight(long bytes)
+{
+
+}
+
+Clock* Clock::getWallClock()
+{
+    static WallClock wallClock;
+
+    return &wallClock;
+}
+
+//=================================================================
+// WallClock
+//=================================================================
+double WallClock::now()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+void WallClock::sleepUntil(double time)
+{
+    struct timespec wakeup;
+    wakeup.tv_sec = (time_t)time;
+    wakeup.tv_nsec = (long)((time - wakeup.tv_sec) * 1e9);
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeup, NULL) == EINTR)
+    {
+    }
+}
+
+//=================================================================
+// SimulatedClock
+//=================================================================
+SimulatedClock::SimulatedClock(double startTime) :
+    time(startTime),
+    participants(0),
+    waiting(0),
+    inFlight(0),
+    sequence(0)
+{
+
+}
+
+double SimulatedClock::now()
+{
+    boost::lock_guard<boost::mutex> lock(mutexClock);
+
+    return time;
+}
+
+void SimulatedClock::sleepUntil(double time)
+{
+    boost::unique_lock<boost::mutex> lock(mutexClock);
+
+    if (time <= this->time)
+    {
+        return;
+    }
+
+    std::pair<double, unsigned long long> sleeper(time, sequence++);
+    sleepers.insert(sleeper);
+    waiting++;
+    advance();
+
+    //the sleeper is removed when it is woken
+    while (sleepers.count(sleeper) > 0)
+    {
+        if (!condition.timed_wait(lock, boost::posix_time::seconds(1)) && sleepers.count(sleeper) > 0 && waiting >= participants && inFlight != 0)
+        {
+            ROS_WARN_NAMED("clock", "simulated clock: %lld bytes were never read, continue", inFlight);
+            inFlight = 0;
+            advance();
+        }
+    }
+}
+
+bool SimulatedClock::isSimulated()
+{
+    return true;
+}
+
+void SimulatedClock::addParticipant()
+{
+    boost::lock_guard<boost::mutex> lock(mutexClock);
+
+    participants++;
+}
+
+void SimulatedClock::removeParticipant()
+{
+    boost::lock_guard<boost::mutex> lock(mutexClock);
+
+    participants--;
+    advance();
+}
+
+void SimulatedClock::beginWait()
+{
+    boost::lock_guard<boost::mutex> lock(mutexClock);
+
+    waiting++;
+    advance();
+}
+
+void SimulatedClock::endWait()
+{
+    boost::lock_guard<boost::mutex> lock(mutexClock);
+
+    waiting--;
+}
+
+void SimulatedClock::addInFlight(long bytes)
+{
+    boost::lock_guard<boost::mutex> lock(mutexClock);
+
+    inFlight += bytes;
+}
+
+void SimulatedClock::advance()
+{
+    if (participants > 0 && waiting >= participants && inFlight == 0 && !sleepers.empty())
+    {
+        std::set<std::pair<double, unsigned long long> >::iterator first = sleepers.begin();
+        if (first->first > time)
+        {
+            time = first->first;
+        }
+
+        sleepers.erase(first);
+        waiting--;
+
+        condition.notify_all();
+    }
+}
+
+//=================================================================
+// ClockRate
+//=================================================================
+ClockRate::ClockRate(Clock* clock, double frequency) :
+    clock(clock),
+    period(1.0 / frequency),
+    next(clock->now() + period)
+{
+
+}
+
+void ClockRate::sleep()
+{
+    //skip the missed cycles
+    double now = clock->now();
+    if (now > next + period)
+    {
+        next = now;
+    }
+
+    clock->sleepUntil(next);
+    next += period;
+}
@@ -32,6 +32,16 @@ std::string Command::getCommandString()
     return commandString;
 }
 
+const std::vector<int>& Command::getCommandIds()
+{
+    return commandIds;
+}
+
+void Command::setCommandIds(const std::vector<int>& commandIds)
+{
+    this->commandIds = commandIds;
+}
+
 CommandJointPosition::CommandJointPosition(JointValue position, double speed, double accel)
 {
     char buffer[255];
@@ -303,3 +313,222 @@ CommandLinJointTimed::CommandLinJointTimed(JointValue position, double speed, do
 
     commandString = std::string(buffer);
 }
+
+CommandServoProgram::CommandServoProgram(const std::string& host, int port, double cycleTime, double lookahead, double gain, double timeout, int bufferDepth)
+{
+    char buffer[4096];
+
+    //frames of 8 integers: keepalive (0 stop, 1 setpoint, 2 idle), sequence number and the joint positions in micro radians.
+    //Without buffer each frame is answered with a report (fill 0, sequence number), which requests the next frame
+    //while servoj runs, so no frames queue up in the socket
+    if (bufferDepth <= 0)
+    {
+        snprintf(buffer, sizeof(buffer),
+            "def driverServo():\n"
+            "  socket_open(\"%s\", %i, \"servo\")\n"
+            "  keepalive = 1\n"
+            "  while keepalive > 0:\n"
+            "    setpoint = socket_read_binary_integer(8, \"servo\", %5.5f)\n"
+            "    if setpoint[0] == 8:\n"
+            "      keepalive = setpoint[1]\n"
+            "      socket_send_int(0, \"servo\")\n"
+            "      socket_send_int(setpoint[2], \"servo\")\n"
+            "      if keepalive == 1:\n"
+            "        q = [setpoint[3] / 1000000.0, setpoint[4] / 1000000.0, setpoint[5] / 1000000.0, setpoint[6] / 1000000.0, setpoint[7] / 1000000.0, setpoint[8] / 1000000.0]\n"
+            "        servoj(q, t=%5.5f, lookahead_time=%5.5f, gain=%5.5f)\n"
+            "      else:\n"
+            "        sync()\n"
+            "      end\n"
+            "    else:\n"
+            "      keepalive = 0\n"
+            "    end\n"
+            "  end\n"
+            "  stopj(2.0)\n"
+            "  socket_close(\"servo\")\n"
+            "end\n"
+            "driverServo()\n",
+            host.c_str(),
+            port,
+            timeout,
+            cycleTime,
+            lookahead,
+            gain);
+
+        commandString = std::string(buffer);
+
+        return;
+    }
+
+    //a reader thread fills a ring buffer of twice the depth (6 values per setpoint), the main loop plays one setpoint
+    //per cycle and reports the fill level and the last received sequence number. Playing starts when the buffer holds
+    //the depth (or the stream paused for as many cycles), an empty buffer holds the position until it is filled again
+    int capacity = 2 * bufferDepth;
+    std::string ring = "0";
+    for (int i = 1; i < 6 * capacity; i++)
+    {
+        ring += ", 0";
+    }
+
+    snprintf(buffer, sizeof(buffer),
+        "def driverServo():\n"
+        "  textmsg(\"servo buffer capacity \", %i)\n"
+        "  global ring = [RING]\n"
+        "  global head = 0\n"
+        "  global fill = 0\n"
+        "  global received = -1\n"
+        "  global keepalive = 1\n"
+        "  socket_open(\"%s\", %i, \"servo\")\n"
+        "  thread servoReader():\n"
+        "    while keepalive > 0:\n"
+        "      setpoint = socket_read_binary_integer(8, \"servo\", %5.5f)\n"
+        "      if setpoint[0] == 8:\n"
+        "        if setpoint[1] == 1 and setpoint[2] > received and fill < %i:\n"
+        "          i = ((head + fill) %% %i) * 6\n"
+        "          ring[i] = setpoint[3] / 1000000.0\n"
+        "          ring[i + 1] = setpoint[4] / 1000000.0\n"
+        "          ring[i + 2] = setpoint[5] / 1000000.0\n"
+        "          ring[i + 3] = setpoint[6] / 1000000.0\n"
+        "          ring[i + 4] = setpoint[7] / 1000000.0\n"
+        "          ring[i + 5] = setpoint[8] / 1000000.0\n"
+        "          fill = fill + 1\n"
+        "          received = setpoint[2]\n"
+        "        elif setpoint[1] == 0:\n"
+        "          keepalive = 0\n"
+        "        end\n"
+        "      elif fill == 0:\n"
+        "        keepalive = 0\n"
+        "      end\n"
+        "    end\n"
+        "  end\n"
+        "  reader = run servoReader()\n"
+        "  q = get_actual_joint_positions()\n"
+        "  playing = False\n"
+        "  waiting = 0\n"
+        "  while keepalive > 0:\n"
+        "    if not playing and fill > 0:\n"
+        "      waiting = waiting + 1\n"
+        "      if fill >= %i or waiting >= %i:\n"
+        "        playing = True\n"
+        "        waiting = 0\n"
+        "      end\n"
+        "    end\n"
+        "    if playing and fill > 0:\n"
+        "      i = head * 6\n"
+        "      q = [ring[i], ring[i + 1], ring[i + 2], ring[i + 3], ring[i + 4], ring[i + 5]]\n"
+        "      head = (head + 1) %% %i\n"
+        "      fill = fill - 1\n"
+        "    elif playing:\n"
+        "      playing = False\n"
+        "    end\n"
+        "    socket_send_int(fill, \"servo\")\n"
+        "    socket_send_int(received, \"servo\")\n"
+        "    servoj(q, t=%5.5f, lookahead_time=%5.5f, gain=%5.5f)\n"
+        "  end\n"
+        "  kill reader\n"
+        "  stopj(2.0)\n"
+        "  socket_close(\"servo\")\n"
+        "end\n"
+        "driverServo()\n",
+        capacity,
+        host.c_str(),
+        port,
+        timeout,
+        capacity,
+        capacity,
+        bufferDepth,
+        bufferDepth,
+        capacity,
+        cycleTime,
+        lookahead,
+        gain);
+
+    //the literal of the ring buffer grows with the depth
+    std::string program(buffer);
+    program.replace(program.find("RING"), 4, ring);
+
+    commandString = program;
+}
+
+CommandSpeedProgram::CommandSpeedProgram(const std::string& host, int port, double cycleTime, double acceleration, double timeout)
+{
+    char buffer[1024];
+
+    //frames of the ServoServer with joint velocities in micro radians per second, each one requests the next one
+    snprintf(buffer, sizeof(buffer),
+        "def driverSpeed():\n"
+        "  socket_open(\"%s\", %i, \"speed\")\n"
+        "  keepalive = 1\n"
+        "  while keepalive > 0:\n"
+        "    setpoint = socket_read_binary_integer(8, \"speed\", %5.5f)\n"
+        "    if setpoint[0] == 8:\n"
+        "      keepalive = setpoint[1]\n"
+        "      socket_send_int(0, \"speed\")\n"
+        "      socket_send_int(setpoint[2], \"speed\")\n"
+        "      if keepalive == 1:\n"
+        "        qd = [setpoint[3] / 1000000.0, setpoint[4] / 1000000.0, setpoint[5] / 1000000.0, setpoint[6] / 1000000.0, setpoint[7] / 1000000.0, setpoint[8] / 1000000.0]\n"
+        "        speedj(qd, %5.5f, %5.5f)\n"
+        "      else:\n"
+        "        sync()\n"
+        "      end\n"
+        "    else:\n"
+        "      keepalive = 0\n"
+        "    end\n"
+        "  end\n"
+        "  stopj(%5.5f)\n"
+        "  socket_close(\"speed\")\n"
+        "end\n"
+        "driverSpeed()\n",
+        host.c_str(),
+        port,
+        timeout,
+        acceleration,
+        cycleTime,
+        acceleration);
+
+    commandString = std::string(buffer);
+}
+
+CommandMoveProgram::CommandMoveProgram(const std::string& host, int port, double timeout)
+{
+    char buffer[2048];
+
+    //frames of 11 integers: type (0 stop, 1 movej, 2 movej to a pose, 3 movep, 4 movep to a pose, 5 idle), sequence
+    //number, the target, acceleration, velocity and blend radius in millionths. The frame is acknowledged before the
+    //move, so the next frame is received while the robot moves and the moves blend. Without a move the program waits
+    //in the read, idle frames only keep it alive
+    snprintf(buffer, sizeof(buffer),
+        "def driverMoves():\n"
+        "  socket_open(\"%s\", %i, \"moves\")\n"
+        "  keepalive = 1\n"
+        "  while keepalive > 0:\n"
+        "    move = socket_read_binary_integer(11, \"moves\", %5.5f)\n"
+        "    if move[0] == 11:\n"
+        "      keepalive = move[1]\n"
+        "      socket_send_int(move[2], \"moves\")\n"
+        "      x = [move[3] / 1000000.0, move[4] / 1000000.0, move[5] / 1000000.0, move[6] / 1000000.0, move[7] / 1000000.0, move[8] / 1000000.0]\n"
+        "      a = move[9] / 1000000.0\n"
+        "      v = move[10] / 1000000.0\n"
+        "      r = move[11] / 1000000.0\n"
+        "      if keepalive == 1:\n"
+        "        movej(x, a=a, v=v, r=r)\n"
+        "      elif keepalive == 2:\n"
+        "        movej(p[x[0], x[1], x[2], x[3], x[4], x[5]], a=a, v=v, r=r)\n"
+        "      elif keepalive == 3:\n"
+        "        movep(x, a=a, v=v, r=r)\n"
+        "      elif keepalive == 4:\n"
+        "        movep(p[x[0], x[1], x[2], x[3], x[4], x[5]], a=a, v=v, r=r)\n"
+        "      end\n"
+        "    else:\n"
+        "      keepalive = 0\n"
+        "    end\n"
+        "  end\n"
+        "  stopj(2.0)\n"
+        "  socket_close(\"moves\")\n"
+        "end\n"
+        "driverMoves()\n",
+        host.c_str(),
+        port,
+        timeout);
+
+    commandString = std::string(buffer);
+}
@@ -18,6 +18,8 @@
 
 #include <connector.h>
 #include <iostream>
+#include <algorithm>
+#include <cstddef>
 
 using namespace std;
 using namespace ur_driver;
@@ -26,9 +28,12 @@ using namespace boost::asio::ip;
 //=================================================================
 // RobotState
 //=================================================================
-RobotState::RobotState()
+RobotState::RobotState() :
+    isUrProgramRunning(false),
+    isUrProgramPaused(false),
+    isTcpOffsetSet(false)
 {
-
+    memset(IOS, 0, sizeof(IOS));
 }
 
 RobotState::RobotState(const JointPosition& jointPosition, const JointVelocity& jointVelocity, const CartesianPosition& cartesianPosition)
@@ -36,6 +41,7 @@ RobotState::RobotState(const JointPosition& jointPosition, const JointVelocity&
     this->jointPosition = jointPosition;
     this->jointVelocity = jointVelocity;
     this->cartesianPosition = cartesianPosition;
+    isTcpOffsetSet = false;
 }
 
 JointPosition& RobotState::getJointPosition()
@@ -68,6 +74,53 @@ void RobotState::setCartesianPosition(const CartesianPosition& cartesianPosition
     this->cartesianPosition = cartesianPosition;
 }
 
+CartesianPosition& RobotState::getFlangePosition()
+{
+    return flangePosition;
+}
+
+void RobotState::setFlangePosition(const CartesianPosition& flangePosition)
+{
+    this->flangePosition = flangePosition;
+}
+
+CartesianPosition& RobotState::getTcpOffset()
+{
+    return tcpOffset;
+}
+
+void RobotState::setTcpOffset(const CartesianPosition& tcpOffset)
+{
+    this->tcpOffset = tcpOffset;
+    isTcpOffsetSet = true;
+}
+
+bool RobotState::hasTcpOffset()
+{
+    return isTcpOffsetSet;
+}
+
+LatencyTrace& RobotState::getLatencyTrace()
+{
+    return latencyTrace;
+}
+
+//=================================================================
+// ConnectorStatistics
+//=================================================================
+ConnectorStatistics::ConnectorStatistics() :
+    bytes(0),
+    frames(0),
+    robotStates(0),
+    decodeErrors(0),
+    skippedMessages(0),
+    resyncs(0),
+    discardedBytes(0),
+    connections(0)
+{
+
+}
+
 //=================================================================
 // Connector
 //=================================================================
@@ -75,13 +128,21 @@ Connector::Connector() :
     runConnectSocketThread(false),
     runReadSocketThread(false),
     runWriteSocketThread(false),
-    socket(io),
     isRunning(false),
     host("localhost"),
     port(SECONDARY),
     isDummy(true),
-    readFrequency(20),
-    writeFrequency(20)
+    writeFrequency(20),
+    transportType(Transport::TCP),
+    server(NULL),
+    clock(Clock::getWallClock()),
+    executor(NULL),
+    isReading(false),
+    flightRecorder(NULL),
+    latencyTracer(NULL),
+    frameSequence(0),
+    commandTracer(NULL),
+    realtimeFrameSize(0)
 {
 
 }
@@ -105,7 +166,7 @@ void Connector::addCommand(Command* command)
     mutexCommandQueue.unlock();
 }
 
-void Connector::connect(std::string host, int port, bool isDummy, double readFrequency, double writeFrequency)
+void Connector::connect(std::string host, int port, bool isDummy, double writeFrequency)
 {
     mutexStartStop.lock();
 
@@ -116,13 +177,12 @@ void Connector::connect(std::string host, int port, bool isDummy, double readFre
         this->host = host;
         this->port = port;
         this->isDummy = isDummy;
-        this->readFrequency = readFrequency;
         this->writeFrequency = writeFrequency;
 
-        //start dummy server
+        //start dummy server, in-process transports do not need the port
         if (isDummy)
         {
-            dummy.start(port);
+            dummy.start(port, transportType == Transport::TCP);
         }
 
         //clear command queue
@@ -154,14 +214,12 @@ void Connector::disconnect()
         runReadSocketThread = false;
         runWriteSocketThread = false;
 
-        try
-        {
-            socket.shutdown(tcp::socket::shutdown_both);
-            socket.close();
-        }
-        catch (std::exception& e)
+        mutexTransport.lock();
+        if (transport)
         {
+            transport->shutdown();
         }
+        mutexTransport.unlock();
 
         connectSocketThread.join();
         readSocketThread.join();
@@ -178,6 +236,46 @@ void Connector::disconnect()
     mutexStartStop.unlock();
 }
 
+void Connector::setFlightRecorder(FlightRecorder* flightRecorder)
+{
+    this->flightRecorder = flightRecorder;
+}
+
+void Connector::setLatencyTracer(LatencyTracer* latencyTracer)
+{
+    this->latencyTracer = latencyTracer;
+}
+
+void Connector::setCommandTracer(CommandTracer* commandTracer)
+{
+    this->commandTracer = commandTracer;
+}
+
+void Connector::setClock(Clock* clock)
+{
+    this->clock = clock;
+    dummy.setClock(clock);
+}
+
+void Connector::setTransport(Transport::Type type, Dummy* server)
+{
+    this->transportType = type;
+    this->server = server;
+}
+
+void Connector::setExecutor(Executor* executor)
+{
+    this->executor = executor;
+    dummy.setExecutor(executor);
+}
+
+ConnectorStatistics Connector::getStatistics()
+{
+    boost::lock_guard<boost::mutex> lock(mutexStatistics);
+
+    return statistics;
+}
+
 void Connector::notifyListeners(RobotState& robotState)
 {
     signalRobotState(robotState);
@@ -204,34 +302,96 @@ void Connector::connectSocketWorker()
             if (runConnectSocketThread)
             {
                 //TODO support other ports
-                if (/*port != InterfacePort::PRIMARY && */port != SECONDARY/* && port != InterfacePort::REALTIME*/)
+                if (/*port != InterfacePort::PRIMARY && */port != SECONDARY && port != REALTIME)
                 {
                     ROS_ERROR("port %i not supported", port);
                 }
                 else
                 {
-                    //resolve host
-                    tcp::resolver::query query(host, boost::lexical_cast<std::string>(port));
-                    tcp::resolver resolver(io);
-                    tcp::resolver::iterator endpointIterator = resolver.resolve(query);
+                    //the asynchronous reads of executor mode complete on the executor
+                    bool isExecutorMode = (executor != NULL && !clock->isSimulated());
 
-                    //connect to first resolved endpoint
-                    socket.connect(*endpointIterator);
+                    boost::shared_ptr<Transport> connection;
+                    if (transportType == Transport::TCP)
+                    {
+                        boost::shared_ptr<TcpTransport> tcpTransport(new TcpTransport(isExecutorMode ? executor->getIoService() : io));
+                        tcpTransport->connect(host, port);
+                        connection = tcpTransport;
 
-                    ROS_INFO_NAMED("connector", "connection established to %s:%i", host.c_str(), port);
+                        ROS_INFO_NAMED("connector", "connection established to %s:%i", host.c_str(), port);
+                    }
+                    else
+                    {
+                        //in-process connection to the dummy server
+                        connection = ((server != NULL) ? server : &dummy)->connect(transportType);
+                        if (!connection)
+                        {
+                            throw std::runtime_error("dummy server is not running");
+                        }
+
+                        ROS_INFO_NAMED("connector", "connection established to dummy server (%s transport)", Transport::getTypeName(transportType));
+                    }
+
+                    //a disconnect may have shut down the previous transport only
+                    mutexTransport.lock();
+                    transport = connection;
+                    if (!runConnectSocketThread)
+                    {
+                        transport->shutdown();
+                    }
+                    mutexTransport.unlock();
+
+                    mutexStatistics.lock();
+                    statistics.connections++;
+                    mutexStatistics.unlock();
 
-                    //start read/write worker threads
                     runReadSocketThread = true;
                     runWriteSocketThread = true;
-                    readSocketThread = boost::thread(boost::bind(&Connector::readSocketWorker, this));
-                    writeSocketThread = boost::thread(boost::bind(&Connector::writeSocketWorker, this));
 
                     //reset retries (no exception was thrown, therefore a connection was established)
                     retries = 0;
 
-                    //wait for read/write worker threads to finish
-                    readSocketThread.join();
-                    writeSocketThread.join();
+                    if (isExecutorMode)
+                    {
+                        //discard an incomplete frame of a previous connection
+                        receiveBuffer.clear();
+                        realtimeFrameSize = 0;
+
+                        //start the asynchronous read and the write task
+                        isReading = true;
+                        writeTask.reset(new PeriodicTask(executor, (writeFrequency > 0) ? writeFrequency : 1000.0, boost::bind(&Connector::writeStep, this)));
+                        writeTask->start();
+                        transport->asyncRead(readData, sizeof(readData), boost::bind(&Connector::handleRead, this, _1, _2));
+
+                        //wait for the end of the connection
+                        boost::unique_lock<boost::mutex> lock(mutexRead);
+                        while (isReading)
+                        {
+                            readCondition.wait(lock);
+                        }
+                        lock.unlock();
+
+                        writeTask->stop();
+                        writeTask.reset();
+                    }
+                    else
+                    {
+                        //the worker threads take part in the clock
+                        clock->addParticipant();
+                        clock->addParticipant();
+
+                        //start read/write worker threads
+                        readSocketThread = boost::thread(boost::bind(&Connector::readSocketWorker, this));
+                        writeSocketThread = boost::thread(boost::bind(&Connector::writeSocketWorker, this));
+
+                        //wait for read/write worker threads to finish
+                        readSocketThread.join();
+                        writeSocketThread.join();
+                    }
+
+                    mutexTransport.lock();
+                    transport.reset();
+                    mutexTransport.unlock();
 
                     ROS_INFO_NAMED("connector", "disconnected from %s:%i", host.c_str(), port);
                 }
@@ -248,24 +408,26 @@ void Connector::connectSocketWorker()
 
 void Connector::readSocketWorker()
 {
-    ros::Rate rate = ros::Rate(readFrequency);
+    //discard an incomplete frame of a previous connection
+    receiveBuffer.clear();
+    realtimeFrameSize = 0;
 
-    while(runReadSocketThread && socket.is_open())
+    while(runReadSocketThread && transport->isOpen())
     {
         try
         {
             boost::system::error_code error;
 
-            //===========================
-            // 1. read package size
-            //===========================
-            char dataPackageSize[4];
-            size_t length = socket.read_some(boost::asio::buffer(dataPackageSize), error); //reads only 4 bytes of overall comming package size
+            char data[4096];
+            clock->beginWait();
+            size_t length = transport->read(data, sizeof(data), error);
+            clock->endWait();
+            clock->addInFlight(-(long)length);
 
             //connection closed cleanly by peer.
             if (error == boost::asio::error::eof)
             {
-                socket.close();
+                transport->close();
 
                 break;
             }
@@ -275,206 +437,419 @@ void Connector::readSocketWorker()
                 throw boost::system::system_error(error);
             }
 
-            //verify read byte length
-            if (length != 4)
-            {
-                throw length_error("socket read: data package size: read byte length (" + boost::lexical_cast<string>(length) + ") differs from expected length (4)");
-            }
+            //the read blocks until data arrives, so the next read follows without a pause
+            processData(port, data, length);
+        }
+        catch (std::exception& e)
+        {
+            ROS_WARN_NAMED("connector", "error in read socket thread: %s", e.what());
 
-            // Calculate packagesize
-            uint32_t packageSize = (dataPackageSize[3] << 24) | (dataPackageSize[2] << 16) | (dataPackageSize[1] << 8) | dataPackageSize[0];
-            packageSize = be32toh(packageSize) - 4;
+            //the connection is broken (e.g. reset by peer), reconnect
+            transport->close();
+        }
+    }
 
-            //print dataPackageContent stream in hex format
-            ROS_DEBUG_NAMED("connector", "socket read: data package size (%i): %s", (int)length, hexString(dataPackageSize, length).c_str());
+    clock->removeParticipant();
 
-            //===========================
-            // 2. read package content
-            //===========================
-            char dataPackageContent[1024];
-            length = socket.read_some(boost::asio::buffer(dataPackageContent), error); // reads the rest of the package
+    ROS_DEBUG_NAMED("connector", "exit readSocketWorker thread");
+}
 
-            //connection closed cleanly by peer.
-            if (error == boost::asio::error::eof)
+void Connector::handleRead(const boost::system::error_code& error, size_t length)
+{
+    try
+    {
+        if (!error)
+        {
+            processData(port, readData, length);
+
+            if (runReadSocketThread && transport->isOpen())
             {
-                break;
+                transport->asyncRead(readData, sizeof(readData), boost::bind(&Connector::handleRead, this, _1, _2));
+
+                return;
             }
-            //some other error
-            else if (error)
+        }
+        //connection closed cleanly by peer or shut down by disconnect
+        else if (error != boost::asio::error::eof && error != boost::asio::error::operation_aborted)
+        {
+            ROS_WARN_NAMED("connector", "error in read handler: %s", error.message().c_str());
+        }
+    }
+    catch (std::exception& e)
+    {
+        ROS_WARN_NAMED("connector", "error in read handler: %s", e.what());
+    }
+
+    //the connection is finished (or broken), reconnect
+    transport->close();
+
+    boost::lock_guard<boost::mutex> lock(mutexRead);
+    isReading = false;
+    readCondition.notify_all();
+}
+
+void Connector::processData(int port, const char* data, size_t length)
+{
+    uint64_t readTimestamp = (latencyTracer != NULL) ? LatencyTracer::now() : 0;
+
+    receiveBuffer.insert(receiveBuffer.end(), data, data + length);
+
+    ConnectorStatistics received;
+    received.bytes = length;
+
+    size_t offset = 0;
+    size_t discardStart = 0;
+    bool isDiscarding = false;
+    while (receiveBuffer.size() - offset >= 4)
+    {
+        //frame size is big endian and includes the 4 bytes of the size itself
+        uint32_t frameSize;
+        memcpy(&frameSize, &receiveBuffer[offset], 4);
+        frameSize = be32toh(frameSize);
+
+        //the realtime interface sends frames of constant size
+        bool isValidSize = (frameSize > 4 && frameSize <= MAX_FRAME_SIZE);
+        if (port == REALTIME && realtimeFrameSize != 0)
+        {
+            isValidSize = (frameSize == realtimeFrameSize);
+        }
+
+        if (!isValidSize)
+        {
+            //skip byte by byte until a valid frame size is found
+            if (!isDiscarding)
             {
-                throw boost::system::system_error(error);
+                isDiscarding = true;
+                discardStart = offset;
+                received.resyncs++;
             }
+            offset++;
+
+            continue;
+        }
+
+        if (isDiscarding)
+        {
+            ROS_WARN_THROTTLE_NAMED(1.0, "connector", "socket read: invalid frame size, discarded %i bytes", (int)(offset - discardStart));
+            received.discardedBytes += offset - discardStart;
+            recordDiscarded(port, discardStart, offset);
+            isDiscarding = false;
+        }
+
+        //wait for the rest of the frame
+        if (receiveBuffer.size() - offset < frameSize)
+        {
+            break;
+        }
+
+        received.frames++;
+        DecodeResult result = processFrame(port, &receiveBuffer[offset], frameSize, readTimestamp);
+        if (result == DECODED)
+        {
+            received.robotStates++;
 
-            //verify read byte length
-            if (length != packageSize) //throws if read package size does not match with received package size
+            if (port == REALTIME)
             {
-                throw length_error("socket read: data package content: read byte length (" + boost::lexical_cast<string>(length) + ") differs from expected length (" + boost::lexical_cast<string>(packageSize) + ")");
+                realtimeFrameSize = frameSize;
             }
+        }
+        else if (result == SKIPPED)
+        {
+            received.skippedMessages++;
+        }
+        else
+        {
+            received.decodeErrors++;
+        }
+
+        offset += frameSize;
+    }
+
+    if (isDiscarding)
+    {
+        received.discardedBytes += offset - discardStart;
+        recordDiscarded(port, discardStart, offset);
+    }
+
+    receiveBuffer.erase(receiveBuffer.begin(), receiveBuffer.begin() + offset);
+
+    boost::lock_guard<boost::mutex> lock(mutexStatistics);
+    statistics.bytes += received.bytes;
+    statistics.frames += received.frames;
+    statistics.robotStates += received.robotStates;
+    statistics.decodeErrors += received.decodeErrors;
+    statistics.skippedMessages += received.skippedMessages;
+    statistics.resyncs += received.resyncs;
+    statistics.discardedBytes += received.discardedBytes;
+}
+
+void Connector::recordDiscarded(int port, size_t start, size_t end)
+{
+    if (flightRecorder != NULL)
+    {
+        flightRecorder->record(FlightRecorderRecordHeader::DISCARDED, port, &receiveBuffer[start], end - start);
+    }
+}
+
+Connector::DecodeResult Connector::processFrame(int port, char* frame, uint32_t frameSize, uint64_t readTimestamp)
+{
+    //print frame in hex format
+    ROS_DEBUG_NAMED("connector", "socket read: frame (%i): %s", (int)frameSize, hexString(frame, frameSize).c_str());
+
+    //record the raw frame before it is decoded in place
+    if (flightRecorder != NULL)
+    {
+        flightRecorder->record(FlightRecorderRecordHeader::FRAME, port, frame, frameSize);
+    }
+
+    RobotState robotState;
+
+    if (port == SECONDARY)
+    {
+        DecodeResult result = decodeSecondary(frame + 4, frameSize - 4, robotState);
+        if (result != DECODED)
+        {
+            return result;
+        }
+    }
+    else if (port == REALTIME)
+    {
+        if (!decodeRealtime(frame + 4, frameSize - 4, robotState))
+        {
+            return DECODE_ERROR;
+        }
+    }
+    else
+    {
+        //TODO support port
+        ROS_WARN("port %i not supported", port);
+
+        return DECODE_ERROR;
+    }
+
+    frameSequence++;
+
+    if (latencyTracer != NULL)
+    {
+        LatencyTrace& trace = robotState.getLatencyTrace();
+        trace.sequence = frameSequence;
+        trace.timestamps[LatencyTrace::FRAME_READ] = readTimestamp;
+        latencyTracer->stamp(trace, LatencyTrace::DECODED);
+    }
+
+    notifyListeners(robotState);
+
+    return DECODED;
+}
+
+Connector::DecodeResult Connector::decodeSecondary(char* dataPackageContent, uint32_t packageSize, RobotState& robotState)
+{
+    if (dataPackageContent[0] != 16)
+    {
+        //other robot messages (version, error codes, ...) do not contain a robot state
+        ROS_DEBUG_NAMED("connector", "skip robot message of type %i", dataPackageContent[0]);
+
+        return SKIPPED;
+    }
 
-            //print dataPackageContent stream in hex format, and only the content part (without the first 4byte package size info!)
-            ROS_DEBUG_NAMED("connector", "socket read: data package content (%i): %s", (int)length, hexString(dataPackageContent, length).c_str());
+    JointPosition jointPosition(6);
+    JointVelocity jointVelocity(6);
+    CartesianPosition cartesianPosition;
+    CartesianPosition tcpOffset;
+    bool isCartesianInfo = false;
 
-            if (port == PRIMARY)
+    uint32_t bytepointer = 1; // first byte of message was consumed as RobotMessageType
+
+    while (bytepointer + sizeof(Packet_port30002::PacketHeader) <= packageSize)
+    {
+        Packet_port30002::PacketHeader *packageHeader = (Packet_port30002::PacketHeader*)&dataPackageContent[bytepointer];
+        packageHeader->fixByteOrder();
+
+        //a corrupt package length would let the loop run forever or beyond the frame
+        if (packageHeader->packageLength < (int)sizeof(Packet_port30002::PacketHeader) || packageHeader->packageLength > packageSize - bytepointer)
+        {
+            ROS_WARN_NAMED("connector", "invalid package length %i of package type %i", packageHeader->packageLength, packageHeader->packageType);
+
+            return DECODE_ERROR;
+        }
+
+        uint32_t payloadSize = packageHeader->packageLength - sizeof(Packet_port30002::PacketHeader);
+        char* payload = &dataPackageContent[bytepointer+sizeof(Packet_port30002::PacketHeader)];
+
+        //ROS_WARN("Type: %i, Length: %i", packageHeader->packageType, packageHeader->packageLength);
+        switch (packageHeader->packageType)
+        {
+            case 0:
             {
-                //TODO support port
-                ROS_WARN("port %i not supported", port);
+                if (payloadSize < sizeof(Packet_port30002::RobotMode))
+                {
+                    break;
+                }
+
+                Packet_port30002::RobotMode *robotmode = (Packet_port30002::RobotMode*)payload;
+                ROS_DEBUG("RobotMode Package received");
+                robotmode->fixByteOrder();
+                robotState.isUrProgramRunning = robotmode->isProgramRunning;
+                robotState.isUrProgramPaused = robotmode->isProgramPaused;
+                break;
             }
-            else if (port == SECONDARY)
+            case 1:
             {
-                ROS_WARN_COND(dataPackageContent[0] != 16, "Something went wrong: First packageType must always be 16 but was %i", dataPackageContent[0]);
-
-                //process data package
-                RobotState robotState;
+                if (payloadSize < 6 * sizeof(Packet_port30002::Joint))
+                {
+                    break;
+                }
 
-                JointPosition jointPosition(6);
-                JointVelocity jointVelocity(6);
-                CartesianPosition cartesianPosition;
+                for (int jointCnt=0; jointCnt<6; jointCnt++)
+                {
+                    Packet_port30002::Joint *jointData = (Packet_port30002::Joint*)&payload[jointCnt*sizeof(Packet_port30002::Joint)];
+                    jointData->fixByteOrder();
+                    jointPosition[jointCnt] = jointData->q_act;
+                    jointVelocity[jointCnt] = jointData->qd_act;
+                }
+                ROS_DEBUG("JointData Package received");
+            break;
+            }
+            case 2:
+            {
+                ROS_DEBUG("ToolData Package received");
+                // Do the following before using it!
+                //toolData->fixByteOrder();
+            break;
+            }
+            case 3:
+            {
+                if (payloadSize < sizeof(Packet_port30002::MasterboardData))
+                {
+                    break;
+                }
 
-                int bytepointer = 1; // first byte of message was consumed as RobotMessageType
+                Packet_port30002::MasterboardData *masterBoardData = (Packet_port30002::MasterboardData*)payload;
+                masterBoardData->fixByteOrder();
+                ROS_DEBUG("MasterboardData Package received");
 
-                while (bytepointer < packageSize)
+                // Read Input State 0 to 7 -> robotState.getIO(0..7)
+                for (int i=0; i<8; i++)
                 {
-                    Packet_port30002::PacketHeader *packageHeader = (Packet_port30002::PacketHeader*)&dataPackageContent[bytepointer];
-                    packageHeader->fixByteOrder();
-                    //ROS_WARN("Type: %i, Length: %i", packageHeader->packageType, packageHeader->packageLength);
-                    switch (packageHeader->packageType)
-                    {
-                        case 0:
-                        {
-                            Packet_port30002::RobotMode *robotmode = (Packet_port30002::RobotMode*)&dataPackageContent[bytepointer+sizeof(Packet_port30002::PacketHeader)];
-                            ROS_DEBUG("RobotMode Package received");
-                            robotmode->fixByteOrder();
-                            robotState.isUrProgramRunning = robotmode->isProgramRunning;
-                            robotState.isUrProgramPaused = robotmode->isProgramPaused;
-                            break;
-                        }
-                        case 1:
-                        {
-                            for (int jointCnt=0; jointCnt<6; jointCnt++)
-                            {
-                                Packet_port30002::Joint *jointData =
-                                        (Packet_port30002::Joint*)&dataPackageContent[bytepointer+sizeof(Packet_port30002::PacketHeader)+jointCnt*sizeof(Packet_port30002::Joint)];
-                                jointData->fixByteOrder();
-                                jointPosition[jointCnt] = jointData->q_act;
-                                jointVelocity[jointCnt] = jointData->qd_act;
-                            }
-                            ROS_DEBUG("JointData Package received");
-                        break;
-                        }
-                        case 2:
-                        {
-                            Packet_port30002::ToolData *toolData = (Packet_port30002::ToolData*)&dataPackageContent[bytepointer+sizeof(Packet_port30002::PacketHeader)];
-                            ROS_DEBUG("ToolData Package received");
-                            // Do the following before using it!
-                            //toolData->fixByteOrder();
-                        break;
-                        }
-                        case 3:
-                        {
-                            Packet_port30002::MasterboardData *masterBoardData = (Packet_port30002::MasterboardData*)&dataPackageContent[bytepointer+sizeof(Packet_port30002::PacketHeader)];
-                            masterBoardData->fixByteOrder();
-                            ROS_DEBUG("MasterboardData Package received");
-
-                            // Read Input State 0 to 7 -> robotState.getIO(0..7)
-                            for (int i=0; i<8; i++)
-                            {
-                                robotState.set_IO(i, masterBoardData->bit_to_bool(masterBoardData->DigitalnputBits, i));
-                                ROS_INFO("Input State %d: %d", i, robotState.get_IO(i));
-                            }
-
-                            // Read Output State 0 to 7 -> robotState.getIO(8..15)
-                            for (int i=0; i<8; i++)
-                            {
-                                robotState.set_IO(18+i, masterBoardData->bit_to_bool(masterBoardData->DigitaOutputBits, i));
-                                ROS_INFO("Output State %d: %d", 18 + i, robotState.get_IO(18+i));
-                            }
-
-                            // TODO: Read Tool inputs and outputs??? The following worked in the past but not with CB3.2
-
-						    // IOS
-						    // 0-7 digital input, 8-15 configurable input, 16-17 tool input, 18-25 digital output, 26-33 configurable output, 34-35 tool output
-						    /* for (int i= 0; i< 8; i++) robotState.set_IO(i, packet->bit_to_bool(dataPackageContent, 452, i%8));
-						    for (int i= 8; i<16; i++) robotState.set_IO(i, packet->bit_to_bool(dataPackageContent, 451, i%8));
-						    for (int i=16; i<18; i++) robotState.set_IO(i, packet->bit_to_bool(dataPackageContent, 450, i%2));
-						    for (int i=18; i<26; i++) robotState.set_IO(i, packet->bit_to_bool(dataPackageContent, 456, i%8));
-						    for (int i=26; i<34; i++) robotState.set_IO(i, packet->bit_to_bool(dataPackageContent, 455, i%8));
-						    for (int i=34; i<36; i++) robotState.set_IO(i, packet->bit_to_bool(dataPackageContent, 454, i%2)); */
-
-
-                        break;
-                        }
-                        case 4:
-                        {
-                            Packet_port30002::CartesianInfo *cartesianInfo = (Packet_port30002::CartesianInfo*)&dataPackageContent[bytepointer+sizeof(Packet_port30002::PacketHeader)];
-                            ROS_DEBUG("CartesianInfo Package received");
-                            cartesianInfo->fixByteOrder();
-                            cartesianPosition.setValues(
-                                        cartesianInfo->X_Tool,
-                                        cartesianInfo->Y_Tool,
-                                        cartesianInfo->Z_Tool,
-                                        cartesianInfo->Rx,
-                                        cartesianInfo->Ry,
-                                        cartesianInfo->Rz);
-
-                        break;
-                        }
-                    }
+                    robotState.set_IO(i, masterBoardData->bit_to_bool(masterBoardData->DigitalnputBits, i));
+                    ROS_DEBUG("Input State %d: %d", i, robotState.get_IO(i));
+                }
 
-                    bytepointer+=packageHeader->packageLength;
+                // Read Output State 0 to 7 -> robotState.getIO(8..15)
+                for (int i=0; i<8; i++)
+                {
+                    robotState.set_IO(18+i, masterBoardData->bit_to_bool(masterBoardData->DigitaOutputBits, i));
+                    ROS_DEBUG("Output State %d: %d", 18 + i, robotState.get_IO(18+i));
                 }
 
-                robotState.setJointPosition(jointPosition);
-                robotState.setJointVelocity(jointVelocity);
-                robotState.setCartesianPosition(cartesianPosition);
+                // TODO: Read Tool inputs and outputs??? The following worked in the past but not with CB3.2
+
+			    // IOS
+			    // 0-7 digital input, 8-15 configurable input, 16-17 tool input, 18-25 digital output, 26-33 configurable output, 34-35 tool output
+			    /* for (int i= 0; i< 8; i++) robotState.set_IO(i, packet->bit_to_bool(dataPackageContent, 452, i%8));
+			    for (int i= 8; i<16; i++) robotState.set_IO(i, packet->bit_to_bool(dataPackageContent, 451, i%8));
+			    for (int i=16; i<18; i++) robotState.set_IO(i, packet->bit_to_bool(dataPackageContent, 450, i%2));
+			    for (int i=18; i<26; i++) robotState.set_IO(i, packet->bit_to_bool(dataPackageContent, 456, i%8));
+			    for (int i=26; i<34; i++) robotState.set_IO(i, packet->bit_to_bool(dataPackageContent, 455, i%8));
+			    for (int i=34; i<36; i++) robotState.set_IO(i, packet->bit_to_bool(dataPackageContent, 454, i%2)); */
 
-                notifyListeners(robotState);
+
+            break;
             }
-            else if (port == REALTIME)
+            case 4:
             {
-                //TODO support port
-                ROS_WARN("port %i not supported", port);
-            }
+                if (payloadSize < sizeof(Packet_port30002::CartesianInfo))
+                {
+                    break;
+                }
 
-            if (readFrequency > 0)
-            {
-                rate.sleep();
+                Packet_port30002::CartesianInfo *cartesianInfo = (Packet_port30002::CartesianInfo*)payload;
+                ROS_DEBUG("CartesianInfo Package received");
+                cartesianInfo->fixByteOrder();
+                cartesianPosition.setValues(
+                            cartesianInfo->X_Tool,
+                            cartesianInfo->Y_Tool,
+                            cartesianInfo->Z_Tool,
+                            cartesianInfo->Rx,
+                            cartesianInfo->Ry,
+                            cartesianInfo->Rz);
+                tcpOffset.setValues(
+                            cartesianInfo->TCPOffsetX,
+                            cartesianInfo->TCPOffsetY,
+                            cartesianInfo->TCPOffsetZ,
+                            cartesianInfo->TCPOffsetRX,
+                            cartesianInfo->TCPOffsetRY,
+                            cartesianInfo->TCPOffsetRZ);
+                isCartesianInfo = true;
+
+            break;
             }
         }
-        catch (std::exception& e)
-        {
-            ROS_WARN_NAMED("connector", "error in read socket thread: %s", e.what());
-        }
+
+        bytepointer+=packageHeader->packageLength;
     }
 
-    ROS_DEBUG_NAMED("connector", "exit readSocketWorker thread");
+    robotState.setJointPosition(jointPosition);
+    robotState.setJointVelocity(jointVelocity);
+    robotState.setCartesianPosition(cartesianPosition);
+    if (isCartesianInfo)
+    {
+        robotState.setTcpOffset(tcpOffset);
+    }
+
+    return DECODED;
 }
 
-void Connector::writeSocketWorker()
+bool Connector::decodeRealtime(char* dataPackageContent, uint32_t packageSize, RobotState& robotState)
 {
-    ros::Rate rate(writeFrequency);
-
-    while(runWriteSocketThread && socket.is_open())
+    //the packet length differs between controller versions, only the fields up to the tool pose are required
+    size_t requiredSize = offsetof(Packet_port30003, tool_vel);
+    if (packageSize < requiredSize)
     {
-        try
-        {
-            mutexCommandQueue.lock();
+        ROS_WARN_NAMED("connector", "realtime package too short (%u bytes)", packageSize);
 
-            if (!commandQueue.empty())
-            {
-                Command* command = commandQueue.front();
-                commandQueue.pop();
+        return false;
+    }
 
-                std::string commandStr = command->getCommandString();
+    //copy into an aligned packet, short packets leave the remaining fields zero
+    Packet_port30003 packet;
+    memset(&packet, 0, sizeof(packet));
+    memcpy(&packet, dataPackageContent, std::min((size_t)packageSize, sizeof(packet)));
+    packet.fixByteOrder();
 
-                delete command;
+    JointPosition jointPosition(6);
+    JointVelocity jointVelocity(6);
+    for (int i = 0; i < 6; i++)
+    {
+        jointPosition[i] = packet.q_act[i];
+        jointVelocity[i] = packet.qd_act[i];
+    }
 
-                ROS_DEBUG_NAMED("connector", "socket write: send command to robot controller: %s", commandStr.c_str());
+    CartesianPosition cartesianPosition;
+    cartesianPosition.setValues(
+                packet.tool_pose[0],
+                packet.tool_pose[1],
+                packet.tool_pose[2],
+                packet.tool_pose[3],
+                packet.tool_pose[4],
+                packet.tool_pose[5]);
 
-                boost::system::error_code error;
-                size_t length = socket.write_some(boost::asio::buffer(commandStr), error);
-            }
+    robotState.setJointPosition(jointPosition);
+    robotState.setJointVelocity(jointVelocity);
+    robotState.setCartesianPosition(cartesianPosition);
+
+    return true;
+}
+
+void Connector::writeSocketWorker()
+{
+    ClockRate rate(clock, writeFrequency);
 
-            mutexCommandQueue.unlock();
+    while(runWriteSocketThread && transport->isOpen())
+    {
+        try
+        {
+            writeCommand();
 
             if (writeFrequency > 0)
             {
@@ -487,9 +862,69 @@ void Connector::writeSocketWorker()
         }
     }
 
+    clock->removeParticipant();
+
     ROS_DEBUG_NAMED("connector", "exit writeSocketWorker thread");
 }
 
+void Connector::writeStep()
+{
+    if (!runWriteSocketThread || !transport->isOpen())
+    {
+        return;
+    }
+
+    try
+    {
+        writeCommand();
+    }
+    catch (std::exception& e)
+    {
+        ROS_WARN_NAMED("connector", "error in write task: %s", e.what());
+    }
+}
+
+void Connector::writeCommand()
+{
+    boost::lock_guard<boost::mutex> lock(mutexCommandQueue);
+
+    if (commandQueue.empty())
+    {
+        return;
+    }
+
+    Command* command = commandQueue.front();
+    commandQueue.pop();
+
+    std::string commandStr = command->getCommandString();
+
+    std::vector<int> commandIds;
+    if (commandTracer != NULL)
+    {
+        commandIds = command->getCommandIds();
+        commandTracer->stamp(commandIds, CommandTrace::DEQUEUED);
+    }
+
+    delete command;
+
+    ROS_DEBUG_NAMED("connector", "socket write: send command to robot controller: %s", commandStr.c_str());
+
+    if (flightRecorder != NULL)
+    {
+        flightRecorder->record(FlightRecorderRecordHeader::SCRIPT, port, commandStr.c_str(), commandStr.length());
+    }
+
+    boost::system::error_code error;
+    clock->addInFlight(commandStr.length());
+    size_t length = transport->write(commandStr.c_str(), commandStr.length(), error);
+    clock->addInFlight(-(long)(commandStr.length() - length));
+
+    if (commandTracer != NULL)
+    {
+        commandTracer->stamp(commandIds, CommandTrace::WRITTEN);
+    }
+}
+
 inline std::string Connector::hexString(char data[], int length)
 {
     std::stringstream hex;
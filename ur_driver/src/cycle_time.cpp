@@ -0,0 +1,218 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Execution time of a command list without running it
+// ----------------------------------------------------------------------------
+
+#include <cycle_time.h>
+#include <blending.h>
+
+#include <math.h>
+#include <algorithm>
+
+using namespace ur_driver;
+
+/**
+ * Joint moves shorter than this have no leading joint [rad].
+ */
+static const double CYCLE_TIME_EPSILON = 1e-9;
+
+//=================================================================
+// CycleTimeEstimator
+//=================================================================
+CycleTimeEstimator::CycleTimeEstimator() :
+    hasJoints(false), hasTcp(false)
+{
+    reset(NULL, NULL);
+}
+
+void CycleTimeEstimator::reset(const double* q, const double* tcp)
+{
+    types.clear();
+    velocities.clear();
+    accelerations.clear();
+    radii.clear();
+    times.clear();
+
+    hasJoints = q != NULL;
+    hasTcp = tcp != NULL;
+    joints.assign(6, 0.0);
+    tcps.assign(3, 0.0);
+    if (hasJoints)
+    {
+        std::copy(q, q + 6, joints.begin());
+    }
+    if (hasTcp)
+    {
+        std::copy(tcp, tcp + 3, tcps.begin());
+    }
+}
+
+void CycleTimeEstimator::addLinear(const double* tcp, const double* q, double velocity, double acceleration, double radius)
+{
+    addTarget(LINEAR, q, tcp, velocity, acceleration, radius, 0);
+}
+
+void CycleTimeEstimator::addJoint(const double* q, const double* tcp, double velocity, double acceleration, double radius)
+{
+    addTarget(JOINT, q, tcp, velocity, acceleration, radius, 0);
+}
+
+void CycleTimeEstimator::addTimed(const double* q, const double* tcp, double time)
+{
+    addTarget(TIMED, q, tcp, 0, 0, 0, time);
+}
+
+void CycleTimeEstimator::addTarget(int type, const double* q, const double* tcp, double velocity, double acceleration, double radius, double time)
+{
+    types.push_back(type);
+    velocities.push_back(velocity);
+    accelerations.push_back(acceleration);
+    radii.push_back(radius);
+    times.push_back(time);
+
+    //an unknown position stays where it is, the first known position is also taken for the targets before it
+    size_t previous = types.size() - 1;
+    if (q == NULL)
+    {
+        joints.insert(joints.end(), joints.begin() + previous * 6, joints.begin() + previous * 6 + 6);
+    }
+    else
+    {
+        if (!hasJoints)
+        {
+            for (size_t i = 0; i <= previous; i++)
+            {
+                std::copy(q, q + 6, joints.begin() + i * 6);
+            }
+            hasJoints = true;
+        }
+        joints.insert(joints.end(), q, q + 6);
+    }
+
+    if (tcp == NULL)
+    {
+        tcps.insert(tcps.end(), tcps.begin() + previous * 3, tcps.begin() + previous * 3 + 3);
+    }
+    else
+    {
+        if (!hasTcp)
+        {
+            for (size_t i = 0; i <= previous; i++)
+            {
+                std::copy(tcp, tcp + 3, tcps.begin() + i * 3);
+            }
+            hasTcp = true;
+        }
+        tcps.insert(tcps.end(), tcp, tcp + 3);
+    }
+}
+
+double CycleTimeEstimator::estimate(std::vector<double>& durations)
+{
+    durations.assign(types.size(), 0.0);
+
+    double total = 0;
+    size_t begin = 0;
+    while (begin < types.size())
+    {
+        if (types[begin] == TIMED)
+        {
+            durations[begin] = std::max(times[begin], 0.0);
+            total += durations[begin];
+            begin++;
+            continue;
+        }
+
+        //moves of the same kind blend into each other
+        size_t end = begin + 1;
+        while (end < types.size() && types[end] == types[begin])
+        {
+            end++;
+        }
+
+        total += estimateRun(begin, end, durations);
+        begin = end;
+    }
+
+    return total;
+}
+
+double CycleTimeEstimator::estimateRun(size_t begin, size_t end, std::vector<double>& durations)
+{
+    runVelocities.assign(velocities.begin() + begin, velocities.begin() + end);
+    runAccelerations.assign(accelerations.begin() + begin, accelerations.begin() + end);
+    runRadii.assign(radii.begin() + begin, radii.begin() + end);
+
+    int dimension = 3;
+    if (types[begin] == LINEAR)
+    {
+        runPositions.assign(tcps.begin() + begin * 3, tcps.begin() + (end + 1) * 3);
+    }
+    else
+    {
+        dimension = 6;
+        runPositions.assign(joints.begin() + begin * 6, joints.begin() + (end + 1) * 6);
+
+        //the leading joint moves with the speed and acceleration, along the joint space path they are scaled
+        runScales.assign(end - begin, 0.0);
+        for (size_t i = 0; i < end - begin; i++)
+        {
+            double sum = 0;
+            double leading = 0;
+            for (int j = 0; j < 6; j++)
+            {
+                double distance = runPositions[(i + 1) * 6 + j] - runPositions[i * 6 + j];
+                sum += distance * distance;
+                leading = std::max(leading, fabs(distance));
+            }
+
+            if (leading > CYCLE_TIME_EPSILON)
+            {
+                runVelocities[i] *= sqrt(sum) / leading;
+                runAccelerations[i] *= sqrt(sum) / leading;
+            }
+
+            //joint distance per TCP distance of the move
+            double tcpDistance = 0;
+            for (int j = 0; j < 3; j++)
+            {
+                tcpDistance += pow(tcps[(begin + i + 1) * 3 + j] - tcps[(begin + i) * 3 + j], 2);
+            }
+            tcpDistance = sqrt(tcpDistance);
+            if (tcpDistance > CYCLE_TIME_EPSILON)
+            {
+                runScales[i] = sqrt(sum) / tcpDistance;
+            }
+        }
+
+        //the blend radius is a TCP distance, in joint space it is scaled with the smaller ratio of both moves (a
+        //waypoint without TCP distance stops)
+        for (size_t i = 0; i + 1 < end - begin; i++)
+        {
+            runRadii[i] *= std::min(runScales[i], runScales[i + 1]);
+        }
+    }
+
+    double total = BlendedMoveEstimator::estimate(runPositions, dimension, runVelocities, runAccelerations, runRadii, runDurations);
+    std::copy(runDurations.begin(), runDurations.end(), durations.begin() + begin);
+
+    return total;
+}
+
+size_t CycleTimeEstimator::getCount() const
+{
+    return types.size();
+}
@@ -23,8 +23,10 @@
 #include <boost/asio.hpp>
 #include <ros/console.h>
 #include <tf/tf.h>
+#include <urdf/model.h>
 #include <signal.h>
 #include <errno.h>
+#include <limits>
 
 using namespace std;
 using namespace ur_driver;
@@ -52,6 +54,18 @@ Configuration::Configuration(ros::NodeHandle& nodeHandle)
     nodeHandle.param<bool>("isDummy", isDummy, true);
     ROS_DEBUG_NAMED("driver", "isDummy=%s", (isDummy) ? "true" : "false");
 
+    //run the dummy server, the connector and the commander on a simulated clock as fast as possible (published on /clock)
+    nodeHandle.param<bool>("simulatedClock", simulatedClock, false);
+    ROS_DEBUG_NAMED("driver", "simulatedClock=%s", (simulatedClock) ? "true" : "false");
+
+    //transport to the dummy server: tcp, unix (socket pair) or memory (ring buffers). The in-process transports do not use the port
+    nodeHandle.param<string>("transport", transport, "tcp");
+    ROS_DEBUG_NAMED("driver", "transport=%s", transport.c_str());
+
+    //threads of the executor which runs the connector and the periodic work of all drivers in the process (0: dedicated threads per driver). Not used with the simulated clock
+    nodeHandle.param<int>("executorThreads", executorThreads, 0);
+    ROS_DEBUG_NAMED("driver", "executorThreads=%i", executorThreads);
+
     //joint names of the (non fixed) joints
     XmlRpc::XmlRpcValue value;
     nodeHandle.getParam("jointNames", value);
@@ -82,7 +96,104 @@ Configuration::Configuration(ros::NodeHandle& nodeHandle)
     nodeHandle.param<string>("robotTcpFrameName", robotTcpFrameName, "ur_flange");
     ROS_DEBUG_NAMED("driver", "robotTcpFrameName=%s", robotTcpFrameName.c_str());
 
-    //the frequency with which the driver will read the robot state from the robot controller
+    //source of the TCP offset (flange to TCP): "tf" (robotFlangeFrameName to robotTcpFrameName) or "controller" (TCP configured on the robot controller)
+    nodeHandle.param<string>("tcpOffsetSource", tcpOffsetSource, "tf");
+    ROS_DEBUG_NAMED("driver", "tcpOffsetSource=%s", tcpOffsetSource.c_str());
+
+    //source of the flange pose: "controller" (reported pose) or "ur5"/"ur10" (forward kinematics of the joint positions of every robot state)
+    nodeHandle.param<string>("kinematics", kinematics, "controller");
+    ROS_DEBUG_NAMED("driver", "kinematics=%s", kinematics.c_str());
+
+    //solve all waypoints of a command list with the inverse kinematics of the model (kinematics "ur5"/"ur10") and reject unreachable or branch flipping lists before sending
+    nodeHandle.param<bool>("checkWaypoints", checkWaypoints, false);
+    ROS_DEBUG_NAMED("driver", "checkWaypoints=%s", (checkWaypoints) ? "true" : "false");
+
+    //largest blend radius of the waypoints of command lists [m]: the radius of each blended waypoint is replaced by the largest one which is within this tolerance and doesn't overlap the blends of the neighbouring waypoints (0: the radii of the commands are used)
+    nodeHandle.param<double>("blendTolerance", blendTolerance, 0.0);
+    ROS_DEBUG_NAMED("driver", "blendTolerance=%f", blendTolerance);
+
+    //stream joint setpoints of the topic joint_servo to a persistent servoj program instead of sending a script per command
+    nodeHandle.param<bool>("servoMode", servoMode, false);
+    ROS_DEBUG_NAMED("driver", "servoMode=%s", (servoMode) ? "true" : "false");
+
+    //address of the driver as seen from the robot controller, the servo program connects to it (the loopback address
+    //of the controller is the controller itself, so it has to be set for a real robot)
+    nodeHandle.param<string>("servoHost", servoHost, "");
+    ROS_DEBUG_NAMED("driver", "servoHost=%s", servoHost.c_str());
+
+    //port of the servo server
+    nodeHandle.param<int>("servoPort", servoPort, 50001);
+    ROS_DEBUG_NAMED("driver", "servoPort=%i", servoPort);
+
+    //rate of the setpoints sent to the servo program, the rate of the controller (125 for CB2, 500 for e-Series)
+    nodeHandle.param<double>("servoFrequency", servoFrequency, 125);
+    ROS_DEBUG_NAMED("driver", "servoFrequency=%f", servoFrequency);
+
+    //lookahead time of servoj [s] (0.03 - 0.2), smooths the trajectory and delays it
+    nodeHandle.param<double>("servoLookahead", servoLookahead, 0.1);
+    ROS_DEBUG_NAMED("driver", "servoLookahead=%f", servoLookahead);
+
+    //proportional gain of servoj (100 - 2000)
+    nodeHandle.param<double>("servoGain", servoGain, 300);
+    ROS_DEBUG_NAMED("driver", "servoGain=%f", servoGain);
+
+    //the servo program stops the robot if no setpoint frame arrives within this time [s]
+    nodeHandle.param<double>("servoTimeout", servoTimeout, 0.1);
+    ROS_DEBUG_NAMED("driver", "servoTimeout=%f", servoTimeout);
+
+    //setpoints buffered by the servo program, played in order one per cycle (0: the latest setpoint is executed). Each buffered setpoint adds a cycle of latency and rides out a late frame
+    nodeHandle.param<int>("servoBufferDepth", servoBufferDepth, 0);
+    ROS_DEBUG_NAMED("driver", "servoBufferDepth=%i", servoBufferDepth);
+
+    //acceleration limit of trajectories interpolated for the servo stream [rad/s^2] (the velocity limit is maxAngularVelocity)
+    nodeHandle.param<double>("servoAcceleration", servoAcceleration, 2.0);
+    ROS_DEBUG_NAMED("driver", "servoAcceleration=%f", servoAcceleration);
+
+    //command lists of PTP moves to joint positions are retimed time optimally within jointMaxVelocity and jointMaxAcceleration and streamed to the servo program (requires servoMode)
+    nodeHandle.param<bool>("retimeCommandLists", retimeCommandLists, false);
+    ROS_DEBUG_NAMED("driver", "retimeCommandLists=%s", (retimeCommandLists) ? "true" : "false");
+
+    //stream the joint velocities of the topic joint_teleop to a persistent speedj program, only the latest velocity counts
+    nodeHandle.param<bool>("teleopMode", teleopMode, false);
+    ROS_DEBUG_NAMED("driver", "teleopMode=%s", (teleopMode) ? "true" : "false");
+
+    //port of the teleoperation server (servoHost is the address of the driver)
+    nodeHandle.param<int>("teleopPort", teleopPort, 50002);
+    ROS_DEBUG_NAMED("driver", "teleopPort=%i", teleopPort);
+
+    //rate of the velocities sent to the speed program
+    nodeHandle.param<double>("teleopFrequency", teleopFrequency, 125);
+    ROS_DEBUG_NAMED("driver", "teleopFrequency=%f", teleopFrequency);
+
+    //acceleration limit of the teleoperation [rad/s^2] (the velocity limit is maxAngularVelocity)
+    nodeHandle.param<double>("teleopAcceleration", teleopAcceleration, 2.0);
+    ROS_DEBUG_NAMED("driver", "teleopAcceleration=%f", teleopAcceleration);
+
+    //jerk limit of the teleoperation [rad/s^3]
+    nodeHandle.param<double>("teleopJerk", teleopJerk, 20.0);
+    ROS_DEBUG_NAMED("driver", "teleopJerk=%f", teleopJerk);
+
+    //cycles without a velocity after which the watchdog stops the robot
+    nodeHandle.param<int>("teleopWatchdogCycles", teleopWatchdogCycles, 10);
+    ROS_DEBUG_NAMED("driver", "teleopWatchdogCycles=%i", teleopWatchdogCycles);
+
+    //cycles in which the watchdog ramps the velocity to zero
+    nodeHandle.param<int>("teleopStopCycles", teleopStopCycles, 25);
+    ROS_DEBUG_NAMED("driver", "teleopStopCycles=%i", teleopStopCycles);
+
+    //stream command lists of LIN and PTP moves to a persistent move program: a replacing list keeps the moves already sent to the controller and the robot blends into the new moves without stopping
+    nodeHandle.param<bool>("streamCommandLists", streamCommandLists, false);
+    ROS_DEBUG_NAMED("driver", "streamCommandLists=%s", (streamCommandLists) ? "true" : "false");
+
+    //port of the move stream server (servoHost is the address of the driver)
+    nodeHandle.param<int>("movePort", movePort, 50003);
+    ROS_DEBUG_NAMED("driver", "movePort=%i", movePort);
+
+    //the frequency with which the cached TCP offset will be updated from TF (only if TF changed)
+    nodeHandle.param<double>("tcpOffsetUpdateFrequency", tcpOffsetUpdateFrequency, 10);
+    ROS_DEBUG_NAMED("driver", "tcpOffsetUpdateFrequency=%f", tcpOffsetUpdateFrequency);
+
+    //the frequency with which the driver checks the command progress, the robot state is read as soon as it arrives
     nodeHandle.param<double>("robotReadFrequency", robotReadFrequency, 20);
     ROS_DEBUG_NAMED("driver", "robotReadFrequency=%f", robotReadFrequency);
 
@@ -90,9 +201,18 @@ Configuration::Configuration(ros::NodeHandle& nodeHandle)
     nodeHandle.param<double>("robotWriteFrequency", robotWriteFrequency, 20);
     ROS_DEBUG_NAMED("driver", "robotWriteFrequency=%f", robotWriteFrequency);
 
-    //publish frequency of the robot state
-    nodeHandle.param<double>("publishStateFrequency", publishStateFrequency, 20);
-    ROS_DEBUG_NAMED("driver", "publishStateFrequency=%f", publishStateFrequency);
+    //the robot state is published on every received robot state. A decimation factor of n publishes only every n-th state, 0 disables the output
+    nodeHandle.param<int>("jointStatesDecimation", jointStatesDecimation, 1);
+    ROS_DEBUG_NAMED("driver", "jointStatesDecimation=%i", jointStatesDecimation);
+
+    nodeHandle.param<int>("poseStateDecimation", poseStateDecimation, 1);
+    ROS_DEBUG_NAMED("driver", "poseStateDecimation=%i", poseStateDecimation);
+
+    nodeHandle.param<int>("toolFrameDecimation", toolFrameDecimation, 1);
+    ROS_DEBUG_NAMED("driver", "toolFrameDecimation=%i", toolFrameDecimation);
+
+    nodeHandle.param<int>("tfDecimation", tfDecimation, 1);
+    ROS_DEBUG_NAMED("driver", "tfDecimation=%i", tfDecimation);
 
     //velocity
     //TODO really needed? -> use parameter in message/action
@@ -116,6 +236,63 @@ Configuration::Configuration(ros::NodeHandle& nodeHandle)
     //limit for angular velocity
     nodeHandle.param<double>("maxAngularVelocity", maxAngularVelocity, 0.5);
     ROS_DEBUG_NAMED("driver", "maxAngularVelocity=%f", maxAngularVelocity);
+
+    //velocity limit of each joint of retimed command lists [rad/s] (empty: the <limit> tags of robot_description, otherwise maxAngularVelocity)
+    nodeHandle.param<std::vector<double> >("jointMaxVelocity", jointMaxVelocity, std::vector<double>());
+    if (jointMaxVelocity.size() < jointNames.size())
+    {
+        std::string key;
+        std::string description;
+        urdf::Model model;
+        jointMaxVelocity.clear();
+        if (nodeHandle.searchParam("robot_description", key) && nodeHandle.getParam(key, description) && model.initString(description))
+        {
+            for (size_t i = 0; i < jointNames.size(); i++)
+            {
+                boost::shared_ptr<const urdf::Joint> joint = model.getJoint(jointNames[i]);
+                if (joint && joint->limits && joint->limits->velocity > 0)
+                {
+                    jointMaxVelocity.push_back(joint->limits->velocity);
+                }
+            }
+        }
+
+        if (jointMaxVelocity.size() < jointNames.size())
+        {
+            jointMaxVelocity.assign(jointNames.size(), maxAngularVelocity);
+        }
+    }
+    for (size_t i = 0; i < jointMaxVelocity.size(); i++)
+    {
+        ROS_DEBUG_NAMED("driver", "jointMaxVelocity[%i]=%f", (int)i, jointMaxVelocity[i]);
+    }
+
+    //acceleration limit of each joint of retimed command lists [rad/s^2] (the URDF has none, empty: servoAcceleration)
+    nodeHandle.param<std::vector<double> >("jointMaxAcceleration", jointMaxAcceleration, std::vector<double>());
+    if (jointMaxAcceleration.size() < jointNames.size())
+    {
+        jointMaxAcceleration.assign(jointNames.size(), servoAcceleration);
+    }
+    for (size_t i = 0; i < jointMaxAcceleration.size(); i++)
+    {
+        ROS_DEBUG_NAMED("driver", "jointMaxAcceleration[%i]=%f", (int)i, jointMaxAcceleration[i]);
+    }
+
+    //file of the flight recorder which records all frames and scripts exchanged with the robot controller (empty: disabled)
+    nodeHandle.param<string>("flightRecorderFile", flightRecorderFile, "");
+    ROS_DEBUG_NAMED("driver", "flightRecorderFile=%s", flightRecorderFile.c_str());
+
+    //size of the flight recorder file in MB, the oldest records are overwritten
+    nodeHandle.param<int>("flightRecorderSize", flightRecorderSize, 64);
+    ROS_DEBUG_NAMED("driver", "flightRecorderSize=%i", flightRecorderSize);
+
+    //trace the latency of the robot state from the socket to the published message, histograms are published on /diagnostics
+    nodeHandle.param<bool>("latencyTracing", latencyTracing, false);
+    ROS_DEBUG_NAMED("driver", "latencyTracing=%s", (latencyTracing) ? "true" : "false");
+
+    //trace each command_id from the command list to the robot reaching the target, traces are published on command_trace and histograms on /diagnostics
+    nodeHandle.param<bool>("commandTracing", commandTracing, false);
+    ROS_DEBUG_NAMED("driver", "commandTracing=%s", (commandTracing) ? "true" : "false");
 }
 
 Configuration::~Configuration()
@@ -128,7 +305,8 @@ Configuration::~Configuration()
 //=================================================================
 bool Driver::shutdownSignal = false;
 
-Driver::Driver() :
+Driver::Driver(const ros::NodeHandle& driverNodeHandle) :
+    nodeHandle(driverNodeHandle),
     configuration(nodeHandle),
     /*jointPositionServer(nodeHandle, "joint_pos", boost::bind(&Driver::jointPositionCallback, this, _1), false),
     /*cartesianPositionServer(nodeHandle, "cartesian_pos", boost::bind(&Driver::cartesianPositionCallback, this, _1), false),*/
@@ -139,9 +317,6 @@ Driver::Driver() :
     //logger level
     ros::console::set_logger_level(ROSCONSOLE_DEFAULT_NAME, (ros::console::Level)configuration.loggerLevel);
 
-    //signal handler
-    signal((int) SIGINT, Driver::signalHandler);
-
     //setup input interface
     //jointVelocitySubscriber = nodeHandle.subscribe("joint_vel", 1, &Driver::jointVelocityCallback, this);
     //cartesianVelocitySubscriber = nodeHandle.subscribe("cartesian_vel", 1, &Driver::cartesianVelocityCallback, this);
@@ -155,38 +330,283 @@ Driver::Driver() :
     digitalIOServer.start();
     digitalIOArrayServer.start();
 
+    tfListener = getSharedTransformListener();
+
+    //simulated time
+    clock = Clock::getWallClock();
+    runClockPublishThread = false;
+    if (configuration.simulatedClock && !configuration.isDummy)
+    {
+        ROS_ERROR_NAMED("driver", "simulated clock is only supported with the dummy server. Use wall time");
+    }
+    else if (configuration.simulatedClock && !claimClockTopic(true))
+    {
+        ROS_ERROR_NAMED("driver", "/clock is published by another driver of this process, only one robot can run on a simulated clock. Use wall time");
+    }
+    else if (configuration.simulatedClock)
+    {
+        clock = &simulatedClock;
+        connector.setClock(clock);
+
+        clockPublisher = nodeHandle.advertise<rosgraph_msgs::Clock>("/clock", 1);
+        runClockPublishThread = true;
+        clock->addParticipant();
+        clockPublishThread = boost::thread(&Driver::clockPublishWorker, this);
+    }
+
+    //shared executor, the simulated clock needs the dedicated threads
+    if (configuration.executorThreads > 0 && clock == Clock::getWallClock())
+    {
+        executor = Executor::getShared(configuration.executorThreads);
+        connector.setExecutor(executor.get());
+
+        ROS_INFO_NAMED("driver", "run on the shared executor (%i threads)", executor->getThreadCount());
+    }
+
     // Robot Movement Interface
     isCommandActive = false;
 	isLastCommand = false;
     commandResultPublisher = nodeHandle.advertise<robot_movement_interface::Result>("command_result", 1);
     commandListSubscriber = nodeHandle.subscribe("command_list", 1, &Driver::commandListCallback, this);
-    commandThread = boost::thread(&Driver::commandThreadWorker, this); // start commander
+    estimateCycleTimeService = nodeHandle.advertiseService("estimate_cycle_time", &Driver::estimateCycleTimeCallback, this);
+    runCommandThread = true;
+    if (executor)
+    {
+        commandTask.reset(new PeriodicTask(executor.get(), configuration.robotReadFrequency, boost::bind(&Driver::commandStep, this)));
+        commandTask->start();
+    }
+    else
+    {
+        clock->addParticipant();
+        commandThread = boost::thread(&Driver::commandThreadWorker, this); // start commander
+    }
 
     //setup output interface
     jointStatePublisher = nodeHandle.advertise<sensor_msgs::JointState>("joint_states", 1);
     poseStatePublisher = nodeHandle.advertise<geometry_msgs::Pose>("pose_state", 1);
     toolFrameStatePublisher = nodeHandle.advertise<robot_movement_interface::EulerFrame>("tool_frame", 1);
 
-    //start publisher
-    runRobotStatePublishThread = true;
-    robotStatePublishThread = boost::thread(&Driver::robotStatePublishWorker, this);
+    //preallocate the output messages, only the numeric fields are overwritten on publishing
+    sensor_msgs::JointState jointState;
+    jointState.name = configuration.jointNames;
+    jointState.position.resize(configuration.jointNames.size(), 0);
+    jointState.velocity.resize(configuration.jointNames.size(), 0);
+    jointState.effort.resize(configuration.jointNames.size(), 0);           //TODO get effort values
+    jointStatePool.init(jointState);
+    poseStatePool.init(geometry_msgs::Pose());
+    toolFramePool.init(robot_movement_interface::EulerFrame());
+
+    //start TCP offset cache
+    isTcpOffsetValid = false;
+    isTfChanged = true;
+    runTcpOffsetThread = false;
+    tcpOffsetFlangeFrameName = configuration.robotFlangeFrameName;
+    tcpOffsetTcpFrameName = configuration.robotTcpFrameName;
+    if (configuration.tcpOffsetSource == "tf")
+    {
+        tfChangedConnection = tfListener->addTransformsChangedListener(boost::bind(&Driver::tfChangedListener, this));
+        runTcpOffsetThread = true;
+        if (executor)
+        {
+            //a step of the executor must not wait for TF
+            tcpOffsetTask.reset(new PeriodicTask(executor.get(), configuration.tcpOffsetUpdateFrequency, boost::bind(&Driver::tcpOffsetStep, this, ros::Duration(0))));
+            tcpOffsetTask->start();
+        }
+        else
+        {
+            tcpOffsetThread = boost::thread(&Driver::tcpOffsetWorker, this);
+        }
+    }
+    else if (configuration.tcpOffsetSource != "controller")
+    {
+        ROS_ERROR_NAMED("driver", "unknown TCP offset source \"%s\". No TCP frame will be published", configuration.tcpOffsetSource.c_str());
+    }
+
+    //forward kinematics
+    kinematicsModel = Kinematics::getModel(configuration.kinematics);
+    if (kinematicsModel == Kinematics::NONE && configuration.kinematics != "controller")
+    {
+        ROS_ERROR_NAMED("driver", "unknown kinematics \"%s\". Use the pose of the controller", configuration.kinematics.c_str());
+    }
+
+    if (configuration.checkWaypoints && kinematicsModel == Kinematics::NONE)
+    {
+        ROS_ERROR_NAMED("driver", "checking the waypoints needs the kinematics \"ur5\" or \"ur10\". The waypoints will not be checked");
+    }
+    else if (configuration.checkWaypoints)
+    {
+        waypointSolver.reset(new WaypointSolver(kinematicsModel));
+    }
+
+    //start publisher, on the executor the robot states are published when they are received
+    robotStateSequence = 0;
+    runRobotStatePublishThread = !executor;
+    if (runRobotStatePublishThread)
+    {
+        robotStatePublishThread = boost::thread(&Driver::robotStatePublishWorker, this);
+    }
+
+    //start flight recorder
+    if (!configuration.flightRecorderFile.empty() && flightRecorder.open(configuration.flightRecorderFile, (uint64_t)configuration.flightRecorderSize * 1024 * 1024))
+    {
+        connector.setFlightRecorder(&flightRecorder);
+    }
+
+    //start latency tracing
+    if (configuration.latencyTracing)
+    {
+        latencyTracer.setEnabled(true);
+        connector.setLatencyTracer(&latencyTracer);
+    }
+
+    //start command tracing
+    if (configuration.commandTracing)
+    {
+        commandTracer.setEnabled(true);
+        connector.setCommandTracer(&commandTracer);
+        commandTracePublisher = nodeHandle.advertise<ur_driver::CommandLatency>("command_trace", 100);
+        commandTraceService = nodeHandle.advertiseService("get_command_trace", &Driver::getCommandTraceCallback, this);
+    }
+
+    if (configuration.latencyTracing || configuration.commandTracing || (configuration.servoMode && configuration.servoBufferDepth > 0))
+    {
+        registerDiagnostics(this, true);
+    }
 
     //connect to robot controller
-    connector.connect(configuration.host, configuration.port, configuration.isDummy, configuration.robotReadFrequency, configuration.robotWriteFrequency);
+    Transport::Type transportType = Transport::TCP;
+    if (!Transport::parseType(configuration.transport, transportType))
+    {
+        ROS_ERROR_NAMED("driver", "unknown transport %s. Use tcp", configuration.transport.c_str());
+    }
+    else if (transportType != Transport::TCP && !configuration.isDummy)
+    {
+        ROS_ERROR_NAMED("driver", "%s transport is only supported with the dummy server. Use tcp", configuration.transport.c_str());
+        transportType = Transport::TCP;
+    }
+    connector.setTransport(transportType);
+
+    connector.connect(configuration.host, configuration.port, configuration.isDummy, configuration.robotWriteFrequency);
     connector.addRobotStateListener(&Driver::robotStateListener, this);
 
+    //the programs of the streaming modes connect back to servoHost, the dummy server runs next to the driver
+    if (configuration.servoHost.empty() && configuration.isDummy)
+    {
+        configuration.servoHost = "127.0.0.1";
+    }
+    else if (configuration.servoHost.empty() && (configuration.servoMode || configuration.teleopMode || configuration.streamCommandLists))
+    {
+        ROS_ERROR_NAMED("driver", "servoHost is not set. Set it to the address of this PC as seen from the robot to use servoMode, teleopMode or streamCommandLists");
+        configuration.servoMode = false;
+        configuration.teleopMode = false;
+        configuration.streamCommandLists = false;
+    }
+
+    //start servo streaming
+    lastServoUpload = 0;
+    servoTrajectoryTime = -1;
+    isCommandListRetimed = false;
+    if (configuration.servoMode)
+    {
+        servoServer.setClock(clock);
+        servoServer.setBufferDepth(configuration.servoBufferDepth);
+        servoServer.setGenerator(boost::bind(&Driver::servoStep, this, _1, _2));
+        servoServer.start(configuration.servoPort, configuration.servoFrequency);
+        uploadServoProgram();
+
+        jointServoSubscriber = nodeHandle.subscribe("joint_servo", 1, &Driver::jointServoCallback, this, ros::TransportHints().tcpNoDelay());
+    }
+
+    //start velocity teleoperation, the program is uploaded with the first velocity if the servo program runs
+    lastTeleopUpload = 0;
+    if (configuration.teleopMode)
+    {
+        teleop.setLimits(configuration.maxAngularVelocity, configuration.teleopAcceleration, configuration.teleopJerk);
+        teleop.setWatchdog(configuration.teleopWatchdogCycles, configuration.teleopStopCycles);
+
+        teleopServer.setClock(clock);
+        teleopServer.setGenerator(boost::bind(&Driver::teleopStep, this, _1, _2));
+        teleopServer.start(configuration.teleopPort, configuration.teleopFrequency);
+        if (!configuration.servoMode)
+        {
+            uploadTeleopProgram();
+        }
+
+        jointTeleopSubscriber = nodeHandle.subscribe("joint_teleop", 1, &Driver::jointTeleopCallback, this, ros::TransportHints().tcpNoDelay());
+    }
+
+    //stream command lists, the move program is uploaded with the first list
+    lastMoveUpload = 0;
+    isCommandListStreamed = false;
+    if (configuration.streamCommandLists)
+    {
+        moveStream.setClock(clock);
+        moveStream.setTimeout(configuration.servoTimeout);
+        if (configuration.commandTracing)
+        {
+            moveStream.setCommandTracer(&commandTracer);
+        }
+        moveStream.start(configuration.movePort);
+    }
+
     ROS_INFO_NAMED("driver", "driver initialized");
 }
 
 Driver::~Driver()
 {
+    //stop tracing diagnostics
+    registerDiagnostics(this, false);
+
+    //stop servo streaming, teleoperation and move streaming, the programs stop the robot
+    jointServoSubscriber.shutdown();
+    servoServer.stop();
+    jointTeleopSubscriber.shutdown();
+    teleopServer.stop();
+    moveStream.stop();
+
+    //disconnect from robot controller
+    connector.removeRobotStateListener(&Driver::robotStateListener, this);
+    connector.disconnect();
+
+    //stop commander
+    runCommandThread = false;
+    commandThread.join();
+    if (commandTask)
+    {
+        commandTask->stop();
+    }
+
+    //stop simulated time
+    runClockPublishThread = false;
+    clockPublishThread.join();
+    if (clock == &simulatedClock)
+    {
+        claimClockTopic(false);
+    }
+
     //stop publisher
     runRobotStatePublishThread = false;
+    robotStateCondition.notify_all();
     robotStatePublishThread.join();
+
+    //stop TCP offset cache
+    if (tfChangedConnection.connected())
+    {
+        tfListener->removeTransformsChangedListener(tfChangedConnection);
+    }
+    runTcpOffsetThread = false;
+    tcpOffsetThread.join();
+    if (tcpOffsetTask)
+    {
+        tcpOffsetTask->stop();
+    }
 }
 
 void Driver::spin()
 {
+    //signal handler
+    signal((int) SIGINT, Driver::signalHandler);
+
     //spinner
     ros::AsyncSpinner spinner(4);
     spinner.start();
@@ -198,8 +618,7 @@ void Driver::spin()
         rate.sleep();
     }
 
-    delete this;
-    ros::spinOnce();
+    spinner.stop();
 }
 
 /*
@@ -821,6 +1240,7 @@ void Driver::executeDigIo(const ur_driver::DigIOGoalConstPtr &goal)
     ur_driver::DigIOResult result;
 
     if (goal->readOnly){
+        boost::lock_guard<boost::mutex> lock(mutexRobotState);
         result.state = lastRobotState.get_IO(goal->ioNr);
     } else {
         Command* command = new CommandDigitalIO(goal->ioNr, (bool)goal->newState);
@@ -854,6 +1274,7 @@ void Driver::executeDigIoArray(const ur_driver::DigIOArrayGoalConstPtr &goal)
     {
 
         if (goal->readOnly[i]){
+            boost::lock_guard<boost::mutex> lock(mutexRobotState);
             result.ioNr.push_back(goal->ioNr[i]);
             result.state.push_back(lastRobotState.get_IO(goal->ioNr[i]));
         } else {
@@ -874,338 +1295,1549 @@ void Driver::executeDigIoArray(const ur_driver::DigIOArrayGoalConstPtr &goal)
 
 void Driver::robotStatePublishWorker()
 {
-    ros::Rate rate(configuration.publishStateFrequency);
+    RobotState robotState;
+    unsigned long sequence = 0;
 
     while (ros::ok() && runRobotStatePublishThread)
     {
-        //publish joint state
-        sensor_msgs::JointState jointState;
-        jointState.header.stamp = ros::Time::now();
-        jointState.name = configuration.jointNames;
-        jointState.position = lastRobotState.getJointPosition().getValues();
-        jointState.velocity = lastRobotState.getJointVelocity().getValues();
-        jointState.effort.resize(jointState.position.size(), 0);                //TODO get effort values
-
-        if (jointState.position.size() > 0 && jointState.velocity.size() > 0)
-        {
-            jointStatePublisher.publish(jointState);
-        }
-
-        //publish pose state
-        geometry_msgs::Pose poseState;
-        poseState.position.x = lastRobotState.getCartesianPosition().x();
-        poseState.position.y = lastRobotState.getCartesianPosition().y();
-        poseState.position.z = lastRobotState.getCartesianPosition().z();
-        tf::Vector3 rot = axisToQuaternion(lastRobotState.getCartesianPosition().rx(), lastRobotState.getCartesianPosition().ry(), lastRobotState.getCartesianPosition().rz());
-        poseState.orientation.x = rot.x();
-        poseState.orientation.y = rot.y();
-        poseState.orientation.z = rot.z();
-        poseState.orientation.w = rot.w();
-
-        poseStatePublisher.publish(poseState);
-
-        // publish pose with euler intrinsic zyx
-        robot_movement_interface::EulerFrame pose_xyzState;
-        pose_xyzState.x = lastRobotState.getCartesianPosition().x();
-        pose_xyzState.y = lastRobotState.getCartesianPosition().y();
-        pose_xyzState.z = lastRobotState.getCartesianPosition().z();
-        tf::Vector3 rot2 = axisToRpy(lastRobotState.getCartesianPosition().rx(), lastRobotState.getCartesianPosition().ry(), lastRobotState.getCartesianPosition().rz());
-        // axisToRPY produces extrinsic x,y,z -> we need intrinsic z,y,x (direct conversion by changing order)
-        pose_xyzState.alpha = rot2.z();
-        pose_xyzState.beta  = rot2.y();
-        pose_xyzState.gamma = rot2.x();
-        toolFrameStatePublisher.publish(pose_xyzState);
-
-        //publish a frame for the position of the TCP. Because the given pose state is the position of the flange a transformation into the tool frame is necessary.
-        try
-        {
-            tf::Pose tfPose;
-            tf::poseMsgToTF(poseState, tfPose);
-            tf::StampedTransform transformFlange2Tcp;
-            tfListener.waitForTransform(configuration.robotFlangeFrameName, configuration.robotTcpFrameName, ros::Time(0), ros::Duration(0.5));
-            tfListener.lookupTransform(configuration.robotFlangeFrameName, configuration.robotTcpFrameName, ros::Time(0), transformFlange2Tcp);
-            tfPose *= transformFlange2Tcp;
-            tfBroadcaster.sendTransform(tf::StampedTransform(tfPose, ros::Time::now(), configuration.robotBaseFrameName, "robot_state_tcp"));
-        }
-        catch (tf::TransformException& e)
+        //wait for a new robot state (the timeout is only needed to recognize a shutdown)
         {
-            ROS_ERROR_NAMED("driver", "TCP pose transformation failed: %s", e.what());
+            boost::unique_lock<boost::mutex> lock(mutexRobotState);
+
+            if (robotStateSequence == sequence)
+            {
+                robotStateCondition.timed_wait(lock, boost::posix_time::milliseconds(100));
+            }
+
+            if (robotStateSequence == sequence)
+            {
+                continue;
+            }
+
+            robotState = lastRobotState;
+            sequence = robotStateSequence;
         }
 
-        rate.sleep();
+        publishRobotState(robotState, sequence);
     }
 }
 
-void Driver::robotStateListener(const RobotState& robotState)
+void Driver::publishRobotState(RobotState& robotState, unsigned long sequence)
 {
-    //TODO need mutex? (probably yes, but no side effects so far)
-    lastRobotState = robotState;
-}
+    latencyTracer.stamp(robotState.getLatencyTrace(), LatencyTrace::SNAPSHOT);
 
-void Driver::signalHandler(int signal)
-{
-    ROS_INFO_NAMED("driver", "shutdown");
-    shutdownSignal = true;
-}
+    ros::Time stamp = ros::Time::now();
 
-void Driver::commandThreadWorker()
-{
-    ros::Rate rate(configuration.robotReadFrequency);
+    if (isPublishCycle(sequence, configuration.jointStatesDecimation))
+    {
+        publishJointState(robotState, stamp);
+    }
 
-    int result;
+    if (isPublishCycle(sequence, configuration.poseStateDecimation))
+    {
+        publishPoseState(robotState);
+    }
 
-    while (ros::ok())
+    if (isPublishCycle(sequence, configuration.toolFrameDecimation))
     {
+        publishToolFrame(robotState);
+    }
 
-        commandMutex.lock();
+    if (isPublishCycle(sequence, configuration.tfDecimation))
+    {
+        broadcastTcpFrame(robotState, stamp);
+    }
 
-		if (commandList.size() > 0){
-			if (isCommandFinished(commandList[0], &result)){
+    if (latencyTracer.isEnabled())
+    {
+        latencyTracer.stamp(robotState.getLatencyTrace(), LatencyTrace::PUBLISHED);
+        latencyTracer.record(robotState.getLatencyTrace());
+    }
+}
 
-				isLastCommand = true;
-				lastCommand = commandList[0];
+bool Driver::isPublishCycle(unsigned long sequence, int decimation)
+{
+    return decimation > 0 && sequence % decimation == 0;
+}
 
-				if (commandList[0].command_id >= 0){
+void Driver::publishJointState(RobotState& robotState, const ros::Time& stamp)
+{
+    if (robotState.getJointPosition().getValues().size() > 0 && robotState.getJointVelocity().getValues().size() > 0)
+    {
+        sensor_msgs::JointStatePtr jointState = jointStatePool.acquire();
+        fillJointState(robotState, stamp, *jointState);
+        jointStatePublisher.publish(jointState);
+    }
+}
 
-					robot_movement_interface::Result result_msg;
-		            result_msg.command_id = commandList[0].command_id;
-		            result_msg.result_code = result;
-		            commandResultPublisher.publish(result_msg); 
+void Driver::publishPoseState(RobotState& robotState)
+{
+    geometry_msgs::PosePtr poseState = poseStatePool.acquire();
+    fillPoseState(robotState, *poseState);
+    poseStatePublisher.publish(poseState);
+}
 
-				}
+void Driver::publishToolFrame(RobotState& robotState)
+{
+    robot_movement_interface::EulerFramePtr toolFrame = toolFramePool.acquire();
+    fillToolFrame(robotState, *toolFrame);
+    toolFrameStatePublisher.publish(toolFrame);
+}
 
-				commandList.erase(commandList.begin());
-			}
-		}
+void Driver::fillJointState(RobotState& robotState, const ros::Time& stamp, sensor_msgs::JointState& jointState)
+{
+    const std::vector<double>& position = robotState.getJointPosition().getValues();
+    const std::vector<double>& velocity = robotState.getJointVelocity().getValues();
 
-        commandMutex.unlock();
+    jointState.header.stamp = stamp;
+    jointState.position.assign(position.begin(), position.end());
+    jointState.velocity.assign(velocity.begin(), velocity.end());
+}
 
-        rate.sleep();
-    }
+void Driver::fillPoseState(RobotState& robotState, geometry_msgs::Pose& poseState)
+{
+    poseState.position.x = robotState.getCartesianPosition().x();
+    poseState.position.y = robotState.getCartesianPosition().y();
+    poseState.position.z = robotState.getCartesianPosition().z();
+    Rotation::axisToQuaternion(robotState.getCartesianPosition().rx(), robotState.getCartesianPosition().ry(), robotState.getCartesianPosition().rz(),
+                               poseState.orientation.x, poseState.orientation.y, poseState.orientation.z, poseState.orientation.w);
 }
 
-bool Driver::isCommandFinished(robot_movement_interface::Command command, int *result){
-    
-    *result = 0;
+void Driver::fillToolFrame(RobotState& robotState, robot_movement_interface::EulerFrame& toolFrame)
+{
+    toolFrame.x = robotState.getCartesianPosition().x();
+    toolFrame.y = robotState.getCartesianPosition().y();
+    toolFrame.z = robotState.getCartesianPosition().z();
+    double roll, pitch, yaw;
+    Rotation::axisToRpy(robotState.getCartesianPosition().rx(), robotState.getCartesianPosition().ry(), robotState.getCartesianPosition().rz(), roll, pitch, yaw);
+    // axisToRPY produces extrinsic x,y,z -> we need intrinsic z,y,x (direct conversion by changing order)
+    toolFrame.alpha = yaw;
+    toolFrame.beta  = pitch;
+    toolFrame.gamma = roll;
+}
 
-    if (strcmp(command.pose_type.c_str(), "EULER_INTRINSIC_ZYX") == 0){
+void Driver::broadcastTcpFrame(RobotState& robotState, const ros::Time& stamp)
+{
+    //publish a frame for the position of the TCP. The TCP offset of the source is applied to the flange pose (not to the TCP pose of the controller).
+    tf::Transform transform;
+    if (!getTcpOffset(robotState, transform))
+    {
+        ROS_WARN_THROTTLE_NAMED(5.0, "driver", "TCP offset not available. TCP frame will not be published");
 
-        // delta is the launch distance previous to blending, if not given then it should be low value but not 0 (over robot resolution)
-        double dx = fabs(lastRobotState.getCartesianPosition().x() - command.pose[0]);
-        double dy = fabs(lastRobotState.getCartesianPosition().y() - command.pose[1]);
-        double dz = fabs(lastRobotState.getCartesianPosition().z() - command.pose[2]);
+        return;
+    }
 
-		float blending = 0.0;	// m
-		float delta = 0.001;	// m
+    tf::Pose tfPose = poseToTransform(&robotState.getFlangePosition().getValues()[0]);
+    tfPose *= transform;
+    tfBroadcaster.sendTransform(tf::StampedTransform(tfPose, stamp, configuration.robotBaseFrameName, "robot_state_tcp"));
+}
 
-		if (command.blending.size() > 0) blending = command.blending[0];
-		if (command.blending.size() > 1) delta = command.blending[1];
+bool Driver::getTcpOffset(RobotState& robotState, tf::Transform& transform)
+{
+    if (configuration.tcpOffsetSource == "controller")
+    {
+        //the realtime interface does not send the TCP offset
+        transform = poseToTransform(&robotState.getTcpOffset().getValues()[0]);
 
-        return (dx * dx + dy * dy + dz * dz) <= (blending + delta) * (blending + delta);
+        return robotState.hasTcpOffset();
+    }
 
-    } else if (strcmp(command.pose_type.c_str(), "JOINTS") == 0){
+    boost::lock_guard<boost::mutex> lock(mutexTcpOffset);
+    transform = transformFlange2Tcp;
 
-		double sum = 0;
-		double delta = 0.01; // 0.01 rad to consider a position correct
+    return isTcpOffsetValid;
+}
 
-		if (command.blending.size() > 1) delta = command.blending[1];
+void Driver::getTcpPosition(const double* pose, const tf::Transform& tcpOffset, double* tcp)
+{
+    tf::Vector3 position = (poseToTransform(pose) * tcpOffset).getOrigin();
+    tcp[0] = position.x();
+    tcp[1] = position.y();
+    tcp[2] = position.z();
+}
 
-		JointPosition pos =	lastRobotState.getJointPosition();	
-		for (int i = 0; i < 6; i++) sum += fabs(command.pose[i] - pos[i]) * fabs(command.pose[i] - pos[i]);
-		return sum <= (delta) * (delta); 
-	}
+void Driver::transformPose(const double* pose, const tf::Transform& transform, double* result)
+{
+    tf::Transform transformed = poseToTransform(pose) * transform;
+    tf::Quaternion rotation = transformed.getRotation();
+    result[0] = transformed.getOrigin().x();
+    result[1] = transformed.getOrigin().y();
+    result[2] = transformed.getOrigin().z();
+    Rotation::quaternionToAxis(rotation.x(), rotation.y(), rotation.z(), rotation.w(), result[3], result[4], result[5]);
+}
 
-    return false;
+tf::Transform Driver::poseToTransform(const double* pose)
+{
+    double x, y, z, w;
+    Rotation::axisToQuaternion(pose[3], pose[4], pose[5], x, y, z, w);
 
+    return tf::Transform(tf::Quaternion(x, y, z, w), tf::Vector3(pose[0], pose[1], pose[2]));
 }
 
-int Driver::processCommand(robot_movement_interface::Command command, ur_driver::Command * result){
+void Driver::tcpOffsetWorker()
+{
+    ros::Rate rate(configuration.tcpOffsetUpdateFrequency);
 
-	// ------------------------------------------------------------------------
-	// Format validation
-	// ------------------------------------------------------------------------
+    while (ros::ok() && runTcpOffsetThread)
+    {
+        tcpOffsetStep(ros::Duration(0.5));
 
-	if (strcmp(command.pose_type.c_str(), "JOINTS") == 0){
-		if (command.pose.size() < 6) return 0;
-	}
+        rate.sleep();
+    }
+}
 
-	if (strcmp(command.pose_type.c_str(), "EULER_INTRINSIC_ZYX") == 0){
-		if (command.pose.size() < 6) return 0;
-	}
+void Driver::tcpOffsetStep(const ros::Duration& timeout)
+{
+    if (!ros::ok() || !runTcpOffsetThread)
+    {
+        return;
+    }
 
-	if (strcmp(command.velocity_type.c_str(), "M/S") == 0){
-		if (command.velocity.size() < 1) return 0;
-	}
+    //invalidate the cache if the frame names were changed on the parameter server
+    std::string flangeFrameName;
+    std::string tcpFrameName;
+    {
+        boost::lock_guard<boost::mutex> lock(mutexTcpOffset);
+        flangeFrameName = tcpOffsetFlangeFrameName;
+        tcpFrameName = tcpOffsetTcpFrameName;
+    }
+    std::string newFlangeFrameName = flangeFrameName;
+    std::string newTcpFrameName = tcpFrameName;
+    nodeHandle.getParamCached("robotFlangeFrameName", newFlangeFrameName);
+    nodeHandle.getParamCached("robotTcpFrameName", newTcpFrameName);
 
-	if (strcmp(command.acceleration_type.c_str(), "M/S^2") == 0){
-		if (command.acceleration.size() < 1) return 0;
-	}
+    if (newFlangeFrameName != flangeFrameName || newTcpFrameName != tcpFrameName)
+    {
+        ROS_INFO_NAMED("driver", "TCP offset frames changed to \"%s\" -> \"%s\"", newFlangeFrameName.c_str(), newTcpFrameName.c_str());
 
-	if (strcmp(command.velocity_type.c_str(), "RAD/S") == 0){
-		if (command.velocity.size() < 1) return 0;
-	}
+        flangeFrameName = newFlangeFrameName;
+        tcpFrameName = newTcpFrameName;
 
-	if (strcmp(command.acceleration_type.c_str(), "RAD/S^2") == 0){
-		if (command.acceleration.size() < 1) return 0;
-	}
+        boost::lock_guard<boost::mutex> lock(mutexTcpOffset);
+        tcpOffsetFlangeFrameName = newFlangeFrameName;
+        tcpOffsetTcpFrameName = newTcpFrameName;
+        isTcpOffsetValid = false;
+        isTfChanged = true;
+    }
 
-	if (strcmp(command.blending_type.c_str(), "M") == 0){
-		if (command.blending.size() < 1) return 0;
-	}
-	// ------------------------------------------------------------------------
+    //update the cache if the TCP offset in TF changed (a failed lookup keeps the last valid offset)
+    bool update;
+    {
+        boost::lock_guard<boost::mutex> lock(mutexTcpOffset);
+        update = isTfChanged || !isTcpOffsetValid;
+        isTfChanged = false;
+    }
 
+    if (update)
+    {
+        try
+        {
+            tf::StampedTransform transform;
+            tfListener->waitForTransform(flangeFrameName, tcpFrameName, ros::Time(0), timeout);
+            tfListener->lookupTransform(flangeFrameName, tcpFrameName, ros::Time(0), transform);
+
+            boost::lock_guard<boost::mutex> lock(mutexTcpOffset);
+            transformFlange2Tcp = transform;
+            tcpOffsetTime = transform.stamp_;
+            isTcpOffsetValid = true;
+        }
+        catch (tf::TransformException& e)
+        {
+            ROS_ERROR_THROTTLE_NAMED(5.0, "driver", "TCP pose transformation failed: %s", e.what());
+        }
+    }
+}
 
-	if (strcmp(command.command_type.c_str(), "LIN") == 0) {
+boost::shared_ptr<tf::TransformListener> Driver::getSharedTransformListener()
+{
+    static boost::mutex mutexShared;
+    static boost::weak_ptr<tf::TransformListener> shared;
 
-		if (strcmp(command.pose_type.c_str(), "JOINTS") == 0) {
+    boost::lock_guard<boost::mutex> lock(mutexShared);
 
-			JointValue position = JointValue(6);
-			for (int i=0; i<6; i++) position[i] = command.pose[i];
+    boost::shared_ptr<tf::TransformListener> tfListener = shared.lock();
+    if (!tfListener)
+    {
+        tfListener.reset(new tf::TransformListener());
+        shared = tfListener;
+    }
 
-			if (strcmp(command.velocity_type.c_str(), "M/S") != 0) return 0;
-			if (strcmp(command.acceleration_type.c_str(), "M/S^2") != 0) return 0;
-			if (strcmp(command.blending_type.c_str(), "M") != 0) return 0;
+    return tfListener;
+}
 
-			*result = CommandLinJointBlending(position, command.velocity[0], command.acceleration[0], command.blending[0]);
+void Driver::tfChangedListener()
+{
+    //called for every TF message (also for the TCP frame of the driver), only a new transform from the flange to the TCP invalidates the cache
+    std::string flangeFrameName;
+    std::string tcpFrameName;
+    ros::Time time;
+    {
+        boost::lock_guard<boost::mutex> lock(mutexTcpOffset);
+        if (isTfChanged || !isTcpOffsetValid)
+        {
+            return;
+        }
+        flangeFrameName = tcpOffsetFlangeFrameName;
+        tcpFrameName = tcpOffsetTcpFrameName;
+        time = tcpOffsetTime;
+    }
 
-		} else if (strcmp(command.pose_type.c_str(), "EULER_INTRINSIC_ZYX") == 0) {
+    ros::Time latestTime;
+    if (tfListener->getLatestCommonTime(flangeFrameName, tcpFrameName, latestTime, NULL) != tf::NO_ERROR || latestTime == time)
+    {
+        return;
+    }
 
-			if (strcmp(command.velocity_type.c_str(), "M/S") != 0) return 0;
-			if (strcmp(command.acceleration_type.c_str(), "M/S^2") != 0) return 0;
-			if (strcmp(command.blending_type.c_str(), "M") != 0) return 0;
+    boost::lock_guard<boost::mutex> lock(mutexTcpOffset);
+    isTfChanged = true;
+}
 
-			// Euler intrinsic ZYX -> RPY extrinsic XYZ needs only to change order
-			CartesianPosition cartesianPosition;
-		    cartesianPosition.x() = command.pose[0];
-		    cartesianPosition.y() = command.pose[1];
-		    cartesianPosition.z() = command.pose[2];
-			tf::Vector3 quaternion = rpyToQuaternion(command.pose[5], command.pose[4], command.pose[3]);
-		    tf::Vector3 axis = quaternionToAxis(quaternion.x(), quaternion.y(), quaternion.z(), quaternion.w());
-		    cartesianPosition.rx() = axis.x();
-		    cartesianPosition.ry() = axis.y();
-		    cartesianPosition.rz() = axis.z();
+void Driver::robotStateListener(const RobotState& robotState)
+{
+    //hand the robot state over to the publisher thread
+    unsigned long sequence;
+    {
+        boost::lock_guard<boost::mutex> lock(mutexRobotState);
+        lastRobotState = robotState;
+        robotStateSequence++;
+
+        //the cartesian position of the controller is the TCP pose, keep the flange pose separately for other TCP offsets
+        tf::Transform tcpOffset;
+        bool hasTcpOffset = lastRobotState.hasTcpOffset();
+        if (hasTcpOffset)
+        {
+            tcpOffset = poseToTransform(&lastRobotState.getTcpOffset().getValues()[0]);
+        }
 
-			*result = CommandLinCartesianBlending(cartesianPosition, command.velocity[0], command.acceleration[0], command.blending[0]);
+        //the joint positions come with every state (also at the rate of the realtime interface), the pose of the controller can lag them
+        const std::vector<double>& q = lastRobotState.getJointPosition().getValues();
+        double flange[6];
+        if (q.size() >= 6 && Kinematics::forward(kinematicsModel, &q[0], flange))
+        {
+            lastRobotState.getFlangePosition().setValues(flange[0], flange[1], flange[2], flange[3], flange[4], flange[5]);
+
+            //without the TCP offset (realtime interface) the TCP pose of the controller is kept
+            if (hasTcpOffset)
+            {
+                double tcp[6];
+                transformPose(flange, tcpOffset, tcp);
+                lastRobotState.getCartesianPosition().setValues(tcp[0], tcp[1], tcp[2], tcp[3], tcp[4], tcp[5]);
+            }
+        }
+        else if (hasTcpOffset)
+        {
+            transformPose(&lastRobotState.getCartesianPosition().getValues()[0], tcpOffset.inverse(), flange);
+            lastRobotState.getFlangePosition().setValues(flange[0], flange[1], flange[2], flange[3], flange[4], flange[5]);
+        }
+        else
+        {
+            lastRobotState.setFlangePosition(lastRobotState.getCartesianPosition());
+        }
+
+        latencyTracer.stamp(lastRobotState.getLatencyTrace(), LatencyTrace::NOTIFIED);
+
+        sequence = robotStateSequence;
+        if (executor)
+        {
+            publishedRobotState = lastRobotState;
+        }
+    }
+
+    //on the executor the read handler of the connector publishes, the reads of a connection don't overlap
+    if (executor)
+    {
+        publishRobotState(publishedRobotState, sequence);
+    }
+    else
+    {
+        robotStateCondition.notify_one();
+    }
+}
+
+Driver::SharedDiagnostics& Driver::getSharedDiagnostics()
+{
+    static SharedDiagnostics shared;
+
+    return shared;
+}
+
+void Driver::registerDiagnostics(Driver* driver, bool add)
+{
+    SharedDiagnostics& shared = getSharedDiagnostics();
+    ros::WallTimer timer;
+    {
+        boost::lock_guard<boost::mutex> lock(shared.mutex);
+
+        if (add && shared.drivers.empty())
+        {
+            ros::NodeHandle nodeHandle;
+            shared.publisher = nodeHandle.advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics", 1);
+            shared.timer = nodeHandle.createWallTimer(ros::WallDuration(1.0), &Driver::publishDiagnostics);
+        }
+
+        if (add)
+        {
+            shared.drivers.insert(driver);
+        }
+        else if (shared.drivers.erase(driver) > 0 && shared.drivers.empty())
+        {
+            shared.publisher.shutdown();
+            timer = shared.timer;
+            shared.timer = ros::WallTimer();
+        }
+    }
+
+    //stopping waits for a running callback, which needs the lock
+    timer.stop();
+}
+
+bool Driver::claimClockTopic(bool claim)
+{
+    static boost::mutex mutexClaim;
+    static bool isClaimed = false;
+
+    boost::lock_guard<boost::mutex> lock(mutexClaim);
+
+    if (claim && isClaimed)
+    {
+        return false;
+    }
+    isClaimed = claim;
+
+    return true;
+}
+
+void Driver::publishDiagnostics(const ros::WallTimerEvent& event)
+{
+    SharedDiagnostics& shared = getSharedDiagnostics();
+
+    boost::lock_guard<boost::mutex> lock(shared.mutex);
+
+    diagnostic_msgs::DiagnosticArray diagnostics;
+    diagnostics.header.stamp = ros::Time::now();
+    for (std::set<Driver*>::iterator driver = shared.drivers.begin(); driver != shared.drivers.end(); ++driver)
+    {
+        (*driver)->addDiagnostics(diagnostics);
+    }
+
+    if (!diagnostics.status.empty())
+    {
+        shared.publisher.publish(diagnostics);
+    }
+}
+
+void Driver::addDiagnostics(diagnostic_msgs::DiagnosticArray& diagnostics)
+{
+    std::vector<LatencyHistogram> histograms;
+
+    if (latencyTracer.isEnabled())
+    {
+        latencyTracer.getHistograms(histograms, true);
+
+        diagnostic_msgs::DiagnosticStatus status;
+        status.level = diagnostic_msgs::DiagnosticStatus::OK;
+        status.name = nodeHandle.getNamespace() + ": robot state latency";
+        status.hardware_id = configuration.host;
+        status.message = boost::lexical_cast<std::string>(histograms[0].getCount()) + " robot states traced in the last period";
+        for (size_t i = 0; i < histograms.size(); i++)
+        {
+            addHistogramValues(status, LatencyTracer::getHistogramName(i), histograms[i]);
+        }
+        diagnostics.status.push_back(status);
+    }
+
+    if (commandTracer.isEnabled())
+    {
+        commandTracer.getHistograms(histograms, true);
+
+        diagnostic_msgs::DiagnosticStatus status;
+        status.level = diagnostic_msgs::DiagnosticStatus::OK;
+        status.name = nodeHandle.getNamespace() + ": command latency";
+        status.hardware_id = configuration.host;
+        status.message = boost::lexical_cast<std::string>(histograms[0].getCount()) + " commands finished in the last period";
+        for (size_t i = 0; i < histograms.size(); i++)
+        {
+            addHistogramValues(status, CommandTracer::getHistogramName(i), histograms[i]);
+        }
+        diagnostics.status.push_back(status);
+    }
+
+    if (configuration.servoMode && configuration.servoBufferDepth > 0)
+    {
+        ServoStatistics servoStatistics = servoServer.getStatistics(true);
+
+        diagnostic_msgs::DiagnosticStatus status;
+        status.level = (servoStatistics.starvedCycles > 0) ? diagnostic_msgs::DiagnosticStatus::WARN : diagnostic_msgs::DiagnosticStatus::OK;
+        status.name = nodeHandle.getNamespace() + ": servo buffer";
+        status.hardware_id = configuration.host;
+        status.message = boost::lexical_cast<std::string>(servoStatistics.setpoints) + " setpoints streamed in the last period";
+
+        diagnostic_msgs::KeyValue keyValue;
+        keyValue.key = "fill";
+        keyValue.value = boost::lexical_cast<std::string>(servoStatistics.fill);
+        status.values.push_back(keyValue);
+        keyValue.key = "minimum fill";
+        keyValue.value = boost::lexical_cast<std::string>(servoStatistics.minimumFill);
+        status.values.push_back(keyValue);
+        keyValue.key = "starved cycles";
+        keyValue.value = boost::lexical_cast<std::string>(servoStatistics.starvedCycles);
+        status.values.push_back(keyValue);
+        keyValue.key = "dropped setpoints";
+        keyValue.value = boost::lexical_cast<std::string>(servoStatistics.droppedSetpoints);
+        status.values.push_back(keyValue);
+        diagnostics.status.push_back(status);
+    }
+}
+
+void Driver::addHistogramValues(diagnostic_msgs::DiagnosticStatus& status, const std::string& name, const LatencyHistogram& histogram)
+{
+    //latencies in microseconds
+    char value[32];
+
+    diagnostic_msgs::KeyValue keyValue;
+    keyValue.key = name + " count";
+    keyValue.value = boost::lexical_cast<std::string>(histogram.getCount());
+    status.values.push_back(keyValue);
+
+    snprintf(value, sizeof(value), "%.1f", histogram.getMean() * 1e-3);
+    keyValue.key = name + " mean [us]";
+    keyValue.value = value;
+    status.values.push_back(keyValue);
+
+    const double percentiles[] = {50, 90, 99};
+    for (int i = 0; i < 3; i++)
+    {
+        snprintf(value, sizeof(value), "%.1f", histogram.getPercentile(percentiles[i]) * 1e-3);
+        keyValue.key = name + " p" + boost::lexical_cast<std::string>((int)percentiles[i]) + " [us]";
+        keyValue.value = value;
+        status.values.push_back(keyValue);
+    }
+
+    snprintf(value, sizeof(value), "%.1f", histogram.getMax() * 1e-3);
+    keyValue.key = name + " max [us]";
+    keyValue.value = value;
+    status.values.push_back(keyValue);
+}
+
+void Driver::signalHandler(int signal)
+{
+    ROS_INFO_NAMED("driver", "shutdown");
+    shutdownSignal = true;
+}
+
+void Driver::clockPublishWorker()
+{
+    ClockRate rate(clock, 100);
+    rosgraph_msgs::Clock message;
+
+    while (ros::ok() && runClockPublishThread)
+    {
+        message.clock.fromSec(clock->now());
+        clockPublisher.publish(message);
+
+        rate.sleep();
+    }
+
+    clock->removeParticipant();
+}
+
+void Driver::commandThreadWorker()
+{
+    ClockRate rate(clock, configuration.robotReadFrequency);
+
+    while (ros::ok() && runCommandThread)
+    {
+        commandStep();
+
+        rate.sleep();
+    }
+
+    clock->removeParticipant();
+}
+
+void Driver::commandStep()
+{
+    int result;
+
+    RobotState robotState;
+    {
+        boost::lock_guard<boost::mutex> lock(mutexRobotState);
+        robotState = lastRobotState;
+    }
+
+    commandMutex.lock();
+
+    //retimed and streamed lists pass blended targets fast and the states only sample the motion: a target can also be
+    //passed between the state of the last step and this one, several targets within one step
+    bool isSampled = isCommandListRetimed || isCommandListStreamed;
+	while (commandList.size() > 0 && (isCommandFinished(commandList[0], robotState, &result)
+	    || (isSampled && isCommandPassed(commandList[0], commandRobotState, robotState, &result)))){
+
+		isLastCommand = true;
+		lastCommand = commandList[0];
+
+		if (commandList[0].command_id >= 0){
+
+			robot_movement_interface::Result result_msg;
+            result_msg.command_id = commandList[0].command_id;
+            result_msg.result_code = result;
+            commandResultPublisher.publish(result_msg); 
+
+            if (commandTracer.isEnabled())
+            {
+                publishCommandTrace(commandList[0].command_id);
+            }
 
 		}
 
-	} else if (strcmp(command.command_type.c_str(), "LIN_TIMED") == 0){
+		commandList.erase(commandList.begin());
 
-		if (strcmp(command.pose_type.c_str(), "JOINTS") != 0) return 0;
-	
-        JointPosition jointPosition(6);
-		for (int i = 0; i < 6; i++) jointPosition[i] = command.pose[i];
+		//a program finishes one command per step
+		if (!isSampled) break;
+	}
+    commandRobotState = robotState;
 
-		double velocity = configuration.velocity; // No matters, time has priority
-        double acceleration = configuration.acceleration; // No matters, time has priority
+    commandMutex.unlock();
+}
 
-		if (strcmp(command.blending_type.c_str(), "M") != 0) return 0;
-		double blending = command.blending[0];
+void Driver::publishCommandTrace(int commandId)
+{
+    CommandTrace trace;
+    if (!commandTracer.finish(commandId, trace))
+    {
+        return;
+    }
 
-		if (command.additional_values.size() < 1) return 0;
-		double time = command.additional_values[0];
+    ur_driver::CommandLatencyPtr message(new ur_driver::CommandLatency());
+    message->header.stamp = ros::Time::now();
+    getCommandLatency(trace, *message);
 
-        *result = CommandLinJointTimed(jointPosition, velocity, acceleration, blending, time);
+    commandTracePublisher.publish(message);
+}
 
-	} else if (strcmp(command.command_type.c_str(), "PTP") == 0) {
+bool Driver::getCommandTraceCallback(ur_driver::GetCommandTrace::Request &req, ur_driver::GetCommandTrace::Response &res)
+{
+    CommandTrace trace;
+    res.found = commandTracer.getTrace(req.command_id, trace);
+    res.finished = res.found && trace.timestamps[CommandTrace::FINISHED] != 0;
+    res.latency.header.stamp = ros::Time::now();
+    res.latency.command_id = req.command_id;
+    if (res.found)
+    {
+        getCommandLatency(trace, res.latency);
+    }
 
-		if (strcmp(command.pose_type.c_str(), "JOINTS") == 0) {
+    return true;
+}
 
-			JointValue position = JointValue(6);
-			for (int i=0; i<6; i++) position[i] = command.pose[i];
+void Driver::getCommandLatency(const CommandTrace& trace, ur_driver::CommandLatency& latency)
+{
+    //durations of the stages, a stage which was not passed is reported as 0
+    latency.command_id = trace.commandId;
 
-			if (strcmp(command.velocity_type.c_str(), "RAD/S") != 0) return 0;
-			if (strcmp(command.acceleration_type.c_str(), "RAD/S^2") != 0) return 0;
-			if (strcmp(command.blending_type.c_str(), "M") != 0) return 0;
+    double* durations[CommandTrace::STAGE_COUNT] = {&latency.total, &latency.processing, &latency.queue, &latency.write, &latency.robot};
+    for (int i = 0; i < CommandTrace::STAGE_COUNT; i++)
+    {
+        int from = (i == 0) ? CommandTrace::RECEIVED : i - 1;
+        int to = (i == 0) ? CommandTrace::FINISHED : i;
+        bool isValid = trace.timestamps[from] != 0 && trace.timestamps[to] >= trace.timestamps[from];
+        *durations[i] = isValid ? (trace.timestamps[to] - trace.timestamps[from]) * 1e-9 : 0.0;
+    }
+}
+
+bool Driver::isCommandFinished(const robot_movement_interface::Command& command, RobotState& robotState, int *result){
+    
+    *result = 0;
+
+    if (strcmp(command.pose_type.c_str(), "EULER_INTRINSIC_ZYX") == 0){
+
+        // delta is the launch distance previous to blending, if not given then it should be low value but not 0 (over robot resolution)
+        double dx = fabs(robotState.getCartesianPosition().x() - command.pose[0]);
+        double dy = fabs(robotState.getCartesianPosition().y() - command.pose[1]);
+        double dz = fabs(robotState.getCartesianPosition().z() - command.pose[2]);
+
+		float blending = 0.0;	// m
+		float delta = 0.001;	// m
+
+		if (command.blending.size() > 0) blending = command.blending[0];
+		if (command.blending.size() > 1) delta = command.blending[1];
+
+        return (dx * dx + dy * dy + dz * dz) <= (blending + delta) * (blending + delta);
+
+    } else if (strcmp(command.pose_type.c_str(), "JOINTS") == 0){
+
+		double sum = 0;
+		double delta = 0.01; // 0.01 rad to consider a position correct
+
+		if (command.blending.size() > 1) delta = command.blending[1];
+
+		JointPosition& pos = robotState.getJointPosition();	
+		for (int i = 0; i < 6; i++) sum += fabs(command.pose[i] - pos[i]) * fabs(command.pose[i] - pos[i]);
+		return sum <= (delta) * (delta); 
+	}
+
+    return false;
+
+}
+
+bool Driver::isCommandPassed(const robot_movement_interface::Command& command, RobotState& previousState, RobotState& robotState, int *result)
+{
+    *result = 0;
+
+    //no previous state (first step)
+    const std::vector<double>& previous = previousState.getJointPosition().getValues();
+    const std::vector<double>& current = robotState.getJointPosition().getValues();
+    if (previous.size() < 6 || current.size() < 6)
+    {
+        return false;
+    }
+
+    //closest point of the straight line between both states to the target, within the distance of isCommandFinished
+    double from[6];
+    double to[6];
+    double target[6];
+    int dimension = 0;
+    double distance = 0;
+    if (command.pose_type == "EULER_INTRINSIC_ZYX" && command.pose.size() >= 3)
+    {
+        dimension = 3;
+        for (int i = 0; i < 3; i++)
+        {
+            from[i] = previousState.getCartesianPosition().getValues()[i];
+            to[i] = robotState.getCartesianPosition().getValues()[i];
+            target[i] = command.pose[i];
+        }
+        distance = ((command.blending.size() > 0) ? command.blending[0] : 0.0) + ((command.blending.size() > 1) ? command.blending[1] : 0.001);
+    }
+    else if (command.pose_type == "JOINTS" && command.pose.size() >= 6)
+    {
+        dimension = 6;
+        std::copy(previous.begin(), previous.begin() + 6, from);
+        std::copy(current.begin(), current.begin() + 6, to);
+        std::copy(command.pose.begin(), command.pose.begin() + 6, target);
+        distance = (command.blending.size() > 1) ? command.blending[1] : 0.01;
+    }
+    else
+    {
+        return false;
+    }
+
+    double length = 0;
+    double projection = 0;
+    for (int i = 0; i < dimension; i++)
+    {
+        length += (to[i] - from[i]) * (to[i] - from[i]);
+        projection += (target[i] - from[i]) * (to[i] - from[i]);
+    }
+    double t = (length > 0) ? std::max(0.0, std::min(projection / length, 1.0)) : 0.0;
+
+    double sum = 0;
+    for (int i = 0; i < dimension; i++)
+    {
+        double difference = from[i] + t * (to[i] - from[i]) - target[i];
+        sum += difference * difference;
+    }
+
+    return sum <= distance * distance;
+}
+
+int Driver::processCommand(robot_movement_interface::Command command, ur_driver::Command * result){
+
+	// ------------------------------------------------------------------------
+	// Format validation
+	// ------------------------------------------------------------------------
+
+	if (strcmp(command.pose_type.c_str(), "JOINTS") == 0){
+		if (command.pose.size() < 6) return 0;
+	}
+
+	if (strcmp(command.pose_type.c_str(), "EULER_INTRINSIC_ZYX") == 0){
+		if (command.pose.size() < 6) return 0;
+	}
+
+	if (strcmp(command.velocity_type.c_str(), "M/S") == 0){
+		if (command.velocity.size() < 1) return 0;
+	}
+
+	if (strcmp(command.acceleration_type.c_str(), "M/S^2") == 0){
+		if (command.acceleration.size() < 1) return 0;
+	}
+
+	if (strcmp(command.velocity_type.c_str(), "RAD/S") == 0){
+		if (command.velocity.size() < 1) return 0;
+	}
+
+	if (strcmp(command.acceleration_type.c_str(), "RAD/S^2") == 0){
+		if (command.acceleration.size() < 1) return 0;
+	}
+
+	if (strcmp(command.blending_type.c_str(), "M") == 0){
+		if (command.blending.size() < 1) return 0;
+	}
+	// ------------------------------------------------------------------------
+
+
+	if (strcmp(command.command_type.c_str(), "LIN") == 0) {
+
+		if (strcmp(command.pose_type.c_str(), "JOINTS") == 0) {
+
+			JointValue position = JointValue(6);
+			for (int i=0; i<6; i++) position[i] = command.pose[i];
+
+			if (strcmp(command.velocity_type.c_str(), "M/S") != 0) return 0;
+			if (strcmp(command.acceleration_type.c_str(), "M/S^2") != 0) return 0;
+			if (strcmp(command.blending_type.c_str(), "M") != 0) return 0;
+
+			*result = CommandLinJointBlending(position, command.velocity[0], command.acceleration[0], command.blending[0]);
+
+		} else if (strcmp(command.pose_type.c_str(), "EULER_INTRINSIC_ZYX") == 0) {
+
+			if (strcmp(command.velocity_type.c_str(), "M/S") != 0) return 0;
+			if (strcmp(command.acceleration_type.c_str(), "M/S^2") != 0) return 0;
+			if (strcmp(command.blending_type.c_str(), "M") != 0) return 0;
+
+			// Euler intrinsic ZYX -> RPY extrinsic XYZ needs only to change order
+			CartesianPosition cartesianPosition;
+		    cartesianPosition.x() = command.pose[0];
+		    cartesianPosition.y() = command.pose[1];
+		    cartesianPosition.z() = command.pose[2];
+			tf::Vector3 quaternion = rpyToQuaternion(command.pose[5], command.pose[4], command.pose[3]);
+		    tf::Vector3 axis = quaternionToAxis(quaternion.x(), quaternion.y(), quaternion.z(), quaternion.w());
+		    cartesianPosition.rx() = axis.x();
+		    cartesianPosition.ry() = axis.y();
+		    cartesianPosition.rz() = axis.z();
+
+			*result = CommandLinCartesianBlending(cartesianPosition, command.velocity[0], command.acceleration[0], command.blending[0]);
+
+		}
+
+	} else if (strcmp(command.command_type.c_str(), "LIN_TIMED") == 0){
+
+		if (strcmp(command.pose_type.c_str(), "JOINTS") != 0) return 0;
+	
+        JointPosition jointPosition(6);
+		for (int i = 0; i < 6; i++) jointPosition[i] = command.pose[i];
+
+		double velocity = configuration.velocity; // No matters, time has priority
+        double acceleration = configuration.acceleration; // No matters, time has priority
+
+		if (strcmp(command.blending_type.c_str(), "M") != 0) return 0;
+		double blending = command.blending[0];
+
+		if (command.additional_values.size() < 1) return 0;
+		double time = command.additional_values[0];
+
+        *result = CommandLinJointTimed(jointPosition, velocity, acceleration, blending, time);
+
+	} else if (strcmp(command.command_type.c_str(), "PTP") == 0) {
+
+		if (strcmp(command.pose_type.c_str(), "JOINTS") == 0) {
+
+			JointValue position = JointValue(6);
+			for (int i=0; i<6; i++) position[i] = command.pose[i];
+
+			if (strcmp(command.velocity_type.c_str(), "RAD/S") != 0) return 0;
+			if (strcmp(command.acceleration_type.c_str(), "RAD/S^2") != 0) return 0;
+			if (strcmp(command.blending_type.c_str(), "M") != 0) return 0;
+
+			*result = CommandPtpJointBlending(position, command.velocity[0], command.acceleration[0], command.blending[0]);
+
+		} else if (strcmp(command.pose_type.c_str(), "EULER_INTRINSIC_ZYX") == 0) {
+
+			if (strcmp(command.velocity_type.c_str(), "RAD/S") != 0) return 0;
+			if (strcmp(command.acceleration_type.c_str(), "RAD/S^2") != 0) return 0;
+			if (strcmp(command.blending_type.c_str(), "M") != 0) return 0;
+
+			// Euler intrinsic ZYX -> RPY extrinsic XYZ needs only to change order
+			CartesianPosition cartesianPosition;
+		    cartesianPosition.x() = command.pose[0];
+		    cartesianPosition.y() = command.pose[1];
+		    cartesianPosition.z() = command.pose[2];
+			tf::Vector3 quaternion = rpyToQuaternion(command.pose[5], command.pose[4], command.pose[3]);
+		    tf::Vector3 axis = quaternionToAxis(quaternion.x(), quaternion.y(), quaternion.z(), quaternion.w());
+		    cartesianPosition.rx() = axis.x();
+		    cartesianPosition.ry() = axis.y();
+		    cartesianPosition.rz() = axis.z();
+
+			*result = CommandPtpCartesianBlending(cartesianPosition, command.velocity[0], command.acceleration[0], command.blending[0]);
+
+		}
+
+	} else if (strcmp(command.command_type.c_str(), "JOINT_SPEED") == 0){
+
+
+		if (command.velocity.size() < 6) return 0;
+
+        JointVelocity jointVelocity(6);
+        for (int i=0; i<6; i++) jointVelocity[i] = command.velocity[i];
+
+		if (strcmp(command.acceleration_type.c_str(), "RAD/S^2") != 0) return 0;
+
+		double acceleration = command.acceleration[0];
+
+		if (command.additional_values.size() == 0){ 
+			*result = CommandJointVelocity(jointVelocity, acceleration, 1.0);
+		} else {
+			*result = CommandJointVelocity(jointVelocity, acceleration, command.additional_values[0]);
+		}
+
+	} else if (strcmp(command.command_type.c_str(), "CARTESIAN_SPEED") == 0){
+
+		if (command.velocity.size() < 6) return 0;
+        
+        CartesianVelocity cartesianVelocity;
+        cartesianVelocity.x() = command.velocity[0];
+        cartesianVelocity.y() = command.velocity[1];
+        cartesianVelocity.z() = command.velocity[2];
+        // Euler intrinsic ZYX -> RPY extrinsic XYZ needs only to change order
+        tf::Vector3 quaternion = rpyToQuaternion(command.velocity[5], command.velocity[4], command.velocity[3]);
+        tf::Vector3 axis = quaternionToAxis(quaternion.x(), quaternion.y(), quaternion.z(), quaternion.w());
+        cartesianVelocity.rx() = axis.x();
+        cartesianVelocity.ry() = axis.y();
+        cartesianVelocity.rz() = axis.z();
+
+		double acceleration = configuration.acceleration;
+		if (strcmp(command.acceleration_type.c_str(), "M/S^2") == 0) acceleration = command.acceleration[0];
+
+		if (command.additional_values.size() == 0){ 
+			*result = CommandCartesianVelocity(cartesianVelocity, acceleration, 1.0);
+		} else {
+			*result = CommandCartesianVelocity(cartesianVelocity, acceleration, command.additional_values[0]);
+		}
+
+	} else {
+		return 0;
+	}
+
+	return 1;
+
+}
+
+void Driver::jointServoCallback(const trajectory_msgs::JointTrajectory::ConstPtr &msg)
+{
+    //get indices of the joint names
+    std::vector<int> jointIndex(msg->joint_names.size(), -1);
+    int count = 0;
+    for (size_t i = 0; i < msg->joint_names.size(); i++)
+    {
+        for (size_t j = 0; j < configuration.jointNames.size() && j < 6; j++)
+        {
+            if (msg->joint_names[i] == configuration.jointNames[j])
+            {
+                jointIndex[i] = j;
+                count++;
+                break;
+            }
+        }
+    }
+
+    if (count != 6)
+    {
+        ROS_WARN_NAMED("driver", "missing joint name of at least one joint. The servo setpoints will be ignored");
+
+        return;
+    }
+
+    //time stamped points are interpolated at the servo rate
+    bool isTrajectory = msg->points.size() > 0 && msg->points.back().time_from_start.toSec() > 0;
+    if (isTrajectory)
+    {
+        setServoTrajectory(msg->points, jointIndex);
+    }
+    else
+    {
+        boost::lock_guard<boost::mutex> lock(mutexServoTrajectory);
+        servoTrajectoryTime = -1;
+    }
+
+    //with a buffer all points are played one per cycle, otherwise the first point is the latest setpoint
+    size_t pointCount = isTrajectory ? 0 : (configuration.servoBufferDepth > 0) ? msg->points.size() : std::min(msg->points.size(), (size_t)1);
+    std::vector<double> jointPosition(6, 0.0);
+    for (size_t i = 0; i < pointCount; i++)
+    {
+        if (msg->points[i].positions.size() != msg->joint_names.size())
+        {
+            ROS_WARN_NAMED("driver", "positions count doesn't match joint names count. This servo setpoint will be ignored");
+
+            continue;
+        }
+
+        for (size_t j = 0; j < jointIndex.size(); j++)
+        {
+            if (jointIndex[j] >= 0)
+            {
+                jointPosition[jointIndex[j]] = msg->points[i].positions[j];
+            }
+        }
+
+        servoServer.setSetpoint(jointPosition);
+    }
+
+    //the program ended (timeout, stop, other program), restart it at most once per second
+    if (!servoServer.isConnected() && clock->now() - lastServoUpload > 1.0)
+    {
+        uploadServoProgram();
+    }
+}
+
+void Driver::setServoTrajectory(const std::vector<trajectory_msgs::JointTrajectoryPoint>& points, const std::vector<int>& jointIndex)
+{
+    std::vector<double> times;
+    std::vector<double> positions;
+    std::vector<double> velocities;
+    std::vector<double> accelerations;
+    bool hasVelocities = true;
+    bool hasAccelerations = true;
+
+    //a trajectory which doesn't start at 0 starts at the current joint positions
+    if (points[0].time_from_start.toSec() > 0)
+    {
+        boost::lock_guard<boost::mutex> lock(mutexRobotState);
+        const std::vector<double>& q = lastRobotState.getJointPosition().getValues();
+        if (q.size() < 6)
+        {
+            ROS_WARN_NAMED("driver", "no robot state received. The servo trajectory will be ignored");
+
+            return;
+        }
+
+        times.push_back(0);
+        positions.insert(positions.end(), q.begin(), q.begin() + 6);
+        velocities.resize(6, 0.0);
+        accelerations.resize(6, 0.0);
+    }
+
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        if (points[i].positions.size() != jointIndex.size())
+        {
+            ROS_WARN_NAMED("driver", "positions count doesn't match joint names count. The servo trajectory will be ignored");
+
+            return;
+        }
+
+        hasVelocities = hasVelocities && points[i].velocities.size() == jointIndex.size();
+        hasAccelerations = hasAccelerations && points[i].accelerations.size() == jointIndex.size();
+
+        times.push_back(points[i].time_from_start.toSec());
+        positions.resize(positions.size() + 6);
+        velocities.resize(velocities.size() + 6);
+        accelerations.resize(accelerations.size() + 6);
+        for (size_t j = 0; j < jointIndex.size(); j++)
+        {
+            if (jointIndex[j] >= 0)
+            {
+                positions[positions.size() - 6 + jointIndex[j]] = points[i].positions[j];
+                velocities[velocities.size() - 6 + jointIndex[j]] = hasVelocities ? points[i].velocities[j] : 0.0;
+                accelerations[accelerations.size() - 6 + jointIndex[j]] = hasAccelerations ? points[i].accelerations[j] : 0.0;
+            }
+        }
+    }
+
+    if (!hasVelocities)
+    {
+        velocities.clear();
+    }
+    if (!hasAccelerations)
+    {
+        accelerations.clear();
+    }
+
+    //the spline is fitted outside of the lock, the stream only waits for the copy
+    SplineTrajectory trajectory;
+    if (!trajectory.fit(times, positions, velocities, accelerations))
+    {
+        ROS_WARN_NAMED("driver", "the times of the servo trajectory don't increase. It will be ignored");
+
+        return;
+    }
+
+    double scale = trajectory.limit(configuration.maxAngularVelocity, configuration.servoAcceleration);
+    if (scale > 1.0)
+    {
+        ROS_WARN_NAMED("driver", "the servo trajectory exceeds the joint limits. It is slowed down by the factor %f", scale);
+    }
+
+    startServoTrajectory(trajectory);
+}
+
+void Driver::startServoTrajectory(const SplineTrajectory& trajectory)
+{
+    boost::lock_guard<boost::mutex> lock(mutexServoTrajectory);
+    servoTrajectory = trajectory;
+    servoTrajectoryTime = 0;
+}
+
+bool Driver::streamCommandList(const std::vector<robot_movement_interface::Command>& commands)
+{
+    for (size_t i = 0; i < commands.size(); i++)
+    {
+        if (commands[i].command_type != "PTP" || commands[i].pose_type != "JOINTS")
+        {
+            return false;
+        }
+    }
+
+    std::vector<double> start;
+    {
+        boost::lock_guard<boost::mutex> lock(mutexRobotState);
+        const std::vector<double>& q = lastRobotState.getJointPosition().getValues();
+        if (q.size() < 6)
+        {
+            ROS_WARN_NAMED("driver", "no robot state received. The command list is not retimed");
+
+            return false;
+        }
+        start.assign(q.begin(), q.begin() + 6);
+    }
+
+    SplineTrajectory trajectory;
+    if (!retimeCommandList(commands, start, configuration.jointMaxVelocity, configuration.jointMaxAcceleration, configuration.servoFrequency,
+        kinematicsModel, trajectory))
+    {
+        return false;
+    }
+
+    ROS_INFO_NAMED("driver", "retimed command list of %i commands: %f s", (int)commands.size(), trajectory.getDuration());
+
+    startServoTrajectory(trajectory);
+
+    if (!servoServer.isConnected() && clock->now() - lastServoUpload > 1.0)
+    {
+        uploadServoProgram();
+    }
+
+    return true;
+}
+
+bool Driver::retimeCommandList(const std::vector<robot_movement_interface::Command>& commands, const std::vector<double>& start,
+    const std::vector<double>& maxVelocity, const std::vector<double>& maxAcceleration, double frequency, Kinematics::Model model,
+    SplineTrajectory& trajectory)
+{
+    std::vector<double> waypoints(start.begin(), start.begin() + 6);
+    for (size_t i = 0; i < commands.size(); i++)
+    {
+        waypoints.insert(waypoints.end(), commands[i].pose.begin(), commands[i].pose.begin() + 6);
+    }
+
+    //joint distance per TCP distance of each move (like CycleTimeEstimator), 0 without TCP distance
+    size_t count = commands.size() + 1;
+    std::vector<double> scales(count, 0.0);
+    double previousPose[6];
+    double pose[6];
+    if (Kinematics::forward(model, &waypoints[0], previousPose))
+    {
+        for (size_t i = 0; i + 1 < count; i++)
+        {
+            Kinematics::forward(model, &waypoints[(i + 1) * 6], pose);
+
+            double jointDistance = 0;
+            double tcpDistance = 0;
+            for (int j = 0; j < 6; j++)
+            {
+                jointDistance += pow(waypoints[(i + 1) * 6 + j] - waypoints[i * 6 + j], 2);
+            }
+            for (int j = 0; j < 3; j++)
+            {
+                tcpDistance += pow(pose[j] - previousPose[j], 2);
+            }
+            tcpDistance = sqrt(tcpDistance);
+            scales[i] = (tcpDistance > 1e-9) ? sqrt(jointDistance) / tcpDistance : 0.0;
+
+            std::copy(pose, pose + 6, previousPose);
+        }
+    }
+
+    //the blend radius is a TCP distance, in joint space it is scaled with the smaller ratio of both moves (a waypoint
+    //without TCP distance stops). The arc stays well within the distance at which the command counts as finished, the
+    //states of the robot only sample the path. Without kinematics the radius only enables blending.
+    std::vector<double> deviations(1, 0.0);
+    for (size_t i = 0; i < commands.size(); i++)
+    {
+        double radius = commands[i].blending.empty() ? 0.0 : commands[i].blending[0];
+        double delta = (commands[i].blending.size() > 1) ? commands[i].blending[1] : 0.01;
+        double deviation = (radius > 0) ? 0.5 * delta : 0.0;
+        if (model != Kinematics::NONE)
+        {
+            deviation = std::min(deviation, radius * std::min(scales[i], scales[i + 1]));
+        }
+        deviations.push_back(deviation);
+    }
+
+    PathParameterization parameterization;
+    parameterization.setLimits(maxVelocity, maxAcceleration);
+    if (!parameterization.compute(waypoints, deviations))
+    {
+        return false;
+    }
+
+    //the servo samples the motion at its rate, so the spline meets the points exactly
+    std::vector<double> times;
+    std::vector<double> positions;
+    std::vector<double> velocities;
+    std::vector<double> accelerations;
+    parameterization.getPoints(1.0 / frequency, times, positions, velocities, accelerations);
+
+    return trajectory.fit(times, positions, velocities, accelerations);
+}
+
+bool Driver::servoStep(bool isFirst, std::vector<double>& jointPosition)
+{
+    boost::lock_guard<boost::mutex> lock(mutexServoTrajectory);
+
+    //a new program starts at rest, a trajectory which was interrupted is not continued
+    if ((isFirst && servoTrajectoryTime > 0) || servoTrajectoryTime < 0)
+    {
+        servoTrajectoryTime = -1;
+
+        return false;
+    }
+
+    //the last sample holds the end of the trajectory, afterwards the setpoints of the topic are streamed again
+    servoTrajectory.sample(servoTrajectoryTime, &jointPosition[0], NULL, NULL);
+    if (servoTrajectoryTime >= servoTrajectory.getDuration())
+    {
+        servoTrajectoryTime = -1;
+    }
+    else
+    {
+        servoTrajectoryTime += 1.0 / configuration.servoFrequency;
+    }
+
+    return true;
+}
+
+void Driver::uploadServoProgram()
+{
+    ROS_INFO_NAMED("driver", "upload servo program (%s:%i)", configuration.servoHost.c_str(), configuration.servoPort);
+
+    lastServoUpload = clock->now();
+    connector.addCommand(new CommandServoProgram(configuration.servoHost, configuration.servoPort, 1.0 / configuration.servoFrequency,
+        configuration.servoLookahead, configuration.servoGain, configuration.servoTimeout, configuration.servoBufferDepth));
+}
+
+void Driver::jointTeleopCallback(const trajectory_msgs::JointTrajectory::ConstPtr &msg)
+{
+    if (msg->points.empty() || msg->points[0].velocities.size() != msg->joint_names.size())
+    {
+        ROS_WARN_NAMED("driver", "teleoperation without joint velocities. It will be ignored");
+
+        return;
+    }
+
+    //sort the joint velocities by the joint names of the configuration
+    std::vector<double> jointVelocity(6, 0.0);
+    int count = 0;
+    for (size_t i = 0; i < msg->joint_names.size(); i++)
+    {
+        for (size_t j = 0; j < configuration.jointNames.size() && j < 6; j++)
+        {
+            if (msg->joint_names[i] == configuration.jointNames[j])
+            {
+                jointVelocity[j] = msg->points[0].velocities[i];
+                count++;
+                break;
+            }
+        }
+    }
+
+    if (count != 6)
+    {
+        ROS_WARN_NAMED("driver", "missing joint name of at least one joint. The teleoperation velocity will be ignored");
+
+        return;
+    }
+
+    teleop.setTarget(jointVelocity);
+
+    //the program ended (timeout, stop, other program), restart it at most once per second
+    if (!teleopServer.isConnected() && clock->now() - lastTeleopUpload > 1.0)
+    {
+        uploadTeleopProgram();
+    }
+}
+
+bool Driver::teleopStep(bool isFirst, std::vector<double>& velocity)
+{
+    //a new program starts at rest
+    if (isFirst)
+    {
+        teleop.reset();
+    }
+
+    return teleop.step(1.0 / configuration.teleopFrequency, velocity);
+}
+
+void Driver::uploadTeleopProgram()
+{
+    ROS_INFO_NAMED("driver", "upload speed program (%s:%i)", configuration.servoHost.c_str(), configuration.teleopPort);
+
+    //the acceleration of speedj must not slow down the ramp of the watchdog
+    double acceleration = std::max(configuration.teleopAcceleration, configuration.maxAngularVelocity * configuration.teleopFrequency / std::max(configuration.teleopStopCycles, 1));
+
+    lastTeleopUpload = clock->now();
+    connector.addCommand(new CommandSpeedProgram(configuration.servoHost, configuration.teleopPort, 1.0 / configuration.teleopFrequency,
+        acceleration, configuration.servoTimeout));
+}
+
+bool Driver::getStreamedMoves(const std::vector<robot_movement_interface::Command>& commands, size_t start, std::vector<StreamedMove>& moves)
+{
+    moves.assign(commands.size() - start, StreamedMove());
+    for (size_t i = 0; i < moves.size(); i++)
+    {
+        const robot_movement_interface::Command& command = commands[start + i];
+        bool isJoints = command.pose_type == "JOINTS";
+
+        //processCommand ignores other pose types and units, these are not streamed either
+        if ((!isJoints && command.pose_type != "EULER_INTRINSIC_ZYX") || command.pose.size() < 6
+            || command.velocity.empty() || command.acceleration.empty() || command.blending.empty())
+        {
+            return false;
+        }
+
+        if (command.command_type == "PTP")
+        {
+            moves[i].type = isJoints ? MOVE_JOINT : MOVE_JOINT_POSE;
+        }
+        else if (command.command_type == "LIN")
+        {
+            moves[i].type = isJoints ? MOVE_PROCESS : MOVE_PROCESS_POSE;
+        }
+        else
+        {
+            return false;
+        }
+
+        std::copy(command.pose.begin(), command.pose.begin() + 6, moves[i].target);
+        if (!isJoints)
+        {
+            // Euler intrinsic ZYX -> RPY extrinsic XYZ needs only to change order
+            double x, y, z, w;
+            Rotation::rpyToQuaternion(command.pose[5], command.pose[4], command.pose[3], x, y, z, w);
+            Rotation::quaternionToAxis(x, y, z, w, moves[i].target[3], moves[i].target[4], moves[i].target[5]);
+        }
+        moves[i].acceleration = command.acceleration[0];
+        moves[i].velocity = command.velocity[0];
+        moves[i].radius = command.blending[0];
+        moves[i].commandId = command.command_id;
+    }
+
+    return true;
+}
+
+Driver::StreamResult Driver::streamCommandMoves(const std::vector<robot_movement_interface::Command>& previousCommands, uint64_t receivedTimestamp)
+{
+    std::vector<StreamedMove> moves;
+    if (!getStreamedMoves(commandList, 0, moves))
+    {
+        return NOT_STREAMED;
+    }
+
+    //the new commands are checked behind the committed ones until the program took no move during the checks
+    std::vector<robot_movement_interface::Command> commands;
+    commands.swap(commandList);
+    bool isConnected = moveStream.isConnected();
+    bool isSpliced = isConnected && isCommandListStreamed;
+    size_t queued = isSpliced ? moveStream.getQueuedCount() : 0;
+    size_t committed = 0;
+    while (true)
+    {
+        committed = isSpliced ? previousCommands.size() - std::min(queued, previousCommands.size()) : 0;
+        commandList.assign(previousCommands.begin(), previousCommands.begin() + committed);
+        commandList.insert(commandList.end(), commands.begin(), commands.end());
+
+        double spliceBlendLimit = std::numeric_limits<double>::max();
+        if (committed > 0 && !getSpliceBlendLimit(commandList, committed, spliceBlendLimit))
+        {
+            commandList.swap(commands);
+
+            return NOT_STREAMED;
+        }
+
+        if (configuration.blendTolerance > 0)
+        {
+            optimizeBlending(commandList, committed);
+        }
+        if (commandList[committed].blending[0] > spliceBlendLimit)
+        {
+            commandList[committed].blending[0] = spliceBlendLimit;
+        }
+
+        for (size_t i = committed; i < commandList.size(); i++)
+        {
+            Command command;
+            if (processCommand(commandList[i], &command) == 0)
+            {
+                ROS_ERROR_NAMED("driver", "error in command list (command id %i), aborting", commandList[i].command_id);
+                rejectStreamedCommands(previousCommands, isSpliced);
+
+                return REJECTED;
+            }
+        }
+
+        //the waypoints are solved from the robot through the committed moves
+        if (waypointSolver && !isCommandListReachable(commandList))
+        {
+            rejectStreamedCommands(previousCommands, isSpliced);
 
-			*result = CommandPtpJointBlending(position, command.velocity[0], command.acceleration[0], command.blending[0]);
+            return REJECTED;
+        }
 
-		} else if (strcmp(command.pose_type.c_str(), "EULER_INTRINSIC_ZYX") == 0) {
+        getStreamedMoves(commandList, committed, moves);
 
-			if (strcmp(command.velocity_type.c_str(), "RAD/S") != 0) return 0;
-			if (strcmp(command.acceleration_type.c_str(), "RAD/S^2") != 0) return 0;
-			if (strcmp(command.blending_type.c_str(), "M") != 0) return 0;
+        //the traces start before the program can take the first move, the previous commands keep theirs until it is
+        //known which of them are committed
+        if (commandTracer.isEnabled())
+        {
+            std::vector<int> previousCommandIds;
+            std::vector<int> commandIds;
+            getCommandIds(previousCommands, 0, previousCommandIds);
+            getCommandIds(commandList, committed, commandIds);
+            commandTracer.start(commandIds, receivedTimestamp, previousCommandIds);
+            commandTracer.stamp(commandIds, CommandTrace::QUEUED);
+        }
 
-			// Euler intrinsic ZYX -> RPY extrinsic XYZ needs only to change order
-			CartesianPosition cartesianPosition;
-		    cartesianPosition.x() = command.pose[0];
-		    cartesianPosition.y() = command.pose[1];
-		    cartesianPosition.z() = command.pose[2];
-			tf::Vector3 quaternion = rpyToQuaternion(command.pose[5], command.pose[4], command.pose[3]);
-		    tf::Vector3 axis = quaternionToAxis(quaternion.x(), quaternion.y(), quaternion.z(), quaternion.w());
-		    cartesianPosition.rx() = axis.x();
-		    cartesianPosition.ry() = axis.y();
-		    cartesianPosition.rz() = axis.z();
+        if (!isSpliced)
+        {
+            moveStream.replace(moves);
+            break;
+        }
 
-			*result = CommandPtpCartesianBlending(cartesianPosition, command.velocity[0], command.acceleration[0], command.blending[0]);
+        size_t current = moveStream.replace(moves, queued);
+        if (current == queued)
+        {
+            break;
+        }
 
-		}
+        ROS_DEBUG_NAMED("driver", "the move program took %i moves during the checks, check again", (int)queued - (int)current);
+        queued = current;
+    }
+    isCommandListStreamed = true;
 
-	} else if (strcmp(command.command_type.c_str(), "JOINT_SPEED") == 0){
+    ROS_DEBUG_NAMED("driver", "streamed %i moves after %i committed moves", (int)moves.size(), (int)committed);
 
+    if (commandTracer.isEnabled())
+    {
+        //the traces of the committed moves continue, those of the replaced moves end
+        std::vector<int> replacedCommandIds;
+        std::vector<int> commandIds;
+        getCommandIds(previousCommands, committed, replacedCommandIds);
+        getCommandIds(commandList, committed, commandIds);
+        commandTracer.discard(replacedCommandIds, commandIds);
+    }
 
-		if (command.velocity.size() < 6) return 0;
+    //the program ended (timeout, stop, other program), restart it at most once per second
+    if (!isConnected && clock->now() - lastMoveUpload > 1.0)
+    {
+        uploadMoveProgram();
+    }
 
-        JointVelocity jointVelocity(6);
-        for (int i=0; i<6; i++) jointVelocity[i] = command.velocity[i];
+    return STREAMED;
+}
 
-		if (strcmp(command.acceleration_type.c_str(), "RAD/S^2") != 0) return 0;
+void Driver::getCommandIds(const std::vector<robot_movement_interface::Command>& commands, size_t start, std::vector<int>& commandIds)
+{
+    for (size_t i = start; i < commands.size(); i++)
+    {
+        if (commands[i].command_id >= 0)
+        {
+            commandIds.push_back(commands[i].command_id);
+        }
+    }
+}
 
-		double acceleration = command.acceleration[0];
+void Driver::rejectStreamedCommands(const std::vector<robot_movement_interface::Command>& previousCommands, bool isSpliced)
+{
+    //the queued moves were not replaced, the results of the previous list are still published
+    if (isSpliced)
+    {
+        commandList = previousCommands;
+    }
+    else
+    {
+        commandList.clear();
+    }
+}
 
-		if (command.additional_values.size() == 0){ 
-			*result = CommandJointVelocity(jointVelocity, acceleration, 1.0);
-		} else {
-			*result = CommandJointVelocity(jointVelocity, acceleration, command.additional_values[0]);
-		}
+bool Driver::getSpliceBlendLimit(const std::vector<robot_movement_interface::Command>& commands, size_t committed, double& radius)
+{
+    //a committed move without blend stops at its waypoint
+    const robot_movement_interface::Command& last = commands[committed - 1];
+    double lastRadius = last.blending.empty() ? 0 : last.blending[0];
+    if (lastRadius <= 0)
+    {
+        radius = std::numeric_limits<double>::max();
 
-	} else if (strcmp(command.command_type.c_str(), "CARTESIAN_SPEED") == 0){
+        return true;
+    }
 
-		if (command.velocity.size() < 6) return 0;
-        
-        CartesianVelocity cartesianVelocity;
-        cartesianVelocity.x() = command.velocity[0];
-        cartesianVelocity.y() = command.velocity[1];
-        cartesianVelocity.z() = command.velocity[2];
-        // Euler intrinsic ZYX -> RPY extrinsic XYZ needs only to change order
-        tf::Vector3 quaternion = rpyToQuaternion(command.velocity[5], command.velocity[4], command.velocity[3]);
-        tf::Vector3 axis = quaternionToAxis(quaternion.x(), quaternion.y(), quaternion.z(), quaternion.w());
-        cartesianVelocity.rx() = axis.x();
-        cartesianVelocity.ry() = axis.y();
-        cartesianVelocity.rz() = axis.z();
+    RobotState robotState;
+    {
+        boost::lock_guard<boost::mutex> lock(mutexRobotState);
+        robotState = lastRobotState;
+    }
 
-		double acceleration = configuration.acceleration;
-		if (strcmp(command.acceleration_type.c_str(), "M/S^2") == 0) acceleration = command.acceleration[0];
+    tf::Transform tcpOffset;
+    if (!getTcpOffset(robotState, tcpOffset))
+    {
+        tcpOffset.setIdentity();
+    }
 
-		if (command.additional_values.size() == 0){ 
-			*result = CommandCartesianVelocity(cartesianVelocity, acceleration, 1.0);
-		} else {
-			*result = CommandCartesianVelocity(cartesianVelocity, acceleration, command.additional_values[0]);
-		}
+    double start[3];
+    double end[3];
+    if (!getWaypointPosition(last, tcpOffset, start) || !getWaypointPosition(commands[committed], tcpOffset, end))
+    {
+        ROS_WARN_NAMED("driver", "the blend of the last committed move (command id %i) can't be checked without the kinematics", last.command_id);
 
-	} else {
-		return 0;
-	}
+        return false;
+    }
 
-	return 1;
+    double distance = sqrt((end[0] - start[0]) * (end[0] - start[0]) + (end[1] - start[1]) * (end[1] - start[1]) + (end[2] - start[2]) * (end[2] - start[2]));
+    radius = BLEND_MARGIN * distance - lastRadius;
+    if (radius < 0)
+    {
+        ROS_WARN_NAMED("driver", "the blend radius %.3f m of the last committed move (command id %i) overlaps the first new move", lastRadius, last.command_id);
 
+        return false;
+    }
+
+    return true;
 }
 
+void Driver::uploadMoveProgram()
+{
+    ROS_INFO_NAMED("driver", "upload move program (%s:%i)", configuration.servoHost.c_str(), configuration.movePort);
+
+    lastMoveUpload = clock->now();
+    connector.addCommand(new CommandMoveProgram(configuration.servoHost, configuration.movePort, configuration.servoTimeout));
+}
 
 void Driver::commandListCallback(const robot_movement_interface::CommandListConstPtr &msg)
 {
+    uint64_t receivedTimestamp = commandTracer.isEnabled() ? LatencyTracer::now() : 0;
 
 	if (!msg->replace_previous_commands) return; // No more addition allowed, can be simulated by repeating commands in the new trajectory
     
     commandMutex.lock();
 
-	if (msg->replace_previous_commands) commandList.clear(); // Deletion in cascade should prevent from memory leaks
+	// The previous commands are kept until a streamed list has taken the committed ones
+	std::vector<robot_movement_interface::Command> previousList;
+	if (msg->replace_previous_commands) previousList.swap(commandList);
 
 	for (int i = 0; i < msg->commands.size(); i++) commandList.push_back(msg->commands[i]); // Commands are copied including copy in cascade of the vectors
 	
 	// Replace quaternions with euler coordinates
 	replaceQuaternions(commandList);
 
+	// Streamed moves are spliced into the running move program, the list is checked there
+	if (configuration.streamCommandLists && msg->commands.size() > 0 && streamCommandMoves(previousList, receivedTimestamp) != NOT_STREAMED){
+		isCommandListRetimed = false;
+		commandMutex.unlock();
+		return;
+	}
+
+	if (configuration.blendTolerance > 0) optimizeBlending(commandList);
+
 	if (msg->commands.size() > 0){
 		Command commands [commandList.size()];
 		bool differential_found = false;
@@ -1220,8 +2852,44 @@ void Driver::commandListCallback(const robot_movement_interface::CommandListCons
 			if (strcmp(commandList[i].command_type.c_str(), "CARTESIAN_SPEED") == 0) differential_found = true; // The commands include a differential command, no result will be provided
 		}
 
+		if (waypointSolver && !isCommandListReachable(commandList)){
+			commandList.clear();
+			commandMutex.unlock();
+			return;
+		}
+
+		// Any other program ends the move program
+		moveStream.replace(std::vector<StreamedMove>());
+		isCommandListStreamed = false;
+
+		// Retimed lists are streamed, there is no program
+		isCommandListRetimed = configuration.retimeCommandLists && configuration.servoMode && streamCommandList(commandList);
+		if (isCommandListRetimed){
+			if (commandTracer.isEnabled()){
+				// The trajectory is handed to the servo stream at once, there is no queue and no script
+				std::vector<int> commandIds;
+				getCommandIds(commandList, 0, commandIds);
+				commandTracer.start(commandIds, receivedTimestamp);
+				commandTracer.stamp(commandIds, CommandTrace::QUEUED);
+				commandTracer.stamp(commandIds, CommandTrace::DEQUEUED);
+				commandTracer.stamp(commandIds, CommandTrace::WRITTEN);
+			}
+			commandMutex.unlock();
+			return;
+		}
+
 		CommandMultiCommand * multi = new CommandMultiCommand(commands, commandList.size());
 
+		if (commandTracer.isEnabled()){
+			std::vector<int> commandIds;
+			for (int i = 0; i < commandList.size(); i++){
+				if (commandList[i].command_id >= 0) commandIds.push_back(commandList[i].command_id);
+			}
+			commandTracer.start(commandIds, receivedTimestamp);
+			commandTracer.stamp(commandIds, CommandTrace::QUEUED);
+			multi->setCommandIds(commandIds);
+		}
+
 		if (differential_found){
 			commandList.clear();
 			isLastCommand = false;
@@ -1231,7 +2899,12 @@ void Driver::commandListCallback(const robot_movement_interface::CommandListCons
 	} else {
 		// Send stop command if replace == true
 		if (msg->replace_previous_commands){
+			moveStream.replace(std::vector<StreamedMove>());
+			isCommandListStreamed = false;
+			isCommandListRetimed = false;
+
 			Command * stopcommand = new CommandStop(configuration.acceleration);
+			if (commandTracer.isEnabled()) commandTracer.start(std::vector<int>(), receivedTimestamp);
 			connector.addCommand(stopcommand);
 		}
 	}
@@ -1242,6 +2915,329 @@ void Driver::commandListCallback(const robot_movement_interface::CommandListCons
 
 }
 
+bool Driver::estimateCycleTimeCallback(ur_driver::EstimateCycleTime::Request &req, ur_driver::EstimateCycleTime::Response &res)
+{
+    std::vector<robot_movement_interface::Command> commands = req.command_list.commands;
+
+    //prepared like a command list
+    replaceQuaternions(commands);
+    if (configuration.blendTolerance > 0)
+    {
+        optimizeBlending(commands);
+    }
+
+    std::vector<bool> isValid(commands.size(), true);
+    Command command;
+    for (size_t i = 0; i < commands.size(); i++)
+    {
+        if (processCommand(commands[i], &command) == 0)
+        {
+            isValid[i] = false;
+            res.rejected_command_ids.push_back(commands[i].command_id);
+            res.rejections.push_back("invalid command");
+        }
+    }
+
+    RobotState robotState;
+    {
+        boost::lock_guard<boost::mutex> lock(mutexRobotState);
+        robotState = lastRobotState;
+    }
+
+    tf::Transform tcpOffset;
+    if (!getTcpOffset(robotState, tcpOffset))
+    {
+        tcpOffset.setIdentity();
+    }
+
+    //joint solutions of the poses and the waypoint check
+    const std::vector<double>& seed = robotState.getJointPosition().getValues();
+    std::vector<WaypointSolution> solutions;
+    if (kinematicsModel != Kinematics::NONE && seed.size() >= 6)
+    {
+        std::vector<Waypoint> waypoints;
+        getWaypoints(commands, tcpOffset, waypoints);
+
+        //the solver continues after the first rejected waypoint, report all of them
+        WaypointSolver solver(kinematicsModel);
+        solver.solve(waypoints, &seed[0], solutions);
+        for (size_t i = 0; i < solutions.size(); i++)
+        {
+            bool isRejected = solutions[i].status == WaypointSolution::UNREACHABLE || solutions[i].status == WaypointSolution::BRANCH_FLIP;
+            if (isRejected && isValid[i])
+            {
+                isValid[i] = false;
+                res.rejected_command_ids.push_back(commands[i].command_id);
+                res.rejections.push_back(std::string("waypoint ") + WaypointSolution::getStatusName(solutions[i].status));
+            }
+        }
+    }
+
+    CycleTimeEstimator estimator;
+    if (seed.size() >= 6)
+    {
+        //the TCP offset is applied to the flange pose (the cartesian position is already the TCP pose of the controller)
+        double tcp[3];
+        getTcpPosition(&robotState.getFlangePosition().getValues()[0], tcpOffset, tcp);
+        estimator.reset(&seed[0], tcp);
+    }
+    else
+    {
+        ROS_WARN_NAMED("driver", "no robot state received. The first move starts at its target");
+
+        estimator.reset(NULL, NULL);
+    }
+
+    for (size_t i = 0; i < commands.size(); i++)
+    {
+        const robot_movement_interface::Command& command = commands[i];
+        if (!isValid[i])
+        {
+            estimator.addTimed(NULL, NULL, 0);
+            continue;
+        }
+
+        if (command.command_type == "JOINT_SPEED" || command.command_type == "CARTESIAN_SPEED")
+        {
+            estimator.addTimed(NULL, NULL, (command.additional_values.size() > 0) ? command.additional_values[0] : 1.0);
+            continue;
+        }
+
+        //target joints and TCP position, each from the other one if the kinematics are known
+        double q[6];
+        double tcp[3];
+        bool hasJoints = false;
+        bool hasTcp = false;
+        if (command.pose_type == "JOINTS")
+        {
+            std::copy(command.pose.begin(), command.pose.begin() + 6, q);
+            hasJoints = true;
+        }
+        else if (i < solutions.size() && solutions[i].status == WaypointSolution::OK)
+        {
+            std::copy(solutions[i].q, solutions[i].q + 6, q);
+            hasJoints = true;
+        }
+
+        double pose[6];
+        if (command.pose_type == "EULER_INTRINSIC_ZYX")
+        {
+            std::copy(command.pose.begin(), command.pose.begin() + 3, tcp);
+            hasTcp = true;
+        }
+        else if (hasJoints && Kinematics::forward(kinematicsModel, q, pose))
+        {
+            getTcpPosition(pose, tcpOffset, tcp);
+            hasTcp = true;
+        }
+
+        bool isLinear = command.command_type == "LIN";
+        if ((isLinear && !hasTcp) || (command.command_type == "PTP" && !hasJoints))
+        {
+            res.rejected_command_ids.push_back(command.command_id);
+            res.rejections.push_back("duration unknown without the kinematics");
+            estimator.addTimed(hasJoints ? q : NULL, hasTcp ? tcp : NULL, 0);
+        }
+        else if (isLinear)
+        {
+            estimator.addLinear(tcp, hasJoints ? q : NULL, command.velocity[0], command.acceleration[0], command.blending[0]);
+        }
+        else if (command.command_type == "PTP")
+        {
+            estimator.addJoint(q, hasTcp ? tcp : NULL, command.velocity[0], command.acceleration[0], command.blending[0]);
+        }
+        else
+        {
+            estimator.addTimed(q, hasTcp ? tcp : NULL, command.additional_values[0]);
+        }
+    }
+
+    res.total = estimator.estimate(res.durations);
+    ROS_DEBUG_NAMED("driver", "estimated %.3f s for %i commands, %i rejected", res.total, (int)commands.size(), (int)res.rejections.size());
+
+    return true;
+}
+
+bool Driver::isCommandListReachable(const std::vector<robot_movement_interface::Command>& commands)
+{
+    RobotState robotState;
+    {
+        boost::lock_guard<boost::mutex> lock(mutexRobotState);
+        robotState = lastRobotState;
+    }
+
+    const std::vector<double>& seed = robotState.getJointPosition().getValues();
+    if (seed.size() < 6)
+    {
+        ROS_WARN_NAMED("driver", "no robot state received. The waypoints are not checked");
+
+        return true;
+    }
+
+    tf::Transform tcpOffset;
+    if (!getTcpOffset(robotState, tcpOffset))
+    {
+        tcpOffset.setIdentity();
+    }
+
+    std::vector<Waypoint> waypoints;
+    getWaypoints(commands, tcpOffset, waypoints);
+
+    std::vector<WaypointSolution> solutions;
+    int rejected = waypointSolver->solve(waypoints, &seed[0], solutions);
+    if (rejected < 0)
+    {
+        return true;
+    }
+
+    const char* reason = WaypointSolution::getStatusName(solutions[rejected].status);
+    ROS_ERROR_NAMED("driver", "command list rejected, waypoint %i (command id %i): %s", rejected, commands[rejected].command_id, reason);
+
+    robot_movement_interface::Result result;
+    result.command_id = commands[rejected].command_id;
+    result.result_code = -1;
+    result.additional_information = std::string("waypoint ") + reason;
+    commandResultPublisher.publish(result);
+
+    return false;
+}
+
+void Driver::getWaypoints(const std::vector<robot_movement_interface::Command>& commands, const tf::Transform& tcpOffset, std::vector<Waypoint>& waypoints)
+{
+    //the commands are TCP poses, the kinematics use the flange
+    tf::Transform tcp2Flange = tcpOffset.inverse();
+
+    waypoints.assign(commands.size(), Waypoint());
+    for (size_t i = 0; i < commands.size(); i++)
+    {
+        const robot_movement_interface::Command& command = commands[i];
+        if (command.pose.size() < 6)
+        {
+            continue;
+        }
+
+        bool isLinear = command.command_type == "LIN" || command.command_type == "LIN_TIMED";
+
+        if (command.pose_type == "JOINTS" && (isLinear || command.command_type == "PTP"))
+        {
+            double q[6];
+            std::copy(command.pose.begin(), command.pose.begin() + 6, q);
+            waypoints[i].setJoints(q, isLinear);
+        }
+        else if (command.pose_type == "EULER_INTRINSIC_ZYX" && (command.command_type == "LIN" || command.command_type == "PTP"))
+        {
+            // Euler intrinsic ZYX -> RPY extrinsic XYZ needs only to change order
+            double x, y, z, w;
+            Rotation::rpyToQuaternion(command.pose[5], command.pose[4], command.pose[3], x, y, z, w);
+            tf::Transform flange = tf::Transform(tf::Quaternion(x, y, z, w), tf::Vector3(command.pose[0], command.pose[1], command.pose[2])) * tcp2Flange;
+
+            tf::Quaternion rotation = flange.getRotation();
+            double pose[6] = {flange.getOrigin().x(), flange.getOrigin().y(), flange.getOrigin().z()};
+            Rotation::quaternionToAxis(rotation.x(), rotation.y(), rotation.z(), rotation.w(), pose[3], pose[4], pose[5]);
+            waypoints[i].setPose(pose, isLinear);
+        }
+    }
+}
+
+void Driver::optimizeBlending(std::vector<robot_movement_interface::Command>& commands, size_t start)
+{
+    RobotState robotState;
+    {
+        boost::lock_guard<boost::mutex> lock(mutexRobotState);
+        robotState = lastRobotState;
+    }
+
+    tf::Transform tcpOffset;
+    if (!getTcpOffset(robotState, tcpOffset))
+    {
+        tcpOffset.setIdentity();
+    }
+
+    //TCP positions of the start (the robot or the waypoint before the first optimized command) and of each waypoint,
+    //the joint positions through the forward kinematics
+    std::vector<double> positions;
+    std::vector<double> radii;
+    for (int i = (int)start - 1; i < (int)commands.size(); i++)
+    {
+        double tcp[3];
+        if (i < 0)
+        {
+            const std::vector<double>& q = robotState.getJointPosition().getValues();
+            if (q.size() < 6)
+            {
+                ROS_WARN_NAMED("driver", "no robot state received. The blend radii are not optimized");
+
+                return;
+            }
+
+            //the TCP offset is applied to the flange pose (the cartesian position is already the TCP pose of the controller)
+            getTcpPosition(&robotState.getFlangePosition().getValues()[0], tcpOffset, tcp);
+        }
+        else
+        {
+            const robot_movement_interface::Command& command = commands[i];
+            bool isMove = command.command_type == "LIN" || command.command_type == "PTP" || command.command_type == "LIN_TIMED";
+            bool isOptimized = i >= (int)start;
+            if (!isMove || (isOptimized && (command.blending_type != "M" || command.blending.size() < 1)) || command.pose.size() < 6)
+            {
+                return;
+            }
+
+            if (!getWaypointPosition(command, tcpOffset, tcp))
+            {
+                ROS_WARN_NAMED("driver", "blend radii of joint positions need the kinematics. The command list is not optimized");
+
+                return;
+            }
+
+            if (isOptimized)
+            {
+                radii.push_back(command.blending[0]);
+            }
+        }
+
+        positions.insert(positions.end(), tcp, tcp + 3);
+    }
+
+    BlendOptimizer optimizer;
+    optimizer.setTolerance(configuration.blendTolerance);
+    int changes = optimizer.optimize(positions, radii);
+    for (size_t i = start; i < commands.size(); i++)
+    {
+        commands[i].blending[0] = radii[i - start];
+    }
+
+    ROS_DEBUG_NAMED("driver", "optimized %i of %i blend radii", changes, (int)radii.size());
+}
+
+bool Driver::getWaypointPosition(const robot_movement_interface::Command& command, const tf::Transform& tcpOffset, double* tcp)
+{
+    if (command.pose.size() < 6)
+    {
+        return false;
+    }
+
+    if (command.pose_type == "EULER_INTRINSIC_ZYX")
+    {
+        //the commands are TCP poses
+        std::copy(command.pose.begin(), command.pose.begin() + 3, tcp);
+
+        return true;
+    }
+
+    double q[6];
+    double pose[6];
+    std::copy(command.pose.begin(), command.pose.begin() + 6, q);
+    if (command.pose_type != "JOINTS" || !Kinematics::forward(kinematicsModel, q, pose))
+    {
+        return false;
+    }
+
+    getTcpPosition(pose, tcpOffset, tcp);
+
+    return true;
+}
+
 // Replaces all quaternions with Euler coordinates
 void Driver::replaceQuaternions(std::vector<robot_movement_interface::Command> & list){
 	for (int i = 0; i < list.size(); i++){
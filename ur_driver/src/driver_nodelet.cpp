@@ -0,0 +1,29 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// This file contains the nodelet wrapper of the driver
+// ----------------------------------------------------------------------------
+
+#include <driver_nodelet.h>
+#include <pluginlib/class_list_macros.h>
+
+using namespace ur_driver;
+
+void DriverNodelet::onInit()
+{
+    driver.reset(new Driver(getMTNodeHandle()));
+}
+
+PLUGINLIB_EXPORT_CLASS(ur_driver::DriverNodelet, nodelet::Nodelet)
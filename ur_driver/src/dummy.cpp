@@ -17,22 +17,115 @@
 // ----------------------------------------------------------------------------
 
 #include <dummy.h>
+#include <connector.h>
+#include <servo.h>
+#include <move_stream.h>
 #include <ros/ros.h>
 #include <cstdlib>
 #include <iostream>
+#include <sstream>
 #include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <algorithm>
 
 using namespace std;
 using namespace ur_driver;
 using boost::asio::ip::tcp;
 
+/**
+ * Draw a random event.
+ * @param probability
+ * @param seed State of the random number generator of the calling thread.
+ * @return
+ */
+static bool isRandomEvent(double probability, unsigned int& seed)
+{
+    return probability > 0 && rand_r(&seed) < probability * RAND_MAX;
+}
+
+//=================================================================
+// DummyLoad
+//=================================================================
+DummyLoad::DummyLoad() :
+    frequency(0),
+    coalesceFrames(1),
+    fragmentSize(0),
+    truncateProbability(0),
+    corruptProbability(0),
+    stallProbability(0),
+    stallDuration(0),
+    disconnectProbability(0),
+    seed(1)
+{
+
+}
+
+//=================================================================
+// DummyStatistics
+//=================================================================
+DummyStatistics::DummyStatistics() :
+    clients(0),
+    frames(0),
+    bytes(0),
+    truncatedFrames(0),
+    corruptFrames(0),
+    stalls(0),
+    disconnects(0)
+{
+
+}
+
+//=================================================================
+// DummyClient
+//=================================================================
+DummyClient::DummyClient(boost::shared_ptr<Transport> transport, unsigned int seed) :
+    transport(transport),
+    seed(seed),
+    isRealtime(false),
+    frequency(10),
+    coalesceFrames(1),
+    isStalled(false),
+    stallEnd(0),
+    isWriting(true)
+{
+
+}
+
+//=================================================================
+// DummyServoProgram
+//=================================================================
+DummyServoProgram::DummyServoProgram() :
+    cycleTime(0.008),
+    lookahead(0.1),
+    capacity(0),
+    isMoveStream(false)
+{
+
+}
+
+//=================================================================
+// Dummy
+//=================================================================
 Dummy::Dummy() :
     runReadSocketThread(false),
     runWriteSocketThread(false),
     port(30002),
-    isRunning(false)
+    isRunning(false),
+    clock(Clock::getWallClock()),
+    executor(NULL),
+    executorClients(0),
+    runServoThread(false),
+    servoReceived(-1),
+    isServoReading(false),
+    isServoStopped(false)
 {
-
+    //start the simulation at the recorded robot state
+    std::string frame = createRobotStateFrame();
+    RobotState robotState;
+    if (Connector::decodeSecondary(&frame[4], frame.size() - 4, robotState) == Connector::DECODED)
+    {
+        simulator.reset(robotState.getJointPosition().getValues(), robotState.getCartesianPosition().getValues());
+    }
 }
 
 Dummy::~Dummy()
@@ -40,7 +133,7 @@ Dummy::~Dummy()
     stop();
 }
 
-void Dummy::start(int port)
+void Dummy::start(int port, bool isListening)
 {
     mutexStartStop.lock();
 
@@ -50,7 +143,10 @@ void Dummy::start(int port)
 
         this->port = port;
 
-        acceptSocketThread = boost::thread(&Dummy::acceptSocketWorker, this, boost::ref(io));
+        if (isListening)
+        {
+            acceptSocketThread = boost::thread(&Dummy::acceptSocketWorker, this, boost::ref(io));
+        }
 
         isRunning = true;
     }
@@ -72,8 +168,33 @@ void Dummy::stop()
         runWriteSocketThread = false;
 
         acceptSocketThread.join();
-        readSocketThread.join();
-        writeSocketThread.join();
+
+        stopServo();
+
+        //wake up the blocking and asynchronous reads of all clients
+        mutexClients.lock();
+        for (size_t i = 0; i < clients.size(); i++)
+        {
+            clients[i]->transport->shutdown();
+        }
+        std::vector<boost::shared_ptr<boost::thread> > threads = clientThreads;
+        mutexClients.unlock();
+
+        //wait for the clients
+        for (size_t i = 0; i < threads.size(); i++)
+        {
+            threads[i]->join();
+        }
+
+        boost::unique_lock<boost::mutex> lock(mutexClients);
+        while (executorClients > 0)
+        {
+            clientCondition.wait(lock);
+        }
+
+        clients.clear();
+        clientThreads.clear();
+        lock.unlock();
 
         io.reset();
 
@@ -83,22 +204,86 @@ void Dummy::stop()
     mutexStartStop.unlock();
 }
 
-void Dummy::readSocketWorker(boost::shared_ptr<tcp::socket> socket)
+void Dummy::setLoad(const DummyLoad& load)
+{
+    this->load = load;
+}
+
+void Dummy::setClock(Clock* clock)
+{
+    this->clock = clock;
+}
+
+void Dummy::setExecutor(Executor* executor)
+{
+    this->executor = executor;
+}
+
+DummyStatistics Dummy::getStatistics()
+{
+    boost::lock_guard<boost::mutex> lock(mutexStatistics);
+
+    return statistics;
+}
+
+Simulator& Dummy::getSimulator()
+{
+    return simulator;
+}
+
+boost::shared_ptr<Transport> Dummy::connect(Transport::Type type)
+{
+    boost::lock_guard<boost::mutex> lock(mutexStartStop);
+
+    boost::shared_ptr<Transport> client;
+    boost::shared_ptr<Transport> server;
+
+    if (!isRunning)
+    {
+        return client;
+    }
+
+    //the in-process clients run on the executor (if any), their client end as well
+    bool isExecutorClient = (executor != NULL && !clock->isSimulated());
+    boost::asio::io_service& clientIo = isExecutorClient ? executor->getIoService() : io;
+
+    switch (type)
+    {
+        case Transport::UNIX:
+            UnixTransport::createPair(clientIo, client, server);
+            break;
+        case Transport::MEMORY:
+            MemoryTransport::createPair(clientIo, client, server);
+            break;
+        default:
+            boost::shared_ptr<TcpTransport> tcpTransport(new TcpTransport(clientIo));
+            tcpTransport->connect("127.0.0.1", port);
+
+            return tcpTransport;
+    }
+
+    addClient(server, isExecutorClient);
+
+    return client;
+}
+
+void Dummy::readSocketWorker(boost::shared_ptr<DummyClient> client)
 {
     try
     {
-        while(socket->is_open())
+        while(runReadSocketThread && client->transport->isOpen())
         {
-            char data[1024];
-
             //read data from socket
             boost::system::error_code error;
-            size_t length = socket->read_some(boost::asio::buffer(data), error);
+            clock->beginWait();
+            size_t length = client->transport->read(client->data, sizeof(client->data), error);
+            clock->endWait();
+            clock->addInFlight(-(long)length);
 
             //connection closed cleanly by peer.
             if (error == boost::asio::error::eof)
             {
-                socket->close();
+                client->transport->close();
 
                 break;
             }
@@ -107,6 +292,8 @@ void Dummy::readSocketWorker(boost::shared_ptr<tcp::socket> socket)
             {
                 throw boost::system::system_error(error);
             }
+
+            executeScripts(*client, length);
         }
     }
     catch (std::exception& e)
@@ -114,53 +301,446 @@ void Dummy::readSocketWorker(boost::shared_ptr<tcp::socket> socket)
         ROS_WARN("dummy: exception in read thread: %s", e.what());
     }
 
+    clock->removeParticipant();
+
     ROS_DEBUG_NAMED("dummy", "dummy: exit readSocketWorker thread");
 }
 
-void Dummy::writeSocketWorker(boost::shared_ptr<tcp::socket> socket)
+void Dummy::handleRead(boost::shared_ptr<DummyClient> client, const boost::system::error_code& error, size_t length)
+{
+    if (!error)
+    {
+        executeScripts(*client, length);
+
+        if (runReadSocketThread && client->transport->isOpen())
+        {
+            client->transport->asyncRead(client->data, sizeof(client->data), boost::bind(&Dummy::handleRead, this, client, _1, _2));
+
+            return;
+        }
+    }
+    else if (error != boost::asio::error::eof)
+    {
+        ROS_WARN("dummy: exception in read handler: %s", error.message().c_str());
+    }
+
+    //the connection is finished
+    client->transport->close();
+    client->writeTask->stop();
+
+    boost::lock_guard<boost::mutex> lock(mutexClients);
+    executorClients--;
+    clientCondition.notify_all();
+}
+
+void Dummy::executeScripts(DummyClient& client, size_t length)
+{
+    //execute the received programs
+    client.parser.addData(client.data, length);
+    while (client.parser.nextProgram(client.program))
+    {
+        //a new program ends the servo program
+        stopServo();
+
+        simulator.update(clock->now());
+        if (!startServo(client.program))
+        {
+            simulator.execute(client.program);
+        }
+    }
+}
+
+bool Dummy::startServo(const std::vector<ScriptInstruction>& program)
 {
+    //textmsg("servo buffer capacity ", n) ... socket_open("host", port, "servo") ... servoj(q, a, v, t, lookahead_time, gain) ... stopj(a)
+    //or socket_open("host", port, "speed") ... speedj(qd, a, t) ... stopj(a)
+    //or socket_open("host", port, "moves") ... movej(x, a, v, r) ... movep(x, a, v, r) ... stopj(a)
+    const ScriptArgument* host = NULL;
+    const ScriptArgument* port = NULL;
+    DummyServoProgram servo;
+    servo.lookahead = -1;
+
+    for (size_t i = 0; i < program.size(); i++)
+    {
+        const ScriptInstruction& instruction = program[i];
+        const ScriptArgument* name = instruction.getArgument(2, "socket_name");
+        const ScriptArgument* message = instruction.getArgument(0, "s");
+
+        if (instruction.name == "socket_open" && name != NULL && (name->text == "servo" || name->text == "speed" || name->text == "moves"))
+        {
+            host = instruction.getArgument(0, "address");
+            port = instruction.getArgument(1, "port");
+            if (name->text == "moves")
+            {
+                servo.isMoveStream = true;
+                servo.lookahead = 0;
+            }
+        }
+        else if (servo.isMoveStream && instruction.name != "stopj" && instruction.name != "socket_close")
+        {
+            //the moves of the loop are streamed
+        }
+        else if (instruction.name == "textmsg" && message != NULL && message->text == "servo buffer capacity ")
+        {
+            servo.capacity = (int)instruction.getValue(1, "s2", 0);
+        }
+        else if (instruction.name == "servoj")
+        {
+            servo.cycleTime = instruction.getValue(3, "t", 0.008);
+            servo.lookahead = instruction.getValue(4, "lookahead_time", 0.1);
+            servo.motion = instruction;
+        }
+        else if (instruction.name == "speedj")
+        {
+            servo.cycleTime = instruction.getValue(2, "t", 0.008);
+            servo.lookahead = 0;
+            servo.motion = instruction;
+        }
+        else if (servo.lookahead >= 0)
+        {
+            servo.end.push_back(instruction);
+        }
+    }
+
+    if (host == NULL || port == NULL || port->values.empty() || servo.lookahead < 0)
+    {
+        return false;
+    }
+
+    ROS_DEBUG_NAMED("dummy", "dummy: start %s program to %s:%i (buffer %i)", servo.isMoveStream ? "move" : "servo", host->text.c_str(), (int)port->values[0], servo.capacity);
+
+    boost::lock_guard<boost::mutex> lock(mutexServo);
+
+    //the program stops at once if the connection fails, like with an unanswered socket_read_binary_integer
+    boost::shared_ptr<TcpTransport> transport(new TcpTransport(io));
     try
     {
-        ros::Rate loopRate(10);
-
-        while (socket->is_open())
-        {
-            //build dummy data
-            std::stringstream stream;
-            stream <<(char)0 <<(char)0 <<(char)1 <<(char)209 <<(char)16 <<(char)0 <<(char)0 <<(char)0 <<(char)29 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)5 <<(char)7 <<(char)246 <<(char)1 <<(char)1 <<(char)1 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)63 <<(char)240 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0;
-            stream <<(char)0 <<(char)251 <<(char)1 <<(char)64 <<(char)1 <<(char)78 <<(char)244 <<(char)77 <<(char)189 <<(char)249 <<(char)149 <<(char)64 <<(char)1 <<(char)78 <<(char)247 <<(char)89 <<(char)95 <<(char)104 <<(char)85 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)188 <<(char)220 <<(char)97 <<(char)3 <<(char)66 <<(char)62;
-            stream <<(char)0 <<(char)0 <<(char)66 <<(char)0 <<(char)102 <<(char)103 <<(char)66 <<(char)99 <<(char)153 <<(char)154 <<(char)253 <<(char)191 <<(char)246 <<(char)74 <<(char)170 <<(char)216 <<(char)242 <<(char)29 <<(char)102 <<(char)191 <<(char)246 <<(char)74 <<(char)178 <<(char)44 <<(char)92 <<(char)72 <<(char)137 <<(char)0 <<(char)0 <<(char)0 <<(char)0;
-            stream <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)192 <<(char)1 <<(char)106 <<(char)78 <<(char)66 <<(char)63 <<(char)153 <<(char)154 <<(char)66 <<(char)4 <<(char)204 <<(char)205 <<(char)66 <<(char)104 <<(char)0 <<(char)0 <<(char)253 <<(char)63 <<(char)253 <<(char)49 <<(char)202 <<(char)91 <<(char)202 <<(char)8 <<(char)64 <<(char)63 <<(char)253 <<(char)49;
-            stream <<(char)210 <<(char)233 <<(char)51 <<(char)16 <<(char)35 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)191 <<(char)155 <<(char)135 <<(char)34 <<(char)66 <<(char)62 <<(char)0 <<(char)0 <<(char)65 <<(char)249 <<(char)153 <<(char)154 <<(char)66 <<(char)100 <<(char)0 <<(char)0 <<(char)253 <<(char)191 <<(char)220 <<(char)115;
-            stream <<(char)204 <<(char)104 <<(char)205 <<(char)239 <<(char)254 <<(char)191 <<(char)220 <<(char)118 <<(char)68 <<(char)109 <<(char)49 <<(char)34 <<(char)158 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)190 <<(char)60 <<(char)245 <<(char)109 <<(char)66 <<(char)63 <<(char)153 <<(char)154 <<(char)66 <<(char)25 <<(char)51;
-            stream <<(char)51 <<(char)66 <<(char)116 <<(char)204 <<(char)205 <<(char)253 <<(char)63 <<(char)242 <<(char)146 <<(char)224 <<(char)105 <<(char)231 <<(char)66 <<(char)209 <<(char)63 <<(char)242 <<(char)146 <<(char)65 <<(char)3 <<(char)193 <<(char)196 <<(char)156 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)190 <<(char)115;
-            stream <<(char)157 <<(char)190 <<(char)66 <<(char)62 <<(char)0 <<(char)0 <<(char)66 <<(char)21 <<(char)51 <<(char)51 <<(char)66 <<(char)119 <<(char)153 <<(char)154 <<(char)253 <<(char)191 <<(char)231 <<(char)207 <<(char)8 <<(char)215 <<(char)85 <<(char)22 <<(char)88 <<(char)191 <<(char)231 <<(char)206 <<(char)77 <<(char)130 <<(char)151 <<(char)190 <<(char)17;
-            stream <<(char)191 <<(char)146 <<(char)242 <<(char)158 <<(char)148 <<(char)114 <<(char)240 <<(char)57 <<(char)188 <<(char)224 <<(char)224 <<(char)96 <<(char)66 <<(char)68 <<(char)102 <<(char)103 <<(char)66 <<(char)37 <<(char)153 <<(char)154 <<(char)66 <<(char)127 <<(char)153 <<(char)154 <<(char)253 <<(char)0 <<(char)0 <<(char)0 <<(char)53 <<(char)4 <<(char)63;
-            stream <<(char)217 <<(char)153 <<(char)52 <<(char)224 <<(char)36 <<(char)238 <<(char)93 <<(char)191 <<(char)217 <<(char)153 <<(char)169 <<(char)67 <<(char)241 <<(char)211 <<(char)23 <<(char)63 <<(char)207 <<(char)255 <<(char)137 <<(char)8 <<(char)22 <<(char)253 <<(char)198 <<(char)63 <<(char)240 <<(char)0 <<(char)170 <<(char)111 <<(char)207 <<(char)54;
-            stream <<(char)176 <<(char)63 <<(char)243 <<(char)51 <<(char)88 <<(char)137 <<(char)58 <<(char)151 <<(char)217 <<(char)63 <<(char)201 <<(char)148 <<(char)119 <<(char)151 <<(char)70 <<(char)237 <<(char)237 <<(char)0 <<(char)0 <<(char)0 <<(char)29 <<(char)5 <<(char)64 <<(char)143 <<(char)64 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)64 <<(char)143 <<(char)64;
-            stream <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)64 <<(char)143 <<(char)64 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)61 <<(char)3 <<(char)0 <<(char)63 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)63 <<(char)123 <<(char)129 <<(char)184 <<(char)27 <<(char)129 <<(char)184 <<(char)28 <<(char)63 <<(char)112 <<(char)225;
-            stream <<(char)14 <<(char)16 <<(char)225 <<(char)14 <<(char)17 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)66 <<(char)87 <<(char)51 <<(char)51 <<(char)66 <<(char)66 <<(char)0 <<(char)0 <<(char)62 <<(char)35 <<(char)215 <<(char)11 <<(char)61;
-            stream <<(char)241 <<(char)169 <<(char)253 <<(char)0 <<(char)0 <<(char)0 <<(char)37 <<(char)2 <<(char)0 <<(char)0 <<(char)63 <<(char)141 <<(char)83 <<(char)47 <<(char)180 <<(char)171 <<(char)196 <<(char)232 <<(char)63 <<(char)137 <<(char)46 <<(char)99 <<(char)102 <<(char)69 <<(char)149 <<(char)155 <<(char)66 <<(char)55 <<(char)51 <<(char)51 <<(char)0 <<(char)59;
-            stream <<(char)68 <<(char)155 <<(char)166 <<(char)66 <<(char)92 <<(char)0 <<(char)0 <<(char)253;
-
-            const char* data = stream.str().c_str();
-            int length = stream.str().length();
-
-            //write data to socket
-            boost::system::error_code error;
-            socket->write_some(boost::asio::buffer(data, length), error);
+        transport->connect(host->text, (int)port->values[0]);
+    }
+    catch (std::exception& e)
+    {
+        ROS_WARN("dummy: servo program cannot connect: %s", e.what());
+        simulator.execute(servo.end);
 
-            //connection closed cleanly by peer.
-            if (error == boost::asio::error::eof)
+        return true;
+    }
+
+    servoTransport = transport;
+    runServoThread = true;
+    servoBuffer.clear();
+    servoReceived = -1;
+    isServoReading = true;
+    isServoStopped = false;
+
+    clock->addParticipant();
+    servoThread = boost::thread(servo.isMoveStream ? &Dummy::moveWorker : &Dummy::servoWorker, this, transport, servo);
+    if (servo.capacity > 0)
+    {
+        clock->addParticipant();
+        servoPlayThread = boost::thread(&Dummy::servoPlayWorker, this, transport, servo);
+    }
+
+    return true;
+}
+
+void Dummy::stopServo()
+{
+    boost::lock_guard<boost::mutex> lock(mutexServo);
+
+    if (!servoTransport)
+    {
+        return;
+    }
+
+    runServoThread = false;
+    servoTransport->shutdown();
+    servoThread.join();
+    servoPlayThread.join();
+
+    servoTransport->close();
+    servoTransport.reset();
+}
+
+void Dummy::servoWorker(boost::shared_ptr<TcpTransport> transport, DummyServoProgram servo)
+{
+    ClockRate rate(clock, 1.0 / servo.cycleTime);
+    char data[16 * SERVO_FRAME_SIZE];
+    std::string buffer;
+    std::vector<double> jointPosition(6);
+    int sequence;
+    bool isStopped = false;
+
+    while (!isStopped)
+    {
+        boost::system::error_code error;
+        clock->beginWait();
+        size_t length = transport->read(data, sizeof(data), error);
+        clock->endWait();
+        clock->addInFlight(-(long)length);
+
+        if (error)
+        {
+            break;
+        }
+
+        buffer.append(data, length);
+        size_t offset = 0;
+        for (; buffer.size() - offset >= SERVO_FRAME_SIZE && !isStopped; offset += SERVO_FRAME_SIZE)
+        {
+            int keepalive = ServoServer::decodeSetpoint(&buffer[offset], &jointPosition[0], sequence);
+
+            if (keepalive == SERVO_SETPOINT && servo.capacity > 0)
+            {
+                //the buffered program plays the setpoints one per cycle, a full buffer drops them
+                boost::lock_guard<boost::mutex> lock(mutexServoBuffer);
+                if (sequence > servoReceived && (int)servoBuffer.size() < servo.capacity)
+                {
+                    servoBuffer.push_back(jointPosition);
+                    servoReceived = sequence;
+                }
+            }
+            else if (keepalive == SERVO_SETPOINT && servo.motion.name == "speedj")
+            {
+                //the velocity is held for the cycle time, afterwards the robot stops
+                std::vector<ScriptInstruction> speed(1, servo.motion);
+                speed[0].arguments[0].values = jointPosition;
+                simulator.update(clock->now());
+                simulator.execute(speed);
+            }
+            else if (keepalive == SERVO_SETPOINT)
+            {
+                //executed in the order of arrival, each one replaces the previous one
+                simulator.update(clock->now());
+                simulator.servo(jointPosition, servo.lookahead);
+            }
+            else if (keepalive != SERVO_IDLE)
+            {
+                isStopped = true;
+            }
+
+            //like the unbuffered program, which requests the next frame and executes the setpoint for a cycle
+            if (servo.capacity <= 0 && !isStopped)
+            {
+                char report[SERVO_REPORT_SIZE];
+                ServoServer::encodeReport(0, sequence, report);
+                clock->addInFlight(SERVO_REPORT_SIZE);
+                size_t written = transport->write(report, SERVO_REPORT_SIZE, error);
+                clock->addInFlight(-(long)(SERVO_REPORT_SIZE - written));
+
+                rate.sleep();
+            }
+        }
+        buffer.erase(0, offset);
+    }
+
+    if (servo.capacity > 0)
+    {
+        //the play loop ends the buffered program
+        boost::lock_guard<boost::mutex> lock(mutexServoBuffer);
+        isServoReading = false;
+        isServoStopped = isStopped;
+    }
+    else if (runServoThread)
+    {
+        //the stream ended: the program stops the robot and closes the socket, unless another program replaced it
+        ROS_DEBUG_NAMED("dummy", "dummy: servo program finished");
+
+        simulator.update(clock->now());
+        simulator.execute(servo.end);
+        transport->shutdown();
+    }
+
+    clock->removeParticipant();
+}
+
+void Dummy::servoPlayWorker(boost::shared_ptr<TcpTransport> transport, DummyServoProgram servo)
+{
+    ClockRate rate(clock, 1.0 / servo.cycleTime);
+    std::vector<double> jointPosition;
+    char report[SERVO_REPORT_SIZE];
+    int depth = std::max(servo.capacity / 2, 1);
+    bool isPlaying = false;
+    int waiting = 0;
+
+    while (runServoThread)
+    {
+        //play one setpoint per cycle. The buffer is drained after the stream ended
+        {
+            boost::lock_guard<boost::mutex> lock(mutexServoBuffer);
+            if (isServoStopped || (!isServoReading && servoBuffer.empty()))
             {
                 break;
             }
-            //some other error
-            else if (error)
+
+            //start when the depth is buffered or the stream paused, an underrun fills the buffer again
+            if (!isPlaying && !servoBuffer.empty() && ((int)servoBuffer.size() >= depth || ++waiting >= depth))
             {
-                throw boost::system::system_error(error);
+                isPlaying = true;
+                waiting = 0;
+            }
+
+            jointPosition.clear();
+            if (isPlaying && !servoBuffer.empty())
+            {
+                jointPosition = servoBuffer.front();
+                servoBuffer.pop_front();
+            }
+            else
+            {
+                isPlaying = false;
+            }
+            ServoServer::encodeReport(servoBuffer.size(), servoReceived, report);
+        }
+
+        if (!jointPosition.empty())
+        {
+            simulator.update(clock->now());
+            simulator.servo(jointPosition, servo.lookahead);
+        }
+
+        boost::system::error_code error;
+        clock->addInFlight(SERVO_REPORT_SIZE);
+        size_t length = transport->write(report, SERVO_REPORT_SIZE, error);
+        clock->addInFlight(-(long)(SERVO_REPORT_SIZE - length));
+
+        rate.sleep();
+    }
+
+    if (runServoThread)
+    {
+        ROS_DEBUG_NAMED("dummy", "dummy: servo program finished");
+
+        simulator.update(clock->now());
+        simulator.execute(servo.end);
+        transport->shutdown();
+    }
+
+    clock->removeParticipant();
+}
+
+void Dummy::moveWorker(boost::shared_ptr<TcpTransport> transport, DummyServoProgram servo)
+{
+    ClockRate rate(clock, 1.0 / servo.cycleTime);
+    char data[16 * MOVE_FRAME_SIZE];
+    std::string buffer;
+    StreamedMove move;
+    bool isStopped = false;
+
+    while (!isStopped && runServoThread)
+    {
+        //like the program, which reads the next frame when the controller needs the next move for blending
+        simulator.update(clock->now());
+        if (simulator.isMotionQueued())
+        {
+            rate.sleep();
+            continue;
+        }
+
+        while (buffer.size() < MOVE_FRAME_SIZE && !isStopped)
+        {
+            boost::system::error_code error;
+            clock->beginWait();
+            size_t length = transport->read(data, sizeof(data), error);
+            clock->endWait();
+            clock->addInFlight(-(long)length);
+
+            buffer.append(data, length);
+            if (error)
+            {
+                isStopped = true;
+            }
+        }
+
+        if (isStopped)
+        {
+            break;
+        }
+
+        int sequence = MoveStreamServer::decodeMove(&buffer[0], move);
+        buffer.erase(0, MOVE_FRAME_SIZE);
+
+        char ack[MOVE_ACK_SIZE];
+        MoveStreamServer::encodeAck(sequence, ack);
+        boost::system::error_code error;
+        clock->addInFlight(MOVE_ACK_SIZE);
+        size_t length = transport->write(ack, MOVE_ACK_SIZE, error);
+        clock->addInFlight(-(long)(MOVE_ACK_SIZE - length));
+
+        if (move.type >= MOVE_JOINT && move.type <= MOVE_PROCESS_POSE)
+        {
+            ScriptArgument target;
+            target.values.assign(move.target, move.target + 6);
+            target.isPose = (move.type == MOVE_JOINT_POSE || move.type == MOVE_PROCESS_POSE);
+
+            const char* keywords[3] = {"a", "v", "r"};
+            double values[3] = {move.acceleration, move.velocity, move.radius};
+
+            ScriptInstruction instruction;
+            instruction.name = (move.type <= MOVE_JOINT_POSE) ? "movej" : "movep";
+            instruction.arguments.push_back(target);
+            for (int i = 0; i < 3; i++)
+            {
+                ScriptArgument argument;
+                argument.keyword = keywords[i];
+                argument.values.push_back(values[i]);
+                argument.isPose = false;
+                instruction.arguments.push_back(argument);
             }
 
+            simulator.update(clock->now());
+            simulator.append(instruction);
+        }
+        else if (move.type != MOVE_IDLE)
+        {
+            //an idle frame only keeps the program alive, it reads the next frame at once
+            isStopped = true;
+        }
+    }
+
+    if (runServoThread)
+    {
+        //the stream ended: the program stops the robot and closes the socket, unless another program replaced it
+        ROS_DEBUG_NAMED("dummy", "dummy: move program finished");
+
+        simulator.update(clock->now());
+        simulator.execute(servo.end);
+        transport->shutdown();
+    }
+
+    clock->removeParticipant();
+}
+
+std::string Dummy::createRobotStateFrame()
+{
+    //robot state frame of port 30002 recorded from a robot controller
+    std::stringstream stream;
+    stream <<(char)0 <<(char)0 <<(char)1 <<(char)209 <<(char)16 <<(char)0 <<(char)0 <<(char)0 <<(char)29 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)5 <<(char)7 <<(char)246 <<(char)1 <<(char)1 <<(char)1 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)63 <<(char)240 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0;
+    stream <<(char)0 <<(char)251 <<(char)1 <<(char)64 <<(char)1 <<(char)78 <<(char)244 <<(char)77 <<(char)189 <<(char)249 <<(char)149 <<(char)64 <<(char)1 <<(char)78 <<(char)247 <<(char)89 <<(char)95 <<(char)104 <<(char)85 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)188 <<(char)220 <<(char)97 <<(char)3 <<(char)66 <<(char)62;
+    stream <<(char)0 <<(char)0 <<(char)66 <<(char)0 <<(char)102 <<(char)103 <<(char)66 <<(char)99 <<(char)153 <<(char)154 <<(char)253 <<(char)191 <<(char)246 <<(char)74 <<(char)170 <<(char)216 <<(char)242 <<(char)29 <<(char)102 <<(char)191 <<(char)246 <<(char)74 <<(char)178 <<(char)44 <<(char)92 <<(char)72 <<(char)137 <<(char)0 <<(char)0 <<(char)0 <<(char)0;
+    stream <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)192 <<(char)1 <<(char)106 <<(char)78 <<(char)66 <<(char)63 <<(char)153 <<(char)154 <<(char)66 <<(char)4 <<(char)204 <<(char)205 <<(char)66 <<(char)104 <<(char)0 <<(char)0 <<(char)253 <<(char)63 <<(char)253 <<(char)49 <<(char)202 <<(char)91 <<(char)202 <<(char)8 <<(char)64 <<(char)63 <<(char)253 <<(char)49;
+    stream <<(char)210 <<(char)233 <<(char)51 <<(char)16 <<(char)35 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)191 <<(char)155 <<(char)135 <<(char)34 <<(char)66 <<(char)62 <<(char)0 <<(char)0 <<(char)65 <<(char)249 <<(char)153 <<(char)154 <<(char)66 <<(char)100 <<(char)0 <<(char)0 <<(char)253 <<(char)191 <<(char)220 <<(char)115;
+    stream <<(char)204 <<(char)104 <<(char)205 <<(char)239 <<(char)254 <<(char)191 <<(char)220 <<(char)118 <<(char)68 <<(char)109 <<(char)49 <<(char)34 <<(char)158 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)190 <<(char)60 <<(char)245 <<(char)109 <<(char)66 <<(char)63 <<(char)153 <<(char)154 <<(char)66 <<(char)25 <<(char)51;
+    stream <<(char)51 <<(char)66 <<(char)116 <<(char)204 <<(char)205 <<(char)253 <<(char)63 <<(char)242 <<(char)146 <<(char)224 <<(char)105 <<(char)231 <<(char)66 <<(char)209 <<(char)63 <<(char)242 <<(char)146 <<(char)65 <<(char)3 <<(char)193 <<(char)196 <<(char)156 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)190 <<(char)115;
+    stream <<(char)157 <<(char)190 <<(char)66 <<(char)62 <<(char)0 <<(char)0 <<(char)66 <<(char)21 <<(char)51 <<(char)51 <<(char)66 <<(char)119 <<(char)153 <<(char)154 <<(char)253 <<(char)191 <<(char)231 <<(char)207 <<(char)8 <<(char)215 <<(char)85 <<(char)22 <<(char)88 <<(char)191 <<(char)231 <<(char)206 <<(char)77 <<(char)130 <<(char)151 <<(char)190 <<(char)17;
+    stream <<(char)191 <<(char)146 <<(char)242 <<(char)158 <<(char)148 <<(char)114 <<(char)240 <<(char)57 <<(char)188 <<(char)224 <<(char)224 <<(char)96 <<(char)66 <<(char)68 <<(char)102 <<(char)103 <<(char)66 <<(char)37 <<(char)153 <<(char)154 <<(char)66 <<(char)127 <<(char)153 <<(char)154 <<(char)253 <<(char)0 <<(char)0 <<(char)0 <<(char)53 <<(char)4 <<(char)63;
+    stream <<(char)217 <<(char)153 <<(char)52 <<(char)224 <<(char)36 <<(char)238 <<(char)93 <<(char)191 <<(char)217 <<(char)153 <<(char)169 <<(char)67 <<(char)241 <<(char)211 <<(char)23 <<(char)63 <<(char)207 <<(char)255 <<(char)137 <<(char)8 <<(char)22 <<(char)253 <<(char)198 <<(char)63 <<(char)240 <<(char)0 <<(char)170 <<(char)111 <<(char)207 <<(char)54;
+    stream <<(char)176 <<(char)63 <<(char)243 <<(char)51 <<(char)88 <<(char)137 <<(char)58 <<(char)151 <<(char)217 <<(char)63 <<(char)201 <<(char)148 <<(char)119 <<(char)151 <<(char)70 <<(char)237 <<(char)237 <<(char)0 <<(char)0 <<(char)0 <<(char)29 <<(char)5 <<(char)64 <<(char)143 <<(char)64 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)64 <<(char)143 <<(char)64;
+    stream <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)64 <<(char)143 <<(char)64 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)61 <<(char)3 <<(char)0 <<(char)63 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)63 <<(char)123 <<(char)129 <<(char)184 <<(char)27 <<(char)129 <<(char)184 <<(char)28 <<(char)63 <<(char)112 <<(char)225;
+    stream <<(char)14 <<(char)16 <<(char)225 <<(char)14 <<(char)17 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)0 <<(char)66 <<(char)87 <<(char)51 <<(char)51 <<(char)66 <<(char)66 <<(char)0 <<(char)0 <<(char)62 <<(char)35 <<(char)215 <<(char)11 <<(char)61;
+    stream <<(char)241 <<(char)169 <<(char)253 <<(char)0 <<(char)0 <<(char)0 <<(char)37 <<(char)2 <<(char)0 <<(char)0 <<(char)63 <<(char)141 <<(char)83 <<(char)47 <<(char)180 <<(char)171 <<(char)196 <<(char)232 <<(char)63 <<(char)137 <<(char)46 <<(char)99 <<(char)102 <<(char)69 <<(char)149 <<(char)155 <<(char)66 <<(char)55 <<(char)51 <<(char)51 <<(char)0 <<(char)59;
+    stream <<(char)68 <<(char)155 <<(char)166 <<(char)66 <<(char)92 <<(char)0 <<(char)0 <<(char)253;
+
+    return stream.str();
+}
+
+void Dummy::writeSocketWorker(boost::shared_ptr<DummyClient> client)
+{
+    try
+    {
+        ClockRate loopRate(clock, client->frequency / client->coalesceFrames);
+
+        while (runWriteSocketThread && client->transport->isOpen() && writeFrames(*client))
+        {
             loopRate.sleep();
         }
     }
@@ -169,22 +749,149 @@ void Dummy::writeSocketWorker(boost::shared_ptr<tcp::socket> socket)
         ROS_WARN("dummy: exception in write thread: %s", e.what());
     }
 
+    clock->removeParticipant();
+
     ROS_DEBUG_NAMED("dummy", "dummy: exit writeSocketWorker thread");
 }
 
+void Dummy::writeStep(DummyClient* client)
+{
+    if (!client->isWriting || !runWriteSocketThread || !client->transport->isOpen())
+    {
+        return;
+    }
+
+    try
+    {
+        client->isWriting = writeFrames(*client);
+    }
+    catch (std::exception& e)
+    {
+        ROS_WARN("dummy: exception in write task: %s", e.what());
+        client->isWriting = false;
+    }
+}
+
+bool Dummy::writeFrames(DummyClient& client)
+{
+    DummyStatistics sent;
+    int frames = client.coalesceFrames;
+
+    //stall, the missed frames are sent as a burst
+    if (!client.isStalled && isRandomEvent(load.stallProbability, client.seed))
+    {
+        client.isStalled = true;
+        client.stallEnd = clock->now() + load.stallDuration;
+        sent.stalls++;
+    }
+
+    if (client.isStalled)
+    {
+        if (clock->now() < client.stallEnd)
+        {
+            addStatistics(sent);
+
+            return true;
+        }
+
+        client.isStalled = false;
+        frames += (int)(load.stallDuration * client.frequency);
+    }
+
+    //build the frames from the simulated robot state
+    simulator.update(clock->now());
+
+    client.buffer.clear();
+    for (int i = 0; i < frames; i++)
+    {
+        if (client.isRealtime)
+        {
+            simulator.createRealtimeFrame(client.frame);
+        }
+        else
+        {
+            simulator.createSecondaryFrame(client.frame);
+        }
+
+        if (isRandomEvent(load.truncateProbability, client.seed))
+        {
+            client.frame.resize(1 + rand_r(&client.seed) % (client.frame.size() - 1));
+            sent.truncatedFrames++;
+        }
+        else if (isRandomEvent(load.corruptProbability, client.seed))
+        {
+            client.frame[rand_r(&client.seed) % client.frame.size()] ^= (char)(1 << (rand_r(&client.seed) % 8));
+            sent.corruptFrames++;
+        }
+
+        client.buffer.append(client.frame);
+    }
+
+    //write data to socket, optionally split into fragments of random size
+    boost::system::error_code error;
+    size_t offset = 0;
+    clock->addInFlight(client.buffer.size());
+    while (offset < client.buffer.size() && !error)
+    {
+        size_t length = client.buffer.size() - offset;
+        if (load.fragmentSize > 0)
+        {
+            length = std::min(length, (size_t)(1 + rand_r(&client.seed) % load.fragmentSize));
+        }
+
+        offset += client.transport->write(&client.buffer[offset], length, error);
+    }
+    clock->addInFlight(-(long)(client.buffer.size() - offset));
+
+    //connection closed cleanly by peer.
+    if (error == boost::asio::error::eof)
+    {
+        return false;
+    }
+    //some other error
+    else if (error)
+    {
+        throw boost::system::system_error(error);
+    }
+
+    sent.frames = frames;
+    sent.bytes = client.buffer.size();
+
+    //reset the connection, the reader closes the socket
+    bool isDisconnect = isRandomEvent(load.disconnectProbability, client.seed);
+    if (isDisconnect)
+    {
+        client.transport->reset();
+        sent.disconnects++;
+    }
+
+    addStatistics(sent);
+
+    return !isDisconnect;
+}
+
+void Dummy::addStatistics(const DummyStatistics& sent)
+{
+    boost::lock_guard<boost::mutex> lock(mutexStatistics);
+
+    statistics.frames += sent.frames;
+    statistics.bytes += sent.bytes;
+    statistics.truncatedFrames += sent.truncatedFrames;
+    statistics.corruptFrames += sent.corruptFrames;
+    statistics.stalls += sent.stalls;
+    statistics.disconnects += sent.disconnects;
+}
+
 void Dummy::acceptSocketWorker(boost::asio::io_service& io)
 {
     try
     {
         tcp::acceptor acceptor(io, tcp::endpoint(tcp::v4(), port));
 
-        boost::shared_ptr<tcp::socket> socket(new tcp::socket(acceptor.get_io_service()));
-        acceptor.async_accept(*socket, boost::bind(&Dummy::handleAccept, this, boost::asio::placeholders::error, socket, boost::ref(acceptor)));
+        boost::shared_ptr<TcpTransport> transport(new TcpTransport(acceptor.get_io_service()));
+        acceptor.async_accept(transport->getSocket(), boost::bind(&Dummy::handleAccept, this, boost::asio::placeholders::error, transport, boost::ref(acceptor)));
 
         io.run();
-
-        readSocketThread.join();
-        writeSocketThread.join();
     }
     catch (std::exception& e)
     {
@@ -194,7 +901,7 @@ void Dummy::acceptSocketWorker(boost::asio::io_service& io)
     ROS_DEBUG_NAMED("dummy", "dummy: exit acceptSocketWorker thread");
 }
 
-void Dummy::handleAccept(const boost::system::error_code& error, boost::shared_ptr<boost::asio::ip::tcp::socket> socket, boost::asio::ip::tcp::acceptor& acceptor)
+void Dummy::handleAccept(const boost::system::error_code& error, boost::shared_ptr<TcpTransport> transport, boost::asio::ip::tcp::acceptor& acceptor)
 {
     if (error)
     {
@@ -203,8 +910,77 @@ void Dummy::handleAccept(const boost::system::error_code& error, boost::shared_p
 
     ROS_DEBUG_NAMED("dummy", "dummy: accepted client");
 
+    addClient(transport, false);
+
+    //accept the next client
+    boost::shared_ptr<TcpTransport> nextTransport(new TcpTransport(acceptor.get_io_service()));
+    acceptor.async_accept(nextTransport->getSocket(), boost::bind(&Dummy::handleAccept, this, boost::asio::placeholders::error, nextTransport, boost::ref(acceptor)));
+}
+
+void Dummy::addClient(boost::shared_ptr<Transport> transport, bool isExecutorClient)
+{
+    mutexStatistics.lock();
+    unsigned int seed = load.seed + statistics.clients;
+    mutexStatistics.unlock();
+
+    boost::shared_ptr<DummyClient> client(new DummyClient(transport, seed));
+    client->isRealtime = (port == 30003);
+    client->frequency = (load.frequency > 0) ? load.frequency : (client->isRealtime ? 125 : 10);
+    client->coalesceFrames = std::max(load.coalesceFrames, 1);
+
+    //send each fragment in its own segment
+    if (load.fragmentSize > 0)
+    {
+        transport->setNoDelay(true);
+    }
+
+    //the client threads take part in the clock before the client is visible
+    if (!isExecutorClient)
+    {
+        clock->addParticipant();
+        clock->addParticipant();
+    }
+
+    mutexStatistics.lock();
+    statistics.clients++;
+    mutexStatistics.unlock();
+
     runReadSocketThread = true;
     runWriteSocketThread = true;
-    readSocketThread = boost::thread(boost::bind(&Dummy::readSocketWorker, this, socket));
-    writeSocketThread = boost::thread(boost::bind(&Dummy::writeSocketWorker, this, socket));
+
+    mutexClients.lock();
+
+    //forget the clients which are disconnected
+    for (size_t i = clientThreads.size(); i > 0; i--)
+    {
+        if (clientThreads[i - 1]->timed_join(boost::posix_time::seconds(0)))
+        {
+            clientThreads.erase(clientThreads.begin() + i - 1);
+        }
+    }
+    for (size_t i = clients.size(); i > 0; i--)
+    {
+        if (!clients[i - 1]->transport->isOpen())
+        {
+            clients.erase(clients.begin() + i - 1);
+        }
+    }
+
+    clients.push_back(client);
+
+    if (isExecutorClient)
+    {
+        executorClients++;
+
+        client->writeTask.reset(new PeriodicTask(executor, client->frequency / client->coalesceFrames, boost::bind(&Dummy::writeStep, this, client.get())));
+        client->writeTask->start();
+        transport->asyncRead(client->data, sizeof(client->data), boost::bind(&Dummy::handleRead, this, client, _1, _2));
+    }
+    else
+    {
+        clientThreads.push_back(boost::make_shared<boost::thread>(boost::bind(&Dummy::readSocketWorker, this, client)));
+        clientThreads.push_back(boost::make_shared<boost::thread>(boost::bind(&Dummy::writeSocketWorker, this, client)));
+    }
+
+    mutexClients.unlock();
 }
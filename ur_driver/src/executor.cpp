@@ -0,0 +1,183 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Thread pool which runs the I/O and the periodic work of several drivers
+// ----------------------------------------------------------------------------
+
+#include <executor.h>
+#include <ros/ros.h>
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+
+using namespace ur_driver;
+
+//=================================================================
+// Executor
+//=================================================================
+Executor::Executor(int threads) :
+    work(new boost::asio::io_service::work(io)),
+    threadCount((threads > 0) ? threads : std::max(boost::thread::hardware_concurrency(), 1u))
+{
+    for (int i = 0; i < threadCount; i++)
+    {
+        this->threads.create_thread(boost::bind(&Executor::runWorker, this));
+    }
+
+    ROS_DEBUG_NAMED("executor", "executor started with %i threads", threadCount);
+}
+
+Executor::~Executor()
+{
+    work.reset();
+    threads.join_all();
+
+    ROS_DEBUG_NAMED("executor", "executor stopped");
+}
+
+void Executor::runWorker()
+{
+    io.run();
+}
+
+boost::asio::io_service& Executor::getIoService()
+{
+    return io;
+}
+
+int Executor::getThreadCount()
+{
+    return threadCount;
+}
+
+boost::shared_ptr<Executor> Executor::getShared(int threads)
+{
+    static boost::mutex mutexShared;
+    static boost::weak_ptr<Executor> shared;
+
+    boost::lock_guard<boost::mutex> lock(mutexShared);
+
+    boost::shared_ptr<Executor> executor = shared.lock();
+    if (!executor)
+    {
+        executor.reset(new Executor(threads));
+        shared = executor;
+    }
+
+    return executor;
+}
+
+//=================================================================
+// PeriodicTask
+//=================================================================
+class PeriodicTask::State
+{
+    public:
+        State(boost::asio::io_service& io, double frequency, const boost::function<void()>& step) :
+            timer(io),
+            period((boost::asio::steady_timer::duration::rep)(boost::asio::steady_timer::duration::period::den / (boost::asio::steady_timer::duration::period::num * frequency))),
+            step(step),
+            isRunning(false),
+            isExecuting(false),
+            generation(0)
+        {
+        }
+
+        boost::asio::steady_timer timer;
+        boost::asio::steady_timer::duration period;
+        boost::function<void()> step;
+
+        boost::mutex mutexState;
+        boost::condition_variable condition;
+        bool isRunning;
+        bool isExecuting;
+        boost::thread::id executingThread;
+        unsigned long generation; // a handler of a previous start is ignored
+};
+
+PeriodicTask::PeriodicTask(Executor* executor, double frequency, const boost::function<void()>& step) :
+    state(new State(executor->getIoService(), frequency, step))
+{
+
+}
+
+PeriodicTask::~PeriodicTask()
+{
+    stop();
+}
+
+void PeriodicTask::start()
+{
+    boost::lock_guard<boost::mutex> lock(state->mutexState);
+
+    if (state->isRunning)
+    {
+        return;
+    }
+
+    state->isRunning = true;
+    state->generation++;
+    state->timer.expires_from_now(state->period);
+    state->timer.async_wait(boost::bind(&PeriodicTask::handleTimer, state, state->generation, boost::asio::placeholders::error));
+}
+
+void PeriodicTask::stop()
+{
+    boost::unique_lock<boost::mutex> lock(state->mutexState);
+
+    state->isRunning = false;
+
+    boost::system::error_code error;
+    state->timer.cancel(error);
+
+    while (state->isExecuting && state->executingThread != boost::this_thread::get_id())
+    {
+        state->condition.wait(lock);
+    }
+}
+
+void PeriodicTask::handleTimer(boost::shared_ptr<State> state, unsigned long generation, const boost::system::error_code& error)
+{
+    {
+        boost::lock_guard<boost::mutex> lock(state->mutexState);
+
+        if (!state->isRunning || error || generation != state->generation)
+        {
+            return;
+        }
+
+        state->isExecuting = true;
+        state->executingThread = boost::this_thread::get_id();
+    }
+
+    state->step();
+
+    boost::lock_guard<boost::mutex> lock(state->mutexState);
+
+    state->isExecuting = false;
+    state->condition.notify_all();
+
+    if (!state->isRunning || generation != state->generation)
+    {
+        return;
+    }
+
+    //skip the missed cycles
+    boost::asio::steady_timer::time_point next = state->timer.expires_at() + state->period;
+    boost::asio::steady_timer::time_point now = boost::asio::steady_timer::clock_type::now();
+    state->timer.expires_at((next < now) ? now : next);
+    state->timer.async_wait(boost::bind(&PeriodicTask::handleTimer, state, generation, boost::asio::placeholders::error));
+}
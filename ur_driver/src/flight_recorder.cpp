@@ -0,0 +1,337 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Flight recorder for the raw data exchanged with the robot controller
+// ----------------------------------------------------------------------------
+
+#include <flight_recorder.h>
+#include <ros/ros.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#include <fstream>
+#include <algorithm>
+#include <iterator>
+
+using namespace ur_driver;
+
+static const char FILE_MAGIC[8] = {'U', 'R', 'F', 'L', 'T', 'R', 'E', 'C'};
+static const uint32_t FILE_VERSION = 1;
+static const uint32_t RECORD_MAGIC = 0x31434552;
+
+//=================================================================
+// FlightRecorder
+//=================================================================
+FlightRecorder::FlightRecorder() :
+    fileDescriptor(-1),
+    memory(NULL),
+    mappedSize(0),
+    header(NULL),
+    ring(NULL)
+{
+
+}
+
+FlightRecorder::~FlightRecorder()
+{
+    close();
+}
+
+bool FlightRecorder::open(const std::string& fileName, uint64_t capacity)
+{
+    boost::lock_guard<boost::mutex> lock(mutexRecord);
+
+    if (memory != NULL)
+    {
+        ROS_WARN_NAMED("flight_recorder", "flight recorder is already open");
+
+        return false;
+    }
+
+    capacity = capacity & ~((uint64_t)7);
+    if (capacity < flightRecorderRecordSize(0))
+    {
+        ROS_ERROR_NAMED("flight_recorder", "flight recorder capacity %lu is too small", (unsigned long)capacity);
+
+        return false;
+    }
+
+    fileDescriptor = ::open(fileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fileDescriptor < 0)
+    {
+        ROS_ERROR_NAMED("flight_recorder", "could not create flight recorder file %s: %s", fileName.c_str(), strerror(errno));
+
+        return false;
+    }
+
+    mappedSize = sizeof(FlightRecorderFileHeader) + capacity;
+    if (ftruncate(fileDescriptor, mappedSize) != 0)
+    {
+        ROS_ERROR_NAMED("flight_recorder", "could not resize flight recorder file %s: %s", fileName.c_str(), strerror(errno));
+        ::close(fileDescriptor);
+        fileDescriptor = -1;
+
+        return false;
+    }
+
+    void* address = mmap(NULL, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+    if (address == MAP_FAILED)
+    {
+        ROS_ERROR_NAMED("flight_recorder", "could not map flight recorder file %s: %s", fileName.c_str(), strerror(errno));
+        ::close(fileDescriptor);
+        fileDescriptor = -1;
+
+        return false;
+    }
+
+    memory = (char*)address;
+    header = (FlightRecorderFileHeader*)memory;
+    ring = memory + sizeof(FlightRecorderFileHeader);
+
+    memcpy(header->magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+    header->version = FILE_VERSION;
+    header->headerSize = sizeof(FlightRecorderFileHeader);
+    header->capacity = capacity;
+    header->headOffset = 0;
+    header->tailOffset = 0;
+    header->usedBytes = 0;
+    header->sequence = 0;
+    header->droppedRecords = 0;
+
+    ROS_INFO_NAMED("flight_recorder", "recording to %s (%lu bytes)", fileName.c_str(), (unsigned long)capacity);
+
+    return true;
+}
+
+void FlightRecorder::close()
+{
+    boost::lock_guard<boost::mutex> lock(mutexRecord);
+
+    if (memory != NULL)
+    {
+        msync(memory, mappedSize, MS_SYNC);
+        munmap(memory, mappedSize);
+        ::close(fileDescriptor);
+
+        fileDescriptor = -1;
+        memory = NULL;
+        header = NULL;
+        ring = NULL;
+    }
+}
+
+bool FlightRecorder::isOpen()
+{
+    return memory != NULL;
+}
+
+void FlightRecorder::record(FlightRecorderRecordHeader::RecordType type, uint16_t source, const char* data, uint32_t length)
+{
+    //timestamp from the vDSO clock, no system call
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    uint64_t size = flightRecorderRecordSize(length);
+
+    boost::lock_guard<boost::mutex> lock(mutexRecord);
+
+    if (memory == NULL)
+    {
+        return;
+    }
+
+    if (size > header->capacity)
+    {
+        header->droppedRecords++;
+
+        return;
+    }
+
+    //wrap around: fill the rest of the ring with a padding record
+    if (header->headOffset + size > header->capacity)
+    {
+        freeUntil(header->capacity);
+
+        uint64_t gap = header->capacity - header->headOffset;
+        if (gap >= sizeof(FlightRecorderRecordHeader))
+        {
+            FlightRecorderRecordHeader* padding = (FlightRecorderRecordHeader*)(ring + header->headOffset);
+            padding->type = FlightRecorderRecordHeader::PADDING;
+            padding->source = 0;
+            padding->length = gap - sizeof(FlightRecorderRecordHeader);
+            padding->reserved = 0;
+            padding->sequence = 0;
+            padding->timestamp = 0;
+            padding->magic = RECORD_MAGIC;
+        }
+
+        header->usedBytes += gap;
+        header->headOffset = 0;
+    }
+
+    freeUntil(header->headOffset + size);
+
+    //write the record, the magic is set last to mark the record as complete
+    FlightRecorderRecordHeader* recordHeader = (FlightRecorderRecordHeader*)(ring + header->headOffset);
+    recordHeader->magic = 0;
+    recordHeader->type = type;
+    recordHeader->source = source;
+    recordHeader->length = length;
+    recordHeader->reserved = 0;
+    recordHeader->sequence = header->sequence;
+    recordHeader->timestamp = (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+    memcpy(ring + header->headOffset + sizeof(FlightRecorderRecordHeader), data, length);
+    __sync_synchronize();
+    recordHeader->magic = RECORD_MAGIC;
+    __sync_synchronize();
+
+    header->headOffset += size;
+    if (header->headOffset == header->capacity)
+    {
+        header->headOffset = 0;
+    }
+    header->usedBytes += size;
+    header->sequence++;
+}
+
+void FlightRecorder::freeUntil(uint64_t end)
+{
+    while (header->usedBytes > 0 && header->tailOffset >= header->headOffset && header->tailOffset < end)
+    {
+        uint64_t size;
+        if (header->capacity - header->tailOffset < sizeof(FlightRecorderRecordHeader))
+        {
+            size = header->capacity - header->tailOffset;
+        }
+        else
+        {
+            size = flightRecorderRecordSize(((FlightRecorderRecordHeader*)(ring + header->tailOffset))->length);
+        }
+
+        header->tailOffset += size;
+        if (header->tailOffset >= header->capacity)
+        {
+            header->tailOffset = 0;
+        }
+        header->usedBytes -= size;
+    }
+
+    if (header->usedBytes == 0)
+    {
+        header->tailOffset = header->headOffset;
+    }
+}
+
+//=================================================================
+// FlightRecorderReader
+//=================================================================
+FlightRecorderReader::FlightRecorderReader() :
+    offset(0),
+    remainingBytes(0)
+{
+
+}
+
+FlightRecorderReader::~FlightRecorderReader()
+{
+
+}
+
+bool FlightRecorderReader::open(const std::string& fileName)
+{
+    std::ifstream stream(fileName.c_str(), std::ios::binary);
+    if (!stream)
+    {
+        return false;
+    }
+
+    file.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+
+    if (file.size() < sizeof(FlightRecorderFileHeader))
+    {
+        return false;
+    }
+
+    memcpy(&header, &file[0], sizeof(FlightRecorderFileHeader));
+
+    if (memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 || header.version != FILE_VERSION ||
+        file.size() < header.headerSize + header.capacity || header.usedBytes > header.capacity)
+    {
+        return false;
+    }
+
+    offset = header.tailOffset;
+    remainingBytes = header.usedBytes;
+
+    return true;
+}
+
+bool FlightRecorderReader::next(FlightRecorderRecord& record)
+{
+    const char* ring = &file[header.headerSize];
+
+    while (remainingBytes > 0)
+    {
+        //gap at the end of the ring which is too small for a padding record
+        if (header.capacity - offset < sizeof(FlightRecorderRecordHeader))
+        {
+            remainingBytes -= std::min(remainingBytes, header.capacity - offset);
+            offset = 0;
+
+            continue;
+        }
+
+        FlightRecorderRecordHeader recordHeader;
+        memcpy(&recordHeader, ring + offset, sizeof(FlightRecorderRecordHeader));
+
+        uint64_t size = flightRecorderRecordSize(recordHeader.length);
+        if (recordHeader.magic != RECORD_MAGIC || size > remainingBytes || offset + size > header.capacity)
+        {
+            //incomplete record
+            remainingBytes = 0;
+
+            return false;
+        }
+
+        const char* data = ring + offset + sizeof(FlightRecorderRecordHeader);
+
+        offset += size;
+        if (offset == header.capacity)
+        {
+            offset = 0;
+        }
+        remainingBytes -= size;
+
+        if (recordHeader.type == FlightRecorderRecordHeader::PADDING)
+        {
+            continue;
+        }
+
+        record.type = (FlightRecorderRecordHeader::RecordType)recordHeader.type;
+        record.source = recordHeader.source;
+        record.sequence = recordHeader.sequence;
+        record.timestamp = recordHeader.timestamp;
+        record.data.assign(data, data + recordHeader.length);
+
+        return true;
+    }
+
+    return false;
+}
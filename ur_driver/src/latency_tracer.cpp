@@ -0,0 +1,348 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Latency tracing of the robot state and of the commands sent to the robot
+// ----------------------------------------------------------------------------
+
+#include <latency_tracer.h>
+
+#include <string.h>
+#include <algorithm>
+
+using namespace ur_driver;
+
+//=================================================================
+// LatencyTrace
+//=================================================================
+LatencyTrace::LatencyTrace() :
+    sequence(0)
+{
+    memset(timestamps, 0, sizeof(timestamps));
+}
+
+//=================================================================
+// LatencyHistogram
+//=================================================================
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+void LatencyHistogram::add(uint64_t latency)
+{
+    buckets[getBucketIndex(latency)]++;
+    count++;
+    sum += latency;
+    if (latency > max)
+    {
+        max = latency;
+    }
+}
+
+void LatencyHistogram::reset()
+{
+    memset(buckets, 0, sizeof(buckets));
+    count = 0;
+    sum = 0;
+    max = 0;
+}
+
+uint64_t LatencyHistogram::getCount() const
+{
+    return count;
+}
+
+double LatencyHistogram::getMean() const
+{
+    return (count > 0) ? (double)sum / count : 0.0;
+}
+
+uint64_t LatencyHistogram::getMax() const
+{
+    return max;
+}
+
+uint64_t LatencyHistogram::getPercentile(double percentile) const
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    uint64_t rank = (uint64_t)(percentile / 100.0 * count + 0.5);
+    if (rank < 1)
+    {
+        rank = 1;
+    }
+
+    uint64_t cumulated = 0;
+    for (int i = 0; i < BUCKET_COUNT; i++)
+    {
+        cumulated += buckets[i];
+        if (cumulated >= rank)
+        {
+            //the bucket bound may be above the largest value
+            uint64_t bound = getBucketUpperBound(i);
+
+            return (bound < max) ? bound : max;
+        }
+    }
+
+    return max;
+}
+
+int LatencyHistogram::getBucketIndex(uint64_t latency)
+{
+    if (latency < 4)
+    {
+        return latency;
+    }
+
+    //power of two and the next two bits
+    int exponent = 63 - __builtin_clzll(latency);
+    int mantissa = (latency >> (exponent - 2)) & 3;
+
+    return exponent * 4 + mantissa - 4;
+}
+
+uint64_t LatencyHistogram::getBucketUpperBound(int index)
+{
+    if (index < 4)
+    {
+        return index;
+    }
+
+    int exponent = (index + 4) / 4;
+    int mantissa = (index + 4) % 4;
+
+    return ((uint64_t)(4 + mantissa + 1) << (exponent - 2)) - 1;
+}
+
+//=================================================================
+// LatencyTracer
+//=================================================================
+LatencyTracer::LatencyTracer() :
+    enabled(false)
+{
+
+}
+
+void LatencyTracer::setEnabled(bool enabled)
+{
+    this->enabled = enabled;
+}
+
+void LatencyTracer::record(const LatencyTrace& trace)
+{
+    for (int i = 0; i < LatencyTrace::STAGE_COUNT; i++)
+    {
+        if (trace.timestamps[i] == 0 || (i > 0 && trace.timestamps[i] < trace.timestamps[i - 1]))
+        {
+            return;
+        }
+    }
+
+    boost::lock_guard<boost::mutex> lock(mutexHistograms);
+
+    histograms[0].add(trace.timestamps[LatencyTrace::PUBLISHED] - trace.timestamps[LatencyTrace::FRAME_READ]);
+    for (int i = 1; i < LatencyTrace::STAGE_COUNT; i++)
+    {
+        histograms[i].add(trace.timestamps[i] - trace.timestamps[i - 1]);
+    }
+}
+
+void LatencyTracer::getHistograms(std::vector<LatencyHistogram>& histograms, bool reset)
+{
+    boost::lock_guard<boost::mutex> lock(mutexHistograms);
+
+    histograms.assign(this->histograms, this->histograms + LatencyTrace::STAGE_COUNT);
+
+    if (reset)
+    {
+        for (int i = 0; i < LatencyTrace::STAGE_COUNT; i++)
+        {
+            this->histograms[i].reset();
+        }
+    }
+}
+
+const char* LatencyTracer::getHistogramName(int index)
+{
+    static const char* names[LatencyTrace::STAGE_COUNT] = {"total", "decode", "notify", "snapshot", "publish"};
+
+    return (index >= 0 && index < LatencyTrace::STAGE_COUNT) ? names[index] : "";
+}
+
+//=================================================================
+// CommandTrace
+//=================================================================
+CommandTrace::CommandTrace() :
+    commandId(-1)
+{
+    memset(timestamps, 0, sizeof(timestamps));
+}
+
+//=================================================================
+// CommandTracer
+//=================================================================
+CommandTracer::CommandTracer() :
+    enabled(false)
+{
+
+}
+
+void CommandTracer::setEnabled(bool enabled)
+{
+    this->enabled = enabled;
+}
+
+void CommandTracer::start(const std::vector<int>& commandIds, uint64_t timestamp, const std::vector<int>& keptCommandIds)
+{
+    boost::lock_guard<boost::mutex> lock(mutexTraces);
+
+    std::map<int, CommandTrace> keptTraces;
+    for (size_t i = 0; i < keptCommandIds.size(); i++)
+    {
+        std::map<int, CommandTrace>::iterator trace = traces.find(keptCommandIds[i]);
+        if (trace != traces.end())
+        {
+            keptTraces.insert(*trace);
+        }
+    }
+    traces.swap(keptTraces);
+
+    for (size_t i = 0; i < commandIds.size(); i++)
+    {
+        CommandTrace& trace = traces[commandIds[i]];
+        trace.commandId = commandIds[i];
+        trace.timestamps[CommandTrace::RECEIVED] = timestamp;
+    }
+}
+
+void CommandTracer::discard(const std::vector<int>& commandIds, const std::vector<int>& keptCommandIds)
+{
+    boost::lock_guard<boost::mutex> lock(mutexTraces);
+
+    for (size_t i = 0; i < commandIds.size(); i++)
+    {
+        if (std::find(keptCommandIds.begin(), keptCommandIds.end(), commandIds[i]) == keptCommandIds.end())
+        {
+            traces.erase(commandIds[i]);
+        }
+    }
+}
+
+void CommandTracer::stamp(const std::vector<int>& commandIds, CommandTrace::Stage stage)
+{
+    uint64_t timestamp = LatencyTracer::now();
+
+    boost::lock_guard<boost::mutex> lock(mutexTraces);
+
+    for (size_t i = 0; i < commandIds.size(); i++)
+    {
+        std::map<int, CommandTrace>::iterator trace = traces.find(commandIds[i]);
+        if (trace != traces.end())
+        {
+            trace->second.timestamps[stage] = timestamp;
+        }
+    }
+}
+
+bool CommandTracer::finish(int commandId, CommandTrace& trace)
+{
+    uint64_t timestamp = LatencyTracer::now();
+
+    boost::lock_guard<boost::mutex> lock(mutexTraces);
+
+    std::map<int, CommandTrace>::iterator iterator = traces.find(commandId);
+    if (iterator == traces.end())
+    {
+        return false;
+    }
+
+    trace = iterator->second;
+    trace.timestamps[CommandTrace::FINISHED] = timestamp;
+    traces.erase(iterator);
+
+    finishedTraces.push_front(trace);
+    if (finishedTraces.size() > FINISHED_TRACE_COUNT)
+    {
+        finishedTraces.pop_back();
+    }
+
+    //only commands which passed all stages are added to the histograms
+    for (int i = 0; i < CommandTrace::STAGE_COUNT; i++)
+    {
+        if (trace.timestamps[i] == 0)
+        {
+            return true;
+        }
+    }
+
+    histograms[0].add(trace.timestamps[CommandTrace::FINISHED] - trace.timestamps[CommandTrace::RECEIVED]);
+    for (int i = 1; i < CommandTrace::STAGE_COUNT; i++)
+    {
+        histograms[i].add(trace.timestamps[i] - trace.timestamps[i - 1]);
+    }
+
+    return true;
+}
+
+bool CommandTracer::getTrace(int commandId, CommandTrace& trace)
+{
+    boost::lock_guard<boost::mutex> lock(mutexTraces);
+
+    std::map<int, CommandTrace>::iterator iterator = traces.find(commandId);
+    if (iterator != traces.end())
+    {
+        trace = iterator->second;
+
+        return true;
+    }
+
+    for (std::deque<CommandTrace>::iterator finished = finishedTraces.begin(); finished != finishedTraces.end(); ++finished)
+    {
+        if (finished->commandId == commandId)
+        {
+            trace = *finished;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void CommandTracer::getHistograms(std::vector<LatencyHistogram>& histograms, bool reset)
+{
+    boost::lock_guard<boost::mutex> lock(mutexTraces);
+
+    histograms.assign(this->histograms, this->histograms + CommandTrace::STAGE_COUNT);
+
+    if (reset)
+    {
+        for (int i = 0; i < CommandTrace::STAGE_COUNT; i++)
+        {
+            this->histograms[i].reset();
+        }
+    }
+}
+
+const char* CommandTracer::getHistogramName(int index)
+{
+    static const char* names[CommandTrace::STAGE_COUNT] = {"total", "processing", "queue", "write", "robot"};
+
+    return (index >= 0 && index < CommandTrace::STAGE_COUNT) ? names[index] : "";
+}
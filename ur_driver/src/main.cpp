@@ -16,14 +16,34 @@
 
 #include <driver.h>
 
+#include <vector>
+#include <boost/smart_ptr.hpp>
+
 using namespace ur_driver;
 
 int main(int argc, char **argv)
 {
     ros::init(argc, argv, "ur_driver");
 
-    Driver* driver = new Driver();
-    driver->spin();
+    ros::NodeHandle nodeHandle;
+
+    //namespaces of the robots which are driven by this process, each with its own configuration (empty: one robot)
+    std::vector<std::string> robots;
+    nodeHandle.param("robots", robots, std::vector<std::string>());
+
+    std::vector<boost::shared_ptr<Driver> > drivers;
+    if (robots.empty())
+    {
+        drivers.push_back(boost::make_shared<Driver>(nodeHandle));
+    }
+    for (size_t i = 0; i < robots.size(); i++)
+    {
+        ROS_INFO_NAMED("driver", "start driver of robot %s", robots[i].c_str());
+        drivers.push_back(boost::make_shared<Driver>(ros::NodeHandle(nodeHandle, robots[i])));
+    }
+
+    //the drivers share the global callback queue, one spinner serves all of them
+    drivers[0]->spin();
 
     return 0;
 }
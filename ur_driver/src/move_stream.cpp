@@ -0,0 +1,398 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Move stream to the move program on the robot controller
+// ----------------------------------------------------------------------------
+
+#include <move_stream.h>
+#include <ros/ros.h>
+
+#include <string.h>
+#include <endian.h>
+
+#include <boost/bind.hpp>
+#include <algorithm>
+
+using namespace ur_driver;
+using boost::asio::ip::tcp;
+
+//=================================================================
+// StreamedMove
+//=================================================================
+StreamedMove::StreamedMove() :
+    type(MOVE_IDLE),
+    acceleration(0),
+    velocity(0),
+    radius(0),
+    commandId(-1)
+{
+    std::fill(target, target + 6, 0.0);
+}
+
+//=================================================================
+// MoveStreamServer
+//=================================================================
+MoveStreamServer::MoveStreamServer() :
+    isRunning(false),
+    clock(Clock::getWallClock()),
+    port(50003),
+    timeout(0.1),
+    keepaliveTimer(io),
+    commandTracer(NULL),
+    sequence(0),
+    isProgramWaiting(false)
+{
+
+}
+
+MoveStreamServer::~MoveStreamServer()
+{
+    stop();
+}
+
+void MoveStreamServer::start(int port)
+{
+    boost::lock_guard<boost::mutex> lock(mutexStartStop);
+
+    if (isRunning)
+    {
+        return;
+    }
+
+    ROS_DEBUG_NAMED("moves", "start move stream server on port %i", port);
+
+    this->port = port;
+    acceptThread = boost::thread(&MoveStreamServer::acceptWorker, this);
+
+    isRunning = true;
+}
+
+void MoveStreamServer::stop()
+{
+    boost::lock_guard<boost::mutex> lock(mutexStartStop);
+
+    if (!isRunning)
+    {
+        return;
+    }
+
+    ROS_DEBUG_NAMED("moves", "stop move stream server");
+
+    //let the program on the controller stop the robot
+    {
+        boost::lock_guard<boost::mutex> streamLock(mutexStream);
+        queuedMoves.clear();
+        writeMove(true);
+    }
+
+    io.stop();
+    acceptThread.join();
+    io.reset();
+
+    boost::lock_guard<boost::mutex> streamLock(mutexStream);
+    if (transport)
+    {
+        transport->close();
+        transport.reset();
+    }
+
+    isRunning = false;
+}
+
+void MoveStreamServer::setClock(Clock* clock)
+{
+    this->clock = clock;
+}
+
+void MoveStreamServer::setTimeout(double timeout)
+{
+    this->timeout = timeout;
+}
+
+void MoveStreamServer::setCommandTracer(CommandTracer* commandTracer)
+{
+    this->commandTracer = commandTracer;
+}
+
+size_t MoveStreamServer::replace(const std::vector<StreamedMove>& moves)
+{
+    boost::lock_guard<boost::mutex> lock(mutexStream);
+
+    size_t replaced = queuedMoves.size();
+    queueMoves(moves);
+
+    return replaced;
+}
+
+size_t MoveStreamServer::replace(const std::vector<StreamedMove>& moves, size_t queued)
+{
+    boost::lock_guard<boost::mutex> lock(mutexStream);
+
+    //the program took moves after they were counted, the caller checks the new moves again
+    if (queuedMoves.size() != queued)
+    {
+        return queuedMoves.size();
+    }
+    queueMoves(moves);
+
+    return queued;
+}
+
+void MoveStreamServer::queueMoves(const std::vector<StreamedMove>& moves)
+{
+    queuedMoves.assign(moves.begin(), moves.end());
+
+    //a waiting program gets the first move at once
+    if (isProgramWaiting && !queuedMoves.empty())
+    {
+        isProgramWaiting = false;
+        writeMove(false);
+    }
+}
+
+size_t MoveStreamServer::getQueuedCount()
+{
+    boost::lock_guard<boost::mutex> lock(mutexStream);
+
+    return queuedMoves.size();
+}
+
+bool MoveStreamServer::isConnected()
+{
+    boost::lock_guard<boost::mutex> lock(mutexStream);
+
+    return transport && transport->isOpen();
+}
+
+void MoveStreamServer::encodeMove(const StreamedMove& move, int sequence, char* frame)
+{
+    int32_t values[11];
+    values[0] = htobe32(move.type);
+    values[1] = htobe32(sequence);
+    for (int i = 0; i < 6; i++)
+    {
+        values[i + 2] = htobe32((int32_t)lround(move.target[i] * MOVE_SCALE));
+    }
+    values[8] = htobe32((int32_t)lround(move.acceleration * MOVE_SCALE));
+    values[9] = htobe32((int32_t)lround(move.velocity * MOVE_SCALE));
+    values[10] = htobe32((int32_t)lround(move.radius * MOVE_SCALE));
+
+    memcpy(frame, values, MOVE_FRAME_SIZE);
+}
+
+int MoveStreamServer::decodeMove(const char* frame, StreamedMove& move)
+{
+    int32_t values[11];
+    memcpy(values, frame, MOVE_FRAME_SIZE);
+
+    move.type = (int32_t)be32toh(values[0]);
+    for (int i = 0; i < 6; i++)
+    {
+        move.target[i] = (int32_t)be32toh(values[i + 2]) / MOVE_SCALE;
+    }
+    move.acceleration = (int32_t)be32toh(values[8]) / MOVE_SCALE;
+    move.velocity = (int32_t)be32toh(values[9]) / MOVE_SCALE;
+    move.radius = (int32_t)be32toh(values[10]) / MOVE_SCALE;
+
+    return (int32_t)be32toh(values[1]);
+}
+
+void MoveStreamServer::encodeAck(int sequence, char* ack)
+{
+    int32_t value = htobe32(sequence);
+    memcpy(ack, &value, MOVE_ACK_SIZE);
+}
+
+int MoveStreamServer::decodeAck(const char* ack)
+{
+    int32_t value;
+    memcpy(&value, ack, MOVE_ACK_SIZE);
+
+    return (int32_t)be32toh(value);
+}
+
+void MoveStreamServer::acceptWorker()
+{
+    try
+    {
+        tcp::acceptor acceptor(io, tcp::endpoint(tcp::v4(), port));
+
+        boost::shared_ptr<TcpTransport> transport(new TcpTransport(io));
+        acceptor.async_accept(transport->getSocket(), boost::bind(&MoveStreamServer::handleAccept, this, boost::asio::placeholders::error, transport, boost::ref(acceptor)));
+        startKeepalive();
+
+        io.run();
+    }
+    catch (std::exception& e)
+    {
+        ROS_ERROR_NAMED("moves", "move stream server error: %s", e.what());
+    }
+
+    ROS_DEBUG_NAMED("moves", "exit move stream accept thread");
+}
+
+void MoveStreamServer::handleAccept(const boost::system::error_code& error, boost::shared_ptr<TcpTransport> transport, boost::asio::ip::tcp::acceptor& acceptor)
+{
+    if (error)
+    {
+        return;
+    }
+
+    ROS_INFO_NAMED("moves", "move program connected");
+
+    //each frame is answered immediately
+    transport->setNoDelay(true);
+
+    {
+        boost::lock_guard<boost::mutex> lock(mutexStream);
+        if (this->transport)
+        {
+            this->transport->close();
+        }
+        this->transport = transport;
+        sequence = 0;
+        ackBuffer.clear();
+
+        //the program waits for the first frame
+        isProgramWaiting = queuedMoves.empty();
+        if (!isProgramWaiting)
+        {
+            writeMove(false);
+        }
+    }
+
+    transport->asyncRead(ackData, sizeof(ackData), boost::bind(&MoveStreamServer::handleAck, this, transport, _1, _2));
+
+    boost::shared_ptr<TcpTransport> nextTransport(new TcpTransport(io));
+    acceptor.async_accept(nextTransport->getSocket(), boost::bind(&MoveStreamServer::handleAccept, this, boost::asio::placeholders::error, nextTransport, boost::ref(acceptor)));
+}
+
+void MoveStreamServer::handleAck(boost::shared_ptr<TcpTransport> transport, const boost::system::error_code& error, size_t length)
+{
+    clock->addInFlight(-(long)length);
+
+    boost::lock_guard<boost::mutex> lock(mutexStream);
+
+    //the connection was replaced
+    if (transport != this->transport)
+    {
+        return;
+    }
+
+    //the program ended
+    if (error)
+    {
+        ROS_INFO_NAMED("moves", "move program disconnected: %s", error.message().c_str());
+        transport->close();
+        this->transport.reset();
+
+        return;
+    }
+
+    //one frame per acknowledgement, the acknowledged frame is executed by now. Without a queued move the program waits
+    //in its read, there is no exchange per controller cycle
+    ackBuffer.append(ackData, length);
+    size_t offset = 0;
+    for (; ackBuffer.size() - offset >= MOVE_ACK_SIZE && this->transport; offset += MOVE_ACK_SIZE)
+    {
+        isProgramWaiting = queuedMoves.empty();
+        if (!isProgramWaiting)
+        {
+            writeMove(false);
+        }
+    }
+    ackBuffer.erase(0, offset);
+
+    if (this->transport)
+    {
+        transport->asyncRead(ackData, sizeof(ackData), boost::bind(&MoveStreamServer::handleAck, this, transport, _1, _2));
+    }
+}
+
+void MoveStreamServer::startKeepalive()
+{
+    typedef boost::asio::steady_timer::duration Duration;
+    keepaliveTimer.expires_from_now(Duration((Duration::rep)(0.5 * timeout * Duration::period::den / Duration::period::num)));
+    keepaliveTimer.async_wait(boost::bind(&MoveStreamServer::handleKeepalive, this, boost::asio::placeholders::error));
+}
+
+void MoveStreamServer::handleKeepalive(const boost::system::error_code& error)
+{
+    if (error)
+    {
+        return;
+    }
+
+    {
+        boost::lock_guard<boost::mutex> lock(mutexStream);
+
+        if (transport && isProgramWaiting)
+        {
+            isProgramWaiting = false;
+            writeMove(false);
+        }
+    }
+
+    startKeepalive();
+}
+
+void MoveStreamServer::writeMove(bool isStop)
+{
+    if (!transport)
+    {
+        return;
+    }
+
+    StreamedMove move;
+    move.type = isStop ? MOVE_STOP : MOVE_IDLE;
+    if (!isStop && !queuedMoves.empty())
+    {
+        move = queuedMoves.front();
+        queuedMoves.pop_front();
+    }
+
+    char frame[MOVE_FRAME_SIZE];
+    encodeMove(move, sequence++, frame);
+
+    std::vector<int> commandIds;
+    if (commandTracer != NULL && move.commandId >= 0)
+    {
+        commandIds.push_back(move.commandId);
+        commandTracer->stamp(commandIds, CommandTrace::DEQUEUED);
+    }
+
+    boost::system::error_code error;
+    clock->addInFlight(MOVE_FRAME_SIZE);
+    size_t length = transport->write(frame, MOVE_FRAME_SIZE, error);
+    clock->addInFlight(-(long)(MOVE_FRAME_SIZE - length));
+
+    if (commandTracer != NULL && !error)
+    {
+        commandTracer->stamp(commandIds, CommandTrace::WRITTEN);
+    }
+
+    if (error)
+    {
+        ROS_WARN_NAMED("moves", "move program disconnected: %s", error.message().c_str());
+        transport->close();
+        transport.reset();
+
+        //a move which could not be sent is not lost
+        if (move.type != MOVE_IDLE && move.type != MOVE_STOP)
+        {
+            queuedMoves.push_front(move);
+        }
+    }
+}
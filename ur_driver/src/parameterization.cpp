@@ -0,0 +1,540 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Time optimal parameterization of joint waypoint paths
+// ----------------------------------------------------------------------------
+
+#include <parameterization.h>
+
+#include <math.h>
+#include <limits>
+#include <algorithm>
+
+using namespace ur_driver;
+
+/**
+ * Joint direction components below this are treated as 0.
+ */
+static const double PATH_EPSILON = 1e-9;
+
+/**
+ * Largest angle [rad] by which the tangent turns within one grid interval of an arc.
+ */
+static const double ARC_STEP = 0.02;
+
+//=================================================================
+// PathElement
+//=================================================================
+PathElement::PathElement() :
+    length(0),
+    radius(0)
+{
+    std::fill(start, start + 6, 0.0);
+    std::fill(x, x + 6, 0.0);
+    std::fill(y, y + 6, 0.0);
+}
+
+void PathElement::evaluate(double s, double* position, double* tangent, double* curvature) const
+{
+    if (radius <= 0)
+    {
+        for (int j = 0; j < 6; j++)
+        {
+            position[j] = start[j] + s * y[j];
+            if (tangent)
+            {
+                tangent[j] = y[j];
+            }
+            if (curvature)
+            {
+                curvature[j] = 0;
+            }
+        }
+
+        return;
+    }
+
+    double angle = s / radius;
+    double c = cos(angle);
+    double d = sin(angle);
+    for (int j = 0; j < 6; j++)
+    {
+        position[j] = start[j] + radius * (x[j] * c + y[j] * d);
+        if (tangent)
+        {
+            tangent[j] = -x[j] * d + y[j] * c;
+        }
+        if (curvature)
+        {
+            curvature[j] = -(x[j] * c + y[j] * d) / radius;
+        }
+    }
+}
+
+//=================================================================
+// PathParameterization
+//=================================================================
+PathParameterization::PathParameterization() :
+    hasLimits(false),
+    step(0.001)
+{
+    std::fill(maxVelocity, maxVelocity + 6, 0.0);
+    std::fill(maxAcceleration, maxAcceleration + 6, 0.0);
+}
+
+void PathParameterization::setLimits(const std::vector<double>& maxVelocity, const std::vector<double>& maxAcceleration)
+{
+    hasLimits = maxVelocity.size() >= 6 && maxAcceleration.size() >= 6;
+    for (int j = 0; hasLimits && j < 6; j++)
+    {
+        this->maxVelocity[j] = maxVelocity[j];
+        this->maxAcceleration[j] = maxAcceleration[j];
+        hasLimits = maxVelocity[j] > 0 && maxAcceleration[j] > 0;
+    }
+}
+
+void PathParameterization::setStep(double step)
+{
+    this->step = std::max(step, 1e-6);
+}
+
+bool PathParameterization::compute(const std::vector<double>& waypoints, const std::vector<double>& deviations)
+{
+    gridPositions.clear();
+    gridElements.clear();
+    gridVelocities.clear();
+    gridTimes.clear();
+
+    std::vector<double> stops;
+    buildPath(waypoints, deviations, stops);
+    if (!hasLimits || elements.empty())
+    {
+        return false;
+    }
+
+    //each element is divided into intervals of at most the step, on an arc the tangent turns by at most ARC_STEP
+    for (size_t e = 0; e < elements.size(); e++)
+    {
+        double elementStep = (elements[e].radius > 0) ? std::min(step, elements[e].radius * ARC_STEP) : step;
+        size_t intervals = std::max((size_t)1, (size_t)ceil(elements[e].length / elementStep));
+        for (size_t k = 0; k < intervals; k++)
+        {
+            gridPositions.push_back(elementStarts[e] + elements[e].length * k / intervals);
+            gridElements.push_back(e);
+        }
+    }
+    gridPositions.push_back(getLength());
+    gridElements.push_back(elements.size() - 1);
+
+    size_t count = gridPositions.size();
+    double position[6];
+    double tangent[6];
+    double curvature[6];
+
+    //largest squared path velocity of each point, a point between two elements is limited by both
+    std::vector<double> limits(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t e = gridElements[i];
+        elements[e].evaluate(gridPositions[i] - elementStarts[e], position, tangent, curvature);
+        limits[i] = getMaximumVelocity(tangent, curvature);
+
+        if (i > 0 && gridElements[i - 1] != e)
+        {
+            e = gridElements[i - 1];
+            elements[e].evaluate(elements[e].length, position, tangent, curvature);
+            limits[i] = std::min(limits[i], getMaximumVelocity(tangent, curvature));
+        }
+    }
+
+    limits[0] = 0;
+    limits[count - 1] = 0;
+    for (size_t k = 0; k < stops.size(); k++)
+    {
+        size_t i = std::lower_bound(gridPositions.begin(), gridPositions.end(), stops[k] - step * 1e-6) - gridPositions.begin();
+        limits[std::min(i, count - 1)] = 0;
+    }
+
+    //backward pass: the largest velocity from which the next point can be reached within the limits, the forward pass
+    //below it always finds a valid acceleration
+    std::vector<double> reachable(count, 0.0);
+    double endTangent[6];
+    double endCurvature[6];
+    double startTangent[6];
+    for (size_t i = count - 1; i > 0; i--)
+    {
+        size_t e = gridElements[i - 1];
+        double distance = gridPositions[i] - gridPositions[i - 1];
+        elements[e].evaluate(gridPositions[i - 1] - elementStarts[e], position, tangent, curvature);
+        elements[e].evaluate(gridPositions[i] - elementStarts[e], position, endTangent, endCurvature);
+
+        //the strongest deceleration which ends at the next limit: at the start t * u + c * (x1 - 2 * d * u) has to be
+        //within the limits
+        for (int j = 0; j < 6; j++)
+        {
+            startTangent[j] = tangent[j] - 2 * distance * curvature[j];
+        }
+
+        double startMinimum, startMaximum, endMinimum, endMaximum;
+        getAccelerationRange(startTangent, curvature, reachable[i], startMinimum, startMaximum);
+        getAccelerationRange(endTangent, endCurvature, reachable[i], endMinimum, endMaximum);
+        double velocity = std::max(0.0, std::min(limits[i - 1], reachable[i] - 2 * distance * std::max(startMinimum, endMinimum)));
+
+        //otherwise the largest velocity is lower, the valid velocities are an interval from 0
+        if (!isIntervalValid(tangent, curvature, endTangent, endCurvature, distance, velocity, reachable[i]))
+        {
+            double lower = 0;
+            for (int k = 0; k < 40; k++)
+            {
+                double middle = (lower + velocity) / 2;
+                if (isIntervalValid(tangent, curvature, endTangent, endCurvature, distance, middle, reachable[i]))
+                {
+                    lower = middle;
+                }
+                else
+                {
+                    velocity = middle;
+                }
+            }
+            velocity = lower;
+        }
+
+        reachable[i - 1] = velocity;
+    }
+
+    //forward pass: the strongest acceleration below the backward limit
+    gridVelocities.assign(count, 0.0);
+    for (size_t i = 0; i + 1 < count; i++)
+    {
+        size_t e = gridElements[i];
+        double distance = gridPositions[i + 1] - gridPositions[i];
+        elements[e].evaluate(gridPositions[i] - elementStarts[e], position, tangent, curvature);
+        elements[e].evaluate(gridPositions[i + 1] - elementStarts[e], position, endTangent, endCurvature);
+
+        double minimum, maximum;
+        getIntervalRange(tangent, curvature, endTangent, endCurvature, distance, gridVelocities[i], minimum, maximum);
+        gridVelocities[i + 1] = std::max(0.0, std::min(reachable[i + 1], gridVelocities[i] + 2 * distance * maximum));
+    }
+
+    //constant path acceleration in each interval
+    gridTimes.assign(count, 0.0);
+    for (size_t i = 0; i + 1 < count; i++)
+    {
+        double velocity = sqrt(gridVelocities[i]) + sqrt(gridVelocities[i + 1]);
+        if (velocity <= 0)
+        {
+            gridTimes.clear();
+
+            return false;
+        }
+        gridTimes[i + 1] = gridTimes[i] + 2 * (gridPositions[i + 1] - gridPositions[i]) / velocity;
+    }
+
+    return true;
+}
+
+double PathParameterization::getDuration() const
+{
+    return gridTimes.empty() ? 0.0 : gridTimes.back();
+}
+
+double PathParameterization::getLength() const
+{
+    return elements.empty() ? 0.0 : elementStarts.back() + elements.back().length;
+}
+
+void PathParameterization::sample(double time, double* position, double* velocity, double* acceleration) const
+{
+    if (gridTimes.size() < 2)
+    {
+        return;
+    }
+
+    time = std::max(0.0, std::min(time, gridTimes.back()));
+    size_t i = std::upper_bound(gridTimes.begin(), gridTimes.end(), time) - gridTimes.begin();
+    i = std::min(std::max(i, (size_t)1), gridTimes.size() - 1) - 1;
+
+    double distance = gridPositions[i + 1] - gridPositions[i];
+    double pathAcceleration = (gridVelocities[i + 1] - gridVelocities[i]) / (2 * distance);
+    double t = time - gridTimes[i];
+    double pathVelocity = std::max(0.0, sqrt(gridVelocities[i]) + pathAcceleration * t);
+    double s = std::min(gridPositions[i] + sqrt(gridVelocities[i]) * t + pathAcceleration * t * t / 2, gridPositions[i + 1]);
+
+    size_t e = gridElements[i];
+    double tangent[6];
+    double curvature[6];
+    elements[e].evaluate(s - elementStarts[e], position, tangent, curvature);
+
+    for (int j = 0; j < 6; j++)
+    {
+        if (velocity)
+        {
+            velocity[j] = tangent[j] * pathVelocity;
+        }
+        if (acceleration)
+        {
+            acceleration[j] = tangent[j] * pathAcceleration + curvature[j] * pathVelocity * pathVelocity;
+        }
+    }
+}
+
+void PathParameterization::getPoints(double interval, std::vector<double>& times, std::vector<double>& positions, std::vector<double>& velocities, std::vector<double>& accelerations) const
+{
+    times.clear();
+    positions.clear();
+    velocities.clear();
+    accelerations.clear();
+
+    double duration = getDuration();
+    size_t count = (size_t)ceil(duration / interval) + 1;
+    times.resize(count);
+    positions.resize(count * 6);
+    velocities.resize(count * 6);
+    accelerations.resize(count * 6);
+    for (size_t i = 0; i < count; i++)
+    {
+        times[i] = std::min(i * interval, duration);
+        sample(times[i], &positions[i * 6], &velocities[i * 6], &accelerations[i * 6]);
+    }
+
+    //the last interval can be shorter, but not empty
+    if (count > 2 && times[count - 1] - times[count - 2] < interval * 1e-3)
+    {
+        times.erase(times.end() - 2);
+        positions.erase(positions.end() - 12, positions.end() - 6);
+        velocities.erase(velocities.end() - 12, velocities.end() - 6);
+        accelerations.erase(accelerations.end() - 12, accelerations.end() - 6);
+    }
+}
+
+void PathParameterization::buildPath(const std::vector<double>& waypoints, const std::vector<double>& deviations, std::vector<double>& stops)
+{
+    elements.clear();
+    elementStarts.clear();
+
+    //consecutive equal waypoints are one waypoint with the smaller deviation
+    std::vector<double> points;
+    std::vector<double> pointDeviations;
+    for (size_t i = 0; i + 5 < waypoints.size(); i += 6)
+    {
+        double deviation = (i / 6 < deviations.size()) ? deviations[i / 6] : 0.0;
+        double distance = 0;
+        for (int j = 0; j < 6 && !points.empty(); j++)
+        {
+            distance += (waypoints[i + j] - points[points.size() - 6 + j]) * (waypoints[i + j] - points[points.size() - 6 + j]);
+        }
+
+        if (!points.empty() && sqrt(distance) < PATH_EPSILON)
+        {
+            pointDeviations.back() = std::min(pointDeviations.back(), deviation);
+            continue;
+        }
+
+        points.insert(points.end(), waypoints.begin() + i, waypoints.begin() + i + 6);
+        pointDeviations.push_back(deviation);
+    }
+
+    size_t count = pointDeviations.size();
+    if (count < 2)
+    {
+        return;
+    }
+
+    //direction and length of each segment
+    std::vector<double> directions((count - 1) * 6);
+    std::vector<double> lengths(count - 1, 0.0);
+    for (size_t k = 0; k + 1 < count; k++)
+    {
+        for (int j = 0; j < 6; j++)
+        {
+            directions[k * 6 + j] = points[(k + 1) * 6 + j] - points[k * 6 + j];
+            lengths[k] += directions[k * 6 + j] * directions[k * 6 + j];
+        }
+        lengths[k] = sqrt(lengths[k]);
+        for (int j = 0; j < 6; j++)
+        {
+            directions[k * 6 + j] /= lengths[k];
+        }
+    }
+
+    //distance of the arc ends from each inner waypoint: within the deviation and half of the neighbouring segments
+    std::vector<double> blendDistances(count, 0.0);
+    std::vector<double> angles(count, 0.0);
+    for (size_t k = 1; k + 1 < count; k++)
+    {
+        double cosine = 0;
+        for (int j = 0; j < 6; j++)
+        {
+            cosine += directions[(k - 1) * 6 + j] * directions[k * 6 + j];
+        }
+        angles[k] = acos(std::max(-1.0, std::min(cosine, 1.0)));
+
+        if (angles[k] > PATH_EPSILON && pointDeviations[k] > 0 && angles[k] < M_PI - PATH_EPSILON)
+        {
+            double distance = pointDeviations[k] * sin(angles[k] / 2) / (1 - cos(angles[k] / 2));
+            blendDistances[k] = std::min(distance, std::min(lengths[k - 1], lengths[k]) / 2);
+        }
+    }
+
+    double s = 0;
+    for (size_t k = 0; k + 1 < count; k++)
+    {
+        const double* direction = &directions[k * 6];
+
+        PathElement line;
+        line.length = lengths[k] - blendDistances[k] - blendDistances[k + 1];
+        for (int j = 0; j < 6; j++)
+        {
+            line.start[j] = points[k * 6 + j] + blendDistances[k] * direction[j];
+            line.y[j] = direction[j];
+        }
+        if (line.length > PATH_EPSILON)
+        {
+            elements.push_back(line);
+            elementStarts.push_back(s);
+            s += line.length;
+        }
+
+        if (k + 2 >= count)
+        {
+            break;
+        }
+
+        if (blendDistances[k + 1] <= 0)
+        {
+            //a corner without blend is passed at rest, a straight continuation at any velocity
+            if (angles[k + 1] > PATH_EPSILON)
+            {
+                stops.push_back(s);
+            }
+            continue;
+        }
+
+        //arc tangent to both segments, its center lies on the bisector of the corner
+        double radius = blendDistances[k + 1] / tan(angles[k + 1] / 2);
+        double bisector[6];
+        double norm = 0;
+        for (int j = 0; j < 6; j++)
+        {
+            bisector[j] = directions[(k + 1) * 6 + j] - direction[j];
+            norm += bisector[j] * bisector[j];
+        }
+        norm = sqrt(norm);
+
+        PathElement arc;
+        arc.radius = radius;
+        arc.length = radius * angles[k + 1];
+        for (int j = 0; j < 6; j++)
+        {
+            arc.start[j] = points[(k + 1) * 6 + j] + bisector[j] / norm * radius / cos(angles[k + 1] / 2);
+            arc.x[j] = (points[(k + 1) * 6 + j] - blendDistances[k + 1] * direction[j] - arc.start[j]) / radius;
+            arc.y[j] = direction[j];
+        }
+        elements.push_back(arc);
+        elementStarts.push_back(s);
+        s += arc.length;
+    }
+}
+
+void PathParameterization::getAccelerationRange(const double* tangent, const double* curvature, double velocity, double& minimum, double& maximum) const
+{
+    minimum = -std::numeric_limits<double>::infinity();
+    maximum = std::numeric_limits<double>::infinity();
+
+    for (int j = 0; j < 6; j++)
+    {
+        if (fabs(tangent[j]) < PATH_EPSILON)
+        {
+            continue;
+        }
+
+        double lower = (-maxAcceleration[j] - curvature[j] * velocity) / tangent[j];
+        double upper = (maxAcceleration[j] - curvature[j] * velocity) / tangent[j];
+        if (tangent[j] < 0)
+        {
+            std::swap(lower, upper);
+        }
+
+        minimum = std::max(minimum, lower);
+        maximum = std::min(maximum, upper);
+    }
+}
+
+void PathParameterization::getIntervalRange(const double* tangent, const double* curvature, const double* endTangent, const double* endCurvature,
+    double distance, double velocity, double& minimum, double& maximum) const
+{
+    getAccelerationRange(tangent, curvature, velocity, minimum, maximum);
+
+    //at the end t * u + c * (x0 + 2 * d * u) = (t + 2 * d * c) * u + c * x0
+    double combinedTangent[6];
+    for (int j = 0; j < 6; j++)
+    {
+        combinedTangent[j] = endTangent[j] + 2 * distance * endCurvature[j];
+    }
+
+    double endMinimum, endMaximum;
+    getAccelerationRange(combinedTangent, endCurvature, velocity, endMinimum, endMaximum);
+
+    //the velocity at the end can not be negative
+    minimum = std::max(std::max(minimum, endMinimum), -velocity / (2 * distance));
+    maximum = std::min(maximum, endMaximum);
+}
+
+bool PathParameterization::isIntervalValid(const double* tangent, const double* curvature, const double* endTangent, const double* endCurvature,
+    double distance, double velocity, double next) const
+{
+    double minimum, maximum;
+    getIntervalRange(tangent, curvature, endTangent, endCurvature, distance, velocity, minimum, maximum);
+
+    return minimum <= std::min(maximum, (next - velocity) / (2 * distance)) + PATH_EPSILON;
+}
+
+double PathParameterization::getMaximumVelocity(const double* tangent, const double* curvature) const
+{
+    double velocity = std::numeric_limits<double>::infinity();
+
+    for (int j = 0; j < 6; j++)
+    {
+        if (fabs(tangent[j]) < PATH_EPSILON)
+        {
+            //a joint which only turns with the curvature
+            if (fabs(curvature[j]) > PATH_EPSILON)
+            {
+                velocity = std::min(velocity, maxAcceleration[j] / fabs(curvature[j]));
+            }
+            continue;
+        }
+
+        double v = maxVelocity[j] / tangent[j];
+        velocity = std::min(velocity, v * v);
+
+        //the acceleration range of each pair of joints has to overlap
+        for (int k = 0; k < 6; k++)
+        {
+            if (k == j || fabs(tangent[k]) < PATH_EPSILON)
+            {
+                continue;
+            }
+
+            double factor = curvature[k] / tangent[k] - curvature[j] / tangent[j];
+            if (factor > PATH_EPSILON)
+            {
+                velocity = std::min(velocity, (maxAcceleration[k] / fabs(tangent[k]) + maxAcceleration[j] / fabs(tangent[j])) / factor);
+            }
+        }
+    }
+
+    return velocity;
+}
@@ -0,0 +1,167 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Offline replay of recorded robot controller data through the connector
+// ----------------------------------------------------------------------------
+
+#include <replay.h>
+#include <flight_recorder.h>
+
+#include <string.h>
+#include <fstream>
+#include <iterator>
+
+using namespace ur_driver;
+
+Replay::Replay()
+{
+
+}
+
+Replay::~Replay()
+{
+
+}
+
+bool Replay::loadStream(const std::string& fileName, int port)
+{
+    std::ifstream stream(fileName.c_str(), std::ios::binary);
+    if (!stream)
+    {
+        ROS_ERROR_NAMED("replay", "could not open %s", fileName.c_str());
+
+        return false;
+    }
+
+    std::vector<char> data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+    //native rate of the robot controller
+    uint64_t period = (port == Connector::REALTIME) ? 8000000 : 100000000;
+
+    chunks.clear();
+
+    size_t offset = 0;
+    while (offset < data.size())
+    {
+        size_t length = data.size() - offset;
+
+        if (length >= 4)
+        {
+            uint32_t frameSize;
+            memcpy(&frameSize, &data[offset], 4);
+            frameSize = be32toh(frameSize);
+
+            //a valid frame becomes one chunk, corrupt data is passed on as it is
+            if (frameSize > 4 && frameSize <= Connector::MAX_FRAME_SIZE && frameSize <= length)
+            {
+                length = frameSize;
+            }
+        }
+
+        ReplayChunk chunk;
+        chunk.port = port;
+        chunk.timestamp = chunks.size() * period;
+        chunk.data.assign(data.begin() + offset, data.begin() + offset + length);
+        chunks.push_back(chunk);
+
+        offset += length;
+    }
+
+    ROS_INFO_NAMED("replay", "loaded %i frames (%lu bytes) of port %i from %s", (int)chunks.size(), (unsigned long)data.size(), port, fileName.c_str());
+
+    return true;
+}
+
+bool Replay::loadFlightRecord(const std::string& fileName)
+{
+    FlightRecorderReader reader;
+    if (!reader.open(fileName))
+    {
+        ROS_ERROR_NAMED("replay", "%s is not a valid flight recorder file", fileName.c_str());
+
+        return false;
+    }
+
+    chunks.clear();
+
+    uint64_t firstTimestamp = 0;
+    FlightRecorderRecord record;
+    while (reader.next(record))
+    {
+        //frames and the corrupt data between them, in the order they were received
+        if ((record.type != FlightRecorderRecordHeader::FRAME && record.type != FlightRecorderRecordHeader::DISCARDED) || record.data.empty())
+        {
+            continue;
+        }
+
+        if (chunks.empty())
+        {
+            firstTimestamp = record.timestamp;
+        }
+
+        ReplayChunk chunk;
+        chunk.port = record.source;
+        chunk.timestamp = record.timestamp >= firstTimestamp ? record.timestamp - firstTimestamp : 0;
+        chunk.data.swap(record.data);
+        chunks.push_back(chunk);
+    }
+
+    ROS_INFO_NAMED("replay", "loaded %i frames from %s", (int)chunks.size(), fileName.c_str());
+
+    return true;
+}
+
+void Replay::run(Connector& connector, double speed)
+{
+    ros::WallTime start = ros::WallTime::now();
+
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        ReplayChunk& chunk = chunks[i];
+
+        if (speed > 0)
+        {
+            ros::WallTime due = start + ros::WallDuration(chunk.timestamp * 1e-9 / speed);
+            ros::WallTime now = ros::WallTime::now();
+            if (due > now)
+            {
+                (due - now).sleep();
+            }
+        }
+
+        connector.processData(chunk.port, &chunk.data[0], chunk.data.size());
+    }
+}
+
+size_t Replay::getChunkCount()
+{
+    return chunks.size();
+}
+
+uint64_t Replay::getByteCount()
+{
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        bytes += chunks[i].data.size();
+    }
+
+    return bytes;
+}
+
+double Replay::getDuration()
+{
+    return chunks.empty() ? 0.0 : chunks.back().timestamp * 1e-9;
+}
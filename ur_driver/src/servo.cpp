@@ -0,0 +1,430 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Joint setpoint stream to the servo program on the robot controller
+// ----------------------------------------------------------------------------
+
+#include <servo.h>
+#include <ros/ros.h>
+
+#include <string.h>
+#include <endian.h>
+
+#include <boost/bind.hpp>
+#include <algorithm>
+
+using namespace ur_driver;
+using boost::asio::ip::tcp;
+
+//=================================================================
+// ServoStatistics
+//=================================================================
+ServoStatistics::ServoStatistics() :
+    fill(-1),
+    minimumFill(-1),
+    setpoints(0),
+    droppedSetpoints(0),
+    starvedCycles(0)
+{
+
+}
+
+//=================================================================
+// ServoServer
+//=================================================================
+ServoServer::ServoServer() :
+    runWriteThread(false),
+    isRunning(false),
+    clock(Clock::getWallClock()),
+    port(50001),
+    frequency(125),
+    setpoint(6, 0.0),
+    hasSetpoint(false),
+    isFirstCycle(true),
+    bufferDepth(0),
+    sequence(0),
+    reportedFill(0),
+    reportedSequence(-1)
+{
+
+}
+
+ServoServer::~ServoServer()
+{
+    stop();
+}
+
+void ServoServer::start(int port, double frequency)
+{
+    boost::lock_guard<boost::mutex> lock(mutexStartStop);
+
+    if (isRunning)
+    {
+        return;
+    }
+
+    ROS_DEBUG_NAMED("servo", "start servo server on port %i", port);
+
+    this->port = port;
+    this->frequency = frequency;
+
+    acceptThread = boost::thread(&ServoServer::acceptWorker, this);
+
+    //the reports of the unbuffered program pace the stream
+    if (bufferDepth > 0)
+    {
+        runWriteThread = true;
+        clock->addParticipant();
+        writeThread = boost::thread(&ServoServer::writeWorker, this);
+    }
+
+    isRunning = true;
+}
+
+void ServoServer::stop()
+{
+    boost::lock_guard<boost::mutex> lock(mutexStartStop);
+
+    if (!isRunning)
+    {
+        return;
+    }
+
+    ROS_DEBUG_NAMED("servo", "stop servo server");
+
+    runWriteThread = false;
+    if (writeThread.joinable())
+    {
+        writeThread.join();
+    }
+
+    //let the program on the controller stop the robot
+    writeSetpoint(true);
+
+    io.stop();
+    acceptThread.join();
+    io.reset();
+
+    boost::lock_guard<boost::mutex> streamLock(mutexStream);
+    if (transport)
+    {
+        transport->close();
+        transport.reset();
+    }
+
+    isRunning = false;
+}
+
+void ServoServer::setClock(Clock* clock)
+{
+    this->clock = clock;
+}
+
+void ServoServer::setBufferDepth(int depth)
+{
+    this->bufferDepth = std::max(depth, 0);
+}
+
+void ServoServer::setGenerator(const Generator& generator)
+{
+    this->generator = generator;
+}
+
+void ServoServer::setSetpoint(const std::vector<double>& jointPosition)
+{
+    boost::lock_guard<boost::mutex> lock(mutexStream);
+
+    for (size_t i = 0; i < 6 && i < jointPosition.size(); i++)
+    {
+        setpoint[i] = jointPosition[i];
+    }
+    hasSetpoint = true;
+
+    if (bufferDepth > 0)
+    {
+        //setpoints which arrive faster than they are played only add latency, drop the oldest ones
+        pendingSetpoints.push_back(setpoint);
+        if ((int)pendingSetpoints.size() > bufferDepth + SERVO_MAX_BATCH)
+        {
+            pendingSetpoints.pop_front();
+            statistics.droppedSetpoints++;
+        }
+    }
+}
+
+ServoStatistics ServoServer::getStatistics(bool reset)
+{
+    boost::lock_guard<boost::mutex> lock(mutexStream);
+
+    ServoStatistics result = statistics;
+    if (reset)
+    {
+        statistics = ServoStatistics();
+        statistics.fill = result.fill;
+    }
+
+    return result;
+}
+
+bool ServoServer::isConnected()
+{
+    boost::lock_guard<boost::mutex> lock(mutexStream);
+
+    return transport && transport->isOpen();
+}
+
+void ServoServer::encodeSetpoint(const double* jointPosition, int keepalive, int sequence, char* frame)
+{
+    int32_t values[8];
+    values[0] = htobe32(keepalive);
+    values[1] = htobe32(sequence);
+    for (int i = 0; i < 6; i++)
+    {
+        values[i + 2] = htobe32((int32_t)lround(jointPosition[i] * SERVO_SCALE));
+    }
+
+    memcpy(frame, values, SERVO_FRAME_SIZE);
+}
+
+int ServoServer::decodeSetpoint(const char* frame, double* jointPosition, int& sequence)
+{
+    int32_t values[8];
+    memcpy(values, frame, SERVO_FRAME_SIZE);
+
+    sequence = (int32_t)be32toh(values[1]);
+    for (int i = 0; i < 6; i++)
+    {
+        jointPosition[i] = (int32_t)be32toh(values[i + 2]) / SERVO_SCALE;
+    }
+
+    return (int32_t)be32toh(values[0]);
+}
+
+void ServoServer::encodeReport(int fill, int sequence, char* report)
+{
+    int32_t values[2];
+    values[0] = htobe32(fill);
+    values[1] = htobe32(sequence);
+
+    memcpy(report, values, SERVO_REPORT_SIZE);
+}
+
+void ServoServer::decodeReport(const char* report, int& fill, int& sequence)
+{
+    int32_t values[2];
+    memcpy(values, report, SERVO_REPORT_SIZE);
+
+    fill = (int32_t)be32toh(values[0]);
+    sequence = (int32_t)be32toh(values[1]);
+}
+
+void ServoServer::acceptWorker()
+{
+    try
+    {
+        tcp::acceptor acceptor(io, tcp::endpoint(tcp::v4(), port));
+
+        boost::shared_ptr<TcpTransport> transport(new TcpTransport(io));
+        acceptor.async_accept(transport->getSocket(), boost::bind(&ServoServer::handleAccept, this, boost::asio::placeholders::error, transport, boost::ref(acceptor)));
+
+        io.run();
+    }
+    catch (std::exception& e)
+    {
+        ROS_ERROR_NAMED("servo", "servo server error: %s", e.what());
+    }
+
+    ROS_DEBUG_NAMED("servo", "exit servo accept thread");
+}
+
+void ServoServer::handleAccept(const boost::system::error_code& error, boost::shared_ptr<TcpTransport> transport, boost::asio::ip::tcp::acceptor& acceptor)
+{
+    if (error)
+    {
+        return;
+    }
+
+    ROS_INFO_NAMED("servo", "servo program connected");
+
+    //each setpoint is sent immediately
+    transport->setNoDelay(true);
+
+    {
+        boost::lock_guard<boost::mutex> lock(mutexStream);
+        if (this->transport)
+        {
+            this->transport->close();
+        }
+        this->transport = transport;
+
+        //a new program starts with an empty buffer
+        isFirstCycle = true;
+        sequence = 0;
+        reportedFill = 0;
+        reportedSequence = -1;
+        reportBuffer.clear();
+    }
+
+    transport->asyncRead(reportData, sizeof(reportData), boost::bind(&ServoServer::handleReport, this, transport, _1, _2));
+
+    //the unbuffered program waits for the first frame, it requests the next ones
+    if (bufferDepth <= 0)
+    {
+        writeSetpoint(false);
+    }
+
+    boost::shared_ptr<TcpTransport> nextTransport(new TcpTransport(io));
+    acceptor.async_accept(nextTransport->getSocket(), boost::bind(&ServoServer::handleAccept, this, boost::asio::placeholders::error, nextTransport, boost::ref(acceptor)));
+}
+
+void ServoServer::writeWorker()
+{
+    ClockRate rate(clock, frequency);
+
+    while (runWriteThread)
+    {
+        writeSetpoint(false);
+
+        rate.sleep();
+    }
+
+    clock->removeParticipant();
+}
+
+void ServoServer::handleReport(boost::shared_ptr<TcpTransport> transport, const boost::system::error_code& error, size_t length)
+{
+    clock->addInFlight(-(long)length);
+
+    int requests = 0;
+    {
+        boost::lock_guard<boost::mutex> lock(mutexStream);
+
+        //the connection was replaced or closed
+        if (error || transport != this->transport)
+        {
+            return;
+        }
+
+        reportBuffer.append(reportData, length);
+        size_t offset = 0;
+        for (; reportBuffer.size() - offset >= SERVO_REPORT_SIZE; offset += SERVO_REPORT_SIZE)
+        {
+            if (bufferDepth <= 0)
+            {
+                requests++;
+                continue;
+            }
+
+            decodeReport(&reportBuffer[offset], reportedFill, reportedSequence);
+
+            statistics.fill = reportedFill;
+            if (statistics.minimumFill < 0 || reportedFill < statistics.minimumFill)
+            {
+                statistics.minimumFill = reportedFill;
+            }
+            if (reportedFill == 0 && reportedSequence >= 0 && (!pendingSetpoints.empty() || reportedSequence < sequence - 1))
+            {
+                statistics.starvedCycles++;
+            }
+        }
+        reportBuffer.erase(0, offset);
+    }
+
+    //the unbuffered program requests the next frame before it executes the setpoint, one frame per report
+    for (int i = 0; i < requests; i++)
+    {
+        writeSetpoint(false);
+    }
+
+    transport->asyncRead(reportData, sizeof(reportData), boost::bind(&ServoServer::handleReport, this, transport, _1, _2));
+}
+
+void ServoServer::writeSetpoint(bool isStop)
+{
+    boost::lock_guard<boost::mutex> lock(mutexStream);
+
+    if (!transport)
+    {
+        return;
+    }
+
+    char frames[SERVO_MAX_BATCH * SERVO_FRAME_SIZE];
+    size_t size = 0;
+
+    if (bufferDepth > 0 && !isStop)
+    {
+        //fill level of the program: the last report plus the setpoints sent after the report was sent
+        int fill = reportedFill + (sequence - 1 - reportedSequence);
+        int count = std::min(bufferDepth - fill, SERVO_MAX_BATCH);
+
+        //the generator continues after the queued setpoints
+        while (generator && (int)pendingSetpoints.size() < count)
+        {
+            bool isFirst = isFirstCycle;
+            isFirstCycle = false;
+            if (!generator(isFirst, setpoint))
+            {
+                break;
+            }
+            pendingSetpoints.push_back(setpoint);
+        }
+        count = std::min(count, (int)pendingSetpoints.size());
+
+        for (int i = 0; i < count; i++)
+        {
+            encodeSetpoint(&pendingSetpoints.front()[0], SERVO_SETPOINT, sequence++, &frames[size]);
+            pendingSetpoints.pop_front();
+            size += SERVO_FRAME_SIZE;
+        }
+        statistics.setpoints += std::max(count, 0);
+    }
+    else if (!isStop)
+    {
+        //the setpoint of the cycle is computed while the program is connected, otherwise the latest setpoint is sent
+        bool isGenerated = false;
+        if (generator)
+        {
+            bool isFirst = isFirstCycle;
+            isFirstCycle = false;
+            isGenerated = generator(isFirst, setpoint);
+        }
+
+        if (isGenerated || hasSetpoint)
+        {
+            encodeSetpoint(&setpoint[0], SERVO_SETPOINT, sequence++, frames);
+            size = SERVO_FRAME_SIZE;
+            statistics.setpoints++;
+        }
+    }
+
+    //keep the program alive if there is nothing to send
+    if (size == 0)
+    {
+        encodeSetpoint(&setpoint[0], isStop ? SERVO_STOP : SERVO_IDLE, sequence - 1, frames);
+        size = SERVO_FRAME_SIZE;
+    }
+
+    boost::system::error_code error;
+    clock->addInFlight(size);
+    size_t length = transport->write(frames, size, error);
+    clock->addInFlight(-(long)(size - length));
+
+    if (error)
+    {
+        ROS_WARN_NAMED("servo", "servo program disconnected: %s", error.message().c_str());
+        transport->close();
+        transport.reset();
+    }
+}
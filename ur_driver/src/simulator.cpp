@@ -0,0 +1,996 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// Lightweight kinematic robot simulator used by the dummy server
+// ----------------------------------------------------------------------------
+
+#include <simulator.h>
+#include <ros/ros.h>
+
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <math.h>
+#include <algorithm>
+
+using namespace ur_driver;
+
+static const double STEP_SIZE = 0.008;
+static const double MAX_UPDATE = 1.0;
+static const double STOP_ACCELERATION = 2.0;
+
+//=================================================================
+// ScriptInstruction
+//=================================================================
+const ScriptArgument* ScriptInstruction::getArgument(size_t position, const char* keyword) const
+{
+    for (size_t i = 0; i < arguments.size(); i++)
+    {
+        if (arguments[i].keyword == keyword)
+        {
+            return &arguments[i];
+        }
+    }
+
+    //positional arguments precede the keyword arguments
+    if (position < arguments.size() && arguments[position].keyword.empty())
+    {
+        return &arguments[position];
+    }
+
+    return NULL;
+}
+
+double ScriptInstruction::getValue(size_t position, const char* keyword, double defaultValue) const
+{
+    const ScriptArgument* argument = getArgument(position, keyword);
+
+    return (argument != NULL && argument->values.size() > 0) ? argument->values[0] : defaultValue;
+}
+
+//=================================================================
+// ScriptParser
+//=================================================================
+ScriptParser::ScriptParser() :
+    isInDefinition(false),
+    blockDepth(0)
+{
+
+}
+
+void ScriptParser::addData(const char* data, size_t length)
+{
+    buffer.append(data, length);
+
+    size_t lineEnd;
+    while ((lineEnd = buffer.find('\n')) != std::string::npos)
+    {
+        //trim the line
+        std::string line = buffer.substr(0, lineEnd);
+        buffer.erase(0, lineEnd + 1);
+
+        size_t first = line.find_first_not_of(" \t\r");
+        size_t last = line.find_last_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#')
+        {
+            continue;
+        }
+        line = line.substr(first, last - first + 1);
+
+        //first word of the line
+        size_t wordEnd = 0;
+        while (wordEnd < line.size() && (isalnum(line[wordEnd]) || line[wordEnd] == '_')) wordEnd++;
+        std::string word = line.substr(0, wordEnd);
+        size_t next = line.find_first_not_of(" \t", wordEnd);
+        if (next != std::string::npos && line[next] == '[' && line.find(']', next) != std::string::npos)
+        {
+            //assignment to a list element
+            next = line.find_first_not_of(" \t", line.find(']', next) + 1);
+        }
+        bool isAssignment = next != std::string::npos && line[next] == '=' && line.compare(next, 2, "==") != 0;
+
+        if (line.compare(0, 4, "def ") == 0)
+        {
+            size_t nameEnd = line.find('(');
+            definitionName = line.substr(4, (nameEnd == std::string::npos) ? std::string::npos : nameEnd - 4);
+            isInDefinition = true;
+            blockDepth = 0;
+            definition.clear();
+        }
+        else if (isInDefinition && (word == "while" || word == "if" || word == "thread"))
+        {
+            blockDepth++;
+        }
+        else if (isInDefinition && (word == "elif" || word == "else" || isAssignment || word == "global" || word == "local" || word == "kill"))
+        {
+            //not evaluated
+        }
+        else if (line == "end" && blockDepth > 0)
+        {
+            blockDepth--;
+        }
+        else if (line == "end")
+        {
+            //the controller runs a program as soon as it is defined, the following call is ignored
+            if (isInDefinition)
+            {
+                programs.push_back(definition);
+                definition.clear();
+            }
+            isInDefinition = false;
+        }
+        else
+        {
+            ScriptInstruction instruction;
+            if (!parseInstruction(line, instruction))
+            {
+                ROS_WARN_NAMED("dummy", "dummy: syntax error in script line: %s", line.c_str());
+            }
+            else if (isInDefinition)
+            {
+                definition.push_back(instruction);
+            }
+            else if (!instruction.arguments.empty() || instruction.name != definitionName)
+            {
+                programs.push_back(std::vector<ScriptInstruction>(1, instruction));
+            }
+        }
+    }
+}
+
+bool ScriptParser::nextProgram(std::vector<ScriptInstruction>& program)
+{
+    if (programs.empty())
+    {
+        return false;
+    }
+
+    program.swap(programs.front());
+    programs.pop_front();
+
+    return true;
+}
+
+bool ScriptParser::parseInstruction(const std::string& line, ScriptInstruction& instruction)
+{
+    const char* c = line.c_str();
+
+    //function name
+    const char* nameStart = c;
+    while (isalnum(*c) || *c == '_') c++;
+    instruction.name.assign(nameStart, c);
+    instruction.arguments.clear();
+
+    while (isspace(*c)) c++;
+    if (instruction.name.empty() || *c != '(')
+    {
+        return false;
+    }
+    c++;
+
+    while (isspace(*c)) c++;
+    if (*c == ')')
+    {
+        return true;
+    }
+
+    while (true)
+    {
+        ScriptArgument argument;
+        argument.isPose = false;
+
+        while (isspace(*c)) c++;
+
+        //keyword argument
+        const char* keywordStart = c;
+        while (isalnum(*c) || *c == '_') c++;
+        const char* keywordEnd = c;
+        while (isspace(*c)) c++;
+        if (keywordEnd > keywordStart && *c == '=' && *(c + 1) != '=' && !isdigit(*keywordStart))
+        {
+            argument.keyword.assign(keywordStart, keywordEnd);
+            c++;
+            while (isspace(*c)) c++;
+        }
+        else
+        {
+            c = keywordStart;
+        }
+
+        //value
+        if (*c == 'p' && *(c + 1) == '[')
+        {
+            argument.isPose = true;
+            c++;
+        }
+
+        if (*c == '"')
+        {
+            const char* textEnd = strchr(c + 1, '"');
+            if (textEnd == NULL)
+            {
+                return false;
+            }
+            argument.text.assign(c + 1, textEnd);
+            c = textEnd + 1;
+        }
+        else if (isalpha(*c) && strncmp(c, "True", 4) != 0 && strncmp(c, "False", 5) != 0)
+        {
+            //variable
+            const char* nameStart = c;
+            while (isalnum(*c) || *c == '_') c++;
+            argument.text.assign(nameStart, c);
+        }
+        else if (*c == '[')
+        {
+            c++;
+            while (true)
+            {
+                while (isspace(*c)) c++;
+                if (*c == ']')
+                {
+                    c++;
+                    break;
+                }
+
+                char* end;
+                double value = strtod(c, &end);
+                if (end == c)
+                {
+                    return false;
+                }
+                argument.values.push_back(value);
+                c = end;
+
+                while (isspace(*c)) c++;
+                if (*c == ',')
+                {
+                    c++;
+                }
+                else if (*c != ']')
+                {
+                    return false;
+                }
+            }
+        }
+        else if (strncmp(c, "True", 4) == 0)
+        {
+            argument.values.push_back(1.0);
+            c += 4;
+        }
+        else if (strncmp(c, "False", 5) == 0)
+        {
+            argument.values.push_back(0.0);
+            c += 5;
+        }
+        else
+        {
+            char* end;
+            double value = strtod(c, &end);
+            if (end == c)
+            {
+                return false;
+            }
+            argument.values.push_back(value);
+            c = end;
+        }
+
+        instruction.arguments.push_back(argument);
+
+        while (isspace(*c)) c++;
+        if (*c == ',')
+        {
+            c++;
+        }
+        else if (*c == ')')
+        {
+            return true;
+        }
+        else
+        {
+            return false;
+        }
+    }
+}
+
+//=================================================================
+// TrapezoidalProfile
+//=================================================================
+TrapezoidalProfile::TrapezoidalProfile() :
+    length(0),
+    startVelocity(0),
+    peakVelocity(0),
+    acceleration(1),
+    startAcceleration(0),
+    accelerationTime(0),
+    cruiseTime(0),
+    duration(0)
+{
+
+}
+
+void TrapezoidalProfile::plan(double length, double startVelocity, double maxVelocity, double acceleration, double duration)
+{
+    this->length = std::max(length, 0.0);
+    this->acceleration = (acceleration > 0) ? acceleration : 1.0;
+    maxVelocity = (maxVelocity > 0) ? maxVelocity : 1.0;
+
+    double a = this->acceleration;
+    double l = this->length;
+
+    if (duration > 0)
+    {
+        //the fixed duration has priority, the profile starts at rest
+        startVelocity = 0;
+        double discriminant = a * a * duration * duration - 4 * a * l;
+        if (discriminant >= 0)
+        {
+            peakVelocity = (a * duration - sqrt(discriminant)) / 2;
+        }
+        else
+        {
+            //not reachable with the acceleration, use a triangular profile
+            a = 4 * l / (duration * duration);
+            this->acceleration = a;
+            peakVelocity = a * duration / 2;
+        }
+    }
+    else
+    {
+        //the robot must be able to stop within the path
+        startVelocity = std::min(std::max(startVelocity, 0.0), sqrt(2 * a * l));
+
+        peakVelocity = maxVelocity;
+        if ((fabs(peakVelocity * peakVelocity - startVelocity * startVelocity) + peakVelocity * peakVelocity) / (2 * a) > l)
+        {
+            peakVelocity = sqrt((2 * a * l + startVelocity * startVelocity) / 2);
+        }
+    }
+
+    this->startVelocity = startVelocity;
+
+    if (l <= 0 || peakVelocity <= 0)
+    {
+        startAcceleration = 0;
+        accelerationTime = 0;
+        cruiseTime = 0;
+        this->duration = 0;
+
+        return;
+    }
+
+    startAcceleration = (peakVelocity >= startVelocity) ? a : -a;
+    accelerationTime = fabs(peakVelocity - startVelocity) / a;
+
+    double accelerationDistance = (startVelocity + peakVelocity) / 2 * accelerationTime;
+    double decelerationDistance = peakVelocity * peakVelocity / (2 * a);
+    cruiseTime = std::max(l - accelerationDistance - decelerationDistance, 0.0) / peakVelocity;
+
+    this->duration = accelerationTime + cruiseTime + peakVelocity / a;
+}
+
+double TrapezoidalProfile::getPosition(double time) const
+{
+    if (time >= duration)
+    {
+        return length;
+    }
+
+    if (time < accelerationTime)
+    {
+        return startVelocity * time + 0.5 * startAcceleration * time * time;
+    }
+
+    double accelerationDistance = (startVelocity + peakVelocity) / 2 * accelerationTime;
+    time -= accelerationTime;
+
+    if (time < cruiseTime)
+    {
+        return accelerationDistance + peakVelocity * time;
+    }
+
+    time -= cruiseTime;
+
+    return std::min(accelerationDistance + peakVelocity * cruiseTime + peakVelocity * time - 0.5 * acceleration * time * time, length);
+}
+
+double TrapezoidalProfile::getVelocity(double time) const
+{
+    if (time >= duration)
+    {
+        return 0;
+    }
+
+    if (time < accelerationTime)
+    {
+        return startVelocity + startAcceleration * time;
+    }
+
+    time -= accelerationTime + cruiseTime;
+
+    return (time < 0) ? peakVelocity : std::max(peakVelocity - acceleration * time, 0.0);
+}
+
+double TrapezoidalProfile::getDuration() const
+{
+    return duration;
+}
+
+//=================================================================
+// Simulator
+//=================================================================
+Simulator::Simulator() :
+    simulationTime(0),
+    isTimeValid(false),
+    startTime(0),
+    jointPosition(6, 0.0),
+    jointVelocity(6, 0.0),
+    pose(6, 0.0),
+    poseVelocity(6, 0.0),
+    digitalOutputs(0),
+    isMotionActive(false),
+    motionTime(0),
+    motionStart(6, 0.0),
+    motionDirection(6, 0.0)
+{
+
+}
+
+void Simulator::reset(const std::vector<double>& jointPosition, const std::vector<double>& pose)
+{
+    boost::lock_guard<boost::mutex> lock(mutexState);
+
+    this->jointPosition = jointPosition;
+    this->jointPosition.resize(6, 0.0);
+    this->pose = pose;
+    this->pose.resize(6, 0.0);
+    jointVelocity.assign(6, 0.0);
+    poseVelocity.assign(6, 0.0);
+
+    motions.clear();
+    isMotionActive = false;
+}
+
+void Simulator::execute(const std::vector<ScriptInstruction>& program)
+{
+    boost::lock_guard<boost::mutex> lock(mutexState);
+
+    //a new program replaces the running program
+    motions.clear();
+    isMotionActive = false;
+
+    for (size_t i = 0; i < program.size(); i++)
+    {
+        Motion motion;
+        if (createMotion(program[i], motion))
+        {
+            motions.push_back(motion);
+        }
+        else
+        {
+            ROS_DEBUG_NAMED("dummy", "dummy: ignore script function %s", program[i].name.c_str());
+        }
+    }
+
+    startNextMotion();
+}
+
+bool Simulator::append(const ScriptInstruction& instruction)
+{
+    boost::lock_guard<boost::mutex> lock(mutexState);
+
+    Motion motion;
+    if (!createMotion(instruction, motion))
+    {
+        return false;
+    }
+
+    motions.push_back(motion);
+    if (!isMotionActive)
+    {
+        startNextMotion();
+    }
+
+    return true;
+}
+
+bool Simulator::isMotionQueued()
+{
+    boost::lock_guard<boost::mutex> lock(mutexState);
+
+    return !motions.empty();
+}
+
+void Simulator::servo(const std::vector<double>& jointPosition, double lookahead)
+{
+    boost::lock_guard<boost::mutex> lock(mutexState);
+
+    motions.clear();
+
+    motion = Motion();
+    motion.type = SERVO_JOINT;
+    motion.target = jointPosition;
+    motion.target.resize(6, 0.0);
+    motion.time = lookahead;
+    isMotionActive = true;
+    motionTime = 0;
+    poseVelocity.assign(6, 0.0);
+}
+
+void Simulator::update(double time)
+{
+    boost::lock_guard<boost::mutex> lock(mutexState);
+
+    if (!isTimeValid)
+    {
+        simulationTime = time;
+        startTime = time;
+        isTimeValid = true;
+
+        return;
+    }
+
+    //the simulation pauses if it was not updated for a long time
+    double remaining = std::min(time - simulationTime, MAX_UPDATE);
+    if (remaining <= 0)
+    {
+        return;
+    }
+
+    while (remaining > 1e-12)
+    {
+        double h = std::min(remaining, STEP_SIZE);
+        step(h);
+        remaining -= h;
+    }
+
+    simulationTime = time;
+}
+
+bool Simulator::isProgramRunning()
+{
+    boost::lock_guard<boost::mutex> lock(mutexState);
+
+    return isMotionActive || !motions.empty();
+}
+
+std::vector<double> Simulator::getJointPosition()
+{
+    boost::lock_guard<boost::mutex> lock(mutexState);
+
+    return jointPosition;
+}
+
+std::vector<double> Simulator::getPose()
+{
+    boost::lock_guard<boost::mutex> lock(mutexState);
+
+    return pose;
+}
+
+bool Simulator::getDigitalOutput(int id)
+{
+    boost::lock_guard<boost::mutex> lock(mutexState);
+
+    return (id >= 0 && id < 32) ? (digitalOutputs >> id) & 1 : false;
+}
+
+bool Simulator::createMotion(const ScriptInstruction& instruction, Motion& motion)
+{
+    const std::string& name = instruction.name;
+
+    motion = Motion();
+
+    if (name == "movej" || name == "movel" || name == "movep")
+    {
+        //movej(q, a=1.4, v=1.05, t=0, r=0), movel(pose, a=1.2, v=0.25, t=0, r=0), movep(pose, a=1.2, v=0.25, r=0)
+        const ScriptArgument* target = instruction.getArgument(0, "q");
+        if (target == NULL)
+        {
+            target = instruction.getArgument(0, "pose");
+        }
+        if (target == NULL || target->values.size() != 6)
+        {
+            return false;
+        }
+
+        bool isJointMove = (name == "movej");
+        motion.type = target->isPose ? MOVE_POSE : MOVE_JOINT;
+        motion.target = target->values;
+        motion.acceleration = instruction.getValue(1, "a", isJointMove ? 1.4 : 1.2);
+        motion.velocity = instruction.getValue(2, "v", isJointMove ? 1.05 : 0.25);
+        if (name == "movep")
+        {
+            motion.blendRadius = instruction.getValue(3, "r", 0);
+        }
+        else
+        {
+            motion.time = instruction.getValue(3, "t", 0);
+            motion.blendRadius = instruction.getValue(4, "r", 0);
+        }
+
+        return true;
+    }
+    else if (name == "speedj" || name == "speedl")
+    {
+        //speedj(qd, a, t), speedl(xd, a, t)
+        const ScriptArgument* target = instruction.getArgument(0, (name == "speedj") ? "qd" : "xd");
+        if (target == NULL || target->values.size() != 6)
+        {
+            return false;
+        }
+
+        motion.type = (name == "speedj") ? SPEED_JOINT : SPEED_POSE;
+        motion.target = target->values;
+        motion.acceleration = instruction.getValue(1, "a", 1.4);
+        motion.time = instruction.getValue(2, "t", 0);
+
+        return true;
+    }
+    else if (name == "stopj" || name == "stopl")
+    {
+        motion.type = STOP;
+        motion.acceleration = instruction.getValue(0, "a", STOP_ACCELERATION);
+
+        return true;
+    }
+    else if (name == "sleep")
+    {
+        motion.type = WAIT;
+        motion.time = instruction.getValue(0, "t", 0);
+
+        return true;
+    }
+    else if (name == "set_digital_out" || name == "set_configurable_digital_out" || name == "set_tool_digital_out")
+    {
+        int offset = (name == "set_digital_out") ? 0 : (name == "set_configurable_digital_out") ? 8 : 16;
+
+        motion.type = SET_OUTPUT;
+        motion.output = offset + (int)instruction.getValue(0, "n", 0);
+        motion.value = instruction.getValue(1, "b", 0) != 0;
+
+        return motion.output >= offset && motion.output < 32;
+    }
+
+    return false;
+}
+
+void Simulator::startNextMotion()
+{
+    isMotionActive = false;
+
+    while (!motions.empty())
+    {
+        motion = motions.front();
+        motions.pop_front();
+
+        if (motion.type == SET_OUTPUT)
+        {
+            if (motion.value)
+            {
+                digitalOutputs |= (1u << motion.output);
+            }
+            else
+            {
+                digitalOutputs &= ~(1u << motion.output);
+            }
+
+            continue;
+        }
+
+        isMotionActive = true;
+        motionTime = 0;
+
+        if (motion.type == MOVE_JOINT || motion.type == MOVE_POSE)
+        {
+            bool isJoint = (motion.type == MOVE_JOINT);
+            std::vector<double>& position = isJoint ? jointPosition : pose;
+            std::vector<double>& velocity = isJoint ? jointVelocity : poseVelocity;
+
+            //path length: leading joint, translation or (for pure rotations) rotation angle
+            double length = 0;
+            if (isJoint)
+            {
+                for (int i = 0; i < 6; i++)
+                {
+                    length = std::max(length, fabs(motion.target[i] - position[i]));
+                }
+            }
+            else
+            {
+                double translation = 0;
+                double rotation = 0;
+                for (int i = 0; i < 3; i++)
+                {
+                    translation += (motion.target[i] - position[i]) * (motion.target[i] - position[i]);
+                    rotation += (motion.target[i + 3] - position[i + 3]) * (motion.target[i + 3] - position[i + 3]);
+                }
+                length = (translation > 1e-12) ? sqrt(translation) : sqrt(rotation);
+            }
+
+            //current velocity projected onto the path
+            double startVelocity = 0;
+            double directionNorm = 0;
+            for (int i = 0; i < 6; i++)
+            {
+                motionStart[i] = position[i];
+                motionDirection[i] = (length > 0) ? (motion.target[i] - position[i]) / length : 0.0;
+                startVelocity += velocity[i] * motionDirection[i];
+                directionNorm += motionDirection[i] * motionDirection[i];
+            }
+            startVelocity = (directionNorm > 0) ? startVelocity / directionNorm : 0.0;
+
+            //the other space does not move
+            (isJoint ? poseVelocity : jointVelocity).assign(6, 0.0);
+
+            profile.plan(length, startVelocity, motion.velocity, motion.acceleration, motion.time);
+        }
+
+        return;
+    }
+
+    //no further motion, stop a moving robot
+    for (int i = 0; i < 6; i++)
+    {
+        if (jointVelocity[i] != 0 || poseVelocity[i] != 0)
+        {
+            motion.type = STOP;
+            motion.acceleration = STOP_ACCELERATION;
+            isMotionActive = true;
+            motionTime = 0;
+
+            return;
+        }
+    }
+}
+
+void Simulator::step(double step)
+{
+    if (!isMotionActive)
+    {
+        startNextMotion();
+        if (!isMotionActive)
+        {
+            return;
+        }
+    }
+
+    motionTime += step;
+
+    bool isDone = false;
+    std::vector<double> zero(6, 0.0);
+
+    switch (motion.type)
+    {
+        case MOVE_JOINT:
+        case MOVE_POSE:
+        {
+            bool isJoint = (motion.type == MOVE_JOINT);
+            std::vector<double>& position = isJoint ? jointPosition : pose;
+            std::vector<double>& velocity = isJoint ? jointVelocity : poseVelocity;
+
+            double pathPosition = profile.getPosition(motionTime);
+            double pathVelocity = profile.getVelocity(motionTime);
+            for (int i = 0; i < 6; i++)
+            {
+                position[i] = motionStart[i] + motionDirection[i] * pathPosition;
+                velocity[i] = motionDirection[i] * pathVelocity;
+            }
+
+            if (motionTime >= profile.getDuration())
+            {
+                position = motion.target;
+                velocity.assign(6, 0.0);
+                isDone = true;
+            }
+            else if (motion.blendRadius > 0 && !motions.empty() && (motions.front().type == MOVE_JOINT || motions.front().type == MOVE_POSE))
+            {
+                //blend into the next move when the remaining distance is within the blend radius
+                double remaining = 0;
+                for (int i = 0; i < (isJoint ? 6 : 3); i++)
+                {
+                    remaining += (motion.target[i] - position[i]) * (motion.target[i] - position[i]);
+                }
+                isDone = sqrt(remaining) <= motion.blendRadius;
+            }
+
+            break;
+        }
+        case SPEED_JOINT:
+        case SPEED_POSE:
+        {
+            bool isJoint = (motion.type == SPEED_JOINT);
+            bool isReached = integrateVelocity(isJoint ? jointPosition : pose, isJoint ? jointVelocity : poseVelocity, motion.target, motion.acceleration, step);
+
+            //without a time the function returns when the velocity is reached, at the end of the program the robot stops
+            isDone = (motion.time > 0) ? motionTime >= motion.time : isReached;
+
+            if (isDone && (motions.empty() || motions.front().type != motion.type))
+            {
+                Motion stop;
+                stop.type = STOP;
+                stop.acceleration = motion.acceleration;
+                motions.push_front(stop);
+            }
+
+            break;
+        }
+        case SERVO_JOINT:
+        {
+            //first order lag with the lookahead time as time constant, the setpoint is held until the next one
+            double factor = std::min(step / std::max(motion.time, step), 1.0);
+            for (int i = 0; i < 6; i++)
+            {
+                double change = (motion.target[i] - jointPosition[i]) * factor;
+                jointPosition[i] += change;
+                jointVelocity[i] = change / step;
+            }
+
+            break;
+        }
+        case STOP:
+        {
+            bool isJointStopped = integrateVelocity(jointPosition, jointVelocity, zero, motion.acceleration, step);
+            bool isPoseStopped = integrateVelocity(pose, poseVelocity, zero, motion.acceleration, step);
+            isDone = isJointStopped && isPoseStopped;
+
+            break;
+        }
+        case WAIT:
+        {
+            isDone = motionTime >= motion.time;
+
+            break;
+        }
+        default:
+        {
+            isDone = true;
+        }
+    }
+
+    if (isDone)
+    {
+        startNextMotion();
+    }
+}
+
+bool Simulator::integrateVelocity(std::vector<double>& position, std::vector<double>& velocity, const std::vector<double>& targetVelocity, double acceleration, double step)
+{
+    double maxDifference = 0;
+    for (int i = 0; i < 6; i++)
+    {
+        maxDifference = std::max(maxDifference, fabs(targetVelocity[i] - velocity[i]));
+    }
+
+    //all components reach the target velocity at the same time
+    double maxChange = ((acceleration > 0) ? acceleration : STOP_ACCELERATION) * step;
+    bool isReached = maxDifference <= maxChange;
+
+    for (int i = 0; i < 6; i++)
+    {
+        double previousVelocity = velocity[i];
+        velocity[i] = isReached ? targetVelocity[i] : velocity[i] + (targetVelocity[i] - velocity[i]) * maxChange / maxDifference;
+        position[i] += (previousVelocity + velocity[i]) / 2 * step;
+    }
+
+    return isReached;
+}
+
+/**
+ * Append a package of port 30002 in network byte order.
+ */
+template <typename T>
+static void appendPackage(std::string& frame, unsigned char type, T& package)
+{
+    Packet_port30002::PacketHeader header;
+    header.packageLength = sizeof(Packet_port30002::PacketHeader) + sizeof(T);
+    header.packageType = type;
+
+    //swapping the byte order is symmetric, the decoding functions also encode
+    header.fixByteOrder();
+    package.fixByteOrder();
+
+    frame.append((const char*)&header, sizeof(header));
+    frame.append((const char*)&package, sizeof(package));
+}
+
+void Simulator::createSecondaryFrame(std::string& frame)
+{
+    boost::lock_guard<boost::mutex> lock(mutexState);
+
+    frame.assign(4, '\0');
+    frame.push_back((char)16); // robot state message
+
+    Packet_port30002::RobotMode robotMode;
+    memset(&robotMode, 0, sizeof(robotMode));
+    robotMode.timeStamp = (unsigned long long)((simulationTime - startTime) * 1000);
+    robotMode.isPhysicalRobotConnected = false;
+    robotMode.isRealRobotEnabled = false;
+    robotMode.isRobotPowerOn = true;
+    robotMode.isProgramRunning = isMotionActive || !motions.empty();
+    robotMode.isProgramPaused = false;
+    robotMode.Robot_Mode = 7; // running
+    robotMode.Speed_Fraction = 1.0;
+    robotMode.SpeedScaling = 1.0;
+    appendPackage(frame, 0, robotMode);
+
+    Packet_port30002::Joint joints[6];
+    memset(joints, 0, sizeof(joints));
+    for (int i = 0; i < 6; i++)
+    {
+        joints[i].q_act = jointPosition[i];
+        joints[i].q_tar = jointPosition[i];
+        joints[i].qd_act = jointVelocity[i];
+        joints[i].voltage = 48;
+        joints[i].temperature = 30;
+        joints[i].JointMode = 253; // running
+        joints[i].fixByteOrder();
+    }
+    Packet_port30002::PacketHeader jointsHeader;
+    jointsHeader.packageLength = sizeof(Packet_port30002::PacketHeader) + sizeof(joints);
+    jointsHeader.packageType = 1;
+    jointsHeader.fixByteOrder();
+    frame.append((const char*)&jointsHeader, sizeof(jointsHeader));
+    frame.append((const char*)joints, sizeof(joints));
+
+    Packet_port30002::CartesianInfo cartesianInfo;
+    memset(&cartesianInfo, 0, sizeof(cartesianInfo));
+    cartesianInfo.X_Tool = pose[0];
+    cartesianInfo.Y_Tool = pose[1];
+    cartesianInfo.Z_Tool = pose[2];
+    cartesianInfo.Rx = pose[3];
+    cartesianInfo.Ry = pose[4];
+    cartesianInfo.Rz = pose[5];
+    appendPackage(frame, 4, cartesianInfo);
+
+    Packet_port30002::MasterboardData masterboardData;
+    memset(&masterboardData, 0, sizeof(masterboardData));
+    masterboardData.DigitaOutputBits = digitalOutputs & 0xff;
+    appendPackage(frame, 3, masterboardData);
+
+    Packet_port30002::ToolData toolData;
+    memset(&toolData, 0, sizeof(toolData));
+    appendPackage(frame, 2, toolData);
+
+    uint32_t frameSize = htobe32(frame.size());
+    memcpy(&frame[0], &frameSize, 4);
+}
+
+void Simulator::createRealtimeFrame(std::string& frame)
+{
+    boost::lock_guard<boost::mutex> lock(mutexState);
+
+    Packet_port30003 packet;
+    memset(&packet, 0, sizeof(packet));
+    packet.time = simulationTime - startTime;
+    for (int i = 0; i < 6; i++)
+    {
+        packet.q_target[i] = jointPosition[i];
+        packet.qd_target[i] = jointVelocity[i];
+        packet.q_act[i] = jointPosition[i];
+        packet.qd_act[i] = jointVelocity[i];
+        packet.tool_pose[i] = pose[i];
+        packet.tool_vel[i] = poseVelocity[i];
+        packet.motor_temp[i] = 30;
+        packet.joint_modes[i] = 253; // running
+    }
+    packet.robot_mode = 7; // running
+
+    //swapping the byte order is symmetric, the decoding function also encodes
+    packet.fixByteOrder();
+
+    uint32_t frameSize = htobe32(4 + sizeof(packet));
+    frame.assign((const char*)&frameSize, 4);
+    frame.append((const char*)&packet, sizeof(packet));
+}
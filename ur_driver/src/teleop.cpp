@@ -0,0 +1,199 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Jerk limited velocity setpoints with a watchdog for teleoperation
+// ----------------------------------------------------------------------------
+
+#include <teleop.h>
+
+#include <math.h>
+#include <algorithm>
+
+using namespace ur_driver;
+
+/**
+ * Limit a value to [-limit, limit].
+ */
+static double clamp(double value, double limit)
+{
+    return std::max(-limit, std::min(value, limit));
+}
+
+/**
+ * Check if the velocity can change by an acceleration for a cycle and then reduce the acceleration to zero with the
+ * maximum jerk without changing by more than a difference.
+ * @param acceleration
+ * @param difference Remaining velocity change, not negative.
+ * @param jerkStep Acceleration change per cycle.
+ * @param cycleTime
+ * @return
+ */
+static bool isReachable(double acceleration, double difference, double jerkStep, double cycleTime)
+{
+    double change = acceleration * cycleTime;
+    if (acceleration > 0)
+    {
+        int steps = (int)floor(acceleration / jerkStep);
+        change += cycleTime * (steps * acceleration - jerkStep * steps * (steps + 1) / 2.0);
+    }
+
+    return change <= difference + 1e-12;
+}
+
+//=================================================================
+// VelocityTeleop
+//=================================================================
+VelocityTeleop::VelocityTeleop() :
+    maxVelocity(1.0),
+    maxAcceleration(2.0),
+    maxJerk(20.0),
+    timeoutCycles(10),
+    stopCycles(25),
+    target(6, 0.0),
+    hasTarget(false),
+    silentCycles(0),
+    velocity(6, 0.0),
+    acceleration(6, 0.0),
+    stopRate(6, 0.0),
+    isStopping(false)
+{
+
+}
+
+void VelocityTeleop::setLimits(double maxVelocity, double maxAcceleration, double maxJerk)
+{
+    this->maxVelocity = maxVelocity;
+    this->maxAcceleration = maxAcceleration;
+    this->maxJerk = maxJerk;
+}
+
+void VelocityTeleop::setWatchdog(int timeoutCycles, int stopCycles)
+{
+    this->timeoutCycles = std::max(timeoutCycles, 1);
+    this->stopCycles = std::max(stopCycles, 1);
+}
+
+void VelocityTeleop::setTarget(const std::vector<double>& velocity)
+{
+    boost::lock_guard<boost::mutex> lock(mutexTarget);
+
+    for (size_t i = 0; i < 6 && i < velocity.size(); i++)
+    {
+        target[i] = clamp(velocity[i], maxVelocity);
+    }
+    hasTarget = true;
+}
+
+void VelocityTeleop::reset()
+{
+    velocity.assign(6, 0.0);
+    acceleration.assign(6, 0.0);
+    isStopping = false;
+}
+
+bool VelocityTeleop::step(double cycleTime, std::vector<double>& velocity)
+{
+    double target[6];
+    {
+        boost::lock_guard<boost::mutex> lock(mutexTarget);
+
+        silentCycles = hasTarget ? 0 : silentCycles + 1;
+        hasTarget = false;
+        std::copy(this->target.begin(), this->target.end(), target);
+    }
+
+    if (silentCycles >= timeoutCycles)
+    {
+        //watchdog: ramp to zero within the stop cycles, regardless of the limits
+        if (!isStopping)
+        {
+            isStopping = true;
+            for (int i = 0; i < 6; i++)
+            {
+                stopRate[i] = fabs(this->velocity[i]) / stopCycles;
+            }
+        }
+
+        bool isMoving = false;
+        for (int i = 0; i < 6; i++)
+        {
+            double change = std::min(fabs(this->velocity[i]), stopRate[i]);
+            this->velocity[i] -= (this->velocity[i] > 0) ? change : -change;
+            acceleration[i] = 0;
+            isMoving = isMoving || this->velocity[i] != 0;
+        }
+
+        velocity = this->velocity;
+
+        return isMoving;
+    }
+
+    isStopping = false;
+
+    double jerkStep = maxJerk * cycleTime;
+    for (int i = 0; i < 6; i++)
+    {
+        //mirror the joint so the target is above the velocity
+        double sign = (target[i] >= this->velocity[i]) ? 1 : -1;
+        double difference = sign * (target[i] - this->velocity[i]);
+        double current = sign * acceleration[i];
+
+        //the largest acceleration within the jerk limit after which the acceleration can still be reduced to zero
+        //without passing the target
+        double low = std::max(current - jerkStep, -maxAcceleration);
+        double high = std::min(current + jerkStep, maxAcceleration);
+        if (isReachable(high, difference, jerkStep, cycleTime))
+        {
+            low = high;
+        }
+        else if (isReachable(low, difference, jerkStep, cycleTime))
+        {
+            for (int j = 0; j < 30; j++)
+            {
+                double middle = (low + high) / 2;
+                if (isReachable(middle, difference, jerkStep, cycleTime))
+                {
+                    low = middle;
+                }
+                else
+                {
+                    high = middle;
+                }
+            }
+        }
+        //otherwise the target changed too late to avoid passing it, reduce the acceleration as fast as possible
+        double chosen = low;
+
+        acceleration[i] = sign * chosen;
+        this->velocity[i] += acceleration[i] * cycleTime;
+
+        if (fabs(target[i] - this->velocity[i]) < 1e-12 && fabs(acceleration[i]) <= jerkStep)
+        {
+            this->velocity[i] = target[i];
+            acceleration[i] = 0;
+        }
+    }
+
+    velocity = this->velocity;
+
+    return true;
+}
+
+bool VelocityTeleop::isWatchdogActive()
+{
+    boost::lock_guard<boost::mutex> lock(mutexTarget);
+
+    return silentCycles >= timeoutCycles;
+}
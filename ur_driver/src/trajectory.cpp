@@ -0,0 +1,239 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Spline interpolation of sparse time stamped joint trajectories
+// ----------------------------------------------------------------------------
+
+#include <trajectory.h>
+
+#include <math.h>
+#include <algorithm>
+
+using namespace ur_driver;
+
+/**
+ * Evaluate a polynomial with 6 coefficients and its derivatives (Horner scheme).
+ * @param c Coefficients
+ * @param t
+ * @param p
+ * @param v First derivative
+ * @param a Second derivative
+ */
+static inline void evaluatePolynomial(const double* c, double t, double& p, double& v, double& a)
+{
+    p = c[0] + t * (c[1] + t * (c[2] + t * (c[3] + t * (c[4] + t * c[5]))));
+    v = c[1] + t * (2 * c[2] + t * (3 * c[3] + t * (4 * c[4] + t * 5 * c[5])));
+    a = 2 * c[2] + t * (6 * c[3] + t * (12 * c[4] + t * 20 * c[5]));
+}
+
+//=================================================================
+// SplineTrajectory
+//=================================================================
+SplineTrajectory::SplineTrajectory() :
+    segment(0)
+{
+
+}
+
+bool SplineTrajectory::fit(const std::vector<double>& times, const std::vector<double>& positions, const std::vector<double>& velocities, const std::vector<double>& accelerations)
+{
+    this->times.clear();
+    coefficients.clear();
+    segment = 0;
+
+    size_t count = times.size();
+    if (count < 2 || positions.size() != count * 6 || (!velocities.empty() && velocities.size() != count * 6) || (!accelerations.empty() && accelerations.size() != count * 6))
+    {
+        return false;
+    }
+
+    for (size_t i = 1; i < count; i++)
+    {
+        if (!(times[i] > times[i - 1]))
+        {
+            return false;
+        }
+    }
+
+    std::vector<double> knotVelocities(velocities);
+    if (knotVelocities.empty())
+    {
+        //velocities at the inner points for a continuous acceleration, a tridiagonal system per joint (Thomas algorithm)
+        knotVelocities.assign(count * 6, 0.0);
+        std::vector<double> c(count, 0.0);
+        std::vector<double> d(count, 0.0);
+        for (int j = 0; j < 6; j++)
+        {
+            for (size_t i = 1; i + 1 < count; i++)
+            {
+                double h0 = times[i] - times[i - 1];
+                double h1 = times[i + 1] - times[i];
+                double rhs = 3 * (h1 * (positions[i * 6 + j] - positions[(i - 1) * 6 + j]) / h0 + h0 * (positions[(i + 1) * 6 + j] - positions[i * 6 + j]) / h1);
+
+                double m = 2 * (h0 + h1) - h1 * c[i - 1];
+                c[i] = h0 / m;
+                d[i] = (rhs - h1 * d[i - 1]) / m;
+            }
+
+            for (size_t i = count - 2; i >= 1; i--)
+            {
+                knotVelocities[i * 6 + j] = d[i] - c[i] * knotVelocities[(i + 1) * 6 + j];
+            }
+        }
+    }
+
+    bool isQuintic = !velocities.empty() && !accelerations.empty();
+
+    this->times.resize(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        this->times[i] = times[i] - times[0];
+    }
+
+    coefficients.assign((count - 1) * 36, 0.0);
+    for (size_t i = 0; i + 1 < count; i++)
+    {
+        for (int j = 0; j < 6; j++)
+        {
+            double p[2] = { positions[i * 6 + j], positions[(i + 1) * 6 + j] };
+            double v[2] = { knotVelocities[i * 6 + j], knotVelocities[(i + 1) * 6 + j] };
+            double a[2] = { isQuintic ? accelerations[i * 6 + j] : 0.0, isQuintic ? accelerations[(i + 1) * 6 + j] : 0.0 };
+            setSegment(i, j, p, v, isQuintic ? a : NULL);
+        }
+    }
+
+    return true;
+}
+
+double SplineTrajectory::limit(double maxVelocity, double maxAcceleration)
+{
+    if (isEmpty() || maxVelocity <= 0 || maxAcceleration <= 0)
+    {
+        return 1.0;
+    }
+
+    double velocity = 0;
+    double acceleration = 0;
+    for (size_t i = 0; i + 1 < times.size(); i++)
+    {
+        double duration = times[i + 1] - times[i];
+        for (int j = 0; j < 6; j++)
+        {
+            for (int k = 0; k <= SPLINE_CHECK_SAMPLES; k++)
+            {
+                double p, v, a;
+                evaluatePolynomial(&coefficients[(i * 6 + j) * 6], duration * k / SPLINE_CHECK_SAMPLES, p, v, a);
+                velocity = std::max(velocity, fabs(v));
+                acceleration = std::max(acceleration, fabs(a));
+            }
+        }
+    }
+
+    double scale = std::max(1.0, std::max(velocity / maxVelocity, sqrt(acceleration / maxAcceleration)));
+    if (scale > 1.0)
+    {
+        for (size_t i = 0; i < times.size(); i++)
+        {
+            times[i] *= scale;
+        }
+
+        //p(t / scale): the k-th coefficient is divided by scale^k
+        for (size_t i = 0; i < coefficients.size(); i += 6)
+        {
+            double factor = 1.0;
+            for (int k = 1; k < 6; k++)
+            {
+                factor /= scale;
+                coefficients[i + k] *= factor;
+            }
+        }
+    }
+
+    return scale;
+}
+
+double SplineTrajectory::getDuration() const
+{
+    return times.empty() ? 0.0 : times.back();
+}
+
+bool SplineTrajectory::isEmpty() const
+{
+    return times.empty();
+}
+
+void SplineTrajectory::sample(double time, double* position, double* velocity, double* acceleration)
+{
+    if (times.empty())
+    {
+        return;
+    }
+
+    bool isEnd = time >= times.back();
+    time = std::max(time, 0.0);
+
+    //the next segment of a stream, otherwise a search
+    size_t last = times.size() - 2;
+    if (segment > last || time < times[segment])
+    {
+        segment = std::upper_bound(times.begin(), times.end() - 1, time) - times.begin() - 1;
+    }
+    while (segment < last && time >= times[segment + 1])
+    {
+        segment++;
+    }
+
+    double t = std::min(time, times[segment + 1]) - times[segment];
+    for (int j = 0; j < 6; j++)
+    {
+        double p, v, a;
+        evaluatePolynomial(&coefficients[(segment * 6 + j) * 6], t, p, v, a);
+
+        position[j] = p;
+        if (velocity)
+        {
+            velocity[j] = isEnd ? 0.0 : v;
+        }
+        if (acceleration)
+        {
+            acceleration[j] = isEnd ? 0.0 : a;
+        }
+    }
+}
+
+void SplineTrajectory::setSegment(size_t index, int joint, const double* p, const double* v, const double* a)
+{
+    double* c = &coefficients[(index * 6 + joint) * 6];
+    double h = times[index + 1] - times[index];
+    double distance = p[1] - p[0];
+
+    c[0] = p[0];
+    c[1] = v[0];
+
+    if (a)
+    {
+        c[2] = a[0] / 2;
+        c[3] = (20 * distance - (8 * v[1] + 12 * v[0]) * h - (3 * a[0] - a[1]) * h * h) / (2 * h * h * h);
+        c[4] = (-30 * distance + (14 * v[1] + 16 * v[0]) * h + (3 * a[0] - 2 * a[1]) * h * h) / (2 * h * h * h * h);
+        c[5] = (12 * distance - 6 * (v[1] + v[0]) * h + (a[1] - a[0]) * h * h) / (2 * h * h * h * h * h);
+    }
+    else
+    {
+        c[2] = (3 * distance / h - 2 * v[0] - v[1]) / h;
+        c[3] = (-2 * distance / h + v[0] + v[1]) / (h * h);
+        c[4] = 0;
+        c[5] = 0;
+    }
+}
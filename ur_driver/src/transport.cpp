@@ -0,0 +1,399 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Byte stream transports between the connector and the robot controller
+// ----------------------------------------------------------------------------
+
+#include <transport.h>
+
+#include <string.h>
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+
+using namespace ur_driver;
+using boost::asio::ip::tcp;
+
+//=================================================================
+// Transport
+//=================================================================
+Transport::~Transport()
+{
+
+}
+
+void Transport::setNoDelay(bool)
+{
+
+}
+
+bool Transport::parseType(const std::string& name, Type& type)
+{
+    if (name == "tcp")
+    {
+        type = TCP;
+    }
+    else if (name == "unix")
+    {
+        type = UNIX;
+    }
+    else if (name == "memory")
+    {
+        type = MEMORY;
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
+const char* Transport::getTypeName(Type type)
+{
+    switch (type)
+    {
+        case UNIX:
+            return "unix";
+        case MEMORY:
+            return "memory";
+        default:
+            return "tcp";
+    }
+}
+
+//=================================================================
+// TcpTransport
+//=================================================================
+TcpTransport::TcpTransport(boost::asio::io_service& io) :
+    io(io),
+    socket(io)
+{
+
+}
+
+void TcpTransport::connect(const std::string& host, int port)
+{
+    //resolve host
+    tcp::resolver::query query(host, boost::lexical_cast<std::string>(port));
+    tcp::resolver resolver(io);
+    tcp::resolver::iterator endpointIterator = resolver.resolve(query);
+
+    //connect to first resolved endpoint
+    socket.connect(*endpointIterator);
+}
+
+tcp::socket& TcpTransport::getSocket()
+{
+    return socket;
+}
+
+size_t TcpTransport::read(char* data, size_t size, boost::system::error_code& error)
+{
+    return socket.read_some(boost::asio::buffer(data, size), error);
+}
+
+void TcpTransport::asyncRead(char* data, size_t size, const ReadHandler& handler)
+{
+    socket.async_read_some(boost::asio::buffer(data, size), handler);
+}
+
+size_t TcpTransport::write(const char* data, size_t length, boost::system::error_code& error)
+{
+    return boost::asio::write(socket, boost::asio::buffer(data, length), error);
+}
+
+void TcpTransport::shutdown()
+{
+    boost::system::error_code error;
+    socket.shutdown(tcp::socket::shutdown_both, error);
+}
+
+void TcpTransport::reset()
+{
+    //the socket is closed by the read thread, without linger this sends a reset
+    boost::system::error_code error;
+    socket.set_option(boost::asio::socket_base::linger(true, 0), error);
+    socket.shutdown(tcp::socket::shutdown_receive, error);
+}
+
+void TcpTransport::close()
+{
+    boost::system::error_code error;
+    socket.close(error);
+}
+
+bool TcpTransport::isOpen()
+{
+    return socket.is_open();
+}
+
+void TcpTransport::setNoDelay(bool noDelay)
+{
+    boost::system::error_code error;
+    socket.set_option(tcp::no_delay(noDelay), error);
+}
+
+//=================================================================
+// UnixTransport
+//=================================================================
+UnixTransport::UnixTransport(boost::asio::io_service& io) :
+    socket(io)
+{
+
+}
+
+void UnixTransport::createPair(boost::asio::io_service& io, boost::shared_ptr<Transport>& first, boost::shared_ptr<Transport>& second)
+{
+    boost::shared_ptr<UnixTransport> firstUnix(new UnixTransport(io));
+    boost::shared_ptr<UnixTransport> secondUnix(new UnixTransport(io));
+    boost::asio::local::connect_pair(firstUnix->socket, secondUnix->socket);
+
+    first = firstUnix;
+    second = secondUnix;
+}
+
+size_t UnixTransport::read(char* data, size_t size, boost::system::error_code& error)
+{
+    return socket.read_some(boost::asio::buffer(data, size), error);
+}
+
+void UnixTransport::asyncRead(char* data, size_t size, const ReadHandler& handler)
+{
+    socket.async_read_some(boost::asio::buffer(data, size), handler);
+}
+
+size_t UnixTransport::write(const char* data, size_t length, boost::system::error_code& error)
+{
+    return boost::asio::write(socket, boost::asio::buffer(data, length), error);
+}
+
+void UnixTransport::shutdown()
+{
+    boost::system::error_code error;
+    socket.shutdown(boost::asio::local::stream_protocol::socket::shutdown_both, error);
+}
+
+void UnixTransport::reset()
+{
+    //a stream socket pair has no reset, the peer gets eof
+    shutdown();
+}
+
+void UnixTransport::close()
+{
+    boost::system::error_code error;
+    socket.close(error);
+}
+
+bool UnixTransport::isOpen()
+{
+    return socket.is_open();
+}
+
+//=================================================================
+// MemoryTransport
+//=================================================================
+MemoryTransport::MemoryTransport(boost::asio::io_service& io, boost::shared_ptr<MemoryPipe> input, boost::shared_ptr<MemoryPipe> output) :
+    io(io),
+    input(input),
+    output(output),
+    isClosed(false)
+{
+
+}
+
+void MemoryTransport::createPair(boost::asio::io_service& io, boost::shared_ptr<Transport>& first, boost::shared_ptr<Transport>& second, size_t capacity)
+{
+    boost::shared_ptr<MemoryPipe> forward(new MemoryPipe(capacity));
+    boost::shared_ptr<MemoryPipe> backward(new MemoryPipe(capacity));
+
+    first.reset(new MemoryTransport(io, backward, forward));
+    second.reset(new MemoryTransport(io, forward, backward));
+}
+
+size_t MemoryTransport::read(char* data, size_t size, boost::system::error_code& error)
+{
+    return input->read(data, size, error);
+}
+
+void MemoryTransport::asyncRead(char* data, size_t size, const ReadHandler& handler)
+{
+    input->asyncRead(io, data, size, handler);
+}
+
+size_t MemoryTransport::write(const char* data, size_t length, boost::system::error_code& error)
+{
+    return output->write(data, length, error);
+}
+
+void MemoryTransport::shutdown()
+{
+    input->close(false);
+    output->close(false);
+}
+
+void MemoryTransport::reset()
+{
+    input->close(false);
+    output->close(true);
+}
+
+void MemoryTransport::close()
+{
+    shutdown();
+    isClosed = true;
+}
+
+bool MemoryTransport::isOpen()
+{
+    return !isClosed;
+}
+
+//=================================================================
+// MemoryPipe
+//=================================================================
+MemoryPipe::MemoryPipe(size_t capacity) :
+    buffer(capacity),
+    head(0),
+    size(0),
+    isClosed(false),
+    isReset(false),
+    pendingIo(NULL),
+    pendingData(NULL),
+    pendingSize(0)
+{
+
+}
+
+size_t MemoryPipe::read(char* data, size_t size, boost::system::error_code& error)
+{
+    boost::unique_lock<boost::mutex> lock(mutexPipe);
+
+    while (this->size == 0 && !isClosed)
+    {
+        condition.wait(lock);
+    }
+
+    return readAvailable(data, size, error);
+}
+
+void MemoryPipe::asyncRead(boost::asio::io_service& io, char* data, size_t size, const Transport::ReadHandler& handler)
+{
+    boost::lock_guard<boost::mutex> lock(mutexPipe);
+
+    pendingIo = &io;
+    pendingData = data;
+    pendingSize = size;
+    pendingHandler = handler;
+
+    completePendingRead();
+}
+
+size_t MemoryPipe::write(const char* data, size_t length, boost::system::error_code& error)
+{
+    boost::unique_lock<boost::mutex> lock(mutexPipe);
+
+    size_t written = 0;
+    while (written < length)
+    {
+        while (size == buffer.size() && !isClosed)
+        {
+            condition.wait(lock);
+        }
+
+        if (isClosed)
+        {
+            error = boost::asio::error::broken_pipe;
+
+            break;
+        }
+
+        size_t chunk = std::min(length - written, buffer.size() - size);
+        size_t tail = (head + size) % buffer.size();
+        size_t first = std::min(chunk, buffer.size() - tail);
+        memcpy(&buffer[tail], data + written, first);
+        memcpy(&buffer[0], data + written + first, chunk - first);
+
+        size += chunk;
+        written += chunk;
+
+        completePendingRead();
+        condition.notify_all();
+    }
+
+    return written;
+}
+
+void MemoryPipe::close(bool isReset)
+{
+    boost::lock_guard<boost::mutex> lock(mutexPipe);
+
+    isClosed = true;
+
+    //a reset discards the data which was not read yet
+    if (isReset)
+    {
+        this->isReset = true;
+        size = 0;
+    }
+
+    completePendingRead();
+    condition.notify_all();
+}
+
+size_t MemoryPipe::readAvailable(char* data, size_t size, boost::system::error_code& error)
+{
+    if (this->size == 0)
+    {
+        if (isReset)
+        {
+            error = boost::asio::error::connection_reset;
+        }
+        else
+        {
+            error = boost::asio::error::eof;
+        }
+
+        return 0;
+    }
+
+    size_t length = std::min(size, this->size);
+    size_t first = std::min(length, buffer.size() - head);
+    memcpy(data, &buffer[head], first);
+    memcpy(data + first, &buffer[0], length - first);
+
+    head = (head + length) % buffer.size();
+    this->size -= length;
+
+    condition.notify_all();
+
+    return length;
+}
+
+void MemoryPipe::completePendingRead()
+{
+    if (!pendingHandler || (size == 0 && !isClosed))
+    {
+        return;
+    }
+
+    boost::system::error_code error;
+    size_t length = readAvailable(pendingData, pendingSize, error);
+    pendingIo->post(boost::bind(pendingHandler, error, length));
+
+    pendingHandler.clear();
+}
@@ -144,73 +144,52 @@ std::string CartesianValue::toString()
 //=================================================================
 tf::Vector3 ur_driver::rpyToAxis(double roll, double pitch, double yaw)
 {
-    tf::Quaternion quaternion = tf::createQuaternionFromRPY(roll, pitch, yaw);
+    double rx, ry, rz;
+    Rotation::rpyToAxis(roll, pitch, yaw, rx, ry, rz);
 
-    return quaternion.getAngle() * quaternion.getAxis();
+    return tf::Vector3(rx, ry, rz);
 }
 
 tf::Vector3 ur_driver::rpyToQuaternion(double roll, double pitch, double yaw)
 {
-    tf::Quaternion quaternion;
-    quaternion.setRPY(roll, pitch, yaw);
-    tf::Vector3 v(quaternion.x(), quaternion.y(), quaternion.z());
-    v.setW(quaternion.w());
+    double x, y, z, w;
+    Rotation::rpyToQuaternion(roll, pitch, yaw, x, y, z, w);
+    tf::Vector3 v(x, y, z);
+    v.setW(w);
 
     return v;
 }
 
 tf::Vector3 ur_driver::axisToRpy(double rx, double ry, double rz)
 {
-    tf::Vector3 e(rx, ry, rz);
-
-    if (e.isZero())
-    {
-        e = tf::Vector3(1, 1, 1);
-    }
-
-    double l = e.length();
-    e = e / l;
-
-    tf::Quaternion quaternion(e, l);
-    tf::Matrix3x3 matrix(quaternion);
     double roll, pitch, yaw;
-    matrix.getRPY(roll, pitch, yaw);
+    Rotation::axisToRpy(rx, ry, rz, roll, pitch, yaw);
 
     return tf::Vector3(roll, pitch, yaw);
 }
 
 tf::Vector3 ur_driver::axisToQuaternion(double rx, double ry, double rz)
 {
-    tf::Vector3 e(rx, ry, rz);
-
-    if (e.isZero())
-    {
-        e = tf::Vector3(1, 1, 1);
-    }
-
-    double l = e.length();
-    e = e / l;
-
-    tf::Quaternion quaternion(e, l);
-    tf::Vector3 v(quaternion.x(), quaternion.y(), quaternion.z());
-    v.setW(quaternion.w());
+    double x, y, z, w;
+    Rotation::axisToQuaternion(rx, ry, rz, x, y, z, w);
+    tf::Vector3 v(x, y, z);
+    v.setW(w);
 
     return v;
 }
 
 tf::Vector3 ur_driver::quaternionToAxis(double x, double y, double z, double w)
 {
-    tf::Quaternion quaternion(x, y, z, w);
+    double rx, ry, rz;
+    Rotation::quaternionToAxis(x, y, z, w, rx, ry, rz);
 
-    return quaternion.getAxis() * quaternion.getAngle();
+    return tf::Vector3(rx, ry, rz);
 }
 
 tf::Vector3 ur_driver::quaternionToRpy(double x, double y, double z, double w)
 {
-    tf::Quaternion quaternion(x, y, z, w);
-    tf::Matrix3x3 matrix(quaternion);
     double roll, pitch, yaw;
-    matrix.getRPY(roll, pitch, yaw);
+    Rotation::quaternionToRpy(x, y, z, w, roll, pitch, yaw);
 
     return tf::Vector3(roll, pitch, yaw);
 }
@@ -0,0 +1,188 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Joint solutions of the waypoints of a command list before it is sent
+// ----------------------------------------------------------------------------
+
+#include <waypoints.h>
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+using namespace ur_driver;
+
+/**
+ * Waypoints per thread below which the inverse kinematics run on the calling thread (about 1 us each).
+ */
+static const size_t WAYPOINTS_PER_THREAD = 256;
+
+//=================================================================
+// Waypoint
+//=================================================================
+Waypoint::Waypoint() :
+    type(UNKNOWN),
+    isLinear(false)
+{
+    std::fill(q, q + 6, 0.0);
+    std::fill(rotation, rotation + 9, 0.0);
+    std::fill(position, position + 3, 0.0);
+}
+
+void Waypoint::setPose(const double* pose, bool isLinear)
+{
+    type = CARTESIAN;
+    this->isLinear = isLinear;
+
+    double x, y, z, w;
+    Rotation::axisToQuaternion(pose[3], pose[4], pose[5], x, y, z, w);
+    Rotation::quaternionToMatrix(x, y, z, w, rotation[0], rotation[1], rotation[2], rotation[3], rotation[4], rotation[5], rotation[6], rotation[7], rotation[8]);
+    std::copy(pose, pose + 3, position);
+}
+
+void Waypoint::setJoints(const double* q, bool isLinear)
+{
+    type = JOINT;
+    this->isLinear = isLinear;
+    std::copy(q, q + 6, this->q);
+}
+
+//=================================================================
+// WaypointSolution
+//=================================================================
+const char* WaypointSolution::getStatusName(Status status)
+{
+    static const char* names[] = {"ok", "unreachable", "branch flip", "not checked"};
+
+    return names[status];
+}
+
+//=================================================================
+// WaypointSolver
+//=================================================================
+WaypointSolver::WaypointSolver(Kinematics::Model model, int threads) :
+    model(model),
+    threadCount((threads > 0) ? threads : std::max(boost::thread::hardware_concurrency(), 1u))
+{
+
+}
+
+int WaypointSolver::solve(const std::vector<Waypoint>& waypoints, const double* seed, std::vector<WaypointSolution>& solutions)
+{
+    size_t size = waypoints.size();
+    inverseSolutions.resize(size);
+    solutions.resize(size);
+
+    //inverse kinematics of all poses, split into contiguous ranges
+    size_t threads = std::min((size_t)threadCount, size / WAYPOINTS_PER_THREAD);
+    if (threads <= 1)
+    {
+        solveRange(&waypoints, 0, size);
+    }
+    else
+    {
+        boost::thread_group group;
+        for (size_t i = 1; i < threads; i++)
+        {
+            group.create_thread(boost::bind(&WaypointSolver::solveRange, this, &waypoints, size * i / threads, size * (i + 1) / threads));
+        }
+        solveRange(&waypoints, 0, size / threads);
+        group.join_all();
+    }
+
+    //select the solutions along the waypoints
+    double current[6];
+    std::copy(seed, seed + 6, current);
+    int branch = Kinematics::getBranch(model, current);
+    bool isKnown = true;
+    int rejected = -1;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        const Waypoint& waypoint = waypoints[i];
+        WaypointSolution& solution = solutions[i];
+
+        if (!isKnown || waypoint.type == Waypoint::UNKNOWN)
+        {
+            isKnown = false;
+            solution.status = WaypointSolution::NOT_CHECKED;
+            std::copy(current, current + 6, solution.q);
+            solution.branch = -1;
+
+            continue;
+        }
+
+        //a linear move must end on the branch of the robot
+        int requiredBranch = waypoint.isLinear ? branch : -1;
+
+        if (waypoint.type == Waypoint::JOINT)
+        {
+            bool isOnBranch = requiredBranch < 0 || Kinematics::getBranch(model, waypoint.q) == requiredBranch;
+            solution.status = isOnBranch ? WaypointSolution::OK : WaypointSolution::BRANCH_FLIP;
+            std::copy(waypoint.q, waypoint.q + 6, solution.q);
+        }
+        else
+        {
+            InverseSolutions& inverse = inverseSolutions[i];
+
+            //in the wrist singularity the solutions were computed with q6 = 0, keep the wrist 3 of the robot instead
+            int index = Kinematics::nearest(inverse, current, requiredBranch, solution.q);
+            if (index >= 0 && std::fabs(std::sin(inverse.q[index][4])) <= KINEMATICS_WRIST_SINGULAR)
+            {
+                InverseSolutions singular;
+                Kinematics::inverse(model, waypoint.rotation, waypoint.position, current[5], singular);
+                index = Kinematics::nearest(singular, current, requiredBranch, solution.q);
+            }
+
+            if (index >= 0)
+            {
+                solution.status = WaypointSolution::OK;
+            }
+            else
+            {
+                solution.status = (inverse.count == 0) ? WaypointSolution::UNREACHABLE : WaypointSolution::BRANCH_FLIP;
+                std::copy(current, current + 6, solution.q);
+            }
+        }
+
+        if (solution.status != WaypointSolution::OK && rejected < 0)
+        {
+            rejected = i;
+        }
+
+        std::copy(solution.q, solution.q + 6, current);
+        branch = Kinematics::getBranch(model, current);
+        solution.branch = branch;
+    }
+
+    return rejected;
+}
+
+void WaypointSolver::solveRange(const std::vector<Waypoint>* waypoints, size_t begin, size_t end)
+{
+    for (size_t i = begin; i < end; i++)
+    {
+        const Waypoint& waypoint = (*waypoints)[i];
+        if (waypoint.type == Waypoint::CARTESIAN)
+        {
+            Kinematics::inverse(model, waypoint.rotation, waypoint.position, 0.0, inverseSolutions[i]);
+        }
+        else
+        {
+            inverseSolutions[i].count = 0;
+        }
+    }
+}
@@ -0,0 +1,96 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Tests of the blend radius optimization
+// ----------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+
+#include <blending.h>
+
+#include <math.h>
+
+using namespace ur_driver;
+
+static const double TOLERANCE = 0.005;
+
+/**
+ * Positions of the start and of three waypoints along x with a turn by the direction change angle at the middle
+ * waypoints.
+ * @param angle [rad]
+ * @param length Length of each segment [m]
+ * @return
+ */
+static std::vector<double> createCorner(double angle, double length)
+{
+    double positions[12] = {0, 0, 0, length, 0, 0, length + length * cos(angle), length * sin(angle), 0,
+                            2 * length + length * cos(angle), length * sin(angle), 0};
+
+    return std::vector<double>(positions, positions + 12);
+}
+
+//=================================================================
+// BlendOptimizer
+//=================================================================
+TEST(BlendOptimizer, DeviationWithinTolerance)
+{
+    BlendOptimizer optimizer;
+    optimizer.setTolerance(TOLERANCE);
+
+    for (int i = 1; i <= 18; i++)
+    {
+        double angle = i * M_PI / 18;
+        std::vector<double> radii(3, 0.001);
+        optimizer.optimize(createCorner(angle, 1.0), radii);
+
+        //the arc of the blend deviates r * tan(a / 4) from the waypoint, the long segments don't limit the radius
+        EXPECT_NEAR(radii[0] * tan(angle / 4), TOLERANCE, 1e-12) << "angle " << angle;
+        EXPECT_NEAR(radii[1] * tan(angle / 4), TOLERANCE, 1e-12) << "angle " << angle;
+        EXPECT_EQ(0.0, radii[2]);
+    }
+}
+
+TEST(BlendOptimizer, NoOverlap)
+{
+    BlendOptimizer optimizer;
+    optimizer.setTolerance(TOLERANCE);
+
+    for (int i = 1; i <= 18; i++)
+    {
+        double angle = i * M_PI / 18;
+        std::vector<double> radii(3, 0.001);
+        optimizer.optimize(createCorner(angle, 0.004), radii);
+
+        EXPECT_LE(radii[0], BLEND_MARGIN * 0.004 + 1e-12);
+        EXPECT_LE(radii[0] + radii[1], BLEND_MARGIN * 0.004 + 1e-12);
+        EXPECT_LE(radii[1], BLEND_MARGIN * 0.004 + 1e-12);
+        EXPECT_LE(radii[0] * tan(angle / 4), TOLERANCE + 1e-12);
+        EXPECT_LE(radii[1] * tan(angle / 4), TOLERANCE + 1e-12);
+    }
+}
+
+TEST(BlendOptimizer, StopsStay)
+{
+    BlendOptimizer optimizer;
+    optimizer.setTolerance(TOLERANCE);
+
+    std::vector<double> radii(3, 0.0);
+    radii[1] = 0.001;
+    optimizer.optimize(createCorner(M_PI / 2, 1.0), radii);
+
+    EXPECT_EQ(0.0, radii[0]);
+    EXPECT_GT(radii[1], 0.0);
+    EXPECT_EQ(0.0, radii[2]);
+}
@@ -0,0 +1,202 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Tests of the splitting of the received data into frames
+// ----------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+
+#include <connector.h>
+
+#include <string>
+
+using namespace ur_driver;
+
+/**
+ * The throttled warnings after an invalid frame size need the ROS time.
+ */
+class ConnectorTest : public ::testing::Test
+{
+    protected:
+        Connector connector;
+
+        virtual void SetUp()
+        {
+            ros::Time::init();
+        }
+
+        void process(int port, const std::string& data)
+        {
+            connector.processData(port, data.data(), data.size());
+        }
+
+        void expectStatistics(unsigned long long frames, unsigned long long robotStates, unsigned long long decodeErrors, unsigned long long discardedBytes)
+        {
+            ConnectorStatistics statistics = connector.getStatistics();
+            EXPECT_EQ(frames, statistics.frames);
+            EXPECT_EQ(robotStates, statistics.robotStates);
+            EXPECT_EQ(decodeErrors, statistics.decodeErrors);
+            EXPECT_EQ(discardedBytes, statistics.discardedBytes);
+        }
+};
+
+/**
+ * Frame of port 30002 with a different frame size (the content is cut or kept).
+ */
+static std::string resizeFrame(const std::string& frame, size_t size)
+{
+    std::string resized = frame.substr(0, size);
+    uint32_t frameSize = htobe32(size);
+    resized.replace(0, 4, (const char*)&frameSize, 4);
+
+    return resized;
+}
+
+/**
+ * Robot state frame of port 30003.
+ */
+static std::string createRealtimeFrame()
+{
+    Simulator simulator;
+    std::string frame;
+    simulator.createRealtimeFrame(frame);
+
+    return frame;
+}
+
+//=================================================================
+// split and coalesced frames
+//=================================================================
+TEST_F(ConnectorTest, CoalescedFrames)
+{
+    std::string frame = Dummy::createRobotStateFrame();
+    process(Connector::SECONDARY, frame + frame + frame);
+    expectStatistics(3, 3, 0, 0);
+}
+
+TEST_F(ConnectorTest, IncompleteFrameKeptAcrossChunks)
+{
+    std::string frame = Dummy::createRobotStateFrame();
+
+    //three frames and the start of the fourth, the rest of it follows
+    process(Connector::SECONDARY, frame + frame + frame + frame.substr(0, 100));
+    expectStatistics(3, 3, 0, 0);
+
+    process(Connector::SECONDARY, frame.substr(100));
+    expectStatistics(4, 4, 0, 0);
+}
+
+TEST_F(ConnectorTest, SplitWithinFrameSize)
+{
+    std::string frame = Dummy::createRobotStateFrame();
+
+    //fewer than the 4 bytes of the frame size
+    process(Connector::SECONDARY, frame.substr(0, 3));
+    expectStatistics(0, 0, 0, 0);
+
+    process(Connector::SECONDARY, frame.substr(3));
+    expectStatistics(1, 1, 0, 0);
+}
+
+TEST_F(ConnectorTest, ByteByByte)
+{
+    std::string frame = Dummy::createRobotStateFrame();
+    std::string data = frame + frame;
+
+    for (size_t i = 0; i < data.size(); i++)
+    {
+        process(Connector::SECONDARY, data.substr(i, 1));
+
+        unsigned long long frames = (i + 1) / frame.size();
+        ASSERT_EQ(frames, connector.getStatistics().robotStates) << "byte " << i;
+    }
+    expectStatistics(2, 2, 0, 0);
+}
+
+//=================================================================
+// corrupt frames
+//=================================================================
+TEST_F(ConnectorTest, TruncatedFrame)
+{
+    //the frame size is consistent, the last package is cut off
+    std::string frame = Dummy::createRobotStateFrame();
+    process(Connector::SECONDARY, resizeFrame(frame, 200) + frame);
+    expectStatistics(2, 1, 1, 0);
+}
+
+TEST_F(ConnectorTest, BitFlippedPackageLength)
+{
+    //the length of the first package exceeds the frame, the next frame decodes
+    std::string frame = Dummy::createRobotStateFrame();
+    std::string flipped = frame;
+    flipped[7] ^= (char)0x80;
+
+    process(Connector::SECONDARY, flipped + frame);
+    expectStatistics(2, 1, 1, 0);
+}
+
+TEST_F(ConnectorTest, ResyncByteByByte)
+{
+    //frame sizes of 0 are invalid, the bytes up to the next frame are skipped
+    std::string frame = Dummy::createRobotStateFrame();
+    process(Connector::SECONDARY, frame + std::string(5, '\0') + frame);
+    expectStatistics(2, 2, 0, 5);
+    EXPECT_EQ(1u, connector.getStatistics().resyncs);
+}
+
+TEST_F(ConnectorTest, ResyncAcrossChunks)
+{
+    //the last 3 bytes of the first chunk can't be checked until the next chunk arrives
+    std::string frame = Dummy::createRobotStateFrame();
+    process(Connector::SECONDARY, std::string(7, (char)0xff));
+    expectStatistics(0, 0, 0, 4);
+
+    process(Connector::SECONDARY, frame);
+    expectStatistics(1, 1, 0, 7);
+}
+
+//=================================================================
+// port 30003
+//=================================================================
+TEST_F(ConnectorTest, RealtimeFrames)
+{
+    std::string frame = createRealtimeFrame();
+    process(Connector::REALTIME, frame + frame.substr(0, 10));
+    expectStatistics(1, 1, 0, 0);
+
+    process(Connector::REALTIME, frame.substr(10) + frame);
+    expectStatistics(3, 3, 0, 0);
+}
+
+TEST_F(ConnectorTest, RealtimeTruncatedFrame)
+{
+    //before the first decoded frame any frame size is accepted, the short frame is a decode error
+    std::string frame = createRealtimeFrame();
+    process(Connector::REALTIME, resizeFrame(frame, 400) + frame);
+    expectStatistics(2, 1, 1, 0);
+}
+
+TEST_F(ConnectorTest, RealtimeConstantFrameSize)
+{
+    //after the first decoded frame only its size is valid: the flipped size (a valid size on port 30002) is skipped
+    //with the whole frame
+    std::string frame = createRealtimeFrame();
+    std::string flipped = frame;
+    flipped[2] ^= (char)0x01;
+
+    process(Connector::REALTIME, frame + flipped + frame);
+    expectStatistics(2, 2, 0, frame.size());
+    EXPECT_EQ(1u, connector.getStatistics().resyncs);
+}
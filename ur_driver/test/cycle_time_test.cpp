@@ -0,0 +1,213 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Tests of the cycle time estimation of command lists
+// ----------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+
+#include <cycle_time.h>
+#include <blending.h>
+#include <kinematics.h>
+
+#include <math.h>
+#include <algorithm>
+
+using namespace ur_driver;
+
+/**
+ * Difference to the closed form durations, only rounding errors [s].
+ */
+static const double DURATION_TOLERANCE = 1e-12;
+
+static const double START[6] = {0.0, -1.57, 1.57, -1.57, -1.57, 0.0};
+static const double START_TCP[3] = {0.4, 0.0, 0.3};
+
+//=================================================================
+// BlendedMoveEstimator
+//=================================================================
+TEST(BlendedMoveEstimator, ProfileDuration)
+{
+    //trapezoid: ramps to and from the velocity v / a, the distance at the velocity
+    EXPECT_NEAR(0.25 / 1.2 + 1.0 / 0.25, BlendedMoveEstimator::getProfileDuration(1.0, 0, 0, 0.25, 1.2), DURATION_TOLERANCE);
+
+    //triangle: the velocity is not reached
+    EXPECT_NEAR(2 * sqrt(0.01 / 1.2), BlendedMoveEstimator::getProfileDuration(0.01, 0, 0, 0.25, 1.2), DURATION_TOLERANCE);
+
+    //at the velocity from the start to the end
+    EXPECT_NEAR(1.0 / 0.25, BlendedMoveEstimator::getProfileDuration(1.0, 0.25, 0.25, 0.25, 1.2), DURATION_TOLERANCE);
+
+    EXPECT_EQ(0, BlendedMoveEstimator::getProfileDuration(0, 0, 0, 0.25, 1.2));
+}
+
+//=================================================================
+// CycleTimeEstimator
+//=================================================================
+TEST(CycleTimeEstimator, LinearMatchesTrapezoid)
+{
+    //1 m at 0.25 m/s and 1.2 m/s^2
+    double target[3] = {1.4, 0.0, 0.3};
+    CycleTimeEstimator estimator;
+    estimator.reset(START, START_TCP);
+    estimator.addLinear(target, NULL, 0.25, 1.2, 0);
+
+    std::vector<double> durations;
+    double total = estimator.estimate(durations);
+    ASSERT_EQ(1u, durations.size());
+    EXPECT_NEAR(0.25 / 1.2 + 1.0 / 0.25, total, DURATION_TOLERANCE);
+    EXPECT_EQ(total, durations[0]);
+}
+
+TEST(CycleTimeEstimator, JointMatchesTrapezoid)
+{
+    //the leading joint moves 2 rad at 1.05 rad/s and 1.4 rad/s^2, the other joints move less
+    double q[6] = {2.0, -1.0, 1.0, -1.57, -1.57, 0.5};
+    CycleTimeEstimator estimator;
+    estimator.reset(START, START_TCP);
+    estimator.addJoint(q, NULL, 1.05, 1.4, 0);
+
+    std::vector<double> durations;
+    EXPECT_NEAR(1.05 / 1.4 + 2.0 / 1.05, estimator.estimate(durations), DURATION_TOLERANCE);
+}
+
+TEST(CycleTimeEstimator, StopBetweenKinds)
+{
+    double target[3] = {1.4, 0.0, 0.3};
+    double q[6] = {2.0, -1.0, 1.0, -1.57, -1.57, 0.5};
+    CycleTimeEstimator estimator;
+    estimator.reset(START, START_TCP);
+    estimator.addLinear(target, NULL, 0.25, 1.2, 0.02);
+    estimator.addJoint(q, NULL, 1.05, 1.4, 0.02);
+    estimator.addTimed(NULL, NULL, 0.5);
+
+    //the radius is ignored, each move starts and ends at rest
+    std::vector<double> durations;
+    double total = estimator.estimate(durations);
+    ASSERT_EQ(3u, durations.size());
+    EXPECT_NEAR(0.25 / 1.2 + 1.0 / 0.25, durations[0], DURATION_TOLERANCE);
+    EXPECT_NEAR(1.05 / 1.4 + 2.0 / 1.05, durations[1], DURATION_TOLERANCE);
+    EXPECT_EQ(0.5, durations[2]);
+    EXPECT_NEAR(durations[0] + durations[1] + durations[2], total, DURATION_TOLERANCE);
+}
+
+/**
+ * Two joint moves of 1 rad around a right angle in joint space, the TCP moves a given distance per move.
+ * @param tcpDistance [m], 0 for unknown TCP positions
+ * @param radius TCP blend radius of the corner [m]
+ * @return total duration [s]
+ */
+static double estimateJointCorner(double tcpDistance, double radius)
+{
+    double q0[6] = {0, 0, 0, 0, 0, 0};
+    double q1[6] = {1, 0, 0, 0, 0, 0};
+    double q2[6] = {1, 1, 0, 0, 0, 0};
+    double tcp0[3] = {0, 0, 0};
+    double tcp1[3] = {tcpDistance, 0, 0};
+    double tcp2[3] = {tcpDistance, tcpDistance, 0};
+    bool hasTcp = tcpDistance > 0;
+
+    CycleTimeEstimator estimator;
+    estimator.reset(q0, hasTcp ? tcp0 : NULL);
+    estimator.addJoint(q1, hasTcp ? tcp1 : NULL, 1.05, 1.4, radius);
+    estimator.addJoint(q2, hasTcp ? tcp2 : NULL, 1.05, 1.4, 0);
+
+    std::vector<double> durations;
+    return estimator.estimate(durations);
+}
+
+/**
+ * The same corner with a blend radius in joint space.
+ * @param radius [rad]
+ * @return total duration [s]
+ */
+static double estimateJointSpaceCorner(double radius)
+{
+    double positions[18] = {0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 1, 1, 0, 0, 0, 0};
+    std::vector<double> velocities(2, 1.05);
+    std::vector<double> accelerations(2, 1.4);
+    std::vector<double> radii(2, 0.0);
+    radii[0] = radius;
+
+    std::vector<double> durations;
+    return BlendedMoveEstimator::estimate(std::vector<double>(positions, positions + 18), 6, velocities, accelerations, radii, durations);
+}
+
+TEST(CycleTimeEstimator, JointRadiusScaledToJointSpace)
+{
+    //0.5 m TCP per 1 rad: the TCP radius of 2 cm is 0.04 rad in joint space (not 0.02 rad)
+    double total = estimateJointCorner(0.5, 0.02);
+    EXPECT_NEAR(estimateJointSpaceCorner(0.04), total, DURATION_TOLERANCE);
+    EXPECT_GT(fabs(estimateJointSpaceCorner(0.02) - total), 1e-3);
+
+    //blending is faster than stopping
+    EXPECT_LT(total, estimateJointSpaceCorner(0) - 1e-3);
+
+    //the same joint space radius with twice the TCP distance per rad
+    EXPECT_NEAR(total, estimateJointCorner(1.0, 0.04), DURATION_TOLERANCE);
+}
+
+TEST(CycleTimeEstimator, JointRadiusWithoutTcp)
+{
+    //the radius can't be scaled, the moves stop at the waypoint
+    EXPECT_NEAR(estimateJointSpaceCorner(0), estimateJointCorner(0, 0.02), DURATION_TOLERANCE);
+}
+
+TEST(CycleTimeEstimator, PickAndPlaceCycle)
+{
+    double pick[6] = {0.0, -1.57, 1.57, -1.57, -1.57, 0.0};
+    double place[6] = {1.2, -1.4, 1.3, -1.47, -1.57, 0.0};
+    double start[6];
+    Kinematics::forward(Kinematics::UR5, pick, start);
+
+    //the cycle of the benchmark, blended and stopped
+    double totals[2];
+    for (int blended = 0; blended < 2; blended++)
+    {
+        double radius = blended ? 0.02 : 0.0;
+        CycleTimeEstimator estimator;
+        estimator.reset(pick, start);
+
+        double* joints[2] = {pick, place};
+        for (int k = 0; k < 2; k++)
+        {
+            double above[6];
+            double down[6];
+            Kinematics::forward(Kinematics::UR5, joints[k], above);
+            std::copy(above, above + 3, down);
+            down[2] -= 0.1;
+
+            estimator.addJoint(joints[k], above, 1.05, 1.4, radius);
+            estimator.addLinear(down, NULL, 0.25, 1.2, 0);
+            estimator.addLinear(above, joints[k], 0.25, 1.2, radius);
+        }
+
+        std::vector<double> durations;
+        totals[blended] = estimator.estimate(durations);
+        ASSERT_EQ(6u, durations.size());
+
+        double sum = 0;
+        for (size_t i = 0; i < durations.size(); i++)
+        {
+            sum += durations[i];
+        }
+        EXPECT_NEAR(sum, totals[blended], DURATION_TOLERANCE);
+
+        //down 0.1 m from a linear run of its own (after a joint move) to a stop
+        EXPECT_NEAR(0.25 / 1.2 + 0.1 / 0.25, durations[1], DURATION_TOLERANCE);
+    }
+
+    EXPECT_GT(totals[0], 0);
+    EXPECT_LE(totals[1], totals[0]);
+}
@@ -0,0 +1,311 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Tests of the driver logic per robot state
+// ----------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+
+#include <driver.h>
+#include <message_pool.h>
+
+#include <stdlib.h>
+#include <new>
+
+using namespace ur_driver;
+
+/*
+ * count heap allocations of the test process to verify the allocation free paths
+ */
+static unsigned long allocations = 0;
+
+void* operator new(size_t size)
+{
+    __sync_fetch_and_add(&allocations, 1);
+
+    void* p = malloc(size == 0 ? 1 : size);
+    if (p == NULL)
+    {
+        throw std::bad_alloc();
+    }
+
+    return p;
+}
+
+void operator delete(void* p) throw()
+{
+    free(p);
+}
+
+static RobotState createRobotState()
+{
+    JointPosition jointPosition(6);
+    JointVelocity jointVelocity(6);
+    for (int i = 0; i < 6; i++)
+    {
+        jointPosition[i] = 0.1 * i;
+        jointVelocity[i] = 0.01 * i;
+    }
+
+    CartesianPosition cartesianPosition;
+    cartesianPosition.setValues(0.4, -0.1, 0.3, 3.1, 0.1, -0.2);
+
+    return RobotState(jointPosition, jointVelocity, cartesianPosition);
+}
+
+/**
+ * The state outputs of a robot state (acquire, fill and publish) do not allocate once the pools are initialized. The
+ * publishers have a queue size of 1, so a subscriber references the last published message until the next one.
+ */
+TEST(StateMessages, PublishWithoutAllocation)
+{
+    const int CYCLES = 1000;
+
+    RobotState robotState = createRobotState();
+    ros::Time stamp(1.0);
+
+    sensor_msgs::JointState jointState;
+    jointState.name.resize(6, "joint");
+    jointState.position.resize(6, 0);
+    jointState.velocity.resize(6, 0);
+    jointState.effort.resize(6, 0);
+
+    MessagePool<sensor_msgs::JointState> jointStatePool;
+    MessagePool<geometry_msgs::Pose> poseStatePool;
+    MessagePool<robot_movement_interface::EulerFrame> toolFramePool;
+    jointStatePool.init(jointState);
+    poseStatePool.init(geometry_msgs::Pose());
+    toolFramePool.init(robot_movement_interface::EulerFrame());
+
+    sensor_msgs::JointStatePtr publishedJointState;
+    geometry_msgs::PosePtr publishedPoseState;
+    robot_movement_interface::EulerFramePtr publishedToolFrame;
+
+    unsigned long allocationsBefore = allocations;
+    for (int i = 0; i < CYCLES; i++)
+    {
+        sensor_msgs::JointStatePtr jointStateMessage = jointStatePool.acquire();
+        Driver::fillJointState(robotState, stamp, *jointStateMessage);
+        publishedJointState = jointStateMessage;
+
+        geometry_msgs::PosePtr poseStateMessage = poseStatePool.acquire();
+        Driver::fillPoseState(robotState, *poseStateMessage);
+        publishedPoseState = poseStateMessage;
+
+        robot_movement_interface::EulerFramePtr toolFrameMessage = toolFramePool.acquire();
+        Driver::fillToolFrame(robotState, *toolFrameMessage);
+        publishedToolFrame = toolFrameMessage;
+    }
+    unsigned long allocationsAfter = allocations;
+
+    EXPECT_EQ(allocationsBefore, allocationsAfter);
+    EXPECT_EQ(0u, jointStatePool.getAllocations());
+    EXPECT_EQ(0u, poseStatePool.getAllocations());
+    EXPECT_EQ(0u, toolFramePool.getAllocations());
+
+    EXPECT_EQ(6u, publishedJointState->position.size());
+    EXPECT_DOUBLE_EQ(0.5, publishedJointState->position[5]);
+    EXPECT_DOUBLE_EQ(0.05, publishedJointState->velocity[5]);
+    EXPECT_DOUBLE_EQ(0.4, publishedPoseState->position.x);
+    EXPECT_DOUBLE_EQ(-0.1, publishedToolFrame->y);
+}
+
+/**
+ * A message is only reused when no subscriber references it anymore, otherwise a copy is allocated.
+ */
+TEST(MessagePool, AllocateOnlyIfAllMessagesAreReferenced)
+{
+    geometry_msgs::Pose prototype;
+    prototype.position.x = 1.0;
+
+    MessagePool<geometry_msgs::Pose> pool(2);
+    pool.init(prototype);
+
+    geometry_msgs::PosePtr first = pool.acquire();
+    geometry_msgs::PosePtr second = pool.acquire();
+    EXPECT_NE(first.get(), second.get());
+    EXPECT_EQ(0u, pool.getAllocations());
+
+    //both messages are still referenced
+    geometry_msgs::PosePtr third = pool.acquire();
+    EXPECT_NE(first.get(), third.get());
+    EXPECT_NE(second.get(), third.get());
+    EXPECT_DOUBLE_EQ(1.0, third->position.x);
+    EXPECT_EQ(1u, pool.getAllocations());
+
+    //the released message is reused
+    geometry_msgs::Pose* released = second.get();
+    second.reset();
+    EXPECT_EQ(released, pool.acquire().get());
+    EXPECT_EQ(1u, pool.getAllocations());
+}
+
+/**
+ * Uniform random number in [-1, 1] (linear congruential generator, reproducible on all platforms).
+ * @param state
+ * @return
+ */
+static double getRandom(uint32_t& state)
+{
+    state = state * 1664525u + 1013904223u;
+
+    return state / 2147483647.5 - 1.0;
+}
+
+/**
+ * A retimed list of blended PTP moves runs to its end: the robot states (at the servo rate) pass each waypoint within
+ * the distance at which the command step (at its own rate) counts the command as finished.
+ */
+TEST(CommandStreaming, BlendedListFinishes)
+{
+    const double SERVO_FREQUENCY = 125;
+    const double COMMAND_FREQUENCY = 100;
+
+    std::vector<double> maxVelocity(6, 3.15);
+    std::vector<double> maxAcceleration(6, 3.0);
+    uint32_t state = 7;
+
+    for (int list = 0; list < 50; list++)
+    {
+        //random steps and, every other list, nearly collinear waypoints which are passed fast
+        std::vector<double> start(6, 0.0);
+        std::vector<double> direction(6);
+        for (int j = 0; j < 6; j++)
+        {
+            direction[j] = getRandom(state);
+        }
+
+        std::vector<robot_movement_interface::Command> commands;
+        std::vector<double> q = start;
+        for (int i = 0; i < 8; i++)
+        {
+            for (int j = 0; j < 6; j++)
+            {
+                q[j] += (list % 2 == 0) ? getRandom(state) : 0.3 * direction[j] + 0.01 * getRandom(state);
+            }
+
+            robot_movement_interface::Command command;
+            command.command_type = "PTP";
+            command.pose_type = "JOINTS";
+            command.pose.assign(q.begin(), q.end());
+            command.blending.push_back((i < 7) ? 0.05 : 0.0);
+            if (i % 2 == 0)
+            {
+                command.blending.push_back(0.02);
+            }
+            commands.push_back(command);
+        }
+
+        SplineTrajectory trajectory;
+        ASSERT_TRUE(Driver::retimeCommandList(commands, start, maxVelocity, maxAcceleration, SERVO_FREQUENCY, Kinematics::UR5, trajectory));
+
+        //the command step checks the last robot state and the motion since the state of the previous step
+        size_t finished = 0;
+        JointPosition startPosition(6);
+        RobotState previousState(startPosition, JointVelocity(6), CartesianPosition());
+        double duration = trajectory.getDuration() + 1.0;
+        for (double time = 0; time <= duration && finished < commands.size(); time += 1.0 / COMMAND_FREQUENCY)
+        {
+            double stateTime = std::min(floor(time * SERVO_FREQUENCY) / SERVO_FREQUENCY, trajectory.getDuration());
+            JointPosition jointPosition(6);
+            trajectory.sample(stateTime, &jointPosition[0], NULL, NULL);
+            RobotState robotState(jointPosition, JointVelocity(6), CartesianPosition());
+
+            int result;
+            while (finished < commands.size() && (Driver::isCommandFinished(commands[finished], robotState, &result)
+                || Driver::isCommandPassed(commands[finished], previousState, robotState, &result)))
+            {
+                finished++;
+            }
+            previousState = robotState;
+        }
+
+        EXPECT_EQ(commands.size(), finished) << "list " << list;
+    }
+}
+
+/**
+ * The blend radius of a retimed PTP move is a TCP distance: the path passes the waypoint within the radius scaled to
+ * joint space, a smaller radius passes it closer.
+ */
+TEST(CommandStreaming, BlendRadiusBoundsDeviation)
+{
+    std::vector<double> maxVelocity(6, 3.15);
+    std::vector<double> maxAcceleration(6, 3.0);
+    double waypoints[3][6] = {{0.0, -1.2, 1.2, -1.5, -1.5, 0.0}, {0.5, -1.0, 1.0, -1.5, -1.5, 0.0}, {0.5, -1.4, 1.6, -1.5, -1.5, 0.3}};
+
+    //joint distance per TCP distance of the moves to and from the blended waypoint
+    double scale = 0;
+    for (int i = 0; i < 2; i++)
+    {
+        double from[6];
+        double to[6];
+        Ur5Kinematics::forward(waypoints[i], from);
+        Ur5Kinematics::forward(waypoints[i + 1], to);
+
+        double jointDistance = 0;
+        double tcpDistance = 0;
+        for (int j = 0; j < 6; j++)
+        {
+            jointDistance += pow(waypoints[i + 1][j] - waypoints[i][j], 2);
+        }
+        for (int j = 0; j < 3; j++)
+        {
+            tcpDistance += pow(to[j] - from[j], 2);
+        }
+        double ratio = sqrt(jointDistance) / sqrt(tcpDistance);
+        scale = (i == 0) ? ratio : std::min(scale, ratio);
+    }
+
+    double radii[2] = {0.005, 0.05};
+    double closest[2];
+    for (int k = 0; k < 2; k++)
+    {
+        std::vector<robot_movement_interface::Command> commands;
+        for (int i = 1; i < 3; i++)
+        {
+            robot_movement_interface::Command command;
+            command.command_type = "PTP";
+            command.pose_type = "JOINTS";
+            command.pose.assign(waypoints[i], waypoints[i] + 6);
+            command.blending.push_back((i == 1) ? radii[k] : 0.0);
+            command.blending.push_back(1.0);
+            commands.push_back(command);
+        }
+
+        SplineTrajectory trajectory;
+        std::vector<double> start(waypoints[0], waypoints[0] + 6);
+        ASSERT_TRUE(Driver::retimeCommandList(commands, start, maxVelocity, maxAcceleration, 500, Kinematics::UR5, trajectory));
+
+        closest[k] = 1e9;
+        for (double time = 0; time <= trajectory.getDuration(); time += 0.0005)
+        {
+            double q[6];
+            trajectory.sample(time, q, NULL, NULL);
+
+            double sum = 0;
+            for (int j = 0; j < 6; j++)
+            {
+                sum += pow(q[j] - waypoints[1][j], 2);
+            }
+            closest[k] = std::min(closest[k], sqrt(sum));
+        }
+
+        //the samples are 0.5 ms apart
+        EXPECT_LE(closest[k], radii[k] * scale + 2e-3) << "radius " << radii[k];
+    }
+
+    EXPECT_LT(closest[0], closest[1]);
+}
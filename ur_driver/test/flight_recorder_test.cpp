@@ -0,0 +1,183 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Tests of the flight recorder ring
+// ----------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+
+#include <flight_recorder.h>
+
+#include <algorithm>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace ur_driver;
+
+/**
+ * Ring of a few records, the payload lengths cycle through sizes which leave gaps of all kinds at the end of the ring:
+ * padding records and gaps smaller than a record header.
+ */
+static const uint64_t CAPACITY = 1120;
+static const uint32_t LENGTHS[] = {0, 1, 7, 8, 13, 50, 100, 203, 17, 64};
+static const size_t LENGTH_COUNT = sizeof(LENGTHS) / sizeof(LENGTHS[0]);
+static const size_t RECORD_COUNT = 400;
+
+/**
+ * Payload of a record, different for each sequence number.
+ */
+static std::vector<char> createPayload(uint64_t sequence)
+{
+    std::vector<char> payload(LENGTHS[sequence % LENGTH_COUNT]);
+    for (size_t i = 0; i < payload.size(); i++)
+    {
+        payload[i] = (char)(sequence * 31 + i * 7);
+    }
+
+    return payload;
+}
+
+/**
+ * Temporary recorder file, removed at the end of the test.
+ */
+class FlightRecorderTest : public ::testing::Test
+{
+    protected:
+        std::string fileName;
+
+        virtual void SetUp()
+        {
+            char name[] = "/tmp/flight_recorder_test_XXXXXX";
+            int fileDescriptor = mkstemp(name);
+            ASSERT_GE(fileDescriptor, 0);
+            close(fileDescriptor);
+            fileName = name;
+        }
+
+        virtual void TearDown()
+        {
+            unlink(fileName.c_str());
+        }
+};
+
+//=================================================================
+// FlightRecorder and FlightRecorderReader
+//=================================================================
+TEST_F(FlightRecorderTest, NewestRecordsSurviveWraps)
+{
+    FlightRecorder recorder;
+    ASSERT_TRUE(recorder.open(fileName, CAPACITY));
+
+    //offset of the next record in the ring, to check that the test covers all gaps
+    uint64_t offset = 0;
+    int paddings = 0;
+    int smallGaps = 0;
+    uint64_t largestSize = 0;
+
+    for (uint64_t sequence = 0; sequence < RECORD_COUNT; sequence++)
+    {
+        std::vector<char> payload = createPayload(sequence);
+        uint64_t size = flightRecorderRecordSize(payload.size());
+        largestSize = std::max(largestSize, size);
+        if (offset + size > CAPACITY)
+        {
+            bool isSmall = CAPACITY - offset < sizeof(FlightRecorderRecordHeader);
+            paddings += isSmall ? 0 : 1;
+            smallGaps += isSmall ? 1 : 0;
+            offset = 0;
+        }
+        offset = (offset + size) % CAPACITY;
+
+        recorder.record(FlightRecorderRecordHeader::FRAME, 30000 + sequence % 4, payload.empty() ? NULL : &payload[0], payload.size());
+
+        //the file is mapped shared, the reader sees every completed record
+        FlightRecorderReader reader;
+        ASSERT_TRUE(reader.open(fileName));
+
+        std::vector<uint64_t> sequences;
+        uint64_t survivingBytes = 0;
+        FlightRecorderRecord record;
+        while (reader.next(record))
+        {
+            ASSERT_EQ(FlightRecorderRecordHeader::FRAME, record.type);
+            ASSERT_EQ(30000 + record.sequence % 4, record.source);
+            ASSERT_TRUE(record.data == createPayload(record.sequence)) << "record " << record.sequence << " after " << sequence;
+
+            sequences.push_back(record.sequence);
+            survivingBytes += flightRecorderRecordSize(record.data.size());
+        }
+
+        //the newest records in order, up to the one just recorded
+        ASSERT_FALSE(sequences.empty());
+        EXPECT_EQ(sequence, sequences.back());
+        for (size_t i = 1; i < sequences.size(); i++)
+        {
+            ASSERT_EQ(sequences[i - 1] + 1, sequences[i]) << "after " << sequence;
+        }
+
+        //only records in the way of the new ones are dropped: at most the gap and the record which didn't fit
+        EXPECT_LE(survivingBytes, CAPACITY);
+        if (sequences.front() > 0)
+        {
+            EXPECT_GT(survivingBytes + 2 * largestSize, CAPACITY) << "after " << sequence;
+        }
+    }
+
+    EXPECT_GT(paddings, 0);
+    EXPECT_GT(smallGaps, 0);
+
+    recorder.close();
+
+    //after closing the file is complete
+    FlightRecorderReader reader;
+    ASSERT_TRUE(reader.open(fileName));
+    FlightRecorderRecord record;
+    uint64_t last = 0;
+    while (reader.next(record))
+    {
+        last = record.sequence;
+    }
+    EXPECT_EQ(RECORD_COUNT - 1, last);
+}
+
+TEST_F(FlightRecorderTest, OversizedRecordDropped)
+{
+    FlightRecorder recorder;
+    ASSERT_TRUE(recorder.open(fileName, CAPACITY));
+
+    std::vector<char> small = createPayload(5);
+    std::vector<char> large(CAPACITY);
+    recorder.record(FlightRecorderRecordHeader::SCRIPT, 30002, &small[0], small.size());
+    recorder.record(FlightRecorderRecordHeader::SCRIPT, 30002, &large[0], large.size());
+    recorder.close();
+
+    //the ring keeps the small record
+    FlightRecorderReader reader;
+    ASSERT_TRUE(reader.open(fileName));
+    FlightRecorderRecord record;
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(FlightRecorderRecordHeader::SCRIPT, record.type);
+    EXPECT_EQ(0u, record.sequence);
+    EXPECT_TRUE(record.data == small);
+    EXPECT_FALSE(reader.next(record));
+}
+
+TEST_F(FlightRecorderTest, InvalidFile)
+{
+    //the empty temporary file has no header
+    FlightRecorderReader reader;
+    EXPECT_FALSE(reader.open(fileName));
+    EXPECT_FALSE(reader.open(fileName + ".missing"));
+}
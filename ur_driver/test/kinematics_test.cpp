@@ -0,0 +1,322 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Tests of the closed form UR kinematics
+// ----------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+
+#include <kinematics.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+using namespace ur_driver;
+
+/**
+ * Largest difference of the positions [m] and of the rotation matrix elements to the product of the DH
+ * transformations, a few times the rounding errors.
+ */
+static const double FORWARD_TOLERANCE = 1e-12;
+
+//=================================================================
+// reference: product of the six DH transformations
+//=================================================================
+template <typename Parameters>
+static void dhForward(const double* q, double* rotation, double* position)
+{
+    const double alpha[6] = {M_PI_2, 0, 0, M_PI_2, -M_PI_2, 0};
+    const double a[6] = {0, Parameters::a2(), Parameters::a3(), 0, 0, 0};
+    const double d[6] = {Parameters::d1(), 0, 0, Parameters::d4(), Parameters::d5(), Parameters::d6()};
+
+    double transform[3][4] = {{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}};
+    for (int i = 0; i < 6; i++)
+    {
+        double ct = std::cos(q[i]);
+        double st = std::sin(q[i]);
+        double ca = std::cos(alpha[i]);
+        double sa = std::sin(alpha[i]);
+        double link[3][4] = {{ct, -st * ca, st * sa, a[i] * ct}, {st, ct * ca, -ct * sa, a[i] * st}, {0, sa, ca, d[i]}};
+
+        double product[3][4];
+        for (int row = 0; row < 3; row++)
+        {
+            for (int column = 0; column < 4; column++)
+            {
+                product[row][column] = transform[row][0] * link[0][column] + transform[row][1] * link[1][column] + transform[row][2] * link[2][column];
+            }
+            product[row][3] += transform[row][3];
+        }
+        std::copy(&product[0][0], &product[0][0] + 12, &transform[0][0]);
+    }
+
+    for (int row = 0; row < 3; row++)
+    {
+        rotation[row * 3] = transform[row][0];
+        rotation[row * 3 + 1] = transform[row][1];
+        rotation[row * 3 + 2] = transform[row][2];
+        position[row] = transform[row][3];
+    }
+}
+
+//=================================================================
+// samples
+//=================================================================
+static const size_t SAMPLE_COUNT = 1024;
+
+/**
+ * Random joint positions in [-2 pi, 2 pi].
+ * @param q 6 values per sample
+ */
+static void createJointSamples(std::vector<double>& q)
+{
+    unsigned int seed = 42;
+    q.resize(SAMPLE_COUNT * 6);
+    for (size_t i = 0; i < q.size(); i++)
+    {
+        q[i] = (-1.0 + 2.0 * rand_r(&seed) / (double)RAND_MAX) * 2 * M_PI;
+    }
+}
+
+/**
+ * Rotation matrix of an axis angle.
+ */
+static void axisToMatrix(const double* axis, double* matrix)
+{
+    double x, y, z, w;
+    Rotation::axisToQuaternion(axis[0], axis[1], axis[2], x, y, z, w);
+    Rotation::quaternionToMatrix(x, y, z, w, matrix[0], matrix[1], matrix[2], matrix[3], matrix[4], matrix[5], matrix[6], matrix[7], matrix[8]);
+}
+
+//=================================================================
+// forward kinematics
+//=================================================================
+template <typename Parameters>
+static void testForward(Kinematics::Model model)
+{
+    std::vector<double> samples;
+    createJointSamples(samples);
+
+    for (size_t i = 0; i < SAMPLE_COUNT; i++)
+    {
+        const double* q = &samples[i * 6];
+        double expectedRotation[9];
+        double expectedPosition[3];
+        dhForward<Parameters>(q, expectedRotation, expectedPosition);
+
+        //rotation matrix of the closed form
+        double rotation[9];
+        double position[3];
+        UrKinematics<Parameters>::forward(q, rotation, position);
+        for (int j = 0; j < 9; j++)
+        {
+            ASSERT_NEAR(expectedRotation[j], rotation[j], FORWARD_TOLERANCE) << "sample " << i << " element " << j;
+        }
+        for (int j = 0; j < 3; j++)
+        {
+            ASSERT_NEAR(expectedPosition[j], position[j], FORWARD_TOLERANCE) << "sample " << i << " axis " << j;
+        }
+
+        //axis angle pose of the runtime dispatch
+        double pose[6];
+        ASSERT_TRUE(Kinematics::forward(model, q, pose));
+        axisToMatrix(&pose[3], rotation);
+        for (int j = 0; j < 9; j++)
+        {
+            ASSERT_NEAR(expectedRotation[j], rotation[j], FORWARD_TOLERANCE) << "sample " << i << " element " << j;
+        }
+        for (int j = 0; j < 3; j++)
+        {
+            ASSERT_NEAR(expectedPosition[j], pose[j], FORWARD_TOLERANCE) << "sample " << i << " axis " << j;
+        }
+    }
+}
+
+TEST(Kinematics, Ur5ForwardMatchesDh)
+{
+    testForward<Ur5Parameters>(Kinematics::UR5);
+}
+
+TEST(Kinematics, Ur10ForwardMatchesDh)
+{
+    testForward<Ur10Parameters>(Kinematics::UR10);
+}
+
+TEST(Kinematics, BatchForwardMatchesSingle)
+{
+    std::vector<double> samples;
+    createJointSamples(samples);
+
+    JointBatch joints;
+    joints.resize(SAMPLE_COUNT);
+    for (size_t i = 0; i < SAMPLE_COUNT; i++)
+    {
+        for (int j = 0; j < 6; j++)
+        {
+            joints.q[j][i] = samples[i * 6 + j];
+        }
+    }
+
+    PoseBatch poses;
+    ASSERT_TRUE(Kinematics::forward(Kinematics::UR10, joints, poses));
+    for (size_t i = 0; i < SAMPLE_COUNT; i++)
+    {
+        double pose[6];
+        Kinematics::forward(Kinematics::UR10, &samples[i * 6], pose);
+        EXPECT_NEAR(pose[0], poses.position.x[i], FORWARD_TOLERANCE);
+        EXPECT_NEAR(pose[1], poses.position.y[i], FORWARD_TOLERANCE);
+        EXPECT_NEAR(pose[2], poses.position.z[i], FORWARD_TOLERANCE);
+        EXPECT_NEAR(pose[3], poses.rotation.x[i], FORWARD_TOLERANCE);
+        EXPECT_NEAR(pose[4], poses.rotation.y[i], FORWARD_TOLERANCE);
+        EXPECT_NEAR(pose[5], poses.rotation.z[i], FORWARD_TOLERANCE);
+    }
+}
+
+TEST(Kinematics, NoModel)
+{
+    double q[6] = {0, 0, 0, 0, 0, 0};
+    double pose[6];
+    EXPECT_FALSE(Kinematics::forward(Kinematics::NONE, q, pose));
+    EXPECT_EQ(Kinematics::NONE, Kinematics::getModel("controller"));
+    EXPECT_EQ(Kinematics::UR5, Kinematics::getModel("ur5"));
+    EXPECT_EQ(Kinematics::UR10, Kinematics::getModel("ur10"));
+}
+
+//=================================================================
+// inverse kinematics
+//=================================================================
+/**
+ * Largest joint difference of the solution which reproduces the sampled joints [rad]. The inverse kinematics lose
+ * accuracy near the singularities, the random samples stay clear of them.
+ */
+static const double INVERSE_TOLERANCE = 1e-8;
+
+/**
+ * Largest difference of two joint positions modulo 2 pi.
+ */
+static double getJointDistance(const double* q1, const double* q2)
+{
+    double distance = 0;
+    for (int j = 0; j < 6; j++)
+    {
+        distance = std::max(distance, std::fabs(std::remainder(q1[j] - q2[j], 2 * M_PI)));
+    }
+
+    return distance;
+}
+
+/**
+ * All inverse solutions of the flange pose of joint positions.
+ */
+static void inverseOfForward(Kinematics::Model model, const double* q, InverseSolutions& solutions)
+{
+    double pose[6];
+    Kinematics::forward(model, q, pose);
+
+    double rotation[9];
+    axisToMatrix(&pose[3], rotation);
+    Kinematics::inverse(model, rotation, pose, q[5], solutions);
+}
+
+static void testInverse(Kinematics::Model model)
+{
+    std::vector<double> samples;
+    createJointSamples(samples);
+
+    for (size_t i = 0; i < SAMPLE_COUNT; i++)
+    {
+        const double* q = &samples[i * 6];
+        InverseSolutions solutions;
+        inverseOfForward(model, q, solutions);
+
+        //the sampled joints are one of the solutions, each solution reaches the pose
+        double minDistance = 2 * M_PI;
+        for (int k = 0; k < solutions.count; k++)
+        {
+            minDistance = std::min(minDistance, getJointDistance(solutions.q[k], q));
+
+            double expected[6];
+            double pose[6];
+            Kinematics::forward(model, q, expected);
+            Kinematics::forward(model, solutions.q[k], pose);
+            for (int j = 0; j < 3; j++)
+            {
+                EXPECT_NEAR(expected[j], pose[j], 1e-9) << "sample " << i << " solution " << k;
+            }
+        }
+        EXPECT_LT(minDistance, INVERSE_TOLERANCE) << "sample " << i << " with " << solutions.count << " solutions";
+    }
+}
+
+TEST(Kinematics, Ur5InverseContainsJoints)
+{
+    testInverse(Kinematics::UR5);
+}
+
+TEST(Kinematics, Ur10InverseContainsJoints)
+{
+    testInverse(Kinematics::UR10);
+}
+
+TEST(Kinematics, InverseOutOfReach)
+{
+    double rotation[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+    double position[3] = {3.0, 0, 0.5};
+    InverseSolutions solutions;
+    ASSERT_TRUE(Kinematics::inverse(Kinematics::UR5, rotation, position, 0.0, solutions));
+    EXPECT_EQ(0, solutions.count);
+}
+
+TEST(Kinematics, NearestKeepsBranch)
+{
+    std::vector<double> samples;
+    createJointSamples(samples);
+
+    for (size_t i = 0; i < SAMPLE_COUNT; i++)
+    {
+        const double* q = &samples[i * 6];
+        InverseSolutions solutions;
+        inverseOfForward(Kinematics::UR5, q, solutions);
+
+        //the nearest solution of the branch of the joints are the joints themselves (within the joint limits)
+        double nearest[6];
+        int branch = Kinematics::getBranch(Kinematics::UR5, q);
+        ASSERT_GE(Kinematics::nearest(solutions, q, branch, nearest), 0) << "sample " << i;
+        for (int j = 0; j < 6; j++)
+        {
+            EXPECT_NEAR(q[j], nearest[j], INVERSE_TOLERANCE) << "sample " << i << " joint " << j;
+        }
+
+        //any other branch gives a solution of that branch or none
+        for (int other = 0; other < 8; other++)
+        {
+            int index = Kinematics::nearest(solutions, q, other, nearest);
+            bool hasBranch = false;
+            for (int k = 0; k < solutions.count; k++)
+            {
+                hasBranch = hasBranch || solutions.branch[k] == other;
+            }
+
+            ASSERT_EQ(hasBranch, index >= 0) << "sample " << i << " branch " << other;
+            if (index >= 0)
+            {
+                EXPECT_EQ(other, solutions.branch[index]);
+                EXPECT_EQ(other, Kinematics::getBranch(Kinematics::UR5, nearest));
+                EXPECT_LT(getJointDistance(solutions.q[index], nearest), 1e-12);
+            }
+        }
+    }
+}
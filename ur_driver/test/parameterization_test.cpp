@@ -0,0 +1,120 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Tests of the time optimal parameterization
+// ----------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+
+#include <parameterization.h>
+
+#include <math.h>
+#include <stdint.h>
+
+using namespace ur_driver;
+
+/*
+ * limits: the velocities of the <limit> tags of ur10_robot.urdf, the accelerations as configured
+ */
+static const double MAX_VELOCITY[6] = { 2.16, 2.16, 3.15, 3.2, 3.2, 3.2 };
+static const double MAX_ACCELERATION[6] = { 3.0, 3.0, 4.0, 6.0, 6.0, 6.0 };
+
+/**
+ * Relative tolerance of the sampled accelerations, the tangent turns by up to 0.02 rad between the grid points of an
+ * arc at which the limits are kept.
+ */
+static const double TOLERANCE = 1e-3;
+
+/**
+ * Deterministic random numbers (linear congruential generator).
+ * @param state
+ * @return [-1, 1]
+ */
+static double getRandom(uint32_t& state)
+{
+    state = state * 1664525u + 1013904223u;
+
+    return state / 2147483647.5 - 1.0;
+}
+
+/**
+ * Check the joint velocities and accelerations sampled at 0.5 ms against the limits.
+ * @param deviation [rad] of all inner waypoints
+ */
+static void checkRandomLists(double deviation)
+{
+    const int LISTS = 100;
+    const double INTERVAL = 0.0005;
+
+    uint32_t state = 1;
+    for (int l = 0; l < LISTS; l++)
+    {
+        //3 to 9 waypoints within +-3 rad
+        int count = 3 + (int)((getRandom(state) + 1) * 3.49);
+        std::vector<double> waypoints;
+        std::vector<double> deviations(count, deviation);
+        for (int i = 0; i < count * 6; i++)
+        {
+            waypoints.push_back(3.0 * getRandom(state));
+        }
+
+        PathParameterization parameterization;
+        parameterization.setLimits(std::vector<double>(MAX_VELOCITY, MAX_VELOCITY + 6), std::vector<double>(MAX_ACCELERATION, MAX_ACCELERATION + 6));
+        ASSERT_TRUE(parameterization.compute(waypoints, deviations)) << "list " << l;
+
+        double position[6];
+        double velocity[6];
+        double acceleration[6];
+        double duration = parameterization.getDuration();
+        for (double time = 0; time < duration + INTERVAL; time += INTERVAL)
+        {
+            parameterization.sample(time, position, velocity, acceleration);
+            for (int j = 0; j < 6; j++)
+            {
+                ASSERT_LE(fabs(velocity[j]), MAX_VELOCITY[j] * (1 + TOLERANCE)) << "list " << l << " time " << time << " joint " << j;
+                ASSERT_LE(fabs(acceleration[j]), MAX_ACCELERATION[j] * (1 + TOLERANCE)) << "list " << l << " time " << time << " joint " << j;
+            }
+        }
+
+        //the motion ends at rest at the last waypoint
+        parameterization.sample(duration, position, velocity, acceleration);
+        for (int j = 0; j < 6; j++)
+        {
+            EXPECT_NEAR(waypoints[(count - 1) * 6 + j], position[j], 1e-9);
+            EXPECT_NEAR(0.0, velocity[j], 1e-9);
+        }
+    }
+}
+
+/**
+ * Blend arcs with a radius close to the grid step (the default deviation of a blended command).
+ */
+TEST(PathParameterization, LimitsOnSmallArcs)
+{
+    checkRandomLists(0.01);
+}
+
+TEST(PathParameterization, LimitsOnLargeArcs)
+{
+    checkRandomLists(0.05);
+}
+
+/**
+ * Unblended waypoints are passed at rest.
+ */
+TEST(PathParameterization, LimitsWithStops)
+{
+    checkRandomLists(0.0);
+}
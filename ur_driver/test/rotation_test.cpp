@@ -0,0 +1,309 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Tests of the rotation conversions
+// ----------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+
+#include <rotation.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace ur_driver;
+
+/*
+ * largest errors of the round trips [rad], a few times the rounding errors of the conversions
+ */
+static const double AXIS_TOLERANCE = 1e-14;
+static const double RPY_TOLERANCE = 1e-13;
+
+/**
+ * Largest error near identity relative to the angle, the conversions must not lose digits for tiny angles.
+ */
+static const double RELATIVE_TOLERANCE = 1e-14;
+
+//=================================================================
+// samples
+//=================================================================
+enum SampleSet
+{
+    GENERIC = 0,    // uniform angles
+    IDENTITY = 1,   // rotations of 1e-12 to 1e-3 rad
+    GIMBAL_LOCK = 2 // pitch within 1e-12 to 1e-3 rad of +-pi/2 (rpy) or angles near pi (axis angle)
+};
+
+static const size_t SAMPLE_COUNT = 1024;
+
+static double randomValue(unsigned int& seed, double min, double max)
+{
+    return min + (max - min) * rand_r(&seed) / (double)RAND_MAX;
+}
+
+/**
+ * Random axis angles with an angle in [0, pi].
+ */
+static Vector3Batch createAxisSamples(SampleSet set)
+{
+    unsigned int seed = 42;
+    Vector3Batch axis;
+    axis.resize(SAMPLE_COUNT);
+
+    for (size_t i = 0; i < SAMPLE_COUNT; i++)
+    {
+        double x = randomValue(seed, -1, 1);
+        double y = randomValue(seed, -1, 1);
+        double z = randomValue(seed, -1, 1);
+        double length = std::sqrt(x * x + y * y + z * z);
+
+        double angle = randomValue(seed, 0, M_PI);
+        if (set == IDENTITY)
+        {
+            angle = std::pow(10.0, randomValue(seed, -12, -3));
+        }
+        else if (set == GIMBAL_LOCK)
+        {
+            angle = M_PI - std::pow(10.0, randomValue(seed, -12, -3));
+        }
+
+        axis.x[i] = x / length * angle;
+        axis.y[i] = y / length * angle;
+        axis.z[i] = z / length * angle;
+    }
+
+    return axis;
+}
+
+static Vector3Batch createRpySamples(SampleSet set)
+{
+    unsigned int seed = 42;
+    Vector3Batch rpy;
+    rpy.resize(SAMPLE_COUNT);
+
+    for (size_t i = 0; i < SAMPLE_COUNT; i++)
+    {
+        double scale = (set == IDENTITY) ? std::pow(10.0, randomValue(seed, -12, -3)) : 1.0;
+        rpy.x[i] = scale * randomValue(seed, -M_PI, M_PI);
+        rpy.y[i] = scale * randomValue(seed, -M_PI_2, M_PI_2);
+        rpy.z[i] = scale * randomValue(seed, -M_PI, M_PI);
+
+        if (set == GIMBAL_LOCK)
+        {
+            rpy.y[i] = ((i % 2 == 0) ? 1 : -1) * (M_PI_2 - std::pow(10.0, randomValue(seed, -12, -3)));
+        }
+    }
+
+    return rpy;
+}
+
+/**
+ * Angle between two rotations given as quaternions.
+ */
+static double rotationError(double x1, double y1, double z1, double w1, double x2, double y2, double z2, double w2)
+{
+    double n1 = std::sqrt(x1 * x1 + y1 * y1 + z1 * z1 + w1 * w1);
+    double n2 = std::sqrt(x2 * x2 + y2 * y2 + z2 * z2 + w2 * w2);
+
+    //q1^-1 * q2, the vector part is sin(error/2)
+    double w = (w1 * w2 + x1 * x2 + y1 * y2 + z1 * z2) / (n1 * n2);
+    double x = (w1 * x2 - x1 * w2 - y1 * z2 + z1 * y2) / (n1 * n2);
+    double y = (w1 * y2 + x1 * z2 - y1 * w2 - z1 * x2) / (n1 * n2);
+    double z = (w1 * z2 - x1 * y2 + y1 * x2 - z1 * w2) / (n1 * n2);
+
+    return 2.0 * std::atan2(std::sqrt(x * x + y * y + z * z), std::fabs(w));
+}
+
+/**
+ * Round trip axis angle -> quaternion -> axis angle.
+ * @param set
+ * @param tolerance Largest error [rad].
+ * @param relativeTolerance Largest error relative to the angle.
+ */
+static void checkAxisRoundTrip(SampleSet set, double tolerance, double relativeTolerance)
+{
+    Vector3Batch axis = createAxisSamples(set);
+
+    for (size_t i = 0; i < SAMPLE_COUNT; i++)
+    {
+        double x, y, z, w, rx, ry, rz;
+        Rotation::axisToQuaternion(axis.x[i], axis.y[i], axis.z[i], x, y, z, w);
+        Rotation::quaternionToAxis(x, y, z, w, rx, ry, rz);
+
+        double dx = rx - axis.x[i];
+        double dy = ry - axis.y[i];
+        double dz = rz - axis.z[i];
+        double error = std::sqrt(dx * dx + dy * dy + dz * dz);
+        double angle = std::sqrt(axis.x[i] * axis.x[i] + axis.y[i] * axis.y[i] + axis.z[i] * axis.z[i]);
+
+        //an angle near pi may come back as the opposite axis angle of the same rotation
+        double qx, qy, qz, qw;
+        Rotation::axisToQuaternion(rx, ry, rz, qx, qy, qz, qw);
+        error = std::min(error, rotationError(x, y, z, w, qx, qy, qz, qw));
+
+        EXPECT_LE(error, tolerance) << "sample " << i;
+        EXPECT_LE(error / angle, relativeTolerance) << "sample " << i;
+    }
+}
+
+/**
+ * Round trip roll, pitch, yaw -> quaternion -> roll, pitch, yaw. The error is the angle between the rotations, roll
+ * and yaw are not unique in the gimbal lock.
+ * @param set
+ * @param tolerance Largest error [rad].
+ * @param relativeTolerance Largest error relative to the angle of the rotation.
+ */
+static void checkRpyRoundTrip(SampleSet set, double tolerance, double relativeTolerance)
+{
+    Vector3Batch rpy = createRpySamples(set);
+
+    for (size_t i = 0; i < SAMPLE_COUNT; i++)
+    {
+        double x, y, z, w, roll, pitch, yaw;
+        Rotation::rpyToQuaternion(rpy.x[i], rpy.y[i], rpy.z[i], x, y, z, w);
+        Rotation::quaternionToRpy(x, y, z, w, roll, pitch, yaw);
+
+        double rx, ry, rz, rw;
+        Rotation::rpyToQuaternion(roll, pitch, yaw, rx, ry, rz, rw);
+        double error = rotationError(x, y, z, w, rx, ry, rz, rw);
+        double angle = 2.0 * std::atan2(std::sqrt(x * x + y * y + z * z), std::fabs(w));
+
+        EXPECT_LE(error, tolerance) << "sample " << i;
+        EXPECT_LE(error / angle, relativeTolerance) << "sample " << i;
+    }
+}
+
+//=================================================================
+// tests
+//=================================================================
+TEST(Rotation, ZeroRotation)
+{
+    double x, y, z, w;
+    Rotation::axisToQuaternion(0, 0, 0, x, y, z, w);
+    EXPECT_EQ(0.0, x);
+    EXPECT_EQ(0.0, y);
+    EXPECT_EQ(0.0, z);
+    EXPECT_EQ(1.0, w);
+
+    Rotation::rpyToQuaternion(0, 0, 0, x, y, z, w);
+    EXPECT_EQ(0.0, x);
+    EXPECT_EQ(0.0, y);
+    EXPECT_EQ(0.0, z);
+    EXPECT_EQ(1.0, w);
+
+    double rx, ry, rz;
+    Rotation::quaternionToAxis(0, 0, 0, 1, rx, ry, rz);
+    EXPECT_EQ(0.0, rx);
+    EXPECT_EQ(0.0, ry);
+    EXPECT_EQ(0.0, rz);
+
+    //the sign of the quaternion does not matter
+    Rotation::quaternionToAxis(0, 0, 0, -1, rx, ry, rz);
+    EXPECT_EQ(0.0, rx);
+    EXPECT_EQ(0.0, ry);
+    EXPECT_EQ(0.0, rz);
+
+    double roll, pitch, yaw;
+    Rotation::quaternionToRpy(0, 0, 0, 1, roll, pitch, yaw);
+    EXPECT_EQ(0.0, roll);
+    EXPECT_EQ(0.0, pitch);
+    EXPECT_EQ(0.0, yaw);
+
+    Rotation::axisToRpy(0, 0, 0, roll, pitch, yaw);
+    EXPECT_EQ(0.0, roll);
+    EXPECT_EQ(0.0, pitch);
+    EXPECT_EQ(0.0, yaw);
+
+    Rotation::rpyToAxis(0, 0, 0, rx, ry, rz);
+    EXPECT_EQ(0.0, rx);
+    EXPECT_EQ(0.0, ry);
+    EXPECT_EQ(0.0, rz);
+}
+
+TEST(Rotation, AxisRoundTrip)
+{
+    checkAxisRoundTrip(GENERIC, AXIS_TOLERANCE, 1.0);
+}
+
+TEST(Rotation, AxisRoundTripNearIdentity)
+{
+    checkAxisRoundTrip(IDENTITY, AXIS_TOLERANCE, RELATIVE_TOLERANCE);
+}
+
+TEST(Rotation, AxisRoundTripNearHalfTurn)
+{
+    checkAxisRoundTrip(GIMBAL_LOCK, AXIS_TOLERANCE, 1.0);
+}
+
+TEST(Rotation, RpyRoundTrip)
+{
+    checkRpyRoundTrip(GENERIC, RPY_TOLERANCE, 1.0);
+}
+
+TEST(Rotation, RpyRoundTripNearIdentity)
+{
+    checkRpyRoundTrip(IDENTITY, RPY_TOLERANCE, RELATIVE_TOLERANCE);
+}
+
+TEST(Rotation, RpyRoundTripNearGimbalLock)
+{
+    checkRpyRoundTrip(GIMBAL_LOCK, RPY_TOLERANCE, 1.0);
+}
+
+/**
+ * The batch variants give the same results as the scalar conversions.
+ */
+TEST(RotationBatch, SameAsScalar)
+{
+    Vector3Batch axis = createAxisSamples(GENERIC);
+    Vector3Batch rpy = createRpySamples(GENERIC);
+
+    QuaternionBatch axisQuaternion;
+    QuaternionBatch rpyQuaternion;
+    Vector3Batch axisRpy;
+    Vector3Batch rpyAxis;
+    RotationBatch::axisToQuaternion(axis, axisQuaternion);
+    RotationBatch::rpyToQuaternion(rpy, rpyQuaternion);
+    RotationBatch::axisToRpy(axis, axisRpy);
+    RotationBatch::rpyToAxis(rpy, rpyAxis);
+
+    for (size_t i = 0; i < SAMPLE_COUNT; i++)
+    {
+        double x, y, z, w;
+        Rotation::axisToQuaternion(axis.x[i], axis.y[i], axis.z[i], x, y, z, w);
+        EXPECT_DOUBLE_EQ(x, axisQuaternion.x[i]);
+        EXPECT_DOUBLE_EQ(y, axisQuaternion.y[i]);
+        EXPECT_DOUBLE_EQ(z, axisQuaternion.z[i]);
+        EXPECT_DOUBLE_EQ(w, axisQuaternion.w[i]);
+
+        Rotation::rpyToQuaternion(rpy.x[i], rpy.y[i], rpy.z[i], x, y, z, w);
+        EXPECT_DOUBLE_EQ(x, rpyQuaternion.x[i]);
+        EXPECT_DOUBLE_EQ(y, rpyQuaternion.y[i]);
+        EXPECT_DOUBLE_EQ(z, rpyQuaternion.z[i]);
+        EXPECT_DOUBLE_EQ(w, rpyQuaternion.w[i]);
+
+        double roll, pitch, yaw;
+        Rotation::axisToRpy(axis.x[i], axis.y[i], axis.z[i], roll, pitch, yaw);
+        EXPECT_DOUBLE_EQ(roll, axisRpy.x[i]);
+        EXPECT_DOUBLE_EQ(pitch, axisRpy.y[i]);
+        EXPECT_DOUBLE_EQ(yaw, axisRpy.z[i]);
+
+        double rx, ry, rz;
+        Rotation::rpyToAxis(rpy.x[i], rpy.y[i], rpy.z[i], rx, ry, rz);
+        EXPECT_DOUBLE_EQ(rx, rpyAxis.x[i]);
+        EXPECT_DOUBLE_EQ(ry, rpyAxis.y[i]);
+        EXPECT_DOUBLE_EQ(rz, rpyAxis.z[i]);
+    }
+}
@@ -0,0 +1,166 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Tests of the selection of the joint solutions of command list waypoints
+// ----------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+
+#include <waypoints.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace ur_driver;
+
+/**
+ * Joint positions of the robot away from the singularities [rad].
+ */
+static const double START[6] = {0.3, -1.2, 1.5, -1.9, -1.4, 0.2};
+
+//=================================================================
+// rejected waypoints
+//=================================================================
+TEST(WaypointSolver, Reachable)
+{
+    double q[6] = {0.5, -1.0, 1.2, -1.7, -1.2, 0.4};
+    double pose[6];
+    Ur5Kinematics::forward(q, pose);
+
+    std::vector<Waypoint> waypoints(2);
+    waypoints[0].setJoints(q, false);
+    waypoints[1].setPose(pose, true);
+
+    WaypointSolver solver(Kinematics::UR5, 1);
+    std::vector<WaypointSolution> solutions;
+    ASSERT_EQ(-1, solver.solve(waypoints, START, solutions));
+    ASSERT_EQ(2u, solutions.size());
+
+    //the linear move to the pose of the joints stays on their branch, at the joints themselves
+    EXPECT_EQ(WaypointSolution::OK, solutions[1].status);
+    EXPECT_EQ(Kinematics::getBranch(Kinematics::UR5, q), solutions[1].branch);
+    for (int j = 0; j < 6; j++)
+    {
+        EXPECT_NEAR(q[j], solutions[1].q[j], 1e-9) << "joint " << j;
+    }
+}
+
+TEST(WaypointSolver, Unreachable)
+{
+    //about three times the reach of the UR5
+    double pose[6] = {3.0, 0.0, 0.5, 0.0, 0.0, 0.0};
+
+    std::vector<Waypoint> waypoints(2);
+    waypoints[0].setJoints(START, false);
+    waypoints[1].setPose(pose, false);
+
+    WaypointSolver solver(Kinematics::UR5, 1);
+    std::vector<WaypointSolution> solutions;
+    EXPECT_EQ(1, solver.solve(waypoints, START, solutions));
+    EXPECT_EQ(WaypointSolution::OK, solutions[0].status);
+    EXPECT_EQ(WaypointSolution::UNREACHABLE, solutions[1].status);
+}
+
+/**
+ * Linear move (true) or joint move (false) from the start to the joints with a negated joint.
+ */
+static WaypointSolution::Status moveToFlipped(int joint, bool isLinear)
+{
+    double q[6];
+    std::copy(START, START + 6, q);
+    q[joint] = -q[joint];
+
+    std::vector<Waypoint> waypoints(1);
+    waypoints[0].setJoints(q, isLinear);
+
+    WaypointSolver solver(Kinematics::UR5, 1);
+    std::vector<WaypointSolution> solutions;
+    solver.solve(waypoints, START, solutions);
+    return solutions[0].status;
+}
+
+TEST(WaypointSolver, ElbowFlip)
+{
+    //sin(q3) changes the sign
+    EXPECT_EQ(WaypointSolution::BRANCH_FLIP, moveToFlipped(2, true));
+    EXPECT_EQ(WaypointSolution::OK, moveToFlipped(2, false));
+}
+
+TEST(WaypointSolver, WristFlip)
+{
+    //sin(q5) changes the sign
+    EXPECT_EQ(WaypointSolution::BRANCH_FLIP, moveToFlipped(4, true));
+    EXPECT_EQ(WaypointSolution::OK, moveToFlipped(4, false));
+}
+
+TEST(WaypointSolver, NotChecked)
+{
+    double pose[6] = {3.0, 0.0, 0.5, 0.0, 0.0, 0.0};
+
+    //after a velocity command the position is unknown, the unreachable pose is not rejected
+    std::vector<Waypoint> waypoints(2);
+    waypoints[1].setPose(pose, true);
+
+    WaypointSolver solver(Kinematics::UR5, 1);
+    std::vector<WaypointSolution> solutions;
+    EXPECT_EQ(-1, solver.solve(waypoints, START, solutions));
+    EXPECT_EQ(WaypointSolution::NOT_CHECKED, solutions[0].status);
+    EXPECT_EQ(WaypointSolution::NOT_CHECKED, solutions[1].status);
+}
+
+//=================================================================
+// threads
+//=================================================================
+TEST(WaypointSolver, ThreadsMatchSingleThread)
+{
+    //poses along a random joint walk, long enough for several threads
+    const size_t count = 4096;
+    unsigned int seed = 42;
+    double q[6];
+    std::copy(START, START + 6, q);
+
+    std::vector<Waypoint> waypoints(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        for (int j = 0; j < 6; j++)
+        {
+            q[j] += 0.002 * (-1.0 + 2.0 * rand_r(&seed) / (double)RAND_MAX);
+        }
+        double pose[6];
+        Ur5Kinematics::forward(q, pose);
+        waypoints[i].setPose(pose, true);
+    }
+
+    std::vector<WaypointSolution> expected;
+    std::vector<WaypointSolution> solutions;
+    EXPECT_EQ(-1, WaypointSolver(Kinematics::UR5, 1).solve(waypoints, START, expected));
+    EXPECT_EQ(-1, WaypointSolver(Kinematics::UR5, 4).solve(waypoints, START, solutions));
+    ASSERT_EQ(count, solutions.size());
+    for (size_t i = 0; i < count; i++)
+    {
+        ASSERT_EQ(expected[i].status, solutions[i].status) << "waypoint " << i;
+        ASSERT_EQ(expected[i].branch, solutions[i].branch) << "waypoint " << i;
+        for (int j = 0; j < 6; j++)
+        {
+            ASSERT_EQ(expected[i].q[j], solutions[i].q[j]) << "waypoint " << i << " joint " << j;
+        }
+    }
+
+    //the walk ends at its joints
+    for (int j = 0; j < 6; j++)
+    {
+        EXPECT_NEAR(q[j], solutions[count - 1].q[j], 1e-6) << "joint " << j;
+    }
+}
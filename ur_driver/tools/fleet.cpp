@@ -0,0 +1,287 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Resource use of several simulated robots in one process, with dedicated threads or a shared executor
+// ----------------------------------------------------------------------------
+
+#include <connector.h>
+#include <executor.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include <fstream>
+
+using namespace ur_driver;
+
+/**
+ * Counts the decoded robot states.
+ */
+class FleetListener
+{
+    public:
+        unsigned long robotStates;
+        boost::mutex mutexRobotStates;
+
+        FleetListener() :
+            robotStates(0)
+        {
+        }
+
+        void robotStateListener(const RobotState& robotState)
+        {
+            boost::lock_guard<boost::mutex> lock(mutexRobotStates);
+            robotStates++;
+        }
+};
+
+/**
+ * One simulated robot: dummy server, connector and the periodic command check of the driver.
+ */
+class FleetRobot
+{
+    public:
+        Dummy dummy;
+        Connector connector;
+        FleetListener listener;
+
+        bool runCommandThread;
+        boost::thread commandThread;
+        boost::shared_ptr<PeriodicTask> commandTask;
+        unsigned long commandSteps;
+
+        FleetRobot(int port, Transport::Type transport, Executor* executor) :
+            runCommandThread(true),
+            commandSteps(0)
+        {
+            dummy.setExecutor(executor);
+            dummy.start(port, false);
+
+            connector.setExecutor(executor);
+            connector.setTransport(transport, &dummy);
+            connector.addRobotStateListener(&FleetListener::robotStateListener, &listener);
+            connector.connect("127.0.0.1", port, false, 20);
+
+            //the command check of the driver runs at the read frequency
+            if (executor != NULL)
+            {
+                commandTask.reset(new PeriodicTask(executor, 20, boost::bind(&FleetRobot::commandStep, this)));
+                commandTask->start();
+            }
+            else
+            {
+                commandThread = boost::thread(&FleetRobot::commandWorker, this);
+            }
+        }
+
+        ~FleetRobot()
+        {
+            runCommandThread = false;
+            commandThread.join();
+            if (commandTask)
+            {
+                commandTask->stop();
+            }
+
+            connector.disconnect();
+            dummy.stop();
+        }
+
+        void commandWorker()
+        {
+            ClockRate rate(Clock::getWallClock(), 20);
+
+            while (runCommandThread)
+            {
+                commandStep();
+                rate.sleep();
+            }
+        }
+
+        void commandStep()
+        {
+            connector.addCommand(new CommandJointStop(1.0));
+            commandSteps++;
+        }
+};
+
+/**
+ * Read a value (in the unit of the kernel) from /proc/self/status.
+ * @param name
+ * @return
+ */
+static long readStatus(const std::string& name)
+{
+    std::ifstream file("/proc/self/status");
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.compare(0, name.size() + 1, name + ":") == 0)
+        {
+            return atol(line.c_str() + name.size() + 1);
+        }
+    }
+
+    return 0;
+}
+
+static double getCpuTime()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+}
+
+/**
+ * Run a fleet and print one line of results.
+ * @param robots
+ * @param executorThreads 0 for dedicated threads
+ * @param port
+ * @param transport
+ * @param duration
+ */
+static void runFleet(int robots, int executorThreads, int port, Transport::Type transport, double duration)
+{
+    long rssStart = readStatus("VmRSS");
+
+    boost::shared_ptr<Executor> executor;
+    if (executorThreads > 0)
+    {
+        executor.reset(new Executor(executorThreads));
+    }
+
+    std::vector<boost::shared_ptr<FleetRobot> > fleet;
+    for (int i = 0; i < robots; i++)
+    {
+        fleet.push_back(boost::make_shared<FleetRobot>(port, transport, executor.get()));
+    }
+
+    //let the connections settle, then measure
+    boost::this_thread::sleep(boost::posix_time::milliseconds(500));
+
+    unsigned long robotStatesStart = 0;
+    for (size_t i = 0; i < fleet.size(); i++)
+    {
+        boost::lock_guard<boost::mutex> lock(fleet[i]->listener.mutexRobotStates);
+        robotStatesStart += fleet[i]->listener.robotStates;
+    }
+    double cpuStart = getCpuTime();
+    ros::WallTime start = ros::WallTime::now();
+
+    boost::this_thread::sleep(boost::posix_time::microseconds((long)(duration * 1e6)));
+
+    double cpu = getCpuTime() - cpuStart;
+    double elapsed = (ros::WallTime::now() - start).toSec();
+    long threads = readStatus("Threads");
+    long rss = readStatus("VmRSS") - rssStart;
+
+    unsigned long robotStates = 0;
+    for (size_t i = 0; i < fleet.size(); i++)
+    {
+        boost::lock_guard<boost::mutex> lock(fleet[i]->listener.mutexRobotStates);
+        robotStates += fleet[i]->listener.robotStates;
+    }
+    robotStates -= robotStatesStart;
+
+    fleet.clear();
+    executor.reset();
+
+    printf("%-10s %6i %8li %8.1f %10.2f %10li %10.0f %12.0f\n",
+           (executorThreads > 0) ? "executor" : "threads",
+           robots,
+           threads,
+           100.0 * cpu / elapsed,
+           100.0 * cpu / elapsed / robots,
+           rss,
+           (double)rss / robots,
+           robotStates / elapsed / robots);
+    fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 5)
+    {
+        fprintf(stderr, "usage: %s [port] [duration] [executor threads] [transport]\n", argv[0]);
+        fprintf(stderr, "  port: 30003 (default) or 30002\n");
+        fprintf(stderr, "  duration: seconds per measurement (default 5)\n");
+        fprintf(stderr, "  executor threads: threads of the shared executor (default 2)\n");
+        fprintf(stderr, "  transport: memory (default) or unix, the dummy servers do not listen on the port\n");
+
+        return 1;
+    }
+
+    int port = (argc > 1) ? atoi(argv[1]) : Connector::REALTIME;
+    double duration = (argc > 2) ? atof(argv[2]) : 5.0;
+    int executorThreads = (argc > 3) ? atoi(argv[3]) : 2;
+    Transport::Type transport = Transport::MEMORY;
+
+    if (port != Connector::SECONDARY && port != Connector::REALTIME)
+    {
+        fprintf(stderr, "port %i not supported\n", port);
+
+        return 1;
+    }
+
+    if (argc > 4 && (!Transport::parseType(argv[4], transport) || transport == Transport::TCP))
+    {
+        fprintf(stderr, "transport %s not supported\n", argv[4]);
+
+        return 1;
+    }
+
+    if (executorThreads < 1)
+    {
+        fprintf(stderr, "at least one executor thread is needed\n");
+
+        return 1;
+    }
+
+    printf("%-10s %6s %8s %8s %10s %10s %10s %12s\n", "mode", "robots", "threads", "cpu%", "cpu%/robot", "rss[kB]", "rss/robot", "states/s/rob");
+    fflush(stdout);
+
+    //each measurement runs in its own process, threads and memory of the previous one do not count
+    int robotCounts[] = {1, 4, 16};
+    for (int i = 0; i < 3; i++)
+    {
+        for (int mode = 0; mode < 2; mode++)
+        {
+            pid_t pid = fork();
+            if (pid == 0)
+            {
+                runFleet(robotCounts[i], (mode == 0) ? 0 : executorThreads, port, transport, duration);
+
+                _exit(0);
+            }
+            else if (pid > 0)
+            {
+                waitpid(pid, NULL, 0);
+            }
+            else
+            {
+                perror("fork");
+
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
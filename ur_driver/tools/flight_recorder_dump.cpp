@@ -0,0 +1,89 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Exports a time window of a flight recorder file to CSV
+// ----------------------------------------------------------------------------
+
+#include <flight_recorder.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace ur_driver;
+
+int main(int argc, char **argv)
+{
+    if (argc < 2 || argc > 4)
+    {
+        fprintf(stderr, "usage: %s <file> [from] [to]\n", argv[0]);
+        fprintf(stderr, "  from, to: time window in seconds since epoch\n");
+
+        return 1;
+    }
+
+    double from = (argc > 2) ? atof(argv[2]) : 0;
+    double to = (argc > 3) ? atof(argv[3]) : 1e18;
+
+    FlightRecorderReader reader;
+    if (!reader.open(argv[1]))
+    {
+        fprintf(stderr, "%s is not a valid flight recorder file\n", argv[1]);
+
+        return 1;
+    }
+
+    printf("sequence,timestamp,type,source,length,data\n");
+
+    FlightRecorderRecord record;
+    while (reader.next(record))
+    {
+        double timestamp = record.timestamp * 1e-9;
+        if (timestamp < from || timestamp > to)
+        {
+            continue;
+        }
+
+        printf("%llu,%.9f,%s,%u,%u,", (unsigned long long)record.sequence, timestamp,
+               (record.type == FlightRecorderRecordHeader::SCRIPT) ? "script" : (record.type == FlightRecorderRecordHeader::DISCARDED) ? "discarded" : "frame",
+               record.source, (unsigned int)record.data.size());
+
+        if (record.type == FlightRecorderRecordHeader::SCRIPT)
+        {
+            //script as quoted text, line breaks escaped
+            putchar('"');
+            for (size_t i = 0; i < record.data.size(); i++)
+            {
+                char c = record.data[i];
+                if (c == '"') printf("\"\"");
+                else if (c == '\n') printf("\\n");
+                else if (c == '\r') printf("\\r");
+                else putchar(c);
+            }
+            putchar('"');
+        }
+        else
+        {
+            //frame or discarded bytes as hex string
+            for (size_t i = 0; i < record.data.size(); i++)
+            {
+                printf("%02x", (unsigned char)record.data[i]);
+            }
+        }
+
+        putchar('\n');
+    }
+
+    return 0;
+}
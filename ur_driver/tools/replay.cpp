@@ -0,0 +1,102 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// ----------------------------------------------------------------------------
+// Replays recorded robot controller data through the connector and reports the throughput
+// ----------------------------------------------------------------------------
+
+#include <replay.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace ur_driver;
+
+/**
+ * Counts the decoded robot states and keeps the last one.
+ */
+class ReplayListener
+{
+    public:
+        unsigned long robotStates;
+        RobotState lastRobotState;
+
+        ReplayListener() :
+            robotStates(0)
+        {
+        }
+
+        void robotStateListener(const RobotState& robotState)
+        {
+            robotStates++;
+            lastRobotState = robotState;
+        }
+};
+
+int main(int argc, char **argv)
+{
+    if (argc < 2 || argc > 4)
+    {
+        fprintf(stderr, "usage: %s <file> [speed] [port]\n", argv[0]);
+        fprintf(stderr, "  speed: 1 replays in real time (default), 0 as fast as possible\n");
+        fprintf(stderr, "  port: 30002 or 30003 if the file is a raw capture of the socket, otherwise a flight recorder file is expected\n");
+
+        return 1;
+    }
+
+    double speed = (argc > 2) ? atof(argv[2]) : 1.0;
+    int port = (argc > 3) ? atoi(argv[3]) : 0;
+
+    Replay replay;
+    if (port != 0 ? !replay.loadStream(argv[1], port) : !replay.loadFlightRecord(argv[1]))
+    {
+        return 1;
+    }
+
+    Connector connector;
+    ReplayListener listener;
+    connector.addRobotStateListener(&ReplayListener::robotStateListener, &listener);
+
+    ros::WallTime start = ros::WallTime::now();
+    replay.run(connector, speed);
+    double elapsed = (ros::WallTime::now() - start).toSec();
+
+    connector.removeRobotStateListener(&ReplayListener::robotStateListener, &listener);
+
+    printf("chunks:       %lu\n", (unsigned long)replay.getChunkCount());
+    printf("bytes:        %llu\n", (unsigned long long)replay.getByteCount());
+    ConnectorStatistics statistics = connector.getStatistics();
+    printf("robot states: %lu\n", listener.robotStates);
+    printf("skipped:      %llu (other message types)\n", statistics.skippedMessages);
+    printf("errors:       %llu (corrupt frames), %llu resyncs, %llu bytes discarded\n", statistics.decodeErrors, statistics.resyncs, statistics.discardedBytes);
+    printf("recorded:     %.3f s\n", replay.getDuration());
+    printf("replayed:     %.3f s\n", elapsed);
+    if (elapsed > 0)
+    {
+        printf("throughput:   %.0f states/s, %.1f MB/s\n", listener.robotStates / elapsed, replay.getByteCount() / elapsed / 1e6);
+    }
+
+    if (listener.robotStates > 0)
+    {
+        const std::vector<double>& jointPosition = listener.lastRobotState.getJointPosition().getValues();
+        printf("last joint position:");
+        for (size_t i = 0; i < jointPosition.size(); i++)
+        {
+            printf(" %.6f", jointPosition[i]);
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
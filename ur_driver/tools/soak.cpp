@@ -0,0 +1,215 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// Soak test of a pick and place cycle against the dummy server on a simulated or the wall clock
+// ----------------------------------------------------------------------------
+
+#include <connector.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+using namespace ur_driver;
+
+/**
+ * Keeps the last robot state and a checksum of all received joint positions.
+ */
+class SoakListener
+{
+    public:
+        unsigned long robotStates;
+        uint64_t checksum;
+        RobotState lastRobotState;
+        boost::mutex mutexRobotState;
+
+        SoakListener() :
+            robotStates(0),
+            checksum(14695981039346656037ULL)
+        {
+        }
+
+        void robotStateListener(const RobotState& robotState)
+        {
+            boost::lock_guard<boost::mutex> lock(mutexRobotState);
+
+            robotStates++;
+            lastRobotState = robotState;
+
+            //FNV-1a over the joint positions
+            const std::vector<double>& jointPosition = lastRobotState.getJointPosition().getValues();
+            const unsigned char* bytes = (const unsigned char*)&jointPosition[0];
+            for (size_t i = 0; i < jointPosition.size() * sizeof(double); i++)
+            {
+                checksum = (checksum ^ bytes[i]) * 1099511628211ULL;
+            }
+        }
+
+        bool isReached(JointPosition& target)
+        {
+            boost::lock_guard<boost::mutex> lock(mutexRobotState);
+
+            for (int i = 0; i < 6; i++)
+            {
+                if (fabs(lastRobotState.getJointPosition()[i] - target[i]) > 0.001)
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        bool isOutputSet(int output, bool value)
+        {
+            boost::lock_guard<boost::mutex> lock(mutexRobotState);
+
+            return lastRobotState.get_IO(output) == value;
+        }
+};
+
+/**
+ * Wait on the clock until the robot reached the target or the output has the value.
+ * @param clock
+ * @param listener
+ * @param target Target joint position, NULL to wait for the output.
+ * @param output
+ * @param value
+ * @return false on timeout
+ */
+static bool waitFor(Clock* clock, SoakListener& listener, JointPosition* target, int output, bool value)
+{
+    ClockRate rate(clock, 125);
+    double timeout = clock->now() + 30;
+
+    while (target != NULL ? !listener.isReached(*target) : !listener.isOutputSet(output, value))
+    {
+        if (clock->now() > timeout)
+        {
+            return false;
+        }
+
+        rate.sleep();
+    }
+
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 5)
+    {
+        fprintf(stderr, "usage: %s [cycles] [clock] [port] [transport]\n", argv[0]);
+        fprintf(stderr, "  cycles: pick and place cycles (default 10)\n");
+        fprintf(stderr, "  clock: simulated (default) or wall\n");
+        fprintf(stderr, "  port: 30002 (default) or 30003 (no digital outputs, the gripper waits time out)\n");
+        fprintf(stderr, "  transport: tcp (default), unix or memory\n");
+
+        return 1;
+    }
+
+    int cycles = (argc > 1) ? atoi(argv[1]) : 10;
+    bool isSimulated = (argc > 2) ? strcmp(argv[2], "wall") != 0 : true;
+    int port = (argc > 3) ? atoi(argv[3]) : Connector::SECONDARY;
+    Transport::Type transport = Transport::TCP;
+
+    if (argc > 4 && !Transport::parseType(argv[4], transport))
+    {
+        fprintf(stderr, "transport %s not supported\n", argv[4]);
+
+        return 1;
+    }
+
+    SimulatedClock simulatedClock;
+    Clock* clock = isSimulated ? (Clock*)&simulatedClock : Clock::getWallClock();
+
+    //the main thread holds the time until the connection is established
+    clock->addParticipant();
+
+    Dummy dummy;
+    dummy.setClock(clock);
+    dummy.start(port, transport == Transport::TCP);
+
+    Connector connector;
+    SoakListener listener;
+    connector.setClock(clock);
+    connector.setTransport(transport, &dummy);
+    connector.addRobotStateListener(&SoakListener::robotStateListener, &listener);
+    connector.connect("127.0.0.1", port, false, 125);
+
+    while (connector.getStatistics().connections == 0 || dummy.getStatistics().clients == 0)
+    {
+        boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+    }
+
+    //pick and place: approach, pick (output 0 on), retract, approach, place (output 0 off), retract
+    const int OUTPUT = 18;
+    JointPosition targets[6];
+    targets[0].setValues(6, 0.0, -1.2, 1.2, -1.57, -1.57, 0.0);
+    targets[1].setValues(6, 0.0, -1.0, 1.3, -1.87, -1.57, 0.0);
+    targets[2].setValues(6, 0.0, -1.2, 1.2, -1.57, -1.57, 0.0);
+    targets[3].setValues(6, 1.57, -1.2, 1.2, -1.57, -1.57, 0.0);
+    targets[4].setValues(6, 1.57, -1.0, 1.3, -1.87, -1.57, 0.0);
+    targets[5].setValues(6, 1.57, -1.2, 1.2, -1.57, -1.57, 0.0);
+    bool gripper[6] = {false, true, true, true, false, false};
+
+    double simulatedStart = clock->now();
+    double wallStart = Clock::getWallClock()->now();
+    int timeouts = 0;
+
+    for (int cycle = 0; cycle < cycles; cycle++)
+    {
+        for (int i = 0; i < 6; i++)
+        {
+            //a new script replaces the running program, set the gripper after the move
+            connector.addCommand(new CommandJointPosition(targets[i], 1.05, 1.4));
+            if (!waitFor(clock, listener, &targets[i], OUTPUT, gripper[i]))
+            {
+                timeouts++;
+            }
+
+            connector.addCommand(new CommandDigitalIO(OUTPUT, gripper[i]));
+            if (!waitFor(clock, listener, NULL, OUTPUT, gripper[i]))
+            {
+                timeouts++;
+            }
+        }
+    }
+
+    double simulatedTime = clock->now() - simulatedStart;
+    double wallTime = Clock::getWallClock()->now() - wallStart;
+
+    listener.mutexRobotState.lock();
+    unsigned long robotStates = listener.robotStates;
+    uint64_t checksum = listener.checksum;
+    listener.mutexRobotState.unlock();
+
+    clock->removeParticipant();
+    connector.disconnect();
+    connector.removeRobotStateListener(&SoakListener::robotStateListener, &listener);
+    dummy.stop();
+
+    printf("cycles:       %i\n", cycles);
+    printf("clock:        %s\n", isSimulated ? "simulated" : "wall");
+    printf("cycle time:   %.3f s\n", simulatedTime / cycles);
+    printf("robot time:   %.3f s\n", simulatedTime);
+    printf("wall time:    %.3f s\n", wallTime);
+    printf("speedup:      %.1f\n", (wallTime > 0) ? simulatedTime / wallTime : 0.0);
+    printf("robot states: %lu\n", robotStates);
+    printf("timeouts:     %i\n", timeouts);
+    printf("checksum:     %016llx\n", (unsigned long long)checksum);
+
+    return (timeouts > 0) ? 1 : 0;
+}
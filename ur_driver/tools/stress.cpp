@@ -0,0 +1,200 @@
+// ----------------------------------------------------------------------------
+// Copyright 2015 Fraunhofer IPA
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// Stress test of the connector against the dummy server with generated load and faults
+// ----------------------------------------------------------------------------
+
+#include <connector.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace ur_driver;
+
+/**
+ * Counts the decoded robot states.
+ */
+class StressListener
+{
+    public:
+        unsigned long robotStates;
+        boost::mutex mutexRobotStates;
+
+        StressListener() :
+            robotStates(0)
+        {
+        }
+
+        void robotStateListener(const RobotState& robotState)
+        {
+            boost::lock_guard<boost::mutex> lock(mutexRobotStates);
+            robotStates++;
+        }
+};
+
+/**
+ * Named load of the dummy server.
+ */
+class StressScenario
+{
+    public:
+        std::string name;
+        DummyLoad load;
+
+        StressScenario(const std::string& name, const DummyLoad& load) :
+            name(name),
+            load(load)
+        {
+        }
+};
+
+static std::vector<StressScenario> createScenarios(double frequency)
+{
+    std::vector<StressScenario> scenarios;
+    DummyLoad load;
+
+    scenarios.push_back(StressScenario("native rate", load));
+
+    load.frequency = frequency;
+    scenarios.push_back(StressScenario("high rate", load));
+
+    DummyLoad fragmented = load;
+    fragmented.fragmentSize = 64;
+    scenarios.push_back(StressScenario("fragmented", fragmented));
+
+    DummyLoad coalesced = load;
+    coalesced.coalesceFrames = 16;
+    scenarios.push_back(StressScenario("coalesced", coalesced));
+
+    DummyLoad truncated = load;
+    truncated.truncateProbability = 0.001;
+    scenarios.push_back(StressScenario("truncated", truncated));
+
+    DummyLoad corrupt = load;
+    corrupt.corruptProbability = 0.01;
+    scenarios.push_back(StressScenario("corrupt", corrupt));
+
+    DummyLoad stalls = load;
+    stalls.stallProbability = 0.001;
+    stalls.stallDuration = 0.2;
+    scenarios.push_back(StressScenario("stalls", stalls));
+
+    DummyLoad disconnects = load;
+    disconnects.disconnectProbability = 0.0005;
+    scenarios.push_back(StressScenario("disconnects", disconnects));
+
+    return scenarios;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 6)
+    {
+        fprintf(stderr, "usage: %s [port] [duration] [clients] [frequency] [transport]\n", argv[0]);
+        fprintf(stderr, "  port: 30002 (default) or 30003\n");
+        fprintf(stderr, "  duration: seconds per scenario (default 5)\n");
+        fprintf(stderr, "  clients: number of simultaneous connections (default 4)\n");
+        fprintf(stderr, "  frequency: frames per second and client of the high rate scenarios (default 2000)\n");
+        fprintf(stderr, "  transport: tcp (default), unix or memory\n");
+
+        return 1;
+    }
+
+    int port = (argc > 1) ? atoi(argv[1]) : Connector::SECONDARY;
+    double duration = (argc > 2) ? atof(argv[2]) : 5.0;
+    int clients = (argc > 3) ? atoi(argv[3]) : 4;
+    double frequency = (argc > 4) ? atof(argv[4]) : 2000.0;
+    Transport::Type transport = Transport::TCP;
+
+    if (port != Connector::SECONDARY && port != Connector::REALTIME)
+    {
+        fprintf(stderr, "port %i not supported\n", port);
+
+        return 1;
+    }
+
+    if (argc > 5 && !Transport::parseType(argv[5], transport))
+    {
+        fprintf(stderr, "transport %s not supported\n", argv[5]);
+
+        return 1;
+    }
+
+    printf("%-12s %10s %10s %10s %8s %7s %8s %10s %8s %8s %10s %6s %6s %6s\n", "scenario", "sent", "received", "states/s", "MB/s",
+           "lost%", "resyncs", "discarded", "errors", "skipped", "reconnects", "trunc", "corr", "stalls");
+
+    std::vector<StressScenario> scenarios = createScenarios(frequency);
+    for (size_t i = 0; i < scenarios.size(); i++)
+    {
+        Dummy dummy;
+        dummy.setLoad(scenarios[i].load);
+        dummy.start(port, transport == Transport::TCP);
+
+        //wait for the server socket
+        boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+
+        std::vector<boost::shared_ptr<Connector> > connectors;
+        StressListener listener;
+        for (int j = 0; j < clients; j++)
+        {
+            boost::shared_ptr<Connector> connector(new Connector());
+            connector->setTransport(transport, &dummy);
+            connector->addRobotStateListener(&StressListener::robotStateListener, &listener);
+            connector->connect("127.0.0.1", port, false, 125);
+            connectors.push_back(connector);
+        }
+
+        ros::WallTime start = ros::WallTime::now();
+        boost::this_thread::sleep(boost::posix_time::microseconds((long)(duration * 1e6)));
+
+        ConnectorStatistics received;
+        for (size_t j = 0; j < connectors.size(); j++)
+        {
+            connectors[j]->disconnect();
+
+            ConnectorStatistics statistics = connectors[j]->getStatistics();
+            received.bytes += statistics.bytes;
+            received.frames += statistics.frames;
+            received.robotStates += statistics.robotStates;
+            received.decodeErrors += statistics.decodeErrors;
+            received.skippedMessages += statistics.skippedMessages;
+            received.resyncs += statistics.resyncs;
+            received.discardedBytes += statistics.discardedBytes;
+            received.connections += statistics.connections;
+        }
+        double elapsed = (ros::WallTime::now() - start).toSec();
+
+        dummy.stop();
+        DummyStatistics sent = dummy.getStatistics();
+
+        printf("%-12s %10llu %10lu %10.0f %8.2f %7.2f %8llu %10llu %8llu %8llu %10llu %6llu %6llu %6llu\n",
+               scenarios[i].name.c_str(),
+               sent.frames,
+               listener.robotStates,
+               listener.robotStates / elapsed,
+               received.bytes / elapsed / 1e6,
+               (sent.frames > 0) ? 100.0 * ((double)sent.frames - listener.robotStates) / sent.frames : 0.0,
+               received.resyncs,
+               received.discardedBytes,
+               received.decodeErrors,
+               received.skippedMessages,
+               (received.connections > (unsigned long long)clients) ? received.connections - clients : 0,
+               sent.truncatedFrames,
+               sent.corruptFrames,
+               sent.stalls);
+        fflush(stdout);
+    }
+
+    return 0;
+}